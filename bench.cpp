@@ -1,10 +1,23 @@
 #include <thh-packed-hashtable/packed-hashtable.hpp>
+#include <thh-packed-hashtable/checkpoint.hpp>
+#include <thh-packed-hashtable/expiring-hashtable.hpp>
+#include <thh-packed-hashtable/frozen.hpp>
+#include <thh-packed-hashtable/packed-cache.hpp>
+#include <thh-packed-hashtable/shared-hashtable.hpp>
+#include <thh-packed-hashtable/snapshot.hpp>
 
 #include <absl/container/flat_hash_map.h>
 #include <benchmark/benchmark.h>
 #include <robin_hood.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <memory_resource>
 #include <random>
 
 // c++20 erase_if stand-in
@@ -39,6 +52,29 @@ struct object_t
   char data_[Size];
 };
 
+// object_t with a user provided move constructor and destructor, it is not
+// trivially copyable so the packed hashtable cannot use its trivially
+// relocatable fast paths (values are moved and destroyed one at a time)
+template<int32_t Size>
+struct non_relocatable_object_t : object_t<Size>
+{
+  non_relocatable_object_t() = default;
+  non_relocatable_object_t(const non_relocatable_object_t&) = default;
+  non_relocatable_object_t(non_relocatable_object_t&& other) noexcept
+    : object_t<Size>(other)
+  {
+    other.data_[0] = 0;
+  }
+  non_relocatable_object_t& operator=(
+    const non_relocatable_object_t&) = default;
+  non_relocatable_object_t& operator=(non_relocatable_object_t&&) = default;
+  ~non_relocatable_object_t() {}
+};
+
+static_assert(
+  !thh::is_trivially_relocatable_v<non_relocatable_object_t<4096>>,
+  "non_relocatable_object_t must not use the trivially relocatable paths");
+
 struct vec3_t
 {
   float x, y, z;
@@ -322,6 +358,126 @@ BENCHMARK(iterate_particle_t_in_unordered_map_by_key_value_pair)
   ->RangeMultiplier(2)
   ->Range(32, 8 << 13);
 
+// iterate the packed hashtable (with reverse lookup) using value iteration,
+// copying the key of each element with key_from_index
+static void iterate_particle_t_in_packed_hashtable_rl_by_key_from_index(
+  benchmark::State& state)
+{
+  thh::packed_hashtable_rl_t<std::string, particle_t>
+    packed_hashtable_particles;
+  packed_hashtable_particles.reserve(static_cast<int32_t>(state.range(0)));
+  for (int i = 0; i < state.range(0); ++i) {
+    packed_hashtable_particles.add(
+      {std::string("name") + std::to_string(i), particle_t{}});
+  }
+
+  for ([[maybe_unused]] auto _ : state) {
+    std::size_t key_bytes = 0;
+    for (int32_t index = 0; index < packed_hashtable_particles.size();
+         ++index) {
+      key_bytes += packed_hashtable_particles.key_from_index(index)->size();
+    }
+    for (auto& particle : packed_hashtable_particles.value_iteration()) {
+      particle.position_.x += particle.velocity_.x;
+    }
+    benchmark::DoNotOptimize(key_bytes);
+    benchmark::DoNotOptimize(packed_hashtable_particles);
+  }
+}
+
+BENCHMARK(iterate_particle_t_in_packed_hashtable_rl_by_key_from_index)
+  ->RangeMultiplier(2)
+  ->Range(32, 8 << 13);
+
+// iterate the packed hashtable (with reverse lookup) using key/value iteration
+// (no hashing and no key copies)
+static void iterate_particle_t_in_packed_hashtable_rl_by_key_value_pair(
+  benchmark::State& state)
+{
+  thh::packed_hashtable_rl_t<std::string, particle_t>
+    packed_hashtable_particles;
+  packed_hashtable_particles.reserve(static_cast<int32_t>(state.range(0)));
+  for (int i = 0; i < state.range(0); ++i) {
+    packed_hashtable_particles.add(
+      {std::string("name") + std::to_string(i), particle_t{}});
+  }
+
+  for ([[maybe_unused]] auto _ : state) {
+    std::size_t key_bytes = 0;
+    for (auto [key, particle] : packed_hashtable_particles.kv_iteration()) {
+      key_bytes += key.size();
+      particle.position_.x += particle.velocity_.x;
+    }
+    benchmark::DoNotOptimize(key_bytes);
+    benchmark::DoNotOptimize(packed_hashtable_particles);
+  }
+}
+
+BENCHMARK(iterate_particle_t_in_packed_hashtable_rl_by_key_value_pair)
+  ->RangeMultiplier(2)
+  ->Range(32, 8 << 13);
+
+// iterate the packed hashtable (with reverse lookup) using handle iteration
+// (key index order), reading the key and updating the value of each element
+static void iterate_particle_t_in_packed_hashtable_rl_by_handle(
+  benchmark::State& state)
+{
+  thh::packed_hashtable_rl_t<std::string, particle_t>
+    packed_hashtable_particles;
+  packed_hashtable_particles.reserve(static_cast<int32_t>(state.range(0)));
+  for (int i = 0; i < state.range(0); ++i) {
+    packed_hashtable_particles.add(
+      {std::string("name") + std::to_string(i), particle_t{}});
+  }
+
+  for ([[maybe_unused]] auto _ : state) {
+    std::size_t key_bytes = 0;
+    for (const auto& [key, handle] :
+         packed_hashtable_particles.handle_iteration()) {
+      key_bytes += key.size();
+      packed_hashtable_particles.call(handle, [](particle_t& particle) {
+        particle.position_.x += particle.velocity_.x;
+      });
+    }
+    benchmark::DoNotOptimize(key_bytes);
+    benchmark::DoNotOptimize(packed_hashtable_particles);
+  }
+}
+
+BENCHMARK(iterate_particle_t_in_packed_hashtable_rl_by_handle)
+  ->RangeMultiplier(2)
+  ->Range(32, 8 << 13);
+
+// iterate the packed hashtable (with reverse lookup) using dense iteration
+// (value order), reading the key and updating the value of each element
+static void iterate_particle_t_in_packed_hashtable_rl_by_dense_handle(
+  benchmark::State& state)
+{
+  thh::packed_hashtable_rl_t<std::string, particle_t>
+    packed_hashtable_particles;
+  packed_hashtable_particles.reserve(static_cast<int32_t>(state.range(0)));
+  for (int i = 0; i < state.range(0); ++i) {
+    packed_hashtable_particles.add(
+      {std::string("name") + std::to_string(i), particle_t{}});
+  }
+
+  for ([[maybe_unused]] auto _ : state) {
+    std::size_t key_bytes = 0;
+    for (auto [key, handle, particle] :
+         packed_hashtable_particles.dense_iteration()) {
+      key_bytes += key.size();
+      benchmark::DoNotOptimize(handle);
+      particle.position_.x += particle.velocity_.x;
+    }
+    benchmark::DoNotOptimize(key_bytes);
+    benchmark::DoNotOptimize(packed_hashtable_particles);
+  }
+}
+
+BENCHMARK(iterate_particle_t_in_packed_hashtable_rl_by_dense_handle)
+  ->RangeMultiplier(2)
+  ->Range(32, 8 << 13);
+
 static void add_particle_t_in_packed_hashtable(benchmark::State& state)
 {
   thh::packed_hashtable_t<int64_t, particle_t> packed_hashtable_particles;
@@ -367,6 +523,982 @@ BENCHMARK(add_particle_t_in_unordered_map)
   ->RangeMultiplier(2)
   ->Range(32, 8 << 13);
 
+// build and discard a packed hashtable each iteration (e.g. per frame) using
+// the default allocator
+static void add_particle_t_per_frame_in_packed_hashtable(
+  benchmark::State& state)
+{
+  for ([[maybe_unused]] auto _ : state) {
+    thh::packed_hashtable_t<int64_t, particle_t> packed_hashtable_particles;
+    packed_hashtable_particles.reserve(static_cast<int32_t>(state.range(0)));
+    for (int i = 0; i < state.range(0); ++i) {
+      packed_hashtable_particles.add({i, particle_t{}});
+    }
+    benchmark::DoNotOptimize(packed_hashtable_particles);
+  }
+}
+
+BENCHMARK(add_particle_t_per_frame_in_packed_hashtable)
+  ->RangeMultiplier(2)
+  ->Range(32, 8 << 13);
+
+// build and discard a packed hashtable each iteration (e.g. per frame) using
+// a monotonic arena that is reset (not freed) at the end of each frame
+static void add_particle_t_per_frame_in_pmr_packed_hashtable(
+  benchmark::State& state)
+{
+  std::vector<std::byte> buffer(
+    static_cast<size_t>(state.range(0)) * (sizeof(particle_t) + 128));
+  for ([[maybe_unused]] auto _ : state) {
+    std::pmr::monotonic_buffer_resource resource(
+      buffer.data(), buffer.size());
+    thh::pmr::packed_hashtable_t<int64_t, particle_t>
+      packed_hashtable_particles(&resource);
+    packed_hashtable_particles.reserve(static_cast<int32_t>(state.range(0)));
+    for (int i = 0; i < state.range(0); ++i) {
+      packed_hashtable_particles.add({i, particle_t{}});
+    }
+    benchmark::DoNotOptimize(packed_hashtable_particles);
+  }
+}
+
+BENCHMARK(add_particle_t_per_frame_in_pmr_packed_hashtable)
+  ->RangeMultiplier(2)
+  ->Range(32, 8 << 13);
+
+// add elements to an empty packed hashtable (no reserve, so values are
+// relocated each time the storage grows)
+template<typename T>
+static void add_object_t_in_packed_hashtable(benchmark::State& state)
+{
+  for ([[maybe_unused]] auto _ : state) {
+    thh::packed_hashtable_t<int64_t, T> packed_hashtable;
+    for (int i = 0; i < state.range(0); ++i) {
+      packed_hashtable.add({i, T{}});
+    }
+    benchmark::DoNotOptimize(packed_hashtable);
+  }
+}
+
+BENCHMARK_TEMPLATE(add_object_t_in_packed_hashtable, object_t<4096>)
+  ->RangeMultiplier(2)
+  ->Range(32, 8 << 10);
+BENCHMARK_TEMPLATE(
+  add_object_t_in_packed_hashtable, non_relocatable_object_t<4096>)
+  ->RangeMultiplier(2)
+  ->Range(32, 8 << 10);
+
+// remove every other element from the packed hashtable by key (the last value
+// is relocated into the position of each removed value)
+template<typename T>
+static void remove_object_t_in_packed_hashtable(benchmark::State& state)
+{
+  for ([[maybe_unused]] auto _ : state) {
+    state.PauseTiming();
+    thh::packed_hashtable_t<int64_t, T> packed_hashtable;
+    packed_hashtable.reserve(static_cast<int32_t>(state.range(0)));
+    for (int i = 0; i < state.range(0); ++i) {
+      packed_hashtable.add({i, T{}});
+    }
+    state.ResumeTiming();
+    for (int i = 0; i < state.range(0); i += 2) {
+      packed_hashtable.remove(i);
+    }
+    benchmark::DoNotOptimize(packed_hashtable);
+  }
+}
+
+BENCHMARK_TEMPLATE(remove_object_t_in_packed_hashtable, object_t<4096>)
+  ->RangeMultiplier(2)
+  ->Range(32, 8 << 10);
+BENCHMARK_TEMPLATE(
+  remove_object_t_in_packed_hashtable, non_relocatable_object_t<4096>)
+  ->RangeMultiplier(2)
+  ->Range(32, 8 << 10);
+
+// remove every other particle while iterating (note: uses reverse lookup -
+// packed_hashtable_rl_t), with deferred_removal_policy_t values are removed
+// in place during dense iteration and compacted once afterwards, otherwise
+// remove_when relocates the last value into each hole as it goes
+template<typename Policy>
+static void remove_particle_t_in_packed_hashtable_rl_while_iterating(
+  benchmark::State& state)
+{
+  using packed_hashtable_t = thh::packed_hashtable_rl_t<
+    int64_t, particle_t, std::hash<int64_t>, std::equal_to<int64_t>,
+    thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int64_t, particle_t>>, Policy>;
+  for ([[maybe_unused]] auto _ : state) {
+    state.PauseTiming();
+    packed_hashtable_t packed_hashtable_particles;
+    packed_hashtable_particles.reserve(static_cast<int32_t>(state.range(0)));
+    for (int i = 0; i < state.range(0); ++i) {
+      auto particle = particle_t{};
+      particle.lifetime_ = i % 2 == 0 ? 1.0f : 0.0f;
+      packed_hashtable_particles.add({i, particle});
+    }
+    state.ResumeTiming();
+    if constexpr (packed_hashtable_t::deferred_removal_v) {
+      for (const auto& [key, handle, particle] :
+           packed_hashtable_particles.dense_iteration()) {
+        if (particle.lifetime_ <= 0.0f) {
+          packed_hashtable_particles.remove(handle);
+        }
+      }
+      packed_hashtable_particles.compact_removals();
+    } else {
+      thh::remove_when(packed_hashtable_particles, [](const auto& particle) {
+        return particle.lifetime_ <= 0.0f;
+      });
+    }
+    benchmark::DoNotOptimize(packed_hashtable_particles);
+  }
+}
+
+BENCHMARK_TEMPLATE(
+  remove_particle_t_in_packed_hashtable_rl_while_iterating,
+  thh::packed_hashtable_policy_t)
+  ->RangeMultiplier(8)
+  ->Range(1 << 10, 1 << 19);
+BENCHMARK_TEMPLATE(
+  remove_particle_t_in_packed_hashtable_rl_while_iterating,
+  thh::deferred_removal_policy_t<>)
+  ->RangeMultiplier(8)
+  ->Range(1 << 10, 1 << 19);
+
+// adds state.range(0) values to an empty packed hashtable each iteration and
+// returns the latency (in nanoseconds) of every add
+template<typename Value, typename Policy>
+static std::vector<int64_t> record_add_latencies(benchmark::State& state)
+{
+  using clock = std::chrono::steady_clock;
+  std::vector<int64_t> latencies;
+  latencies.reserve(state.range(0));
+  for ([[maybe_unused]] auto _ : state) {
+    thh::packed_hashtable_t<
+      int64_t, Value, std::hash<int64_t>, std::equal_to<int64_t>,
+      thh::packed_hashtable_tag_t,
+      std::allocator<std::pair<const int64_t, Value>>, Policy>
+      packed_hashtable;
+    for (int i = 0; i < state.range(0); ++i) {
+      const auto begin = clock::now();
+      packed_hashtable.add({i, Value{}});
+      latencies.push_back(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+          clock::now() - begin)
+          .count());
+    }
+    benchmark::DoNotOptimize(packed_hashtable);
+  }
+  std::sort(latencies.begin(), latencies.end());
+  return latencies;
+}
+
+// reports the tail (p99, p99.9 and max) of sorted latencies as counters
+static void report_tail_latencies(
+  benchmark::State& state, const std::vector<int64_t>& latencies)
+{
+  const auto percentile = [&latencies](const double p) {
+    return static_cast<double>(
+      latencies[static_cast<size_t>(p * (latencies.size() - 1))]);
+  };
+  state.counters["p99_ns"] = percentile(0.99);
+  state.counters["p999_ns"] = percentile(0.999);
+  state.counters["max_ns"] = static_cast<double>(latencies.back());
+}
+
+// records the latency of every add to an empty packed hashtable and reports
+// the tail (p99, p99.9 and max) as counters, growth of the default storage
+// relocates every value while segmented storage only appends a chunk
+template<typename Policy>
+static void add_object_t_tail_latency_in_packed_hashtable(
+  benchmark::State& state)
+{
+  report_tail_latencies(
+    state, record_add_latencies<object_t<1024>, Policy>(state));
+}
+
+BENCHMARK_TEMPLATE(
+  add_object_t_tail_latency_in_packed_hashtable, thh::packed_hashtable_policy_t)
+  ->RangeMultiplier(4)
+  ->Range(1 << 10, 1 << 18);
+BENCHMARK_TEMPLATE(
+  add_object_t_tail_latency_in_packed_hashtable, thh::segmented_policy_t<>)
+  ->RangeMultiplier(4)
+  ->Range(1 << 10, 1 << 18);
+
+// records the latency of every add of a small value to an empty packed
+// hashtable and reports a histogram (number of adds per latency decade) and
+// the tail as counters, growth of std::unordered_map rehashes every key at
+// once while the incremental index migrates a few buckets per add
+template<typename Policy>
+static void add_particle_t_latency_histogram_in_packed_hashtable(
+  benchmark::State& state)
+{
+  const auto latencies = record_add_latencies<particle_t, Policy>(state);
+  const auto count_below = [&latencies](const int64_t ns) {
+    return static_cast<double>(std::distance(
+      latencies.begin(),
+      std::lower_bound(latencies.begin(), latencies.end(), ns)));
+  };
+  const auto total = static_cast<double>(latencies.size());
+  state.counters["lt_100ns"] = count_below(100);
+  state.counters["lt_1us"] = count_below(1'000) - count_below(100);
+  state.counters["lt_10us"] = count_below(10'000) - count_below(1'000);
+  state.counters["lt_100us"] = count_below(100'000) - count_below(10'000);
+  state.counters["ge_100us"] = total - count_below(100'000);
+  report_tail_latencies(state, latencies);
+}
+
+BENCHMARK_TEMPLATE(
+  add_particle_t_latency_histogram_in_packed_hashtable,
+  thh::segmented_policy_t<>)
+  ->RangeMultiplier(4)
+  ->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(
+  add_particle_t_latency_histogram_in_packed_hashtable,
+  thh::incremental_rehash_policy_t<8, thh::segmented_policy_t<>>)
+  ->RangeMultiplier(4)
+  ->Range(1 << 12, 1 << 20);
+
+// builds a packed hashtable with add (e.g. from the source of truth on
+// restart) and reads every value
+static void rebuild_particle_t_packed_hashtable_with_add(
+  benchmark::State& state)
+{
+  for ([[maybe_unused]] auto _ : state) {
+    thh::packed_hashtable_t<int64_t, particle_t> packed_hashtable_particles;
+    for (int i = 0; i < state.range(0); ++i) {
+      packed_hashtable_particles.add({i, particle_t{}});
+    }
+    float lifetime = 0.0f;
+    for (const auto& particle : packed_hashtable_particles.value_iteration()) {
+      lifetime += particle.lifetime_;
+    }
+    benchmark::DoNotOptimize(lifetime);
+  }
+}
+
+BENCHMARK(rebuild_particle_t_packed_hashtable_with_add)
+  ->RangeMultiplier(4)
+  ->Range(1 << 12, 1 << 22);
+
+#if __has_include(<sys/mman.h>)
+// maps a snapshot of a packed hashtable (saved once up front) and reads every
+// value (each page of values is faulted in from the page cache)
+static void load_particle_t_packed_hashtable_snapshot_with_mmap(
+  benchmark::State& state)
+{
+  const auto path =
+    (std::filesystem::temp_directory_path() / "thh-snapshot-bench.bin")
+      .string();
+  {
+    thh::packed_hashtable_t<int64_t, particle_t> packed_hashtable_particles;
+    for (int i = 0; i < state.range(0); ++i) {
+      packed_hashtable_particles.add({i, particle_t{}});
+    }
+    thh::save_snapshot(packed_hashtable_particles, path.c_str());
+  }
+  for ([[maybe_unused]] auto _ : state) {
+    const auto snapshot =
+      thh::packed_hashtable_snapshot_t<int64_t, particle_t>::load_mmap(
+        path.c_str());
+    float lifetime = 0.0f;
+    std::for_each(
+      snapshot->vbegin(), snapshot->vend(),
+      [&lifetime](const particle_t& particle) {
+        lifetime += particle.lifetime_;
+      });
+    benchmark::DoNotOptimize(lifetime);
+  }
+  std::filesystem::remove(path);
+}
+
+BENCHMARK(load_particle_t_packed_hashtable_snapshot_with_mmap)
+  ->RangeMultiplier(4)
+  ->Range(1 << 12, 1 << 22);
+
+// attaches a reader to a packed hashtable in shared memory (built once up
+// front by the writer) and looks up 1000 random keys, compare with
+// rebuild_particle_t_packed_hashtable_with_add for each process building its
+// own copy
+static void attach_particle_t_shared_packed_hashtable_reader(
+  benchmark::State& state)
+{
+  const char* name = "/thh-shared-hashtable-bench";
+  thh::shared_packed_hashtable_t<int64_t, particle_t>::unlink(name);
+  auto writer = thh::shared_packed_hashtable_t<int64_t, particle_t>::create(
+    name, int32_t(state.range(0)));
+  for (int i = 0; i < state.range(0); ++i) {
+    writer->add(i, particle_t{});
+  }
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int64_t> key(0, state.range(0) - 1);
+  for ([[maybe_unused]] auto _ : state) {
+    const auto reader =
+      thh::shared_packed_hashtable_reader_t<int64_t, particle_t>::open(name);
+    float lifetime = 0.0f;
+    for (int i = 0; i < 1000; ++i) {
+      lifetime += reader->get(key(generator))->lifetime_;
+    }
+    benchmark::DoNotOptimize(lifetime);
+  }
+}
+
+BENCHMARK(attach_particle_t_shared_packed_hashtable_reader)
+  ->RangeMultiplier(4)
+  ->Range(1 << 12, 1 << 22);
+
+// looks up random keys with a shared packed hashtable reader (each lookup
+// copies the value out under the seqlock)
+static void get_particle_t_in_shared_packed_hashtable_reader_in_random_order(
+  benchmark::State& state)
+{
+  const char* name = "/thh-shared-hashtable-bench";
+  thh::shared_packed_hashtable_t<int64_t, particle_t>::unlink(name);
+  auto writer = thh::shared_packed_hashtable_t<int64_t, particle_t>::create(
+    name, int32_t(state.range(0)));
+  for (int i = 0; i < state.range(0); ++i) {
+    writer->add(i, particle_t{});
+  }
+  const auto reader =
+    thh::shared_packed_hashtable_reader_t<int64_t, particle_t>::open(name);
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int64_t> key(0, state.range(0) - 1);
+  for ([[maybe_unused]] auto _ : state) {
+    benchmark::DoNotOptimize(reader->get(key(generator)));
+  }
+}
+
+BENCHMARK(get_particle_t_in_shared_packed_hashtable_reader_in_random_order)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21);
+#endif
+
+// changes 1% of the values in a packed hashtable then checkpoints it by
+// saving a full snapshot (cost proportional to the table size)
+static void checkpoint_particle_t_packed_hashtable_with_snapshot(
+  benchmark::State& state)
+{
+  const auto path =
+    (std::filesystem::temp_directory_path() / "thh-checkpoint-bench.bin")
+      .string();
+  thh::packed_hashtable_t<int64_t, particle_t> packed_hashtable_particles;
+  for (int i = 0; i < state.range(0); ++i) {
+    packed_hashtable_particles.add({i, particle_t{}});
+  }
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int64_t> key(0, state.range(0) - 1);
+  for ([[maybe_unused]] auto _ : state) {
+    for (int i = 0; i < state.range(0) / 100; ++i) {
+      packed_hashtable_particles.call(
+        key(generator), [](particle_t& particle) { particle.size_ += 1.0f; });
+    }
+    thh::save_snapshot(packed_hashtable_particles, path.c_str());
+  }
+  std::filesystem::remove(path);
+}
+
+BENCHMARK(checkpoint_particle_t_packed_hashtable_with_snapshot)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21);
+
+// changes 1% of the values in a journaled packed hashtable then checkpoints it
+// by appending the journal to a file (cost proportional to the changes)
+static void checkpoint_particle_t_packed_hashtable_with_journal(
+  benchmark::State& state)
+{
+  const auto path =
+    (std::filesystem::temp_directory_path() / "thh-checkpoint-bench.log")
+      .string();
+  thh::packed_hashtable_t<
+    int64_t, particle_t, std::hash<int64_t>, std::equal_to<int64_t>,
+    thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int64_t, particle_t>>,
+    thh::journaled_policy_t<>>
+    packed_hashtable_particles;
+  for (int i = 0; i < state.range(0); ++i) {
+    packed_hashtable_particles.add({i, particle_t{}});
+  }
+  packed_hashtable_particles.journal().clear();
+  std::ofstream log(path, std::ios::binary);
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int64_t> key(0, state.range(0) - 1);
+  for ([[maybe_unused]] auto _ : state) {
+    for (int i = 0; i < state.range(0) / 100; ++i) {
+      packed_hashtable_particles.call(
+        key(generator), [](particle_t& particle) { particle.size_ += 1.0f; });
+    }
+    auto& journal = packed_hashtable_particles.journal();
+    log.write(
+      reinterpret_cast<const char*>(journal.data()),
+      static_cast<std::streamsize>(journal.size_bytes()));
+    log.flush();
+    journal.clear();
+  }
+  log.close();
+  std::filesystem::remove(path);
+}
+
+BENCHMARK(checkpoint_particle_t_packed_hashtable_with_journal)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21);
+
+// changes 1% of the values in a packed hashtable then starts an incremental
+// background checkpoint, only the pause of the calling thread is measured
+// (the write is waited for outside of the timed region)
+static void checkpoint_async_particle_t_packed_hashtable_pause(
+  benchmark::State& state)
+{
+  const auto path =
+    (std::filesystem::temp_directory_path() / "thh-checkpoint-async-bench.bin")
+      .string();
+  thh::packed_hashtable_t<
+    int64_t, particle_t, std::hash<int64_t>, std::equal_to<int64_t>,
+    thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int64_t, particle_t>>,
+    thh::checkpointed_policy_t<>>
+    packed_hashtable_particles;
+  for (int i = 0; i < state.range(0); ++i) {
+    packed_hashtable_particles.add({i, particle_t{}});
+  }
+  thh::checkpoint_async(packed_hashtable_particles, path.c_str()).wait();
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int64_t> key(0, state.range(0) - 1);
+  std::size_t bytes = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    for (int i = 0; i < state.range(0) / 100; ++i) {
+      packed_hashtable_particles.call(
+        key(generator), [](particle_t& particle) { particle.size_ += 1.0f; });
+    }
+    const auto begin = std::chrono::steady_clock::now();
+    const auto written =
+      thh::checkpoint_async(packed_hashtable_particles, path.c_str());
+    const auto end = std::chrono::steady_clock::now();
+    state.SetIterationTime(std::chrono::duration<double>(end - begin).count());
+    bytes += packed_hashtable_particles.journal().checkpoint_bytes();
+    written.wait();
+  }
+  state.counters["dirty_bytes"] = benchmark::Counter(
+    double(bytes), benchmark::Counter::kAvgIterations);
+  std::filesystem::remove(path);
+}
+
+BENCHMARK(checkpoint_async_particle_t_packed_hashtable_pause)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21)
+  ->UseManualTime();
+
+// update every particle in a packed hashtable with Policy using value
+// iteration (sequential access)
+template<typename Policy>
+static void iterate_particle_t_in_packed_hashtable_with_policy_by_value(
+  benchmark::State& state)
+{
+  thh::packed_hashtable_t<
+    int64_t, particle_t, std::hash<int64_t>, std::equal_to<int64_t>,
+    thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int64_t, particle_t>>, Policy>
+    packed_hashtable_particles;
+  for (int i = 0; i < state.range(0); ++i) {
+    packed_hashtable_particles.add({i, particle_t{}});
+  }
+
+  for ([[maybe_unused]] auto _ : state) {
+    for (auto& particle : packed_hashtable_particles.value_iteration()) {
+      particle.position_.x += particle.velocity_.x;
+      particle.lifetime_ -= 0.01666f;
+    }
+    benchmark::DoNotOptimize(packed_hashtable_particles);
+  }
+}
+
+// update particles in a packed hashtable with Policy using handles in a random
+// order (random access)
+template<typename Policy>
+static void call_particle_t_in_packed_hashtable_with_policy_in_random_order(
+  benchmark::State& state)
+{
+  thh::packed_hashtable_t<
+    int64_t, particle_t, std::hash<int64_t>, std::equal_to<int64_t>,
+    thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int64_t, particle_t>>, Policy>
+    packed_hashtable_particles;
+  std::vector<thh::packed_hashtable_handle_t> handles;
+  for (int i = 0; i < state.range(0); ++i) {
+    handles.push_back(
+      packed_hashtable_particles.add({i, particle_t{}}).first->second);
+  }
+  std::shuffle(handles.begin(), handles.end(), std::mt19937(0));
+
+  for ([[maybe_unused]] auto _ : state) {
+    for (const auto handle : handles) {
+      packed_hashtable_particles.call(handle, [](particle_t& particle) {
+        particle.position_.x += particle.velocity_.x;
+        particle.lifetime_ -= 0.01666f;
+      });
+    }
+    benchmark::DoNotOptimize(packed_hashtable_particles);
+  }
+}
+
+BENCHMARK_TEMPLATE(
+  iterate_particle_t_in_packed_hashtable_with_policy_by_value,
+  thh::packed_hashtable_policy_t)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21);
+BENCHMARK_TEMPLATE(
+  call_particle_t_in_packed_hashtable_with_policy_in_random_order,
+  thh::packed_hashtable_policy_t)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21);
+
+#if __has_include(<sys/mman.h>)
+// values are stored in a file in the system temporary directory (set TMPDIR
+// to compare tmpfs with a local disk)
+BENCHMARK_TEMPLATE(
+  iterate_particle_t_in_packed_hashtable_with_policy_by_value,
+  thh::mapped_policy_t<>)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21);
+BENCHMARK_TEMPLATE(
+  call_particle_t_in_packed_hashtable_with_policy_in_random_order,
+  thh::mapped_policy_t<>)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21);
+#endif
+
+// update particles in a packed hashtable using handles in a random order with
+// for_each_handle (handles are sorted by dense index so values are visited in
+// memory order, compare with
+// call_particle_t_in_packed_hashtable_with_policy_in_random_order)
+static void for_each_handle_particle_t_in_packed_hashtable_in_random_order(
+  benchmark::State& state)
+{
+  thh::packed_hashtable_t<int64_t, particle_t> packed_hashtable_particles;
+  std::vector<thh::packed_hashtable_handle_t> handles;
+  for (int i = 0; i < state.range(0); ++i) {
+    handles.push_back(
+      packed_hashtable_particles.add({i, particle_t{}}).first->second);
+  }
+  std::shuffle(handles.begin(), handles.end(), std::mt19937(0));
+
+  for ([[maybe_unused]] auto _ : state) {
+    packed_hashtable_particles.for_each_handle(
+      handles.begin(), handles.end(),
+      [](particle_t& particle, std::size_t) {
+        particle.position_.x += particle.velocity_.x;
+        particle.lifetime_ -= 0.01666f;
+      });
+    benchmark::DoNotOptimize(packed_hashtable_particles);
+  }
+}
+
+BENCHMARK(for_each_handle_particle_t_in_packed_hashtable_in_random_order)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21);
+
+// look up elements with a zipf distribution (a few keys account for most
+// lookups) where the popular keys are scattered throughout the dense array,
+// with hotness_policy_t values are reordered after a warm up so the popular
+// values share cache lines
+template<typename Policy>
+static void lookup_particle_t_in_packed_hashtable_with_zipf_keys(
+  benchmark::State& state)
+{
+  thh::packed_hashtable_t<
+    int64_t, particle_t, std::hash<int64_t>, std::equal_to<int64_t>,
+    thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int64_t, particle_t>>, Policy>
+    packed_hashtable_particles;
+  std::vector<int64_t> keys(static_cast<std::size_t>(state.range(0)));
+  std::iota(keys.begin(), keys.end(), int64_t(0));
+  std::mt19937 generator(0);
+  std::shuffle(keys.begin(), keys.end(), generator);
+  for (const auto key : keys) {
+    packed_hashtable_particles.add({key, particle_t{}});
+  }
+
+  // the key ranked r is looked up in proportion to 1 / (r + 1)
+  std::vector<double> weights(keys.size());
+  for (std::size_t rank = 0; rank < weights.size(); ++rank) {
+    weights[rank] = 1.0 / static_cast<double>(rank + 1);
+  }
+  std::discrete_distribution<std::size_t> zipf(weights.begin(), weights.end());
+  std::shuffle(keys.begin(), keys.end(), generator);
+  std::vector<int64_t> lookups(1 << 16);
+  for (auto& lookup : lookups) {
+    lookup = keys[zipf(generator)];
+  }
+
+  const auto update = [&packed_hashtable_particles, &lookups] {
+    for (const auto lookup : lookups) {
+      packed_hashtable_particles.call(lookup, [](particle_t& particle) {
+        particle.position_.x += particle.velocity_.x;
+        particle.lifetime_ -= 0.01666f;
+      });
+    }
+  };
+
+  update();
+  if constexpr (decltype(packed_hashtable_particles)::access_profiler_type::
+                  enabled_v) {
+    packed_hashtable_particles.reorder_by_hotness();
+  }
+
+  for ([[maybe_unused]] auto _ : state) {
+    update();
+    benchmark::DoNotOptimize(packed_hashtable_particles);
+  }
+}
+
+BENCHMARK_TEMPLATE(
+  lookup_particle_t_in_packed_hashtable_with_zipf_keys,
+  thh::packed_hashtable_policy_t)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21);
+BENCHMARK_TEMPLATE(
+  lookup_particle_t_in_packed_hashtable_with_zipf_keys, thh::hotness_policy_t<>)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21);
+
+// find the particles modified since the last pass (1 in 100 each pass) by
+// comparing every particle against a copy made on the previous pass
+static void diff_particle_t_in_packed_hashtable_by_full_scan(
+  benchmark::State& state)
+{
+  thh::packed_hashtable_t<int64_t, particle_t> packed_hashtable_particles;
+  std::vector<thh::packed_hashtable_handle_t> handles;
+  for (int i = 0; i < state.range(0); ++i) {
+    handles.push_back(
+      packed_hashtable_particles.add({i, particle_t{}}).first->second);
+  }
+  std::vector<float> previous(handles.size());
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<std::size_t> pick(0, handles.size() - 1);
+
+  for ([[maybe_unused]] auto _ : state) {
+    for (std::size_t change = 0; change < handles.size() / 100; ++change) {
+      packed_hashtable_particles.call(
+        handles[pick(generator)],
+        [](particle_t& particle) { particle.lifetime_ -= 0.01666f; });
+    }
+    int64_t changed = 0;
+    std::size_t index = 0;
+    for (const auto& particle : packed_hashtable_particles.value_iteration()) {
+      if (particle.lifetime_ != previous[index]) {
+        previous[index] = particle.lifetime_;
+        ++changed;
+      }
+      ++index;
+    }
+    benchmark::DoNotOptimize(changed);
+  }
+}
+
+BENCHMARK(diff_particle_t_in_packed_hashtable_by_full_scan)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21);
+
+// find the particles modified since the last pass (1 in 100 each pass) with
+// change_tracking_policy_t, only blocks of values holding a change are read
+static void diff_particle_t_in_packed_hashtable_by_version(
+  benchmark::State& state)
+{
+  thh::packed_hashtable_t<
+    int64_t, particle_t, std::hash<int64_t>, std::equal_to<int64_t>,
+    thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int64_t, particle_t>>,
+    thh::change_tracking_policy_t<>>
+    packed_hashtable_particles;
+  std::vector<thh::packed_hashtable_handle_t> handles;
+  for (int i = 0; i < state.range(0); ++i) {
+    handles.push_back(
+      packed_hashtable_particles.add({i, particle_t{}}).first->second);
+  }
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<std::size_t> pick(0, handles.size() - 1);
+  auto version = packed_hashtable_particles.version();
+
+  for ([[maybe_unused]] auto _ : state) {
+    for (std::size_t change = 0; change < handles.size() / 100; ++change) {
+      packed_hashtable_particles.call(
+        handles[pick(generator)],
+        [](particle_t& particle) { particle.lifetime_ -= 0.01666f; });
+    }
+    int64_t changed = 0;
+    packed_hashtable_particles.for_each_changed_since(
+      version, [&changed](const particle_t& particle, auto) {
+        benchmark::DoNotOptimize(particle.lifetime_);
+        ++changed;
+      });
+    version = packed_hashtable_particles.version();
+    benchmark::DoNotOptimize(changed);
+  }
+}
+
+BENCHMARK(diff_particle_t_in_packed_hashtable_by_version)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21);
+
+// mirror adds and removes of particles into a separate list of handles (e.g.
+// a spatial index) by wrapping add and remove, the handle of each removed
+// element has to be looked up before it is removed
+static void mirror_particle_t_in_packed_hashtable_by_wrapping(
+  benchmark::State& state)
+{
+  for ([[maybe_unused]] auto _ : state) {
+    thh::packed_hashtable_t<int64_t, particle_t> packed_hashtable_particles;
+    std::vector<thh::packed_hashtable_handle_t> added;
+    std::vector<thh::packed_hashtable_handle_t> removed;
+    for (int i = 0; i < state.range(0); ++i) {
+      added.push_back(
+        packed_hashtable_particles.add({i, particle_t{}}).first->second);
+    }
+    for (int i = 0; i < state.range(0); i += 2) {
+      if (const auto it = packed_hashtable_particles.find(i);
+          it != packed_hashtable_particles.hend()) {
+        removed.push_back(it->second);
+        packed_hashtable_particles.remove(it);
+      }
+    }
+    benchmark::DoNotOptimize(added.data());
+    benchmark::DoNotOptimize(removed.data());
+  }
+}
+
+BENCHMARK(mirror_particle_t_in_packed_hashtable_by_wrapping)
+  ->RangeMultiplier(8)
+  ->Range(1 << 10, 1 << 18);
+
+// mirror adds and removes of particles into a separate list of handles with
+// observed_policy_t, events are delivered in one batch
+static void mirror_particle_t_in_packed_hashtable_by_observer(
+  benchmark::State& state)
+{
+  for ([[maybe_unused]] auto _ : state) {
+    thh::packed_hashtable_t<
+      int64_t, particle_t, std::hash<int64_t>, std::equal_to<int64_t>,
+      thh::packed_hashtable_tag_t,
+      std::allocator<std::pair<const int64_t, particle_t>>,
+      thh::observed_policy_t<>>
+      packed_hashtable_particles;
+    std::vector<thh::packed_hashtable_handle_t> added;
+    std::vector<thh::packed_hashtable_handle_t> removed;
+    for (int i = 0; i < state.range(0); ++i) {
+      packed_hashtable_particles.add({i, particle_t{}});
+    }
+    for (int i = 0; i < state.range(0); i += 2) {
+      packed_hashtable_particles.remove(i);
+    }
+    packed_hashtable_particles.deliver_events(
+      [&added, &removed](const auto* first, const auto* last) {
+        for (; first != last; ++first) {
+          (first->event_ == thh::observer_event_e::add ? added : removed)
+            .push_back(first->handle_);
+        }
+      });
+    benchmark::DoNotOptimize(added.data());
+    benchmark::DoNotOptimize(removed.data());
+  }
+}
+
+BENCHMARK(mirror_particle_t_in_packed_hashtable_by_observer)
+  ->RangeMultiplier(8)
+  ->Range(1 << 10, 1 << 18);
+
+// returns count keys drawn from [0, universe) with a zipf distribution (the
+// key ranked r is drawn in proportion to 1 / (r + 1), ranks are shuffled)
+static std::vector<int64_t> zipf_trace(
+  const std::size_t universe, const std::size_t count)
+{
+  std::vector<int64_t> keys(universe);
+  std::iota(keys.begin(), keys.end(), int64_t(0));
+  std::mt19937 generator(0);
+  std::shuffle(keys.begin(), keys.end(), generator);
+  std::vector<double> weights(universe);
+  for (std::size_t rank = 0; rank < weights.size(); ++rank) {
+    weights[rank] = 1.0 / static_cast<double>(rank + 1);
+  }
+  std::discrete_distribution<std::size_t> zipf(weights.begin(), weights.end());
+  std::vector<int64_t> trace(count);
+  for (auto& key : trace) {
+    key = keys[zipf(generator)];
+  }
+  return trace;
+}
+
+// least recently used cache the usual way, a std::list in recency order and
+// an unordered_map from each key to its list node
+class list_lru_cache_t
+{
+  using entry_t = std::pair<int64_t, particle_t>;
+
+  std::list<entry_t> entries_;
+  std::unordered_map<int64_t, std::list<entry_t>::iterator> lookup_;
+  std::size_t max_size_;
+
+public:
+  explicit list_lru_cache_t(const std::size_t max_size) : max_size_(max_size)
+  {
+    lookup_.reserve(max_size_);
+  }
+
+  particle_t* find(const int64_t key)
+  {
+    const auto it = lookup_.find(key);
+    if (it == lookup_.end()) {
+      return nullptr;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &it->second->second;
+  }
+
+  void add(const int64_t key, const particle_t& particle)
+  {
+    if (lookup_.size() >= max_size_) {
+      lookup_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+    entries_.emplace_front(key, particle);
+    lookup_.emplace(key, entries_.begin());
+  }
+};
+
+// replay a zipf trace of particle lookups against a cache holding range(0)
+// particles out of 8 times as many keys (the trace is twice as long as the
+// number of keys), each miss adds the particle (evicting one when full), the
+// hit rate is reported as a counter
+template<typename Cache>
+static void replay_zipf_trace_in_cache(benchmark::State& state, Cache& cache)
+{
+  const auto universe = static_cast<std::size_t>(state.range(0)) * 8;
+  const auto trace = zipf_trace(universe, universe * 2);
+  int64_t hits = 0;
+  int64_t lookups = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    for (const auto key : trace) {
+      if (auto* particle = cache.find(key)) {
+        particle->lifetime_ -= 0.01666f;
+        ++hits;
+      } else {
+        cache.add(key, particle_t{});
+      }
+    }
+    lookups += static_cast<int64_t>(trace.size());
+    benchmark::DoNotOptimize(cache);
+  }
+  state.counters["hit_rate"] =
+    static_cast<double>(hits) / static_cast<double>(lookups);
+  state.SetItemsProcessed(lookups);
+}
+
+// CLOCK eviction with packed_cache_t (reference bits parallel to the values)
+static void cache_particle_t_in_packed_cache_with_zipf_keys(
+  benchmark::State& state)
+{
+  // adapts add to the packed cache interface
+  struct cache_t
+  {
+    thh::packed_cache_t<int64_t, particle_t> packed_cache_;
+    particle_t* find(const int64_t key) { return packed_cache_.find(key); }
+    void add(const int64_t key, const particle_t& particle)
+    {
+      packed_cache_.add_or_update({key, particle});
+    }
+  } cache{thh::packed_cache_t<int64_t, particle_t>(
+    static_cast<int32_t>(state.range(0)))};
+  replay_zipf_trace_in_cache(state, cache);
+}
+
+BENCHMARK(cache_particle_t_in_packed_cache_with_zipf_keys)
+  ->RangeMultiplier(4)
+  ->Range(1 << 10, 1 << 16);
+
+// exact least recently used eviction with an unordered_map and a std::list
+static void cache_particle_t_in_list_lru_cache_with_zipf_keys(
+  benchmark::State& state)
+{
+  list_lru_cache_t cache(static_cast<std::size_t>(state.range(0)));
+  replay_zipf_trace_in_cache(state, cache);
+}
+
+BENCHMARK(cache_particle_t_in_list_lru_cache_with_zipf_keys)
+  ->RangeMultiplier(4)
+  ->Range(1 << 10, 1 << 16);
+
+// session with a deadline (in milliseconds) for the remove_when sweep
+struct session_t
+{
+  uint64_t deadline_ = 0;
+  particle_t particle_;
+};
+
+// expire sessions (range(0) live, each with a time to live of up to an hour)
+// once a second by sweeping every session with remove_when, expired sessions
+// are replaced so the number of sessions stays the same
+static void expire_session_t_in_packed_hashtable_by_sweep(
+  benchmark::State& state)
+{
+  thh::packed_hashtable_rl_t<int64_t, session_t> packed_hashtable_sessions;
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<uint64_t> ttl(1, 3'600'000);
+  int64_t next_key = 0;
+  uint64_t now = 0;
+  const auto add_sessions = [&](const int64_t count) {
+    for (int64_t i = 0; i < count; ++i) {
+      packed_hashtable_sessions.add(
+        {next_key++, session_t{now + ttl(generator), particle_t{}}});
+    }
+  };
+  add_sessions(state.range(0));
+
+  for ([[maybe_unused]] auto _ : state) {
+    now += 1000;
+    const auto expired = thh::remove_when(
+      packed_hashtable_sessions,
+      [now](const session_t& session) { return session.deadline_ <= now; });
+    add_sessions(expired);
+  }
+}
+
+BENCHMARK(expire_session_t_in_packed_hashtable_by_sweep)
+  ->RangeMultiplier(8)
+  ->Range(1 << 10, 1 << 18);
+
+// expire sessions (range(0) live, each with a time to live of up to an hour)
+// once a second with expiring_packed_hashtable_t (a timing wheel), expired
+// sessions are replaced so the number of sessions stays the same
+static void expire_session_t_in_expiring_packed_hashtable(
+  benchmark::State& state)
+{
+  thh::expiring_packed_hashtable_t<int64_t, session_t>
+    packed_hashtable_sessions;
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<uint64_t> ttl(1, 3'600'000);
+  int64_t next_key = 0;
+  const auto add_sessions = [&](const int64_t count) {
+    for (int64_t i = 0; i < count; ++i) {
+      const auto time_to_live = ttl(generator);
+      packed_hashtable_sessions.add(
+        {next_key++,
+         session_t{packed_hashtable_sessions.now() + time_to_live, {}}},
+        time_to_live);
+    }
+  };
+  add_sessions(state.range(0));
+
+  for ([[maybe_unused]] auto _ : state) {
+    const auto expired =
+      packed_hashtable_sessions.expire(packed_hashtable_sessions.now() + 1000);
+    add_sessions(expired);
+  }
+}
+
+BENCHMARK(expire_session_t_in_expiring_packed_hashtable)
+  ->RangeMultiplier(8)
+  ->Range(1 << 10, 1 << 18);
+
 // remove elements passing a predicate from the packed hashtable using value
 // iteration (note: uses reverse lookup - packed_hashtable_rl_t)
 static void remove_particle_t_in_packed_hashtable_by_value(
@@ -490,6 +1622,132 @@ BENCHMARK(find_value_in_unordered_map_by_key)
   ->RangeMultiplier(2)
   ->Range(32, 8 << 13);
 
+// looks up random keys in a packed hashtable, the same table after freeze and
+// an absl::flat_hash_map with the same elements
+static void find_particle_t_in_packed_hashtable_in_random_order(
+  benchmark::State& state)
+{
+  thh::packed_hashtable_t<int64_t, particle_t> packed_hashtable_particles;
+  for (int i = 0; i < state.range(0); ++i) {
+    packed_hashtable_particles.add({i, particle_t{}});
+  }
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int64_t> key(0, state.range(0) - 1);
+  for ([[maybe_unused]] auto _ : state) {
+    benchmark::DoNotOptimize(packed_hashtable_particles.call_return(
+      key(generator),
+      [](const particle_t& particle) { return particle.lifetime_; }));
+  }
+}
+
+BENCHMARK(find_particle_t_in_packed_hashtable_in_random_order)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21);
+
+static void find_particle_t_in_frozen_packed_hashtable_in_random_order(
+  benchmark::State& state)
+{
+  thh::packed_hashtable_t<int64_t, particle_t> packed_hashtable_particles;
+  for (int i = 0; i < state.range(0); ++i) {
+    packed_hashtable_particles.add({i, particle_t{}});
+  }
+  const auto frozen_particles = thh::freeze(packed_hashtable_particles);
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int64_t> key(0, state.range(0) - 1);
+  for ([[maybe_unused]] auto _ : state) {
+    benchmark::DoNotOptimize(frozen_particles.call_return(
+      key(generator),
+      [](const particle_t& particle) { return particle.lifetime_; }));
+  }
+}
+
+BENCHMARK(find_particle_t_in_frozen_packed_hashtable_in_random_order)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21);
+
+static void find_particle_t_in_flat_hash_map_in_random_order(
+  benchmark::State& state)
+{
+  absl::flat_hash_map<int64_t, particle_t> map_particles;
+  for (int i = 0; i < state.range(0); ++i) {
+    map_particles.insert({i, particle_t{}});
+  }
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int64_t> key(0, state.range(0) - 1);
+  for ([[maybe_unused]] auto _ : state) {
+    float lifetime = 0.0f;
+    if (auto found = map_particles.find(key(generator));
+        found != map_particles.end()) {
+      lifetime = found->second.lifetime_;
+    }
+    benchmark::DoNotOptimize(lifetime);
+  }
+}
+
+BENCHMARK(find_particle_t_in_flat_hash_map_in_random_order)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21);
+
+// checks for random keys in a packed hashtable where the second argument is
+// the percentage of keys that are missing, with and without a key filter
+template<typename Policy>
+static void has_particle_t_in_packed_hashtable_with_misses(
+  benchmark::State& state)
+{
+  thh::packed_hashtable_t<
+    int64_t, particle_t, std::hash<int64_t>, std::equal_to<int64_t>,
+    thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int64_t, particle_t>>, Policy>
+    packed_hashtable_particles;
+  const int64_t size = state.range(0);
+  for (int64_t i = 0; i < size; ++i) {
+    packed_hashtable_particles.add({i, particle_t{}});
+  }
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int64_t> hit(0, size - 1);
+  std::uniform_int_distribution<int64_t> miss(size, size * 64);
+  std::uniform_int_distribution<int64_t> percent(0, 99);
+  std::vector<int64_t> lookups(1 << 16);
+  for (auto& lookup : lookups) {
+    lookup = percent(generator) < state.range(1) ? miss(generator)
+                                                 : hit(generator);
+  }
+
+  for ([[maybe_unused]] auto _ : state) {
+    int64_t found = 0;
+    for (const auto lookup : lookups) {
+      found += packed_hashtable_particles.has(lookup) ? 1 : 0;
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed(
+    state.iterations() * static_cast<int64_t>(lookups.size()));
+}
+
+BENCHMARK_TEMPLATE(
+  has_particle_t_in_packed_hashtable_with_misses,
+  thh::packed_hashtable_policy_t)
+  ->ArgsProduct({{1 << 12, 1 << 16, 1 << 20}, {0, 50, 95}});
+BENCHMARK_TEMPLATE(
+  has_particle_t_in_packed_hashtable_with_misses, thh::key_filter_policy_t<>)
+  ->ArgsProduct({{1 << 12, 1 << 16, 1 << 20}, {0, 50, 95}});
+
+// freezes a packed hashtable (builds the minimal perfect hash)
+static void freeze_particle_t_packed_hashtable(benchmark::State& state)
+{
+  thh::packed_hashtable_t<int64_t, particle_t> packed_hashtable_particles;
+  for (int i = 0; i < state.range(0); ++i) {
+    packed_hashtable_particles.add({i, particle_t{}});
+  }
+  for ([[maybe_unused]] auto _ : state) {
+    benchmark::DoNotOptimize(thh::freeze(packed_hashtable_particles).size());
+  }
+}
+
+BENCHMARK(freeze_particle_t_packed_hashtable)
+  ->RangeMultiplier(8)
+  ->Range(1 << 12, 1 << 21);
+
 BENCHMARK_TEMPLATE(
   iterate_object_t_in_unordered_map_by_key_value_pair, object_t<32>)
   ->RangeMultiplier(2)
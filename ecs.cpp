@@ -77,13 +77,8 @@ int main(int argc, char** argv)
   const auto components_display =
     [](const auto& components, const std::string& component_name) {
       std::cout << component_name << " entity ids\n";
-      for (auto it = components.vbegin(); it != components.vend(); ++it) {
-        const auto handle = components.handle_from_index(
-          static_cast<int32_t>(std::distance(components.vbegin(), it)));
-        if (auto entity_id = components.key_from_handle(handle);
-            entity_id.has_value()) {
-          std::cout << entity_id->id_ << ", ";
-        }
+      for (const auto& [entity_id, component] : components.kv_iteration()) {
+        std::cout << entity_id.id_ << ", ";
       }
       std::cout << '\n';
 
@@ -101,19 +96,14 @@ int main(int argc, char** argv)
   std::vector<entity_id_t> physics_value_order_entity_ids;
   // physics components is smaller than transform
   // build entity id list for physics components
-  for (int32_t index = 0; index < physics_components.size(); ++index) {
-    if (auto entity_id = physics_components.key_from_index(index);
-        entity_id.has_value()) {
-      physics_value_order_entity_ids.push_back(entity_id.value());
-    }
+  for (const auto& [entity_id, component] : physics_components.kv_iteration()) {
+    physics_value_order_entity_ids.push_back(entity_id);
   }
 
   std::vector<entity_id_t> transform_value_order_entity_ids;
-  for (int32_t index = 0; index < transform_components.size(); ++index) {
-    if (auto entity_id = transform_components.key_from_index(index);
-        entity_id.has_value()) {
-      transform_value_order_entity_ids.push_back(entity_id.value());
-    }
+  for (const auto& [entity_id, component] :
+       transform_components.kv_iteration()) {
+    transform_value_order_entity_ids.push_back(entity_id);
   }
 
   std::cout << "entity ids in transform component order\n";
@@ -139,9 +129,8 @@ int main(int argc, char** argv)
   // not)
   auto second = transform_components.partition(
     [&physics_components, &transform_components](const int32_t index) {
-      const auto handle = transform_components.handle_from_index(index);
       return physics_components.has(
-        transform_components.key_from_handle(handle).value());
+        *transform_components.key_ptr_from_index(index));
     });
 
   // sort first half (valid/left) of the transform components partition based on
@@ -153,12 +142,8 @@ int main(int argc, char** argv)
            < transform_value_order_entity_ids[rhs].id_;
     });
 
-  // sort physics components based on entity id
-  physics_components.sort(
-    [&physics_value_order_entity_ids](const int32_t lhs, const int32_t rhs) {
-      return physics_value_order_entity_ids[lhs].id_
-           < physics_value_order_entity_ids[rhs].id_;
-    });
+  // sort physics components based on entity id (the key)
+  physics_components.reorder_by_key();
 
   components_display(transform_components, "transform component");
   components_display(physics_components, "physics component");
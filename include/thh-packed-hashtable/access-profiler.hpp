@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace thh
+{
+  // access profiler used by packed hashtables by default, records nothing
+  // (every function is an empty noop so profiling compiles away)
+  // note: this is the interface base_packed_hashtable_t calls to report
+  // lookups, other profilers (see sampling_access_profiler_t) implement the
+  // same functions
+  template<typename Tag, typename Allocator>
+  class no_access_profiler_t
+  {
+  public:
+    // if lookups are recorded (reorder_by_hotness requires a profiler)
+    static constexpr bool enabled_v = false;
+
+    no_access_profiler_t() = default;
+    explicit no_access_profiler_t(const Allocator&) {}
+
+    void record_access(std::size_t) {}
+    void record_add(std::size_t) {}
+    void record_clear() {}
+    [[nodiscard]] uint32_t hits(std::size_t) const { return 0; }
+    void decay() {}
+  };
+
+  // access profiler sampling one in every SampleInterval lookups (see
+  // hotness_policy_t), each sample increments a saturating counter for the
+  // handle id of the element looked up so the counters approximate how often
+  // each element is accessed
+  // note: records are written by base_packed_hashtable_t (the record_
+  // functions are not intended to be called directly)
+  template<typename Tag, typename Allocator, int32_t SampleInterval>
+  class sampling_access_profiler_t
+  {
+    static_assert(SampleInterval > 0, "SampleInterval must be positive");
+
+    using hit_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<uint32_t>;
+
+    // sampled lookups of each element (indexed by handle id)
+    std::vector<uint32_t, hit_allocator_type> hits_;
+    // lookups remaining until the next sample
+    int32_t countdown_ = SampleInterval;
+
+  public:
+    static constexpr bool enabled_v = true;
+
+    sampling_access_profiler_t() = default;
+    explicit sampling_access_profiler_t(const Allocator& allocator);
+
+    // counts a lookup of the element with the handle id specified (one in
+    // every SampleInterval lookups is recorded)
+    void record_access(std::size_t id);
+    // resets the count for a new element (the handle id may have been used by
+    // a removed element)
+    void record_add(std::size_t id);
+    // resets all counts
+    void record_clear();
+    // returns the sampled lookups of the element with the handle id specified
+    [[nodiscard]] uint32_t hits(std::size_t id) const;
+    // halves every count so recent lookups outweigh older ones (called after
+    // each reorder_by_hotness)
+    void decay();
+  };
+} // namespace thh
+
+#include "access-profiler.inl"
@@ -0,0 +1,56 @@
+namespace thh
+{
+  template<typename Tag, typename Allocator, int32_t SampleInterval>
+  sampling_access_profiler_t<Tag, Allocator, SampleInterval>::
+    sampling_access_profiler_t(const Allocator& allocator)
+    : hits_(hit_allocator_type(allocator))
+  {
+  }
+
+  template<typename Tag, typename Allocator, int32_t SampleInterval>
+  void sampling_access_profiler_t<Tag, Allocator, SampleInterval>::
+    record_access(const std::size_t id)
+  {
+    if (--countdown_ > 0) {
+      return;
+    }
+    countdown_ = SampleInterval;
+    if (id >= hits_.size()) {
+      hits_.resize(id + 1);
+    }
+    if (hits_[id] != std::numeric_limits<uint32_t>::max()) {
+      ++hits_[id];
+    }
+  }
+
+  template<typename Tag, typename Allocator, int32_t SampleInterval>
+  void sampling_access_profiler_t<Tag, Allocator, SampleInterval>::record_add(
+    const std::size_t id)
+  {
+    if (id < hits_.size()) {
+      hits_[id] = 0;
+    }
+  }
+
+  template<typename Tag, typename Allocator, int32_t SampleInterval>
+  void sampling_access_profiler_t<
+    Tag, Allocator, SampleInterval>::record_clear()
+  {
+    std::fill(hits_.begin(), hits_.end(), 0);
+  }
+
+  template<typename Tag, typename Allocator, int32_t SampleInterval>
+  uint32_t sampling_access_profiler_t<Tag, Allocator, SampleInterval>::hits(
+    const std::size_t id) const
+  {
+    return id < hits_.size() ? hits_[id] : 0;
+  }
+
+  template<typename Tag, typename Allocator, int32_t SampleInterval>
+  void sampling_access_profiler_t<Tag, Allocator, SampleInterval>::decay()
+  {
+    for (auto& hits : hits_) {
+      hits >>= 1;
+    }
+  }
+} // namespace thh
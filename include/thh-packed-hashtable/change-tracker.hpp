@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace thh
+{
+  // change tracker used by packed hashtables by default, records nothing
+  // (every function is an empty noop so tracking compiles away)
+  // note: this is the interface base_packed_hashtable_t calls to report
+  // changes and moves of values, change_tracker_t implements the same
+  // functions
+  template<typename Allocator>
+  class no_change_tracker_t
+  {
+  public:
+    // if changes are recorded (for_each_changed_since requires a tracker)
+    static constexpr bool enabled_v = false;
+
+    no_change_tracker_t() = default;
+    explicit no_change_tracker_t(const Allocator&) {}
+
+    void record_change(std::size_t) {}
+    void record_swap_remove(std::size_t) {}
+    void record_discard(std::size_t) {}
+    template<typename Index, typename OrderAllocator>
+    void record_reorder(Index, const std::vector<Index, OrderAllocator>&)
+    {
+    }
+    void record_clear() {}
+    [[nodiscard]] uint64_t version() const { return 0; }
+    template<typename Fn>
+    void for_each_changed_since(uint64_t, Fn&&) const
+    {
+    }
+  };
+
+  // version stamps for each value (indexed by dense index, see
+  // change_tracking_policy_t), every change stamps the value with the next
+  // version so a consumer remembering the version it last saw can find the
+  // values changed since without comparing them
+  // note: stamps follow values when they move (swap and pop removal, sort,
+  // partition and reorder) so they always describe the value at their index
+  // note: the highest stamp of each block of 64 values is kept so unchanged
+  // blocks are skipped with a single comparison (scanning is proportional to
+  // the number of blocks with changes, plus one comparison per block)
+  // note: records are written by base_packed_hashtable_t (the record_
+  // functions are not intended to be called directly)
+  template<typename Allocator>
+  class change_tracker_t
+  {
+    using stamp_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<uint64_t>;
+
+    static constexpr std::size_t block_size_v = 64;
+
+    // version of the last change of each value (0 if the value is not
+    // reported, e.g. removed but waiting for compaction)
+    std::vector<uint64_t, stamp_allocator_type> stamps_;
+    // upper bound of the stamps in each block of block_size_v values
+    std::vector<uint64_t, stamp_allocator_type> block_stamps_;
+    // version of the most recent change
+    uint64_t version_ = 0;
+
+    // stores a stamp at the index and raises the bound of its block
+    void stamp(std::size_t index, uint64_t stamp);
+
+  public:
+    static constexpr bool enabled_v = true;
+
+    change_tracker_t() = default;
+    explicit change_tracker_t(const Allocator& allocator);
+
+    // stamps the value at the index with the next version (the index is one
+    // past the last value for a new value)
+    void record_change(std::size_t index);
+    // moves the stamp of the last value to the index and drops the last stamp
+    // (matching a swap and pop removal)
+    void record_swap_remove(std::size_t index);
+    // clears the stamp of the value at the index so it is no longer reported
+    void record_discard(std::size_t index);
+    // permutes the stamps starting at begin so begin + i holds the stamp
+    // previously at order[i]
+    template<typename Index, typename OrderAllocator>
+    void record_reorder(
+      Index begin, const std::vector<Index, OrderAllocator>& order);
+    // drops all stamps (the version is kept so it never goes backwards)
+    void record_clear();
+    // returns the version of the most recent change
+    [[nodiscard]] uint64_t version() const;
+    // invokes fn with the index of each value changed after version, in
+    // ascending index order
+    template<typename Fn>
+    void for_each_changed_since(uint64_t version, Fn&& fn) const;
+  };
+
+  // forward iterator over a range of values that stamps each value as
+  // changed when it is dereferenced (see
+  // base_packed_hashtable_t::value_iteration()), so values modified through
+  // mutable iteration are reported by for_each_changed_since
+  // note: values only read are reported too (iterate with a const container
+  // to avoid stamping)
+  template<typename ValueIt, typename ChangeTracker>
+  class change_stamping_iterator_t
+  {
+    ValueIt value_;
+    std::size_t index_ = 0;
+    ChangeTracker* changes_ = nullptr;
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename std::iterator_traits<ValueIt>::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = typename std::iterator_traits<ValueIt>::pointer;
+    using reference = typename std::iterator_traits<ValueIt>::reference;
+
+    change_stamping_iterator_t() = default;
+    // value is the value at index
+    change_stamping_iterator_t(
+      ValueIt value, std::size_t index, ChangeTracker& changes);
+
+    [[nodiscard]] reference operator*() const;
+    [[nodiscard]] pointer operator->() const;
+    change_stamping_iterator_t& operator++();
+    change_stamping_iterator_t operator++(int);
+
+    [[nodiscard]] bool operator==(const change_stamping_iterator_t& rhs) const;
+    [[nodiscard]] bool operator!=(const change_stamping_iterator_t& rhs) const;
+  };
+} // namespace thh
+
+#include "change-tracker.inl"
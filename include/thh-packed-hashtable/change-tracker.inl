@@ -0,0 +1,155 @@
+namespace thh
+{
+  template<typename Allocator>
+  change_tracker_t<Allocator>::change_tracker_t(const Allocator& allocator)
+    : stamps_(stamp_allocator_type(allocator)),
+      block_stamps_(stamp_allocator_type(allocator))
+  {
+  }
+
+  template<typename Allocator>
+  void change_tracker_t<Allocator>::stamp(
+    const std::size_t index, const uint64_t stamp)
+  {
+    stamps_[index] = stamp;
+    auto& block_stamp = block_stamps_[index / block_size_v];
+    block_stamp = std::max(block_stamp, stamp);
+  }
+
+  template<typename Allocator>
+  void change_tracker_t<Allocator>::record_change(const std::size_t index)
+  {
+    if (index >= stamps_.size()) {
+      stamps_.resize(index + 1, 0);
+      block_stamps_.resize(index / block_size_v + 1, 0);
+    }
+    stamp(index, ++version_);
+  }
+
+  template<typename Allocator>
+  void change_tracker_t<Allocator>::record_swap_remove(const std::size_t index)
+  {
+    stamp(index, stamps_.back());
+    stamps_.pop_back();
+  }
+
+  template<typename Allocator>
+  void change_tracker_t<Allocator>::record_discard(const std::size_t index)
+  {
+    // the block bound is left as is (it is an upper bound)
+    stamps_[index] = 0;
+  }
+
+  template<typename Allocator>
+  template<typename Index, typename OrderAllocator>
+  void change_tracker_t<Allocator>::record_reorder(
+    const Index begin, const std::vector<Index, OrderAllocator>& order)
+  {
+    auto reordered = std::vector<uint64_t, stamp_allocator_type>(
+      order.size(), 0, stamps_.get_allocator());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      reordered[i] = stamps_[static_cast<std::size_t>(order[i])];
+    }
+    const auto first = static_cast<std::size_t>(begin);
+    std::copy(reordered.begin(), reordered.end(), stamps_.begin() + first);
+    // recompute the bounds of the blocks touched
+    const auto last = first + order.size();
+    for (auto block = first / block_size_v;
+         block * block_size_v < last && block < block_stamps_.size();
+         ++block) {
+      const auto from = stamps_.begin() + block * block_size_v;
+      const auto to =
+        stamps_.begin() + std::min(stamps_.size(), (block + 1) * block_size_v);
+      block_stamps_[block] = *std::max_element(from, to);
+    }
+  }
+
+  template<typename Allocator>
+  void change_tracker_t<Allocator>::record_clear()
+  {
+    stamps_.clear();
+    block_stamps_.clear();
+  }
+
+  template<typename Allocator>
+  uint64_t change_tracker_t<Allocator>::version() const
+  {
+    return version_;
+  }
+
+  template<typename Allocator>
+  template<typename Fn>
+  void change_tracker_t<Allocator>::for_each_changed_since(
+    const uint64_t version, Fn&& fn) const
+  {
+    const auto blocks = block_stamps_.size();
+    for (std::size_t block = 0; block < blocks; ++block) {
+      if (block_stamps_[block] <= version) {
+        continue;
+      }
+      const auto first = block * block_size_v;
+      const auto last = std::min(stamps_.size(), first + block_size_v);
+      for (auto index = first; index < last; ++index) {
+        if (stamps_[index] > version) {
+          fn(index);
+        }
+      }
+    }
+  }
+
+  template<typename ValueIt, typename ChangeTracker>
+  change_stamping_iterator_t<ValueIt, ChangeTracker>::
+    change_stamping_iterator_t(
+      const ValueIt value, const std::size_t index, ChangeTracker& changes)
+    : value_(value), index_(index), changes_(&changes)
+  {
+  }
+
+  template<typename ValueIt, typename ChangeTracker>
+  auto change_stamping_iterator_t<ValueIt, ChangeTracker>::operator*() const
+    -> reference
+  {
+    changes_->record_change(index_);
+    return *value_;
+  }
+
+  template<typename ValueIt, typename ChangeTracker>
+  auto change_stamping_iterator_t<ValueIt, ChangeTracker>::operator->() const
+    -> pointer
+  {
+    changes_->record_change(index_);
+    return &*value_;
+  }
+
+  template<typename ValueIt, typename ChangeTracker>
+  auto change_stamping_iterator_t<ValueIt, ChangeTracker>::operator++()
+    -> change_stamping_iterator_t&
+  {
+    ++value_;
+    ++index_;
+    return *this;
+  }
+
+  template<typename ValueIt, typename ChangeTracker>
+  auto change_stamping_iterator_t<ValueIt, ChangeTracker>::operator++(int)
+    -> change_stamping_iterator_t
+  {
+    auto it = *this;
+    ++*this;
+    return it;
+  }
+
+  template<typename ValueIt, typename ChangeTracker>
+  bool change_stamping_iterator_t<ValueIt, ChangeTracker>::operator==(
+    const change_stamping_iterator_t& rhs) const
+  {
+    return index_ == rhs.index_;
+  }
+
+  template<typename ValueIt, typename ChangeTracker>
+  bool change_stamping_iterator_t<ValueIt, ChangeTracker>::operator!=(
+    const change_stamping_iterator_t& rhs) const
+  {
+    return index_ != rhs.index_;
+  }
+} // namespace thh
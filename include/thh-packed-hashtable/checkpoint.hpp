@@ -0,0 +1,239 @@
+#pragma once
+
+#include "snapshot.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace thh
+{
+  // number of elements of type T in a chunk tracked for checkpointing
+  // (roughly a page rounded down to a power of two, at least one element)
+  template<typename T>
+  inline constexpr int32_t checkpoint_chunk_size_v =
+    floor_pow2(std::max<int32_t>(1, int32_t(4096 / sizeof(T))));
+
+  // set of chunks modified since the last checkpoint, marking is constant time
+  // and visiting the dirty chunks is proportional to the number of them
+  template<typename Allocator>
+  class dirty_chunks_t
+  {
+    template<typename T>
+    using vector_t = std::vector<
+      T, typename std::allocator_traits<Allocator>::template rebind_alloc<T>>;
+
+    vector_t<bool> marked_;
+    vector_t<int64_t> chunks_;
+
+  public:
+    dirty_chunks_t() = default;
+    explicit dirty_chunks_t(const Allocator& allocator);
+
+    // marks a chunk as dirty
+    void mark(int64_t chunk);
+    // marks the chunks in the range [begin, end) as dirty
+    void mark(int64_t begin, int64_t end);
+    // returns the dirty chunks (in the order they were first marked)
+    [[nodiscard]] const vector_t<int64_t>& chunks() const;
+    // marks every chunk as clean
+    void clear();
+  };
+
+  // thread writing checkpoint files in the background, tasks run in the order
+  // they are pushed
+  class checkpoint_writer_t
+  {
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<std::packaged_task<bool()>> tasks_;
+    bool stop_ = false;
+    std::thread thread_;
+
+    // runs tasks until stopped (and no tasks remain)
+    void run();
+
+  public:
+    checkpoint_writer_t();
+    checkpoint_writer_t(const checkpoint_writer_t&) = delete;
+    checkpoint_writer_t& operator=(const checkpoint_writer_t&) = delete;
+    // finishes all pushed tasks then joins the thread
+    ~checkpoint_writer_t();
+
+    // queues a task, returns the result of the task once it has run
+    std::shared_future<bool> push(std::packaged_task<bool()> task);
+  };
+
+  // journal tracking the parts of a checkpoint file (a snapshot, see
+  // save_snapshot) that are out of date (see checkpointed_policy_t and
+  // checkpoint_async), value and handle slot changes are tracked in page sized
+  // chunks and key changes are applied to a copy of the key index at the next
+  // checkpoint
+  // note: the checkpoint file reserves space for a capacity (rounded up to a
+  // power of two) so incremental checkpoints can write chunks in place, the
+  // whole file is rewritten if the table outgrows it (or after clear)
+  // note: Key and Value must be trivially copyable
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  class checkpoint_tracker_t
+  {
+    static_assert(
+      std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>,
+      "Checkpoints require trivially copyable keys and values");
+
+    template<typename T>
+    using vector_t = std::vector<
+      T, typename std::allocator_traits<Allocator>::template rebind_alloc<T>>;
+    using entry_t = snapshot_entry_t<Key, Tag>;
+
+    static constexpr int32_t value_chunk_size_v =
+      checkpoint_chunk_size_v<Value>;
+    static constexpr int32_t slot_chunk_size_v =
+      checkpoint_chunk_size_v<snapshot_slot_t>;
+    static constexpr int32_t entry_chunk_size_v =
+      checkpoint_chunk_size_v<entry_t>;
+
+    // file writes handed to the background writer (clean copies of the dirty
+    // chunks, the owning thread does not touch them once the write starts)
+    struct write_t
+    {
+      std::string path_;
+      // rewrite the file from scratch (bytes_ holds the whole file)
+      bool truncate_ = false;
+      // bytes to write, ranges_ holds (file offset, size) of each part of
+      // bytes_ in order
+      std::vector<std::byte> bytes_;
+      std::vector<std::pair<uint64_t, uint64_t>> ranges_;
+    };
+
+    // dense positions of modified values (and dense ids)
+    dirty_chunks_t<Allocator> dirty_values_;
+    // ids of modified handle slots
+    dirty_chunks_t<Allocator> dirty_slots_;
+    // ids of removed handles
+    vector_t<int32_t> removed_ids_;
+    // key index changes in order (the key is empty for a removal)
+    vector_t<std::pair<typed_handle_t<Tag>, std::optional<Key>>>
+      index_changes_;
+    // if the next checkpoint must rewrite the whole file
+    bool full_ = true;
+
+    // path and layout of the checkpoint file
+    std::string path_;
+    snapshot_header_t header_{};
+    // number of values and handle slots the file has space for
+    int32_t capacity_ = 0;
+    int32_t index_shift_ = 64;
+    // copies of the handle slots and key index in the file
+    vector_t<snapshot_slot_t> slots_;
+    vector_t<entry_t> index_;
+    // position of each handle id in index_ (or -1)
+    vector_t<int32_t> index_positions_;
+    // number of bytes copied by the last checkpoint
+    std::size_t checkpoint_bytes_ = 0;
+    // most recent write (each write waits for the previous one)
+    std::shared_future<bool> pending_;
+    // background thread (started by the first checkpoint)
+    std::unique_ptr<checkpoint_writer_t> writer_;
+
+    // returns the mask for positions in the key index
+    [[nodiscard]] std::size_t index_mask() const;
+    // marks the chunk holding a dense position as dirty
+    void mark_position(int32_t position);
+    // adds a key to the copy of the key index (marking changed entries in
+    // dirty if it is not null)
+    template<typename Hash>
+    void index_insert(
+      const Key& key, typed_handle_t<Tag> handle,
+      dirty_chunks_t<Allocator>* dirty);
+    // removes a handle from the copy of the key index (later entries in the
+    // same probe sequence are shifted back), marks changed entries in dirty
+    template<typename Hash>
+    void index_erase(
+      typed_handle_t<Tag> handle, dirty_chunks_t<Allocator>& dirty);
+    // sets the file layout for a capacity (sizes are set per checkpoint)
+    void layout(int32_t capacity);
+    // copies the whole table into write (the file is rewritten)
+    template<typename Hash, typename Table>
+    void copy_all(const Table& table, write_t& write);
+    // copies the dirty chunks of the table into write
+    template<typename Hash, typename Table>
+    void copy_dirty(const Table& table, write_t& write);
+    // writes to the checkpoint file (runs on the background writer)
+    static bool write_file(const write_t& write);
+
+  public:
+    checkpoint_tracker_t() = default;
+    explicit checkpoint_tracker_t(const Allocator& allocator);
+    checkpoint_tracker_t(const checkpoint_tracker_t& other);
+    checkpoint_tracker_t(checkpoint_tracker_t&& other) noexcept = default;
+    checkpoint_tracker_t& operator=(const checkpoint_tracker_t& other);
+    checkpoint_tracker_t& operator=(
+      checkpoint_tracker_t&& other) noexcept = default;
+    // waits for any checkpoint in progress to be written
+    ~checkpoint_tracker_t() = default;
+
+    template<typename Values>
+    void record_add(
+      typed_handle_t<Tag> handle, const Key& key, const Values& values);
+    template<typename Values>
+    void record_update(typed_handle_t<Tag> handle, const Values& values);
+    template<typename Values>
+    void record_remove(typed_handle_t<Tag> handle, const Values& values);
+    void record_clear();
+    void record_reorder(int32_t begin, int32_t end);
+
+    // copies the chunks modified since the last checkpoint and writes them to
+    // the file at path on a background thread (see checkpoint_async)
+    template<typename Hash, typename Table>
+    std::shared_future<bool> checkpoint(const Table& table, const char* path);
+    // returns the number of bytes copied by the last checkpoint (the work
+    // done by the owning thread)
+    [[nodiscard]] std::size_t checkpoint_bytes() const;
+  };
+
+  // writes the contents of a packed hashtable using checkpointed_policy_t to
+  // a snapshot file at path (see save_snapshot and load_mmap) on a background
+  // thread, only the chunks of values, handle slots and the key index changed
+  // since the last checkpoint to the same path are copied (the pause for the
+  // calling thread is proportional to the number of changes)
+  // returns a future that becomes true once the file has been written (false
+  // if a write failed, the following checkpoint then rewrites the whole file)
+  // note: checkpoints are written in order, the file must not be loaded until
+  // the returned future is ready
+  // note: values removed but waiting for compaction are compacted first (see
+  // deferred_removal_policy_t) so value iterators and indices are invalidated
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  std::shared_future<bool> checkpoint_async(
+    base_packed_hashtable_t<
+      Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>&
+      packed_hashtable,
+    const char* path);
+
+  // policy tracking changes for incremental checkpoints (see
+  // checkpoint_async)
+  // note: other policy members are taken from BasePolicy
+  template<typename BasePolicy = packed_hashtable_policy_t>
+  struct checkpointed_policy_t : BasePolicy
+  {
+    template<typename Key, typename Value, typename Tag, typename Allocator>
+    using journal_t = checkpoint_tracker_t<Key, Value, Tag, Allocator>;
+  };
+} // namespace thh
+
+#include "checkpoint.inl"
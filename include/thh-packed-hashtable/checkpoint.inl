@@ -0,0 +1,525 @@
+namespace thh
+{
+  template<typename Allocator>
+  dirty_chunks_t<Allocator>::dirty_chunks_t(const Allocator& allocator)
+    : marked_(allocator), chunks_(allocator)
+  {
+  }
+
+  template<typename Allocator>
+  void dirty_chunks_t<Allocator>::mark(const int64_t chunk)
+  {
+    if (chunk >= static_cast<int64_t>(marked_.size())) {
+      marked_.resize(std::max<std::size_t>(chunk + 1, marked_.size() * 2));
+    }
+    if (!marked_[chunk]) {
+      marked_[chunk] = true;
+      chunks_.push_back(chunk);
+    }
+  }
+
+  template<typename Allocator>
+  void dirty_chunks_t<Allocator>::mark(const int64_t begin, const int64_t end)
+  {
+    for (auto chunk = begin; chunk < end; ++chunk) {
+      mark(chunk);
+    }
+  }
+
+  template<typename Allocator>
+  auto dirty_chunks_t<Allocator>::chunks() const -> const vector_t<int64_t>&
+  {
+    return chunks_;
+  }
+
+  template<typename Allocator>
+  void dirty_chunks_t<Allocator>::clear()
+  {
+    for (const auto chunk : chunks_) {
+      marked_[chunk] = false;
+    }
+    chunks_.clear();
+  }
+
+  inline checkpoint_writer_t::checkpoint_writer_t()
+    : thread_([this] { run(); })
+  {
+  }
+
+  inline checkpoint_writer_t::~checkpoint_writer_t()
+  {
+    {
+      std::lock_guard lock(mutex_);
+      stop_ = true;
+    }
+    ready_.notify_one();
+    thread_.join();
+  }
+
+  inline void checkpoint_writer_t::run()
+  {
+    for (;;) {
+      std::packaged_task<bool()> task;
+      {
+        std::unique_lock lock(mutex_);
+        ready_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+        if (tasks_.empty()) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+  inline std::shared_future<bool> checkpoint_writer_t::push(
+    std::packaged_task<bool()> task)
+  {
+    auto result = task.get_future().share();
+    {
+      std::lock_guard lock(mutex_);
+      tasks_.push_back(std::move(task));
+    }
+    ready_.notify_one();
+    return result;
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  checkpoint_tracker_t<Key, Value, Tag, Allocator>::checkpoint_tracker_t(
+    const Allocator& allocator)
+    : dirty_values_(allocator),
+      dirty_slots_(allocator),
+      removed_ids_(allocator),
+      index_changes_(allocator),
+      slots_(allocator),
+      index_(allocator),
+      index_positions_(allocator)
+  {
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  checkpoint_tracker_t<Key, Value, Tag, Allocator>::checkpoint_tracker_t(
+    const checkpoint_tracker_t& other)
+    : checkpoint_tracker_t(other.slots_.get_allocator())
+  {
+    // a copy is a different table, its first checkpoint writes every chunk
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  checkpoint_tracker_t<Key, Value, Tag, Allocator>& checkpoint_tracker_t<
+    Key, Value, Tag, Allocator>::operator=(const checkpoint_tracker_t& other)
+  {
+    if (this != &other) {
+      *this = checkpoint_tracker_t(other);
+    }
+    return *this;
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  std::size_t checkpoint_tracker_t<Key, Value, Tag, Allocator>::index_mask()
+    const
+  {
+    return index_.size() - 1;
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  void checkpoint_tracker_t<Key, Value, Tag, Allocator>::mark_position(
+    const int32_t position)
+  {
+    dirty_values_.mark(position / value_chunk_size_v);
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  template<typename Values>
+  void checkpoint_tracker_t<Key, Value, Tag, Allocator>::record_add(
+    const typed_handle_t<Tag> handle, const Key& key, const Values& values)
+  {
+    if (full_) {
+      return;
+    }
+    // the file has no space for the handle slot
+    if (handle.id_ >= capacity_) {
+      record_clear();
+      return;
+    }
+    if (const auto position = values.index_from_handle(handle);
+        position.has_value()) {
+      mark_position(*position);
+    }
+    dirty_slots_.mark(handle.id_ / slot_chunk_size_v);
+    index_changes_.push_back({handle, key});
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  template<typename Values>
+  void checkpoint_tracker_t<Key, Value, Tag, Allocator>::record_update(
+    const typed_handle_t<Tag> handle, const Values& values)
+  {
+    if (full_) {
+      return;
+    }
+    if (const auto position = values.index_from_handle(handle);
+        position.has_value()) {
+      mark_position(*position);
+    }
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  template<typename Values>
+  void checkpoint_tracker_t<Key, Value, Tag, Allocator>::record_remove(
+    const typed_handle_t<Tag> handle, const Values& values)
+  {
+    if (full_) {
+      return;
+    }
+    // the last value is moved into the position of the removed value
+    if (const auto position = values.index_from_handle(handle);
+        position.has_value()) {
+      mark_position(*position);
+      mark_position(values.size() - 1);
+    }
+    dirty_slots_.mark(handle.id_ / slot_chunk_size_v);
+    removed_ids_.push_back(handle.id_);
+    index_changes_.push_back({handle, std::nullopt});
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  void checkpoint_tracker_t<Key, Value, Tag, Allocator>::record_clear()
+  {
+    full_ = true;
+    dirty_values_.clear();
+    dirty_slots_.clear();
+    removed_ids_.clear();
+    index_changes_.clear();
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  void checkpoint_tracker_t<Key, Value, Tag, Allocator>::record_reorder(
+    const int32_t begin, const int32_t end)
+  {
+    if (full_ || begin >= end) {
+      return;
+    }
+    dirty_values_.mark(
+      begin / value_chunk_size_v, (end - 1) / value_chunk_size_v + 1);
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  template<typename Hash>
+  void checkpoint_tracker_t<Key, Value, Tag, Allocator>::index_insert(
+    const Key& key, const typed_handle_t<Tag> handle,
+    dirty_chunks_t<Allocator>* dirty)
+  {
+    auto position = snapshot_index_position(Hash()(key), index_shift_);
+    while (index_[position].handle_.id_ != -1) {
+      position = (position + 1) & index_mask();
+    }
+    index_[position].key_ = key;
+    index_[position].handle_ = handle;
+    index_positions_[handle.id_] = static_cast<int32_t>(position);
+    if (dirty != nullptr) {
+      dirty->mark(int64_t(position) / entry_chunk_size_v);
+    }
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  template<typename Hash>
+  void checkpoint_tracker_t<Key, Value, Tag, Allocator>::index_erase(
+    const typed_handle_t<Tag> handle, dirty_chunks_t<Allocator>& dirty)
+  {
+    if (
+      handle.id_ >= static_cast<int32_t>(index_positions_.size())
+      || index_positions_[handle.id_] == -1
+      || !(index_[index_positions_[handle.id_]].handle_ == handle)) {
+      return;
+    }
+    const auto mask = index_mask();
+    auto hole = static_cast<std::size_t>(index_positions_[handle.id_]);
+    index_positions_[handle.id_] = -1;
+    index_[hole] = entry_t{};
+    dirty.mark(int64_t(hole) / entry_chunk_size_v);
+    // move later entries back if the hole is within their probe sequence so
+    // lookups never stop early
+    for (auto next = (hole + 1) & mask; index_[next].handle_.id_ != -1;
+         next = (next + 1) & mask) {
+      const auto ideal =
+        snapshot_index_position(Hash()(index_[next].key_), index_shift_);
+      if (((next - ideal) & mask) >= ((next - hole) & mask)) {
+        index_[hole] = index_[next];
+        index_positions_[index_[hole].handle_.id_] =
+          static_cast<int32_t>(hole);
+        index_[next] = entry_t{};
+        dirty.mark(int64_t(hole) / entry_chunk_size_v);
+        dirty.mark(int64_t(next) / entry_chunk_size_v);
+        hole = next;
+      }
+    }
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  void checkpoint_tracker_t<Key, Value, Tag, Allocator>::layout(
+    const int32_t capacity)
+  {
+    const auto align = [](const uint64_t offset) {
+      return (offset + snapshot_alignment_v - 1) & ~(snapshot_alignment_v - 1);
+    };
+    capacity_ = capacity;
+    // key index with a load factor of at most 0.5
+    const auto index_capacity = uint64_t(capacity) * 2;
+    index_shift_ = 64;
+    for (auto count = index_capacity; count > 1; count /= 2) {
+      --index_shift_;
+    }
+    header_ = snapshot_header_t{};
+    header_.magic_ = {'T', 'H', 'H', 'P', 'H', 'T', 'S', 'N'};
+    header_.version_ = snapshot_version_v;
+    header_.key_size_ = sizeof(Key);
+    header_.value_size_ = sizeof(Value);
+    header_.entry_size_ = sizeof(entry_t);
+    header_.index_capacity_ = static_cast<int64_t>(index_capacity);
+    header_.values_offset_ = align(sizeof(snapshot_header_t));
+    header_.dense_ids_offset_ =
+      align(header_.values_offset_ + uint64_t(capacity) * sizeof(Value));
+    header_.slots_offset_ =
+      align(header_.dense_ids_offset_ + uint64_t(capacity) * sizeof(int32_t));
+    header_.index_offset_ = align(
+      header_.slots_offset_ + uint64_t(capacity) * sizeof(snapshot_slot_t));
+    header_.file_size_ =
+      header_.index_offset_ + index_capacity * sizeof(entry_t);
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  template<typename Hash, typename Table>
+  void checkpoint_tracker_t<Key, Value, Tag, Allocator>::copy_all(
+    const Table& table, write_t& write)
+  {
+    const auto size = table.size();
+    int32_t capacity = 64;
+    while (capacity < table.capacity()) {
+      capacity *= 2;
+    }
+    layout(capacity);
+
+    slots_.assign(capacity, snapshot_slot_t{-1, 0});
+    index_.assign(std::size_t(header_.index_capacity_), entry_t{});
+    index_positions_.assign(capacity, -1);
+    write.truncate_ = true;
+    write.bytes_.assign(header_.file_size_, std::byte{0});
+    write.ranges_.push_back({0, header_.file_size_});
+    auto* bytes = write.bytes_.data();
+
+    auto* values = bytes + header_.values_offset_;
+    for (const auto& value : table.value_iteration()) {
+      std::memcpy(values, &value, sizeof(Value));
+      values += sizeof(Value);
+    }
+    auto* dense_ids = bytes + header_.dense_ids_offset_;
+    for (int32_t position = 0; position < size; ++position) {
+      const auto handle = table.handle_from_index(position);
+      slots_[handle.id_] = snapshot_slot_t{position, handle.gen_};
+      std::memcpy(
+        dense_ids + position * sizeof(int32_t), &handle.id_, sizeof(int32_t));
+    }
+    for (const auto& key_handle : table.handle_iteration()) {
+      index_insert<Hash>(key_handle.first, key_handle.second, nullptr);
+    }
+    std::memcpy(
+      bytes + header_.slots_offset_, slots_.data(),
+      slots_.size() * sizeof(snapshot_slot_t));
+    std::memcpy(
+      bytes + header_.index_offset_, index_.data(),
+      index_.size() * sizeof(entry_t));
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  template<typename Hash, typename Table>
+  void checkpoint_tracker_t<Key, Value, Tag, Allocator>::copy_dirty(
+    const Table& table, write_t& write)
+  {
+    const auto size = table.size();
+
+    // bring the copies of the handle slots and key index up to date
+    for (const auto id : removed_ids_) {
+      slots_[id] = snapshot_slot_t{-1, 0};
+    }
+    for (const auto chunk : dirty_values_.chunks()) {
+      const auto begin = int32_t(chunk) * value_chunk_size_v;
+      const auto end = std::min(begin + value_chunk_size_v, size);
+      for (auto position = begin; position < end; ++position) {
+        const auto handle = table.handle_from_index(position);
+        slots_[handle.id_] = snapshot_slot_t{position, handle.gen_};
+        dirty_slots_.mark(handle.id_ / slot_chunk_size_v);
+      }
+    }
+    dirty_chunks_t<Allocator> dirty_index(slots_.get_allocator());
+    for (const auto& [handle, key] : index_changes_) {
+      if (key.has_value()) {
+        index_insert<Hash>(*key, handle, &dirty_index);
+      } else {
+        index_erase<Hash>(handle, dirty_index);
+      }
+    }
+
+    // allocate the copies up front so the buffer is not reallocated
+    write.bytes_.reserve(
+      dirty_values_.chunks().size() * value_chunk_size_v
+        * (sizeof(Value) + sizeof(int32_t))
+      + dirty_slots_.chunks().size() * slot_chunk_size_v
+          * sizeof(snapshot_slot_t)
+      + dirty_index.chunks().size() * entry_chunk_size_v * sizeof(entry_t)
+      + sizeof(snapshot_header_t));
+    // reserves space for a part of the file and returns where to copy it
+    const auto reserve = [&write](const uint64_t offset, const uint64_t size) {
+      const auto at = write.bytes_.size();
+      write.bytes_.resize(at + size);
+      write.ranges_.push_back({offset, size});
+      return write.bytes_.data() + at;
+    };
+    for (const auto chunk : dirty_values_.chunks()) {
+      const auto begin = int32_t(chunk) * value_chunk_size_v;
+      const auto count = std::min(value_chunk_size_v, capacity_ - begin);
+      if (count <= 0) {
+        continue;
+      }
+      auto* values = reserve(
+        header_.values_offset_ + uint64_t(begin) * sizeof(Value),
+        uint64_t(count) * sizeof(Value));
+      auto* dense_ids = reserve(
+        header_.dense_ids_offset_ + uint64_t(begin) * sizeof(int32_t),
+        uint64_t(count) * sizeof(int32_t));
+      auto value = table.vcbegin() + begin;
+      for (auto offset = 0; offset < std::min(count, size - begin); ++offset) {
+        std::memcpy(values + offset * sizeof(Value), &*value++, sizeof(Value));
+        const auto id = table.handle_from_index(begin + offset).id_;
+        std::memcpy(dense_ids + offset * sizeof(int32_t), &id, sizeof(int32_t));
+      }
+    }
+    for (const auto chunk : dirty_slots_.chunks()) {
+      const auto begin = int32_t(chunk) * slot_chunk_size_v;
+      const auto count = std::min(slot_chunk_size_v, capacity_ - begin);
+      if (count > 0) {
+        std::memcpy(
+          reserve(
+            header_.slots_offset_ + uint64_t(begin) * sizeof(snapshot_slot_t),
+            uint64_t(count) * sizeof(snapshot_slot_t)),
+          slots_.data() + begin, count * sizeof(snapshot_slot_t));
+      }
+    }
+    for (const auto chunk : dirty_index.chunks()) {
+      const auto begin = std::size_t(chunk) * entry_chunk_size_v;
+      const auto count = std::min<std::size_t>(
+        entry_chunk_size_v, index_.size() - begin);
+      std::memcpy(
+        reserve(
+          header_.index_offset_ + begin * sizeof(entry_t),
+          count * sizeof(entry_t)),
+        index_.data() + begin, count * sizeof(entry_t));
+    }
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  bool checkpoint_tracker_t<Key, Value, Tag, Allocator>::write_file(
+    const write_t& write)
+  {
+    auto mode = std::ios::binary | std::ios::out;
+    mode |= write.truncate_ ? std::ios::trunc : std::ios::in;
+    std::fstream file(write.path_, mode);
+    const auto* bytes = write.bytes_.data();
+    for (const auto& [offset, size] : write.ranges_) {
+      file.seekp(static_cast<std::streamoff>(offset));
+      file.write(
+        reinterpret_cast<const char*>(bytes),
+        static_cast<std::streamsize>(size));
+      bytes += size;
+    }
+    file.flush();
+    return file.good();
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  template<typename Hash, typename Table>
+  std::shared_future<bool> checkpoint_tracker_t<Key, Value, Tag, Allocator>::
+    checkpoint(const Table& table, const char* path)
+  {
+    // a failed write leaves the file in an unknown state
+    if (
+      pending_.valid()
+      && pending_.wait_for(std::chrono::seconds(0)) == std::future_status::ready
+      && !pending_.get()) {
+      full_ = true;
+    }
+    if (path_ != path) {
+      path_ = path;
+      full_ = true;
+    }
+    // the file must have space for every handle slot and for the key index
+    // to stay at most half full while the changes are applied (keys added
+    // since the last checkpoint are inserted before later removals)
+    const auto added = std::count_if(
+      index_changes_.begin(), index_changes_.end(),
+      [](const auto& change) { return change.second.has_value(); });
+    if (table.capacity() > capacity_ || header_.size_ + added > capacity_) {
+      full_ = true;
+    }
+
+    write_t write;
+    write.path_ = path_;
+    if (full_) {
+      copy_all<Hash>(table, write);
+    } else {
+      copy_dirty<Hash>(table, write);
+    }
+    header_.size_ = table.size();
+    header_.slot_count_ = table.capacity();
+    if (write.truncate_) {
+      std::memcpy(write.bytes_.data(), &header_, sizeof(header_));
+    } else {
+      write.ranges_.push_back({0, sizeof(header_)});
+      const auto at = write.bytes_.size();
+      write.bytes_.resize(at + sizeof(header_));
+      std::memcpy(write.bytes_.data() + at, &header_, sizeof(header_));
+    }
+    checkpoint_bytes_ = write.bytes_.size();
+
+    full_ = false;
+    dirty_values_.clear();
+    dirty_slots_.clear();
+    removed_ids_.clear();
+    index_changes_.clear();
+
+    // writes run in order, after a failure later writes are skipped until
+    // the file is rewritten
+    if (writer_ == nullptr) {
+      writer_ = std::make_unique<checkpoint_writer_t>();
+    }
+    pending_ = writer_->push(std::packaged_task<bool()>(
+      [previous = pending_, write = std::move(write)] {
+        const auto previous_written = !previous.valid() || previous.get();
+        return previous_written || write.truncate_ ? write_file(write) : false;
+      }));
+    return pending_;
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  std::size_t checkpoint_tracker_t<
+    Key, Value, Tag, Allocator>::checkpoint_bytes() const
+  {
+    return checkpoint_bytes_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  std::shared_future<bool> checkpoint_async(
+    base_packed_hashtable_t<
+      Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>&
+      packed_hashtable,
+    const char* path)
+  {
+    // the file holds the values in dense order without holes
+    packed_hashtable.compact_removals();
+    return packed_hashtable.journal().template checkpoint<Hash>(
+      packed_hashtable, path);
+  }
+} // namespace thh
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <thh-handle-vector/handle-vector.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace thh
+{
+  // handle packing an id (the low IndexBits bits) and a generation (the
+  // remaining bits, at most 31) into a single unsigned Word, e.g. the default
+  // of 32 bits with a 24/8 split is half the size of typed_handle_t and
+  // addresses up to 16M elements (see compact_handle_policy_t)
+  // note: converts implicitly to and from typed_handle_t so it can be passed
+  // to functions taking a typed_handle_t
+  // note: the generation wraps (after 256 removals from the same slot with
+  // 8 bits) so a handle kept that long may refer to a new element, use more
+  // generation bits if handles are held for a long time
+  // note: all bits set is the invalid handle
+  template<typename Tag, typename Word = uint32_t, int32_t IndexBits = 24>
+  struct compact_handle_t
+  {
+    static_assert(std::is_unsigned_v<Word>, "Word must be an unsigned type");
+    static_assert(
+      IndexBits > 0 && IndexBits <= 31
+        && IndexBits < std::numeric_limits<Word>::digits,
+      "IndexBits must be less than the bits in Word and at most 31");
+
+    // number of bits used for the generation
+    static constexpr int32_t gen_bits_v =
+      std::min(std::numeric_limits<Word>::digits - IndexBits, 31);
+    // mask for the id (the id with every bit set is reserved for invalid
+    // handles)
+    static constexpr Word id_mask_v = (Word(1) << IndexBits) - 1;
+    // mask for the generation (after shifting)
+    static constexpr Word gen_mask_v = (Word(1) << gen_bits_v) - 1;
+
+    Word bits_ = ~Word(0);
+
+    compact_handle_t() = default;
+    // packs a typed_handle_t (invalid if the id or generation do not fit)
+    constexpr compact_handle_t(typed_handle_t<Tag> handle);
+    // unpacks to a typed_handle_t (the invalid handle unpacks to {-1, -1})
+    constexpr operator typed_handle_t<Tag>() const;
+
+    // returns the id of the handle
+    [[nodiscard]] constexpr int32_t id() const;
+    // returns the generation of the handle
+    [[nodiscard]] constexpr int32_t gen() const;
+  };
+
+  template<typename Tag, typename Word, int32_t IndexBits>
+  constexpr bool operator==(
+    const compact_handle_t<Tag, Word, IndexBits>& lhs,
+    const compact_handle_t<Tag, Word, IndexBits>& rhs);
+  template<typename Tag, typename Word, int32_t IndexBits>
+  constexpr bool operator!=(
+    const compact_handle_t<Tag, Word, IndexBits>& lhs,
+    const compact_handle_t<Tag, Word, IndexBits>& rhs);
+
+  // hash function implementation for compact_handle_t (a single word so no
+  // combining is required)
+  template<typename Tag, typename Word = uint32_t, int32_t IndexBits = 24>
+  struct compact_handle_hash_t
+  {
+    std::size_t operator()(
+      const compact_handle_t<Tag, Word, IndexBits>& handle) const
+    {
+      return std::hash<Word>{}(handle.bits_);
+    }
+  };
+
+  // handle slots packed into a single Word per slot (the dense index in the
+  // low IndexBits bits and the generation in the rest, see compact_handle_t)
+  // instead of two int32_t values, halving the size of the sparse slots
+  // note: the interface matches handle_slots_t so it can be used in its place
+  // note: free slots store the next free slot in the dense index bits, a slot
+  // is live if the dense id at its index refers back to it
+  // note: throws std::length_error if more than 2^IndexBits - 1 slots are
+  // required
+  template<
+    typename Tag, typename Allocator = std::allocator<int32_t>,
+    typename Word = uint32_t, int32_t IndexBits = 24>
+  class compact_handle_slots_t
+  {
+    using handle_t = compact_handle_t<Tag, Word, IndexBits>;
+    using slot_allocator_type =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Word>;
+    using id_allocator_type =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<int32_t>;
+
+    // sparse handle slots (indexed by handle id)
+    std::vector<Word, slot_allocator_type> slots_;
+    // dense slot ids (indexed by element position)
+    std::vector<int32_t, id_allocator_type> dense_ids_;
+    // head of the free slot list (-1 if there are no free slots)
+    int32_t next_free_ = -1;
+    // generation of new slots, greater than the generation of any slot
+    // released by shrink_to_fit (until the generation wraps)
+    int32_t min_gen_ = 0;
+
+    // packs a dense index (or next free slot) and a generation into a slot
+    static Word pack(int32_t lookup, int32_t gen);
+    // returns the dense index (or next free slot) of a slot
+    static int32_t lookup(Word slot);
+    // returns the generation of a slot
+    static int32_t gen(Word slot);
+    // returns if the slot with the id specified is in use
+    bool live(int32_t id) const;
+    // grows slots_ so there is always at least one free slot available
+    void try_grow_slots();
+    // returns one past the highest slot id in use
+    int32_t used_slots() const;
+
+  public:
+    using handle_type = typed_handle_t<Tag>;
+    using size_type = int32_t;
+    // allocator for scratch index buffers (e.g. the order passed to reorder)
+    using order_allocator_type = id_allocator_type;
+
+    compact_handle_slots_t() = default;
+    explicit compact_handle_slots_t(const Allocator& allocator);
+    compact_handle_slots_t(const compact_handle_slots_t& other) = default;
+    compact_handle_slots_t(compact_handle_slots_t&& other) noexcept;
+    compact_handle_slots_t& operator=(
+      const compact_handle_slots_t& other) = default;
+    compact_handle_slots_t& operator=(compact_handle_slots_t&& other) noexcept;
+    ~compact_handle_slots_t() = default;
+
+    // allocates a new slot and returns its handle
+    // note: the new element is positioned at the end of the dense range
+    typed_handle_t<Tag> add();
+    // frees the slot for the handle, swapping the last dense element into
+    // the position of the removed element
+    // returns the dense index of the removed element or an empty optional if
+    // the handle is invalid
+    std::optional<int32_t> remove(typed_handle_t<Tag> handle);
+    // frees all slots, invalidating all handles
+    void clear();
+    // reserves slots for the number of elements specified
+    void reserve(int32_t capacity);
+    // releases free slots after the highest slot id in use and unused dense
+    // id capacity
+    void shrink_to_fit();
+    // returns the number of bytes shrink_to_fit would release
+    [[nodiscard]] std::size_t reclaimable_bytes() const;
+    // returns if the handle refers to a live element
+    [[nodiscard]] bool has(typed_handle_t<Tag> handle) const;
+    // returns the number of live elements
+    [[nodiscard]] int32_t size() const;
+    // returns the number of available slots
+    [[nodiscard]] int32_t capacity() const;
+    // returns the handle for the element at a given index
+    // note: will return an invalid handle if the index is out of range
+    [[nodiscard]] typed_handle_t<Tag> handle_from_index(int32_t index) const;
+    // returns the index of the element for a given handle
+    // note: will return an empty optional if the handle is invalid
+    [[nodiscard]] std::optional<int32_t> index_from_handle(
+      typed_handle_t<Tag> handle) const;
+    // returns the allocator for scratch index buffers
+    [[nodiscard]] order_allocator_type get_allocator() const;
+    // reorders the dense range starting at begin so position begin + i holds
+    // the element previously at order[i]
+    template<typename OrderAllocator>
+    void reorder(
+      int32_t begin, const std::vector<int32_t, OrderAllocator>& order);
+  };
+} // namespace thh
+
+#include "compact-handle.inl"
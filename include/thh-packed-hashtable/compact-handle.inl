@@ -0,0 +1,325 @@
+namespace thh
+{
+  template<typename Tag, typename Word, int32_t IndexBits>
+  constexpr compact_handle_t<Tag, Word, IndexBits>::compact_handle_t(
+    const typed_handle_t<Tag> handle)
+  {
+    if (
+      handle.id_ >= 0 && Word(handle.id_) < id_mask_v && handle.gen_ >= 0
+      && Word(handle.gen_) <= gen_mask_v) {
+      bits_ = Word(handle.id_) | (Word(handle.gen_) << IndexBits);
+    }
+  }
+
+  template<typename Tag, typename Word, int32_t IndexBits>
+  constexpr compact_handle_t<Tag, Word, IndexBits>::operator typed_handle_t<
+    Tag>() const
+  {
+    typed_handle_t<Tag> handle;
+    if (bits_ != ~Word(0)) {
+      handle.id_ = id();
+      handle.gen_ = gen();
+    }
+    return handle;
+  }
+
+  template<typename Tag, typename Word, int32_t IndexBits>
+  constexpr int32_t compact_handle_t<Tag, Word, IndexBits>::id() const
+  {
+    return static_cast<int32_t>(bits_ & id_mask_v);
+  }
+
+  template<typename Tag, typename Word, int32_t IndexBits>
+  constexpr int32_t compact_handle_t<Tag, Word, IndexBits>::gen() const
+  {
+    return static_cast<int32_t>((bits_ >> IndexBits) & gen_mask_v);
+  }
+
+  template<typename Tag, typename Word, int32_t IndexBits>
+  constexpr bool operator==(
+    const compact_handle_t<Tag, Word, IndexBits>& lhs,
+    const compact_handle_t<Tag, Word, IndexBits>& rhs)
+  {
+    return lhs.bits_ == rhs.bits_;
+  }
+
+  template<typename Tag, typename Word, int32_t IndexBits>
+  constexpr bool operator!=(
+    const compact_handle_t<Tag, Word, IndexBits>& lhs,
+    const compact_handle_t<Tag, Word, IndexBits>& rhs)
+  {
+    return !(lhs == rhs);
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  Word compact_handle_slots_t<Tag, Allocator, Word, IndexBits>::pack(
+    const int32_t lookup, const int32_t gen)
+  {
+    return Word(lookup) | (Word(gen) << IndexBits);
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  int32_t compact_handle_slots_t<Tag, Allocator, Word, IndexBits>::lookup(
+    const Word slot)
+  {
+    return static_cast<int32_t>(slot & handle_t::id_mask_v);
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  int32_t compact_handle_slots_t<Tag, Allocator, Word, IndexBits>::gen(
+    const Word slot)
+  {
+    return static_cast<int32_t>((slot >> IndexBits) & handle_t::gen_mask_v);
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  bool compact_handle_slots_t<Tag, Allocator, Word, IndexBits>::live(
+    const int32_t id) const
+  {
+    const auto index = lookup(slots_[id]);
+    return index < static_cast<int32_t>(dense_ids_.size())
+        && dense_ids_[index] == id;
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  void compact_handle_slots_t<
+    Tag, Allocator, Word, IndexBits>::try_grow_slots()
+  {
+    if (next_free_ == -1) {
+      constexpr auto max_slots = static_cast<int32_t>(handle_t::id_mask_v);
+      const auto slot_count = static_cast<int32_t>(slots_.size());
+      if (slot_count == max_slots) {
+        throw std::length_error("compact handle ids exhausted");
+      }
+      reserve(
+        slot_count == 0 ? 1
+                        : static_cast<int32_t>(std::min<int64_t>(
+                          int64_t(slot_count) * 2, max_slots)));
+    }
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  int32_t compact_handle_slots_t<
+    Tag, Allocator, Word, IndexBits>::used_slots() const
+  {
+    int32_t used = 0;
+    for (const auto id : dense_ids_) {
+      used = std::max(used, id + 1);
+    }
+    return used;
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  compact_handle_slots_t<Tag, Allocator, Word, IndexBits>::
+    compact_handle_slots_t(const Allocator& allocator)
+    : slots_(slot_allocator_type(allocator)),
+      dense_ids_(id_allocator_type(allocator))
+  {
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  compact_handle_slots_t<Tag, Allocator, Word, IndexBits>::
+    compact_handle_slots_t(compact_handle_slots_t&& other) noexcept
+    : slots_(std::move(other.slots_)),
+      dense_ids_(std::move(other.dense_ids_)),
+      next_free_(std::exchange(other.next_free_, -1)),
+      min_gen_(other.min_gen_)
+  {
+    other.slots_.clear();
+    other.dense_ids_.clear();
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  auto compact_handle_slots_t<Tag, Allocator, Word, IndexBits>::operator=(
+    compact_handle_slots_t&& other) noexcept -> compact_handle_slots_t&
+  {
+    slots_ = std::move(other.slots_);
+    dense_ids_ = std::move(other.dense_ids_);
+    next_free_ = std::exchange(other.next_free_, -1);
+    min_gen_ = other.min_gen_;
+    other.slots_.clear();
+    other.dense_ids_.clear();
+    return *this;
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  typed_handle_t<Tag> compact_handle_slots_t<
+    Tag, Allocator, Word, IndexBits>::add()
+  {
+    try_grow_slots();
+    const auto id = next_free_;
+    auto& slot = slots_[id];
+    const auto next_free = lookup(slot);
+    next_free_ =
+      next_free == static_cast<int32_t>(handle_t::id_mask_v) ? -1 : next_free;
+    slot = pack(static_cast<int32_t>(dense_ids_.size()), gen(slot));
+    dense_ids_.push_back(id);
+    typed_handle_t<Tag> handle;
+    handle.id_ = id;
+    handle.gen_ = gen(slot);
+    return handle;
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  std::optional<int32_t> compact_handle_slots_t<
+    Tag, Allocator, Word, IndexBits>::remove(const typed_handle_t<Tag> handle)
+  {
+    if (!has(handle)) {
+      return {};
+    }
+    auto& slot = slots_[handle.id_];
+    const auto index = lookup(slot);
+    const auto last = static_cast<int32_t>(dense_ids_.size()) - 1;
+    if (index != last) {
+      dense_ids_[index] = dense_ids_[last];
+      auto& moved = slots_[dense_ids_[index]];
+      moved = pack(index, gen(moved));
+    }
+    dense_ids_.pop_back();
+    slot = pack(
+      next_free_ == -1 ? static_cast<int32_t>(handle_t::id_mask_v) : next_free_,
+      (gen(slot) + 1) & static_cast<int32_t>(handle_t::gen_mask_v));
+    next_free_ = handle.id_;
+    return index;
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  void compact_handle_slots_t<Tag, Allocator, Word, IndexBits>::clear()
+  {
+    for (const auto id : dense_ids_) {
+      auto& slot = slots_[id];
+      slot = pack(
+        next_free_ == -1 ? static_cast<int32_t>(handle_t::id_mask_v)
+                         : next_free_,
+        (gen(slot) + 1) & static_cast<int32_t>(handle_t::gen_mask_v));
+      next_free_ = id;
+    }
+    dense_ids_.clear();
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  void compact_handle_slots_t<Tag, Allocator, Word, IndexBits>::reserve(
+    const int32_t capacity)
+  {
+    const auto slot_count = static_cast<int32_t>(slots_.size());
+    if (capacity <= slot_count) {
+      return;
+    }
+    if (capacity > static_cast<int32_t>(handle_t::id_mask_v)) {
+      throw std::length_error("compact handle ids exhausted");
+    }
+    slots_.resize(capacity);
+    // link new slots in order, the last new slot links to the previous head
+    for (int32_t id = slot_count; id < capacity - 1; ++id) {
+      slots_[id] = pack(id + 1, min_gen_);
+    }
+    slots_[capacity - 1] = pack(
+      next_free_ == -1 ? static_cast<int32_t>(handle_t::id_mask_v) : next_free_,
+      min_gen_);
+    next_free_ = slot_count;
+    dense_ids_.reserve(capacity);
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  void compact_handle_slots_t<
+    Tag, Allocator, Word, IndexBits>::shrink_to_fit()
+  {
+    const auto used = used_slots();
+    for (int32_t id = used; id < static_cast<int32_t>(slots_.size()); ++id) {
+      min_gen_ = std::max(min_gen_, gen(slots_[id]));
+    }
+    slots_.resize(used);
+    slots_.shrink_to_fit();
+    dense_ids_.shrink_to_fit();
+    // relink the remaining free slots in order (lowest ids are reused first)
+    next_free_ = -1;
+    for (int32_t id = used - 1; id >= 0; --id) {
+      if (!live(id)) {
+        slots_[id] = pack(
+          next_free_ == -1 ? static_cast<int32_t>(handle_t::id_mask_v)
+                           : next_free_,
+          gen(slots_[id]));
+        next_free_ = id;
+      }
+    }
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  std::size_t compact_handle_slots_t<
+    Tag, Allocator, Word, IndexBits>::reclaimable_bytes() const
+  {
+    return (slots_.capacity() - used_slots()) * sizeof(Word)
+         + (dense_ids_.capacity() - dense_ids_.size()) * sizeof(int32_t);
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  bool compact_handle_slots_t<Tag, Allocator, Word, IndexBits>::has(
+    const typed_handle_t<Tag> handle) const
+  {
+    return handle.id_ >= 0 && handle.id_ < static_cast<int32_t>(slots_.size())
+        && live(handle.id_) && gen(slots_[handle.id_]) == handle.gen_;
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  int32_t compact_handle_slots_t<Tag, Allocator, Word, IndexBits>::size() const
+  {
+    return static_cast<int32_t>(dense_ids_.size());
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  int32_t compact_handle_slots_t<
+    Tag, Allocator, Word, IndexBits>::capacity() const
+  {
+    return static_cast<int32_t>(slots_.size());
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  typed_handle_t<Tag> compact_handle_slots_t<
+    Tag, Allocator, Word, IndexBits>::handle_from_index(const int32_t index)
+    const
+  {
+    typed_handle_t<Tag> handle;
+    if (index >= 0 && index < size()) {
+      handle.id_ = dense_ids_[index];
+      handle.gen_ = gen(slots_[handle.id_]);
+    }
+    return handle;
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  std::optional<int32_t> compact_handle_slots_t<
+    Tag, Allocator, Word,
+    IndexBits>::index_from_handle(const typed_handle_t<Tag> handle) const
+  {
+    if (!has(handle)) {
+      return {};
+    }
+    return lookup(slots_[handle.id_]);
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  auto compact_handle_slots_t<Tag, Allocator, Word, IndexBits>::get_allocator()
+    const -> order_allocator_type
+  {
+    return dense_ids_.get_allocator();
+  }
+
+  template<typename Tag, typename Allocator, typename Word, int32_t IndexBits>
+  template<typename OrderAllocator>
+  void compact_handle_slots_t<Tag, Allocator, Word, IndexBits>::reorder(
+    const int32_t begin,
+    const std::vector<int32_t, OrderAllocator>& order)
+  {
+    auto ids = std::vector<int32_t, id_allocator_type>(get_allocator());
+    ids.reserve(order.size());
+    for (const auto index : order) {
+      ids.push_back(dense_ids_[index]);
+    }
+    for (int32_t offset = 0; offset < static_cast<int32_t>(ids.size());
+         ++offset) {
+      dense_ids_[begin + offset] = ids[offset];
+      auto& slot = slots_[ids[offset]];
+      slot = pack(begin + offset, gen(slot));
+    }
+  }
+} // namespace thh
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+namespace thh
+{
+  // holds a member of a class as an empty base when it has no state (e.g. the
+  // noop default policies of a packed hashtable) so it takes no space (empty
+  // base optimisation), otherwise as a data member
+  // note: Index distinguishes holders of the same member type
+  // note: a Mutable member can be modified through a const holder (matching
+  // a mutable data member)
+  template<
+    typename Member, int32_t Index, bool Mutable = false,
+    bool Empty = std::is_empty_v<Member> && !std::is_final_v<Member>>
+  class compressed_member_t : private Member
+  {
+  public:
+    compressed_member_t() = default;
+    template<typename Allocator>
+    explicit compressed_member_t(const Allocator& allocator)
+      : Member(allocator)
+    {
+    }
+
+    [[nodiscard]] Member& get() { return *this; }
+    [[nodiscard]] auto get() const
+      -> std::conditional_t<Mutable, Member&, const Member&>
+    {
+      // an empty member has no state to modify
+      return const_cast<compressed_member_t&>(*this);
+    }
+  };
+
+  // holds a member with state as a data member (see compressed_member_t)
+  template<typename Member, int32_t Index, bool Mutable>
+  class compressed_member_t<Member, Index, Mutable, false>
+  {
+    // mutable so a Mutable member can be returned from the const get (only a
+    // const reference is returned otherwise)
+    mutable Member member_;
+
+  public:
+    compressed_member_t() = default;
+    template<typename Allocator>
+    explicit compressed_member_t(const Allocator& allocator)
+      : member_(allocator)
+    {
+    }
+
+    [[nodiscard]] Member& get() { return member_; }
+    [[nodiscard]] auto get() const
+      -> std::conditional_t<Mutable, Member&, const Member&>
+    {
+      return member_;
+    }
+  };
+} // namespace thh
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "packed-hashtable.hpp"
+#include "timing-wheel.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace thh
+{
+  // packed_hashtable_rl_t with a time to live for each element, expire(now)
+  // removes the elements whose deadline has passed using a hierarchical timing
+  // wheel keyed by handle (see timing_wheel_t), so each call does work
+  // proportional to the expired elements instead of visiting every value
+  // (e.g. a remove_when sweep)
+  // ticks are defined by the caller (e.g. milliseconds), a time to live is
+  // counted from the tick passed to the last expire call
+  // with deferred_removal_policy_t (the default) expired elements are marked
+  // and then released with one compact_removals per expire call, with other
+  // policies each is removed immediately (the last value is moved into its
+  // place)
+  // note: elements added or removed through table() are supported, an element
+  // added without a time to live never expires (see expire_after)
+  template<
+    typename Key, typename Value, typename Hash = std::hash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Tag = packed_hashtable_tag_t,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>,
+    typename Policy = deferred_removal_policy_t<>>
+  class expiring_packed_hashtable_t
+  {
+    using table_t = packed_hashtable_rl_t<
+      Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>;
+
+    table_t table_;
+    timing_wheel_t<typename table_t::handle_type, Allocator> wheel_;
+
+  public:
+    using table_type = table_t;
+    using key_value_type = typename table_t::key_value_type;
+    using handle_type = typename table_t::handle_type;
+    using handle_iterator = typename table_t::handle_iterator;
+    using size_type = typename table_t::size_type;
+
+    expiring_packed_hashtable_t() = default;
+    // constructs an empty container using the allocator provided for all
+    // internal allocations
+    explicit expiring_packed_hashtable_t(const Allocator& allocator);
+
+    // adds a value to the container which expires ttl ticks after now()
+    // returns a pair consisting of an iterator to the inserted element (or to
+    // the element that prevented the insertion) and a bool indicating whether
+    // the insertion took place
+    // type P should conform to key_value_type
+    // note: the time to live of an existing element is unchanged
+    template<typename P>
+    std::pair<handle_iterator, bool> add(P&& key_value, uint64_t ttl);
+    // adds a value to the container which expires ttl ticks after now()
+    // (rvalue reference)
+    // note: supports .add({key, value}, ttl) syntax
+    std::pair<handle_iterator, bool> add(
+      key_value_type&& key_value, uint64_t ttl);
+    // adds a value to the container or updates it if the key already exists,
+    // the element expires ttl ticks after now() (replacing any earlier time
+    // to live)
+    // type P should conform to key_value_type
+    template<typename P>
+    std::pair<handle_iterator, bool> add_or_update(P&& key_value, uint64_t ttl);
+    // adds a value to the container or updates it if the key already exists
+    // (rvalue reference)
+    // note: supports .add_or_update({key, value}, ttl) syntax
+    std::pair<handle_iterator, bool> add_or_update(
+      key_value_type&& key_value, uint64_t ttl);
+    // sets the element with the handle to expire ttl ticks after now()
+    // (replacing any earlier time to live)
+    // returns false if the handle is invalid
+    bool expire_after(handle_type handle, uint64_t ttl);
+    // removes the time to live of the element with the handle (it no longer
+    // expires)
+    void persist(handle_type handle);
+    // returns the tick the element with the handle expires at
+    // note: will return an empty optional if the element does not expire
+    [[nodiscard]] std::optional<uint64_t> deadline(handle_type handle) const;
+    // removes every element whose deadline is at or before now
+    // returns the number of elements removed
+    // note: does nothing if now is before now()
+    size_type expire(uint64_t now);
+    // returns the tick passed to the last expire call (0 before the first)
+    [[nodiscard]] uint64_t now() const;
+    // removes all elements from the container (the current tick is unchanged)
+    void clear();
+    // returns the number of elements in the container
+    [[nodiscard]] size_type size() const;
+    // returns if the container has any elements or not
+    [[nodiscard]] bool empty() const;
+    // returns the underlying table (for lookups, iteration and elements
+    // without a time to live)
+    [[nodiscard]] auto table() -> table_type&;
+    // returns the underlying table (const overload)
+    [[nodiscard]] auto table() const -> const table_type&;
+  };
+} // namespace thh
+
+#include "expiring-hashtable.inl"
@@ -0,0 +1,184 @@
+namespace thh
+{
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  expiring_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::expiring_packed_hashtable_t(const Allocator& allocator)
+    : table_(allocator), wheel_(allocator)
+  {
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  template<typename P>
+  auto expiring_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::add(P&& key_value, const uint64_t ttl)
+    -> std::pair<handle_iterator, bool>
+  {
+    auto result = table_.add(std::forward<P>(key_value));
+    if (result.second) {
+      wheel_.schedule(result.first->second, wheel_.now() + ttl);
+    }
+    return result;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  auto expiring_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::add(key_value_type&& key_value, const uint64_t ttl)
+    -> std::pair<handle_iterator, bool>
+  {
+    return add<key_value_type>(std::move(key_value), ttl);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  template<typename P>
+  auto expiring_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::add_or_update(P&& key_value, const uint64_t ttl)
+    -> std::pair<handle_iterator, bool>
+  {
+    auto result = table_.add_or_update(std::forward<P>(key_value));
+    if (result.first != table_.hend()) {
+      wheel_.schedule(result.first->second, wheel_.now() + ttl);
+    }
+    return result;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  auto expiring_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::add_or_update(key_value_type&& key_value, const uint64_t ttl)
+    -> std::pair<handle_iterator, bool>
+  {
+    return add_or_update<key_value_type>(std::move(key_value), ttl);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  bool expiring_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::expire_after(const handle_type handle, const uint64_t ttl)
+  {
+    if (table_.key_ptr_from_handle(handle) == nullptr) {
+      return false;
+    }
+    wheel_.schedule(handle, wheel_.now() + ttl);
+    return true;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  void expiring_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::persist(const handle_type handle)
+  {
+    wheel_.cancel(handle);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  std::optional<uint64_t> expiring_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::deadline(const handle_type handle) const
+  {
+    if (table_.key_ptr_from_handle(handle) == nullptr) {
+      return {};
+    }
+    if (const auto deadline = wheel_.deadline(handle); deadline != 0) {
+      return deadline;
+    }
+    return {};
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  auto expiring_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::expire(const uint64_t now) -> size_type
+  {
+    size_type removed = 0;
+    // handles removed through table() are ignored by remove
+    wheel_.advance(now, [this, &removed](const handle_type handle) {
+      removed += table_.remove(handle) ? 1 : 0;
+    });
+    if constexpr (table_t::deferred_removal_v) {
+      if (removed > 0) {
+        table_.compact_removals();
+      }
+    }
+    return removed;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  uint64_t expiring_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::now() const
+  {
+    return wheel_.now();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  void expiring_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::clear()
+  {
+    table_.clear();
+    wheel_.clear();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  auto expiring_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::size() const
+    -> size_type
+  {
+    return table_.size();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  bool expiring_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::empty() const
+  {
+    return table_.empty();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  auto expiring_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::table()
+    -> table_type&
+  {
+    return table_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  auto expiring_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::table() const
+    -> const table_type&
+  {
+    return table_;
+  }
+} // namespace thh
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "snapshot.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace thh
+{
+  // current version of the frozen file format (see save_snapshot)
+  inline constexpr uint32_t frozen_version_v = 2;
+
+  // flag set in a frozen_packed_hashtable_t pilot holding a shift (the bucket
+  // has one key which is moved straight to a free position), otherwise the
+  // pilot is a seed the keys of the bucket are rehashed with
+  inline constexpr uint32_t frozen_shift_pilot_v = 0x8000'0000;
+  // flag set in a frozen_packed_hashtable_t pilot when a key of the bucket
+  // has the same hash as other keys, the other keys are stored after the
+  // perfectly hashed keys and are scanned when the hashed key does not match
+  inline constexpr uint32_t frozen_overflow_pilot_v = 0x4000'0000;
+
+  // header at the start of a frozen file, section offsets are from the start
+  // of the file
+  struct frozen_header_t
+  {
+    std::array<char, 8> magic_;
+    uint32_t version_;
+    uint32_t key_size_;
+    uint32_t value_size_;
+    uint32_t pilot_size_;
+    int64_t size_;
+    int64_t hashed_size_;
+    int64_t bucket_count_;
+    uint64_t seed_;
+    uint64_t keys_offset_;
+    uint64_t values_offset_;
+    uint64_t pilots_offset_;
+    uint64_t file_size_;
+  };
+
+  // immutable lookup table built once from a packed hashtable (see freeze)
+  // for tables that are queried but never changed, the keys are placed with a
+  // minimal perfect hash (every key has its own position in [0, size()) so a
+  // lookup reads one pilot and compares one key) and the keys and values are
+  // stored in the same order in two contiguous arrays (no handles,
+  // generations or empty slots)
+  // note: the perfect hash is built with Hash, a table saved with
+  // save_snapshot must be loaded with a Hash that produces the same results
+  // note: keys with the same hash as an earlier key cannot be told apart by
+  // a perfect hash, they are stored after the perfectly hashed keys (the
+  // overflow) and scanned with KeyEqual, only by lookups in a bucket flagged
+  // with frozen_overflow_pilot_v (a Hash with many collisions makes these
+  // lookups linear)
+  // note: throws std::invalid_argument if keys are not unique and
+  // std::length_error with 2^30 keys or more
+  template<
+    typename Key, typename Value, typename Hash = std::hash<Key>,
+    typename KeyEqual = std::equal_to<Key>>
+  class frozen_packed_hashtable_t
+  {
+    // storage when built in memory (empty when mapped)
+    std::vector<Key> key_storage_;
+    std::vector<Value> value_storage_;
+    std::vector<uint32_t> pilot_storage_;
+    // mapping when loaded from a file (null when built in memory)
+    void* mapping_ = nullptr;
+    std::size_t mapping_size_ = 0;
+    const Key* keys_ = nullptr;
+    const Value* values_ = nullptr;
+    const uint32_t* pilots_ = nullptr;
+    int32_t size_ = 0;
+    // number of keys placed by the perfect hash (the rest are the overflow)
+    int32_t hashed_size_ = 0;
+    uint32_t bucket_count_ = 0;
+    uint64_t seed_ = 0;
+    Hash hash_;
+    KeyEqual key_equal_;
+
+    // returns the hash of a key mixed with the table seed
+    [[nodiscard]] uint64_t mixed_hash(const Key& key) const;
+    // returns the bucket for a mixed hash
+    [[nodiscard]] static uint32_t bucket(uint64_t hash, uint32_t bucket_count);
+    // returns the position for a mixed hash with a bucket pilot (in the
+    // range of the perfectly hashed keys)
+    [[nodiscard]] static uint32_t position(
+      uint64_t hash, uint32_t pilot, uint32_t size);
+    // builds the pilots for the keys in key_storage_ and reorders the keys
+    // and values to match
+    void build();
+    // unmaps the file (if mapped)
+    void release();
+
+    template<typename K, typename V, typename H, typename E>
+    friend bool save_snapshot(
+      const frozen_packed_hashtable_t<K, V, H, E>& frozen, const char* path);
+
+  public:
+    frozen_packed_hashtable_t() = default;
+    // builds a frozen table from keys and values (values[i] belongs to
+    // keys[i], keys must be unique)
+    frozen_packed_hashtable_t(std::vector<Key> keys, std::vector<Value> values);
+    frozen_packed_hashtable_t(const frozen_packed_hashtable_t&) = delete;
+    frozen_packed_hashtable_t(frozen_packed_hashtable_t&& other) noexcept;
+    frozen_packed_hashtable_t& operator=(
+      const frozen_packed_hashtable_t&) = delete;
+    frozen_packed_hashtable_t& operator=(
+      frozen_packed_hashtable_t&& other) noexcept;
+    ~frozen_packed_hashtable_t();
+
+#if __has_include(<sys/mman.h>)
+    // maps a frozen table file (see save_snapshot) into memory read only
+    // returns an empty optional if the file could not be mapped or is not a
+    // frozen table with the same key and value types
+    [[nodiscard]] static std::optional<frozen_packed_hashtable_t> load_mmap(
+      const char* path);
+#endif
+
+    // finds the index (position) of the element with the specified key
+    // note: will return an empty optional if the key was not found
+    [[nodiscard]] std::optional<int32_t> find(const Key& key) const;
+    // returns if the table has an element with the equivalent key
+    [[nodiscard]] bool has(const Key& key) const;
+    // returns the number of elements in the table
+    [[nodiscard]] int32_t size() const;
+    // returns if the table has any elements or not
+    [[nodiscard]] bool empty() const;
+    // returns the number of bytes used by the perfect hash (the pilots)
+    [[nodiscard]] std::size_t hash_bytes() const;
+    // invokes a callable object on an element in the table using a key
+    template<typename Fn>
+    void call(const Key& key, Fn&& fn) const;
+    // invokes a callable object on an element in the table and returns a
+    // std::optional containing either the result or an empty optional (as the
+    // key may not have been found)
+    template<typename Fn>
+    decltype(auto) call_return(const Key& key, Fn&& fn) const;
+    // returns a const iterator to the beginning of the keys (contiguous, in
+    // the same order as the values)
+    [[nodiscard]] auto kbegin() const -> const Key*;
+    // returns a const iterator to the end of the keys (contiguous)
+    [[nodiscard]] auto kend() const -> const Key*;
+    // returns a const iterator to the beginning of the values (contiguous)
+    [[nodiscard]] auto vbegin() const -> const Value*;
+    // returns a const iterator to the end of the values (contiguous)
+    [[nodiscard]] auto vend() const -> const Value*;
+  };
+
+  // builds an immutable frozen_packed_hashtable_t with the keys and values of
+  // a packed hashtable (the packed hashtable is unchanged)
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual> freeze(
+    const base_packed_hashtable_t<
+      Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>&
+      packed_hashtable);
+
+  // writes a frozen table to a file at path (a header followed by flat
+  // sections for the keys, values and pilots) that can be loaded in place
+  // with frozen_packed_hashtable_t::load_mmap
+  // note: Key and Value must be trivially copyable
+  // returns false if the file could not be written
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  bool save_snapshot(
+    const frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>& frozen,
+    const char* path);
+} // namespace thh
+
+#include "frozen.inl"
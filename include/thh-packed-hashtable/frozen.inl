@@ -0,0 +1,561 @@
+namespace thh
+{
+  // bijective 64 bit mix (splitmix64 finalizer), spreads weak hashes (e.g.
+  // std::hash of integers) over every bit
+  inline uint64_t frozen_mix(uint64_t hash)
+  {
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebull;
+    hash ^= hash >> 31;
+    return hash;
+  }
+
+  // maps a 32 bit hash to [0, range) without a division
+  inline uint32_t frozen_reduce(const uint32_t hash, const uint32_t range)
+  {
+    return static_cast<uint32_t>((uint64_t(hash) * range) >> 32);
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  uint64_t frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::mixed_hash(
+    const Key& key) const
+  {
+    return frozen_mix(static_cast<uint64_t>(hash_(key)) ^ seed_);
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  uint32_t frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::bucket(
+    const uint64_t hash, const uint32_t bucket_count)
+  {
+    return frozen_reduce(static_cast<uint32_t>(hash >> 32), bucket_count);
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  uint32_t frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::position(
+    const uint64_t hash, const uint32_t pilot, const uint32_t size)
+  {
+    const auto is_shift = (pilot & frozen_shift_pilot_v) != 0;
+    const auto bits =
+      pilot & ~(frozen_shift_pilot_v | frozen_overflow_pilot_v);
+    const auto seed = is_shift ? 0 : bits;
+    const auto shift = is_shift ? bits : 0;
+    const auto base = frozen_reduce(
+      static_cast<uint32_t>(
+        frozen_mix(hash ^ (uint64_t(seed) * 0x9e3779b97f4a7c15ull))),
+      size);
+    // base and shift are both less than size
+    const auto shifted = base + shift;
+    return shifted >= size ? shifted - size : shifted;
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::
+    frozen_packed_hashtable_t(std::vector<Key> keys, std::vector<Value> values)
+    : key_storage_(std::move(keys)), value_storage_(std::move(values))
+  {
+    build();
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  void frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::build()
+  {
+    // pilot seeds tried for a bucket before starting again with a new table
+    // seed (only reached with an unlucky seed)
+    constexpr uint32_t max_pilot_seed = 1 << 16;
+
+    if (key_storage_.size() >= frozen_overflow_pilot_v) {
+      throw std::length_error("Frozen tables must have fewer than 2^30 keys");
+    }
+    size_ = static_cast<int32_t>(key_storage_.size());
+    const auto size = static_cast<uint32_t>(size_);
+
+    // keys with the same hash as an earlier key go to the overflow (the
+    // perfect hash is built from one key per hash)
+    std::vector<uint64_t> key_hashes(size);
+    std::vector<uint32_t> by_hash(size);
+    for (uint32_t i = 0; i < size; ++i) {
+      key_hashes[i] = static_cast<uint64_t>(hash_(key_storage_[i]));
+      by_hash[i] = i;
+    }
+    std::stable_sort(
+      by_hash.begin(), by_hash.end(),
+      [&key_hashes](const uint32_t lhs, const uint32_t rhs) {
+        return key_hashes[lhs] < key_hashes[rhs];
+      });
+    std::vector<uint32_t> hashed_keys;
+    std::vector<bool> overflowed;
+    std::vector<uint32_t> overflow_keys;
+    for (uint32_t first = 0; first < size;) {
+      const auto hash = key_hashes[by_hash[first]];
+      auto last = first + 1;
+      for (; last < size && key_hashes[by_hash[last]] == hash; ++last) {
+        for (auto i = first; i < last; ++i) {
+          if (key_equal_(
+                key_storage_[by_hash[i]], key_storage_[by_hash[last]])) {
+            throw std::invalid_argument("Frozen keys must be unique");
+          }
+        }
+        overflow_keys.push_back(by_hash[last]);
+      }
+      hashed_keys.push_back(by_hash[first]);
+      overflowed.push_back(last - first > 1);
+      first = last;
+    }
+    hashed_size_ = static_cast<int32_t>(hashed_keys.size());
+    const auto hashed_size = static_cast<uint32_t>(hashed_size_);
+
+    // an average of 2 keys per bucket (2 bytes per key), roughly a quarter of
+    // the buckets have a single key and are placed last without a search
+    bucket_count_ = std::max<uint32_t>(1, (hashed_size + 1) / 2);
+
+    std::vector<uint64_t> hashes(hashed_size);
+    std::vector<uint32_t> bucket_starts(bucket_count_ + 1);
+    std::vector<uint32_t> bucket_keys(hashed_size);
+    std::vector<uint32_t> buckets(bucket_count_);
+    std::vector<uint32_t> pilots(bucket_count_);
+    std::vector<uint32_t> positions(hashed_size);
+    std::vector<bool> taken(hashed_size);
+    for (seed_ = 0;; ++seed_) {
+      // group the keys by bucket (counting sort)
+      std::fill(bucket_starts.begin(), bucket_starts.end(), 0);
+      for (uint32_t i = 0; i < hashed_size; ++i) {
+        hashes[i] = frozen_mix(key_hashes[hashed_keys[i]] ^ seed_);
+        ++bucket_starts[bucket(hashes[i], bucket_count_) + 1];
+      }
+      for (uint32_t b = 0; b < bucket_count_; ++b) {
+        bucket_starts[b + 1] += bucket_starts[b];
+      }
+      {
+        auto next = bucket_starts;
+        for (uint32_t i = 0; i < hashed_size; ++i) {
+          bucket_keys[next[bucket(hashes[i], bucket_count_)]++] = i;
+        }
+      }
+      const auto bucket_size = [&bucket_starts](const uint32_t b) {
+        return bucket_starts[b + 1] - bucket_starts[b];
+      };
+
+      // place the largest buckets first (while most positions are free)
+      for (uint32_t b = 0; b < bucket_count_; ++b) {
+        buckets[b] = b;
+      }
+      std::stable_sort(
+        buckets.begin(), buckets.end(),
+        [&bucket_size](const uint32_t lhs, const uint32_t rhs) {
+          return bucket_size(lhs) > bucket_size(rhs);
+        });
+
+      std::fill(pilots.begin(), pilots.end(), 0);
+      std::fill(taken.begin(), taken.end(), false);
+      bool placed = true;
+      uint32_t next_free = 0;
+      for (const auto b : buckets) {
+        const auto* keys = bucket_keys.data() + bucket_starts[b];
+        const auto count = bucket_size(b);
+        if (count == 0) {
+          break;
+        }
+        if (count == 1) {
+          // a single key can be shifted straight to any free position
+          while (taken[next_free]) {
+            ++next_free;
+          }
+          const auto base = position(hashes[keys[0]], 0, hashed_size);
+          pilots[b] = frozen_shift_pilot_v
+                    | ((next_free + hashed_size - base) % hashed_size);
+          positions[keys[0]] = next_free;
+          taken[next_free] = true;
+          continue;
+        }
+        // the hashes in a bucket are distinct so a pilot is always found
+        // (unless the seed is very unlucky)
+        uint32_t pilot = 0;
+        for (; pilot < max_pilot_seed; ++pilot) {
+          uint32_t i = 0;
+          for (; i < count; ++i) {
+            const auto candidate =
+              position(hashes[keys[i]], pilot, hashed_size);
+            if (taken[candidate]) {
+              break;
+            }
+            // mark as it goes so keys in the same bucket cannot collide
+            taken[candidate] = true;
+            positions[keys[i]] = candidate;
+          }
+          if (i == count) {
+            pilots[b] = pilot;
+            break;
+          }
+          for (uint32_t j = 0; j < i; ++j) {
+            taken[positions[keys[j]]] = false;
+          }
+        }
+        if (pilot == max_pilot_seed) {
+          placed = false;
+          break;
+        }
+      }
+      if (placed) {
+        break;
+      }
+    }
+    for (uint32_t i = 0; i < hashed_size; ++i) {
+      if (overflowed[i]) {
+        pilots[bucket(hashes[i], bucket_count_)] |= frozen_overflow_pilot_v;
+      }
+    }
+
+    // move the keys and values to their positions (the overflow last)
+    std::vector<Key> keys;
+    std::vector<Value> values;
+    keys.reserve(size);
+    values.reserve(size);
+    std::vector<uint32_t> order(hashed_size);
+    for (uint32_t i = 0; i < hashed_size; ++i) {
+      order[positions[i]] = hashed_keys[i];
+    }
+    order.insert(order.end(), overflow_keys.begin(), overflow_keys.end());
+    for (const auto i : order) {
+      keys.push_back(std::move(key_storage_[i]));
+      values.push_back(std::move(value_storage_[i]));
+    }
+    key_storage_ = std::move(keys);
+    value_storage_ = std::move(values);
+    pilot_storage_ = std::move(pilots);
+    keys_ = key_storage_.data();
+    values_ = value_storage_.data();
+    pilots_ = pilot_storage_.data();
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::
+    frozen_packed_hashtable_t(frozen_packed_hashtable_t&& other) noexcept
+    : key_storage_(std::move(other.key_storage_)),
+      value_storage_(std::move(other.value_storage_)),
+      pilot_storage_(std::move(other.pilot_storage_)),
+      mapping_(std::exchange(other.mapping_, nullptr)),
+      mapping_size_(std::exchange(other.mapping_size_, 0)),
+      keys_(std::exchange(other.keys_, nullptr)),
+      values_(std::exchange(other.values_, nullptr)),
+      pilots_(std::exchange(other.pilots_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      hashed_size_(std::exchange(other.hashed_size_, 0)),
+      bucket_count_(std::exchange(other.bucket_count_, 0)),
+      seed_(std::exchange(other.seed_, 0)),
+      hash_(std::move(other.hash_)),
+      key_equal_(std::move(other.key_equal_))
+  {
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>&
+  frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::operator=(
+    frozen_packed_hashtable_t&& other) noexcept
+  {
+    if (this != &other) {
+      release();
+      key_storage_ = std::move(other.key_storage_);
+      value_storage_ = std::move(other.value_storage_);
+      pilot_storage_ = std::move(other.pilot_storage_);
+      mapping_ = std::exchange(other.mapping_, nullptr);
+      mapping_size_ = std::exchange(other.mapping_size_, 0);
+      keys_ = std::exchange(other.keys_, nullptr);
+      values_ = std::exchange(other.values_, nullptr);
+      pilots_ = std::exchange(other.pilots_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+      hashed_size_ = std::exchange(other.hashed_size_, 0);
+      bucket_count_ = std::exchange(other.bucket_count_, 0);
+      seed_ = std::exchange(other.seed_, 0);
+      hash_ = std::move(other.hash_);
+      key_equal_ = std::move(other.key_equal_);
+    }
+    return *this;
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  frozen_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual>::~frozen_packed_hashtable_t()
+  {
+    release();
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  void frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::release()
+  {
+#if __has_include(<sys/mman.h>)
+    if (mapping_ != nullptr) {
+      ::munmap(mapping_, mapping_size_);
+      mapping_ = nullptr;
+      mapping_size_ = 0;
+    }
+#endif
+  }
+
+#if __has_include(<sys/mman.h>)
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  auto frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::load_mmap(
+    const char* path) -> std::optional<frozen_packed_hashtable_t>
+  {
+    static_assert(
+      std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>,
+      "Snapshots require trivially copyable keys and values");
+
+    const int file = ::open(path, O_RDONLY);
+    if (file == -1) {
+      return {};
+    }
+    struct stat status;
+    if (
+      ::fstat(file, &status) != 0
+      || status.st_size < static_cast<off_t>(sizeof(frozen_header_t))) {
+      ::close(file);
+      return {};
+    }
+    const auto mapping_size = static_cast<std::size_t>(status.st_size);
+    void* mapping =
+      ::mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // the mapping keeps a reference to the file
+    ::close(file);
+    if (mapping == MAP_FAILED) {
+      return {};
+    }
+
+    frozen_packed_hashtable_t frozen;
+    frozen.mapping_ = mapping;
+    frozen.mapping_size_ = mapping_size;
+
+    frozen_header_t header;
+    std::memcpy(&header, mapping, sizeof(header));
+    const std::array<char, 8> magic = {'T', 'H', 'H', 'P', 'H', 'T', 'F', 'Z'};
+    // returns if a section lies within the file and is suitably aligned
+    const auto section_valid = [mapping_size](
+                                 const uint64_t offset, const int64_t count,
+                                 const std::size_t size,
+                                 const std::size_t alignment) {
+      return count >= 0 && offset % alignment == 0 && offset <= mapping_size
+          && uint64_t(count) <= (mapping_size - offset) / size;
+    };
+    if (
+      header.magic_ != magic || header.version_ != frozen_version_v
+      || header.key_size_ != sizeof(Key) || header.value_size_ != sizeof(Value)
+      || header.pilot_size_ != sizeof(uint32_t)
+      || header.file_size_ != mapping_size
+      || header.size_ >= frozen_overflow_pilot_v || header.hashed_size_ < 0
+      || header.hashed_size_ > header.size_
+      || (header.hashed_size_ == 0) != (header.size_ == 0)
+      || header.bucket_count_ < 1
+      || header.bucket_count_ > std::numeric_limits<uint32_t>::max()
+      || !section_valid(
+        header.keys_offset_, header.size_, sizeof(Key), alignof(Key))
+      || !section_valid(
+        header.values_offset_, header.size_, sizeof(Value), alignof(Value))
+      || !section_valid(
+        header.pilots_offset_, header.bucket_count_, sizeof(uint32_t),
+        alignof(uint32_t))) {
+      return {};
+    }
+
+    const auto* bytes = static_cast<const std::byte*>(mapping);
+    frozen.size_ = static_cast<int32_t>(header.size_);
+    frozen.hashed_size_ = static_cast<int32_t>(header.hashed_size_);
+    frozen.bucket_count_ = static_cast<uint32_t>(header.bucket_count_);
+    frozen.seed_ = header.seed_;
+    frozen.keys_ = reinterpret_cast<const Key*>(bytes + header.keys_offset_);
+    frozen.values_ =
+      reinterpret_cast<const Value*>(bytes + header.values_offset_);
+    frozen.pilots_ =
+      reinterpret_cast<const uint32_t*>(bytes + header.pilots_offset_);
+    // a shift that is out of range would index past the hashed keys
+    const auto hashed_size = static_cast<uint32_t>(frozen.hashed_size_);
+    for (uint32_t b = 0; b < frozen.bucket_count_ && hashed_size > 0; ++b) {
+      const auto pilot = frozen.pilots_[b];
+      if (
+        (pilot & frozen_shift_pilot_v) != 0
+        && (pilot & ~(frozen_shift_pilot_v | frozen_overflow_pilot_v))
+             >= hashed_size) {
+        return {};
+      }
+    }
+    return frozen;
+  }
+#endif
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  std::optional<int32_t> frozen_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual>::find(const Key& key) const
+  {
+    if (size_ == 0) {
+      return {};
+    }
+    const auto hash = mixed_hash(key);
+    const auto pilot = pilots_[bucket(hash, bucket_count_)];
+    const auto index =
+      position(hash, pilot, static_cast<uint32_t>(hashed_size_));
+    if (key_equal_(keys_[index], key)) {
+      return static_cast<int32_t>(index);
+    }
+    if ((pilot & frozen_overflow_pilot_v) != 0) {
+      // keys sharing a hash with a hashed key
+      for (auto overflow = hashed_size_; overflow < size_; ++overflow) {
+        if (key_equal_(keys_[overflow], key)) {
+          return overflow;
+        }
+      }
+    }
+    return {};
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  bool frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::has(
+    const Key& key) const
+  {
+    return find(key).has_value();
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  int32_t frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::size() const
+  {
+    return size_;
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  bool frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::empty() const
+  {
+    return size_ == 0;
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  std::size_t frozen_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual>::hash_bytes() const
+  {
+    return std::size_t(bucket_count_) * sizeof(uint32_t);
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  template<typename Fn>
+  void frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::call(
+    const Key& key, Fn&& fn) const
+  {
+    if (const auto index = find(key); index.has_value()) {
+      fn(values_[*index]);
+    }
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  template<typename Fn>
+  decltype(auto) frozen_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual>::call_return(const Key& key, Fn&& fn) const
+  {
+    using result_t = decltype(fn(std::declval<const Value&>()));
+    if (const auto index = find(key); index.has_value()) {
+      return std::optional<result_t>(fn(values_[*index]));
+    }
+    return std::optional<result_t>{};
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  auto frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::kbegin() const
+    -> const Key*
+  {
+    return keys_;
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  auto frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::kend() const
+    -> const Key*
+  {
+    return keys_ + size_;
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  auto frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::vbegin() const
+    -> const Value*
+  {
+    return values_;
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  auto frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>::vend() const
+    -> const Value*
+  {
+    return values_ + size_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual> freeze(
+    const base_packed_hashtable_t<
+      Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>&
+      packed_hashtable)
+  {
+    std::vector<Key> keys;
+    std::vector<Value> values;
+    keys.reserve(packed_hashtable.size());
+    values.reserve(packed_hashtable.size());
+    for (const auto& key_handle : packed_hashtable.handle_iteration()) {
+      packed_hashtable.call(
+        key_handle.second, [&keys, &values, &key_handle](const Value& value) {
+          keys.push_back(key_handle.first);
+          values.push_back(value);
+        });
+    }
+    return frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>(
+      std::move(keys), std::move(values));
+  }
+
+  template<typename Key, typename Value, typename Hash, typename KeyEqual>
+  bool save_snapshot(
+    const frozen_packed_hashtable_t<Key, Value, Hash, KeyEqual>& frozen,
+    const char* path)
+  {
+    static_assert(
+      std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>,
+      "Snapshots require trivially copyable keys and values");
+
+    const auto size = static_cast<uint64_t>(frozen.size());
+    const auto bucket_count = static_cast<uint64_t>(frozen.bucket_count_);
+    const auto align = [](const uint64_t offset) {
+      return (offset + snapshot_alignment_v - 1) & ~(snapshot_alignment_v - 1);
+    };
+    frozen_header_t header{};
+    header.magic_ = {'T', 'H', 'H', 'P', 'H', 'T', 'F', 'Z'};
+    header.version_ = frozen_version_v;
+    header.key_size_ = sizeof(Key);
+    header.value_size_ = sizeof(Value);
+    header.pilot_size_ = sizeof(uint32_t);
+    header.size_ = static_cast<int64_t>(size);
+    header.hashed_size_ = static_cast<int64_t>(frozen.hashed_size_);
+    header.bucket_count_ = static_cast<int64_t>(bucket_count);
+    header.seed_ = frozen.seed_;
+    header.keys_offset_ = align(sizeof(frozen_header_t));
+    header.values_offset_ = align(header.keys_offset_ + size * sizeof(Key));
+    header.pilots_offset_ = align(header.values_offset_ + size * sizeof(Value));
+    header.file_size_ =
+      header.pilots_offset_ + bucket_count * sizeof(uint32_t);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    uint64_t offset = 0;
+    const auto write = [&file, &offset](
+                         const void* data, const uint64_t bytes) {
+      file.write(
+        static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+      offset += bytes;
+    };
+    const auto pad = [&write, &offset](const uint64_t to) {
+      const std::array<char, snapshot_alignment_v> zeros{};
+      write(zeros.data(), to - offset);
+    };
+    write(&header, sizeof(header));
+    pad(header.keys_offset_);
+    write(frozen.kbegin(), size * sizeof(Key));
+    pad(header.values_offset_);
+    write(frozen.vbegin(), size * sizeof(Value));
+    pad(header.pilots_offset_);
+    write(frozen.pilots_, bucket_count * sizeof(uint32_t));
+    file.flush();
+    return file.good();
+  }
+} // namespace thh
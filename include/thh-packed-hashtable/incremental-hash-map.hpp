@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace thh
+{
+  // hash map with separate chaining that grows incrementally, when the load
+  // factor is exceeded a table with twice the number of buckets is allocated
+  // and the old and new tables live side by side while MigrateBuckets buckets
+  // from the old table are moved to the new table on each insert/erase
+  // note: the interface is the subset of std::unordered_map used by
+  // base_packed_hashtable_t so it can be used in its place
+  // note: nodes are never moved (pointers to keys and values remain stable
+  // and iterators are only invalidated when the element is erased), iteration
+  // order is insertion order
+  // note: allocating (and zeroing) the new bucket array is still O(n) but this
+  // is a small fraction of rehashing every node
+  template<
+    typename Key, typename Mapped, typename Hash = std::hash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Allocator = std::allocator<std::pair<const Key, Mapped>>,
+    int32_t MigrateBuckets = 8>
+  class incremental_hash_map_t
+  {
+    static_assert(MigrateBuckets > 0, "MigrateBuckets must be positive");
+
+  public:
+    using key_type = Key;
+    using mapped_type = Mapped;
+    using value_type = std::pair<const Key, Mapped>;
+    using size_type = std::size_t;
+    using allocator_type = Allocator;
+
+  private:
+    struct node_t
+    {
+      template<typename... Args>
+      explicit node_t(std::size_t hash, Args&&... args)
+        : value_(std::forward<Args>(args)...), hash_(hash)
+      {
+      }
+
+      value_type value_;
+      // mixed hash of the key (cached so migration does not rehash keys)
+      std::size_t hash_;
+      // next node in the same bucket
+      node_t* bucket_next_ = nullptr;
+      // previous and next nodes in insertion order (used for iteration)
+      node_t* prev_ = nullptr;
+      node_t* next_ = nullptr;
+    };
+
+    using node_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<node_t>;
+    using node_traits = std::allocator_traits<node_allocator_type>;
+    using buckets_t = std::vector<
+      node_t*,
+      typename std::allocator_traits<Allocator>::template rebind_alloc<
+        node_t*>>;
+
+    template<bool Const>
+    class iterator_t
+    {
+      template<bool>
+      friend class iterator_t;
+      friend class incremental_hash_map_t;
+
+      node_t* node_ = nullptr;
+
+      explicit iterator_t(node_t* node) : node_(node) {}
+
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = incremental_hash_map_t::value_type;
+      using difference_type = std::ptrdiff_t;
+      using pointer =
+        std::conditional_t<Const, const value_type*, value_type*>;
+      using reference =
+        std::conditional_t<Const, const value_type&, value_type&>;
+
+      iterator_t() = default;
+
+      // support conversion from iterator to const_iterator
+      template<
+        bool OtherConst, typename = std::enable_if_t<Const && !OtherConst>>
+      iterator_t(const iterator_t<OtherConst>& other) : node_(other.node_)
+      {
+      }
+
+      [[nodiscard]] reference operator*() const { return node_->value_; }
+      [[nodiscard]] pointer operator->() const { return &node_->value_; }
+
+      iterator_t& operator++()
+      {
+        node_ = node_->next_;
+        return *this;
+      }
+      iterator_t operator++(int)
+      {
+        auto it = *this;
+        node_ = node_->next_;
+        return it;
+      }
+
+      [[nodiscard]] bool operator==(const iterator_t& rhs) const
+      {
+        return node_ == rhs.node_;
+      }
+      [[nodiscard]] bool operator!=(const iterator_t& rhs) const
+      {
+        return node_ != rhs.node_;
+      }
+    };
+
+  public:
+    using iterator = iterator_t<false>;
+    using const_iterator = iterator_t<true>;
+
+  private:
+    node_allocator_type allocator_;
+    Hash hash_;
+    KeyEqual key_equal_;
+    // table new elements are added to (the new table during migration)
+    buckets_t buckets_;
+    // table being migrated (empty when no migration is in progress)
+    buckets_t old_buckets_;
+    // number of buckets in old_buckets_ already moved to buckets_
+    std::size_t migrated_ = 0;
+    // first and last nodes in insertion order
+    node_t* head_ = nullptr;
+    node_t* tail_ = nullptr;
+    size_type size_ = 0;
+
+    // mixes the bits of a hash so buckets can be found with a mask
+    static std::size_t mix(std::size_t hash);
+    // returns the bucket (in whichever table currently holds it) for a hash
+    node_t*& bucket(std::size_t hash);
+    // returns the bucket (in whichever table currently holds it) for a hash
+    // (const overload)
+    node_t* const& bucket(std::size_t hash) const;
+    // returns the node with an equivalent key or nullptr if there is not one
+    node_t* find_node(const Key& key, std::size_t hash) const;
+    // moves up to count buckets from the old table to the new table
+    void migrate(std::size_t count);
+    // starts a migration to a table with bucket_count buckets
+    void grow(std::size_t bucket_count);
+    // unlinks, destroys and deallocates a node, returns the following node
+    node_t* erase_node(node_t* node);
+    // destroys and deallocates all nodes
+    void destroy_nodes();
+    // adds a node for value (the key must not already exist)
+    template<typename P>
+    std::pair<iterator, bool> insert_internal(P&& value);
+
+  public:
+    incremental_hash_map_t() = default;
+    explicit incremental_hash_map_t(const Allocator& allocator);
+    incremental_hash_map_t(const incremental_hash_map_t& other);
+    incremental_hash_map_t(incremental_hash_map_t&& other) noexcept;
+    // note: allocators are propagated according to std::allocator_traits, if
+    // allocators are not propagated and differ elements are copied/moved
+    incremental_hash_map_t& operator=(const incremental_hash_map_t& other);
+    incremental_hash_map_t& operator=(incremental_hash_map_t&& other) noexcept(
+      node_traits::propagate_on_container_move_assignment::value
+      || node_traits::is_always_equal::value);
+    ~incremental_hash_map_t();
+
+    [[nodiscard]] allocator_type get_allocator() const;
+
+    // inserts value if an element with an equivalent key does not exist
+    std::pair<iterator, bool> insert(const value_type& value);
+    // inserts value if an element with an equivalent key does not exist
+    std::pair<iterator, bool> insert(value_type&& value);
+    // removes the element at position, returns the following element
+    iterator erase(const_iterator position);
+    // removes the element with an equivalent key (if one exists), returns the
+    // number of elements removed
+    size_type erase(const Key& key);
+    [[nodiscard]] iterator find(const Key& key);
+    [[nodiscard]] const_iterator find(const Key& key) const;
+    // removes all elements (the bucket array is kept)
+    void clear();
+    // reserves buckets for the number of elements specified
+    // note: completes any migration in progress and rehashes immediately
+    void reserve(size_type count);
+    // sets the number of buckets to the smallest power of two not less than
+    // count or size() (e.g. rehash(0) releases excess buckets)
+    // note: completes any migration in progress and rehashes immediately
+    void rehash(size_type count);
+    [[nodiscard]] size_type size() const;
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] size_type max_size() const;
+    // returns the number of buckets in the table new elements are added to
+    [[nodiscard]] size_type bucket_count() const;
+    // returns the maximum number of elements per bucket before growing
+    [[nodiscard]] float max_load_factor() const;
+    // returns if a migration from an old table is in progress
+    [[nodiscard]] bool migrating() const;
+    [[nodiscard]] auto begin() -> iterator;
+    [[nodiscard]] auto begin() const -> const_iterator;
+    [[nodiscard]] auto cbegin() const -> const_iterator;
+    [[nodiscard]] auto end() -> iterator;
+    [[nodiscard]] auto end() const -> const_iterator;
+    [[nodiscard]] auto cend() const -> const_iterator;
+  };
+} // namespace thh
+
+#include "incremental-hash-map.inl"
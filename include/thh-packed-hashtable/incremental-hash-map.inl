@@ -0,0 +1,544 @@
+namespace thh
+{
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  std::size_t incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::mix(
+    const std::size_t hash)
+  {
+    // 64 bit finalizer from MurmurHash3
+    auto mixed = static_cast<uint64_t>(hash);
+    mixed ^= mixed >> 33;
+    mixed *= 0xff51afd7ed558ccdULL;
+    mixed ^= mixed >> 33;
+    return static_cast<std::size_t>(mixed);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::bucket(
+    const std::size_t hash) -> node_t*&
+  {
+    return const_cast<node_t*&>(std::as_const(*this).bucket(hash));
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::bucket(
+    const std::size_t hash) const -> node_t* const&
+  {
+    // buckets in the old table before migrated_ have already been moved
+    if (!old_buckets_.empty()) {
+      if (const auto index = hash & (old_buckets_.size() - 1);
+          index >= migrated_) {
+        return old_buckets_[index];
+      }
+    }
+    return buckets_[hash & (buckets_.size() - 1)];
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::find_node(
+    const Key& key, const std::size_t hash) const -> node_t*
+  {
+    if (buckets_.empty()) {
+      return nullptr;
+    }
+    for (node_t* node = bucket(hash); node != nullptr;
+         node = node->bucket_next_) {
+      if (node->hash_ == hash && key_equal_(node->value_.first, key)) {
+        return node;
+      }
+    }
+    return nullptr;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  void incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::migrate(
+    std::size_t count)
+  {
+    if (old_buckets_.empty()) {
+      return;
+    }
+    const auto mask = buckets_.size() - 1;
+    for (; count > 0 && migrated_ < old_buckets_.size(); --count) {
+      for (node_t* node = std::exchange(old_buckets_[migrated_], nullptr);
+           node != nullptr;) {
+        node_t* next = node->bucket_next_;
+        auto& head = buckets_[node->hash_ & mask];
+        node->bucket_next_ = head;
+        head = node;
+        node = next;
+      }
+      ++migrated_;
+    }
+    if (migrated_ == old_buckets_.size()) {
+      // free the old table
+      old_buckets_ = buckets_t(old_buckets_.get_allocator());
+      migrated_ = 0;
+    }
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  void incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::grow(
+    const std::size_t bucket_count)
+  {
+    // the previous migration must be complete before starting another
+    migrate(old_buckets_.size());
+    // elements remain in the old table until they are migrated
+    old_buckets_ = std::move(buckets_);
+    buckets_ = buckets_t(bucket_count, nullptr, old_buckets_.get_allocator());
+    migrated_ = 0;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::erase_node(
+    node_t* node) -> node_t*
+  {
+    node_t** link = &bucket(node->hash_);
+    while (*link != node) {
+      link = &(*link)->bucket_next_;
+    }
+    *link = node->bucket_next_;
+    (node->prev_ != nullptr ? node->prev_->next_ : head_) = node->next_;
+    (node->next_ != nullptr ? node->next_->prev_ : tail_) = node->prev_;
+    node_t* next = node->next_;
+    node_traits::destroy(allocator_, node);
+    node_traits::deallocate(allocator_, node, 1);
+    --size_;
+    return next;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  void incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::destroy_nodes()
+  {
+    for (node_t* node = head_; node != nullptr;) {
+      node_t* next = node->next_;
+      node_traits::destroy(allocator_, node);
+      node_traits::deallocate(allocator_, node, 1);
+      node = next;
+    }
+    head_ = tail_ = nullptr;
+    size_ = 0;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  template<typename P>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::insert_internal(
+    P&& value) -> std::pair<iterator, bool>
+  {
+    // migrate before growing so a migration always completes before the
+    // next one is required
+    migrate(MigrateBuckets);
+    const auto hash = mix(hash_(value.first));
+    if (node_t* node = find_node(value.first, hash); node != nullptr) {
+      return {iterator(node), false};
+    }
+    if (size_ + 1 > buckets_.size()) {
+      grow(buckets_.empty() ? 8 : buckets_.size() * 2);
+    }
+    node_t* node = node_traits::allocate(allocator_, 1);
+    node_traits::construct(allocator_, node, hash, std::forward<P>(value));
+    auto& head = bucket(hash);
+    node->bucket_next_ = head;
+    head = node;
+    node->prev_ = tail_;
+    (tail_ != nullptr ? tail_->next_ : head_) = node;
+    tail_ = node;
+    ++size_;
+    return {iterator(node), true};
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator,
+    MigrateBuckets>::incremental_hash_map_t(const Allocator& allocator)
+    : allocator_(allocator),
+      buckets_(typename buckets_t::allocator_type(allocator)),
+      old_buckets_(typename buckets_t::allocator_type(allocator))
+  {
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator,
+    MigrateBuckets>::incremental_hash_map_t(const incremental_hash_map_t& other)
+    : allocator_(node_traits::select_on_container_copy_construction(
+        other.allocator_)),
+      hash_(other.hash_),
+      key_equal_(other.key_equal_),
+      buckets_(typename buckets_t::allocator_type(allocator_)),
+      old_buckets_(typename buckets_t::allocator_type(allocator_))
+  {
+    reserve(other.size());
+    for (const auto& value : other) {
+      insert_internal(value);
+    }
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator,
+    MigrateBuckets>::incremental_hash_map_t(
+    incremental_hash_map_t&& other) noexcept
+    : allocator_(std::move(other.allocator_)),
+      hash_(std::move(other.hash_)),
+      key_equal_(std::move(other.key_equal_)),
+      buckets_(std::move(other.buckets_)),
+      old_buckets_(std::move(other.old_buckets_)),
+      migrated_(std::exchange(other.migrated_, 0)),
+      head_(std::exchange(other.head_, nullptr)),
+      tail_(std::exchange(other.tail_, nullptr)),
+      size_(std::exchange(other.size_, 0))
+  {
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator,
+    MigrateBuckets>::operator=(const incremental_hash_map_t& other)
+    -> incremental_hash_map_t&
+  {
+    if (this == &other) {
+      return *this;
+    }
+    clear();
+    if constexpr (node_traits::propagate_on_container_copy_assignment::value) {
+      allocator_ = other.allocator_;
+      buckets_ = buckets_t(typename buckets_t::allocator_type(allocator_));
+      old_buckets_ = buckets_t(typename buckets_t::allocator_type(allocator_));
+    }
+    hash_ = other.hash_;
+    key_equal_ = other.key_equal_;
+    reserve(other.size());
+    for (const auto& value : other) {
+      insert_internal(value);
+    }
+    return *this;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator,
+    MigrateBuckets>::operator=(incremental_hash_map_t&& other) noexcept(
+    node_traits::propagate_on_container_move_assignment::value
+    || node_traits::is_always_equal::value) -> incremental_hash_map_t&
+  {
+    if (this == &other) {
+      return *this;
+    }
+    clear();
+    hash_ = std::move(other.hash_);
+    key_equal_ = std::move(other.key_equal_);
+    constexpr bool propagate =
+      node_traits::propagate_on_container_move_assignment::value;
+    if (propagate || allocator_ == other.allocator_) {
+      // take ownership of the other nodes
+      if constexpr (propagate) {
+        allocator_ = std::move(other.allocator_);
+      }
+      buckets_ = std::move(other.buckets_);
+      old_buckets_ = std::move(other.old_buckets_);
+      migrated_ = std::exchange(other.migrated_, 0);
+      head_ = std::exchange(other.head_, nullptr);
+      tail_ = std::exchange(other.tail_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+      other.buckets_.clear();
+      other.old_buckets_.clear();
+    } else {
+      // nodes owned by a different allocator cannot be adopted so elements
+      // are moved to nodes from this allocator instead
+      reserve(other.size());
+      for (auto& value : other) {
+        insert_internal(std::move(value));
+      }
+      other.clear();
+    }
+    return *this;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator,
+    MigrateBuckets>::~incremental_hash_map_t()
+  {
+    destroy_nodes();
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator,
+    MigrateBuckets>::get_allocator() const
+    -> allocator_type
+  {
+    return allocator_type(allocator_);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::insert(
+    const value_type& value) -> std::pair<iterator, bool>
+  {
+    return insert_internal(value);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::insert(
+    value_type&& value) -> std::pair<iterator, bool>
+  {
+    return insert_internal(std::move(value));
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::erase(
+    const const_iterator position) -> iterator
+  {
+    migrate(MigrateBuckets);
+    return iterator(erase_node(position.node_));
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::erase(
+    const Key& key) -> size_type
+  {
+    migrate(MigrateBuckets);
+    if (node_t* node = find_node(key, mix(hash_(key))); node != nullptr) {
+      erase_node(node);
+      return 1;
+    }
+    return 0;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::find(
+    const Key& key) -> iterator
+  {
+    return iterator(find_node(key, mix(hash_(key))));
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::find(
+    const Key& key) const -> const_iterator
+  {
+    return const_iterator(find_node(key, mix(hash_(key))));
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  void incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::clear()
+  {
+    destroy_nodes();
+    std::fill(buckets_.begin(), buckets_.end(), nullptr);
+    old_buckets_ = buckets_t(old_buckets_.get_allocator());
+    migrated_ = 0;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  void incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::reserve(
+    const size_type count)
+  {
+    std::size_t bucket_count = buckets_.empty() ? 8 : buckets_.size();
+    while (bucket_count < count) {
+      bucket_count *= 2;
+    }
+    if (bucket_count > buckets_.size()) {
+      grow(bucket_count);
+    }
+    migrate(old_buckets_.size());
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  void incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::rehash(
+    const size_type count)
+  {
+    std::size_t bucket_count = 8;
+    while (bucket_count < std::max(count, size_)) {
+      bucket_count *= 2;
+    }
+    if (bucket_count != buckets_.size()) {
+      grow(bucket_count);
+    }
+    migrate(old_buckets_.size());
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::size() const
+    -> size_type
+  {
+    return size_;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  bool incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::empty() const
+  {
+    return size_ == 0;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::max_size() const
+    -> size_type
+  {
+    return node_traits::max_size(allocator_);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator,
+    MigrateBuckets>::bucket_count() const
+    -> size_type
+  {
+    return buckets_.size();
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  float incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator,
+    MigrateBuckets>::max_load_factor() const
+  {
+    return 1.0f;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  bool incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::migrating() const
+  {
+    return !old_buckets_.empty();
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::begin()
+    -> iterator
+  {
+    return iterator(head_);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::begin() const
+    -> const_iterator
+  {
+    return const_iterator(head_);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::cbegin() const
+    -> const_iterator
+  {
+    return const_iterator(head_);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::end()
+    -> iterator
+  {
+    return iterator(nullptr);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::end() const
+    -> const_iterator
+  {
+    return const_iterator(nullptr);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t MigrateBuckets>
+  auto incremental_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>::cend() const
+    -> const_iterator
+  {
+    return const_iterator(nullptr);
+  }
+} // namespace thh
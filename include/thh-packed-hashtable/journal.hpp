@@ -0,0 +1,171 @@
+#pragma once
+
+#include <thh-handle-vector/handle-vector.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace thh
+{
+  // type of change recorded by a journal record
+  enum class journal_op_e : uint8_t
+  {
+    // element added, record holds the handle, key and value
+    add,
+    // element value changed, record holds the handle and new value
+    update,
+    // element removed, record holds the handle
+    remove,
+    // all elements removed, record holds no data
+    clear
+  };
+
+  // fixed size header at the start of every journal record, the key and/or
+  // value bytes (depending on op_) follow immediately after
+  template<typename Tag>
+  struct journal_record_header_t
+  {
+    journal_op_e op_;
+    typed_handle_t<Tag> handle_;
+  };
+
+  // journal used by packed hashtables by default, records nothing (every
+  // function is an empty noop so journaling compiles away)
+  // note: this is the interface base_packed_hashtable_t calls to report
+  // changes, other journals (see checkpoint_tracker_t) implement the same
+  // functions
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  class no_journal_t
+  {
+  public:
+    no_journal_t() = default;
+    explicit no_journal_t(const Allocator&) {}
+
+    template<typename Values>
+    void record_add(typename Values::handle_type, const Key&, const Values&)
+    {
+    }
+    template<typename Values>
+    void record_update(typename Values::handle_type, const Values&)
+    {
+    }
+    template<typename Values>
+    void record_remove(typename Values::handle_type, const Values&)
+    {
+    }
+    void record_clear() {}
+    template<typename Index>
+    void record_reorder(Index, Index)
+    {
+    }
+  };
+
+  // append-only log of the changes made to a packed hashtable (see
+  // journaled_policy_t), the log can be persisted or sent to another process
+  // and replayed (see journal_replayer_t) to mirror the table, the cost of a
+  // checkpoint is proportional to the number of changes, not the table size
+  // note: Key and Value must be trivially copyable (records hold their bytes)
+  // note: records are written by base_packed_hashtable_t (the record_ functions
+  // are not intended to be called directly)
+  // note: changes made through value iterators are not recorded, use
+  // record_update on the table after modifying a value this way
+  template<
+    typename Key, typename Value, typename Tag,
+    typename Allocator = std::allocator<std::byte>>
+  class packed_hashtable_journal_t
+  {
+    static_assert(
+      std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>,
+      "Journaling requires trivially copyable keys and values");
+
+    using header_t = journal_record_header_t<Tag>;
+    using byte_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<std::byte>;
+
+    std::vector<std::byte, byte_allocator_type> log_;
+
+    // appends a record to the log, key and value point to the bytes of a Key
+    // and Value (either may be null if the op does not include it)
+    void append(
+      journal_op_e op, typed_handle_t<Tag> handle, const void* key,
+      const void* value);
+
+  public:
+    packed_hashtable_journal_t() = default;
+    explicit packed_hashtable_journal_t(const Allocator& allocator);
+
+    // returns the number of bytes in a record with the specified op
+    [[nodiscard]] static constexpr std::size_t record_size(journal_op_e op);
+
+    // records an element added with handle (value is read from values)
+    template<typename Values>
+    void record_add(
+      typed_handle_t<Tag> handle, const Key& key, const Values& values);
+    // records the current value of the element with handle (if it exists)
+    template<typename Values>
+    void record_update(typed_handle_t<Tag> handle, const Values& values);
+    // records the element with handle is being removed (called before the
+    // element is removed from values)
+    template<typename Values>
+    void record_remove(typed_handle_t<Tag> handle, const Values& values);
+    // records all elements were removed
+    void record_clear();
+    // records the values in the range [begin, end) were reordered (handles
+    // still refer to the same values so nothing is recorded)
+    void record_reorder(int32_t begin, int32_t end);
+
+    // returns the start of the log (records are tightly packed)
+    [[nodiscard]] const std::byte* data() const;
+    // returns the number of bytes in the log
+    [[nodiscard]] std::size_t size_bytes() const;
+    // returns if the log has any records or not
+    [[nodiscard]] bool empty() const;
+    // discards all records (e.g. once they have been persisted or sent)
+    void clear();
+    // collapses the log so each element has at most one record (its final
+    // state), elements added and removed within the log are dropped and
+    // records before the last clear are discarded
+    // note: replaying the compacted log produces the same table as replaying
+    // the original log
+    void compact();
+    // replaces the log with a clear record followed by an add record for
+    // every element of table (a base snapshot further changes are appended to)
+    // note: table must be the packed hashtable being journaled
+    template<typename Table>
+    void rebase(const Table& table);
+  };
+
+  // applies journal records (see packed_hashtable_journal_t) to a replica
+  // packed hashtable, the replayer remembers the key for each handle of the
+  // source table so updates and removes can be applied by key
+  // note: handles in the replica do not match handles in the source table
+  template<typename Key, typename Value, typename Tag>
+  class journal_replayer_t
+  {
+    using header_t = journal_record_header_t<Tag>;
+
+    // keys of source table elements (indexed by handle id)
+    std::vector<std::optional<Key>> keys_;
+
+  public:
+    // applies complete records from data to table (changes are made with
+    // add_or_update, call and remove)
+    // returns the number of bytes consumed, a partial record at the end of
+    // data is not consumed (pass it again with the following bytes)
+    template<typename Table>
+    std::size_t replay(const std::byte* data, std::size_t size, Table& table);
+    // forgets all source handles (e.g. before replaying a rebased journal into
+    // a different replica)
+    void reset();
+  };
+} // namespace thh
+
+#include "journal.inl"
@@ -0,0 +1,277 @@
+namespace thh
+{
+  // returns an object of type T copied from (possibly unaligned) bytes
+  template<typename T>
+  T journal_read(const std::byte* bytes)
+  {
+    alignas(T) std::byte storage[sizeof(T)];
+    std::memcpy(storage, bytes, sizeof(T));
+    return *std::launder(reinterpret_cast<const T*>(storage));
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  packed_hashtable_journal_t<Key, Value, Tag, Allocator>::
+    packed_hashtable_journal_t(const Allocator& allocator)
+    : log_(byte_allocator_type(allocator))
+  {
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  constexpr std::size_t packed_hashtable_journal_t<
+    Key, Value, Tag, Allocator>::record_size(const journal_op_e op)
+  {
+    switch (op) {
+      case journal_op_e::add:
+        return sizeof(header_t) + sizeof(Key) + sizeof(Value);
+      case journal_op_e::update:
+        return sizeof(header_t) + sizeof(Value);
+      default:
+        return sizeof(header_t);
+    }
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  void packed_hashtable_journal_t<Key, Value, Tag, Allocator>::append(
+    const journal_op_e op, const typed_handle_t<Tag> handle, const void* key,
+    const void* value)
+  {
+    header_t header{};
+    header.op_ = op;
+    header.handle_ = handle;
+    const auto offset = log_.size();
+    log_.resize(offset + record_size(op));
+    auto* record = log_.data() + offset;
+    std::memcpy(record, &header, sizeof(header_t));
+    record += sizeof(header_t);
+    if (key != nullptr) {
+      std::memcpy(record, key, sizeof(Key));
+      record += sizeof(Key);
+    }
+    if (value != nullptr) {
+      std::memcpy(record, value, sizeof(Value));
+    }
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  template<typename Values>
+  void packed_hashtable_journal_t<Key, Value, Tag, Allocator>::record_add(
+    const typed_handle_t<Tag> handle, const Key& key, const Values& values)
+  {
+    values.call(handle, [this, handle, &key](const Value& value) {
+      append(journal_op_e::add, handle, &key, &value);
+    });
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  template<typename Values>
+  void packed_hashtable_journal_t<Key, Value, Tag, Allocator>::record_update(
+    const typed_handle_t<Tag> handle, const Values& values)
+  {
+    values.call(handle, [this, handle](const Value& value) {
+      append(journal_op_e::update, handle, nullptr, &value);
+    });
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  template<typename Values>
+  void packed_hashtable_journal_t<Key, Value, Tag, Allocator>::record_remove(
+    const typed_handle_t<Tag> handle, const Values&)
+  {
+    append(journal_op_e::remove, handle, nullptr, nullptr);
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  void packed_hashtable_journal_t<Key, Value, Tag, Allocator>::record_clear()
+  {
+    append(journal_op_e::clear, typed_handle_t<Tag>{}, nullptr, nullptr);
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  void packed_hashtable_journal_t<Key, Value, Tag, Allocator>::record_reorder(
+    int32_t, int32_t)
+  {
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  const std::byte* packed_hashtable_journal_t<
+    Key, Value, Tag, Allocator>::data() const
+  {
+    return log_.data();
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  std::size_t packed_hashtable_journal_t<
+    Key, Value, Tag, Allocator>::size_bytes() const
+  {
+    return log_.size();
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  bool packed_hashtable_journal_t<Key, Value, Tag, Allocator>::empty() const
+  {
+    return log_.empty();
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  void packed_hashtable_journal_t<Key, Value, Tag, Allocator>::clear()
+  {
+    log_.clear();
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  void packed_hashtable_journal_t<Key, Value, Tag, Allocator>::compact()
+  {
+    struct record_t
+    {
+      std::size_t offset_;
+      header_t header_;
+    };
+
+    // state of an element over the records after the last clear
+    struct element_t
+    {
+      // offset of the key bytes (if the element was added)
+      std::size_t key_ = 0;
+      // offset of the latest value bytes
+      std::size_t value_ = 0;
+      // index of the last record
+      std::size_t last_ = 0;
+      bool added_ = false;
+      bool removed_ = false;
+    };
+
+    std::vector<record_t> records;
+    bool cleared = false;
+    for (std::size_t offset = 0; offset < log_.size();) {
+      const auto header = journal_read<header_t>(log_.data() + offset);
+      if (header.op_ == journal_op_e::clear) {
+        records.clear();
+        cleared = true;
+      } else {
+        records.push_back({offset, header});
+      }
+      offset += record_size(header.op_);
+    }
+
+    // elements are identified by handle (handles are not reused)
+    const auto element_key = [](const typed_handle_t<Tag> handle) {
+      return (uint64_t(uint32_t(handle.id_)) << 32) | uint32_t(handle.gen_);
+    };
+    std::unordered_map<uint64_t, element_t> elements;
+    for (std::size_t i = 0; i < records.size(); ++i) {
+      const auto& record = records[i];
+      auto [it, inserted] =
+        elements.try_emplace(element_key(record.header_.handle_));
+      auto& element = it->second;
+      if (inserted && record.header_.op_ == journal_op_e::add) {
+        element.added_ = true;
+        element.key_ = record.offset_ + sizeof(header_t);
+      }
+      element.last_ = i;
+      if (record.header_.op_ == journal_op_e::remove) {
+        element.removed_ = true;
+      } else {
+        // the value is always the last field of a record
+        element.value_ =
+          record.offset_ + record_size(record.header_.op_) - sizeof(Value);
+      }
+    }
+
+    // each element is written at the position of its last record so changes
+    // to different elements with the same key stay in order
+    std::vector<std::byte, byte_allocator_type> log(log_.get_allocator());
+    log.swap(log_);
+    if (cleared) {
+      record_clear();
+    }
+    for (std::size_t i = 0; i < records.size(); ++i) {
+      const auto handle = records[i].header_.handle_;
+      const auto& element = elements.at(element_key(handle));
+      if (element.last_ != i || (element.added_ && element.removed_)) {
+        continue;
+      }
+      if (element.removed_) {
+        append(journal_op_e::remove, handle, nullptr, nullptr);
+      } else if (element.added_) {
+        append(
+          journal_op_e::add, handle, log.data() + element.key_,
+          log.data() + element.value_);
+      } else {
+        append(
+          journal_op_e::update, handle, nullptr, log.data() + element.value_);
+      }
+    }
+  }
+
+  template<typename Key, typename Value, typename Tag, typename Allocator>
+  template<typename Table>
+  void packed_hashtable_journal_t<Key, Value, Tag, Allocator>::rebase(
+    const Table& table)
+  {
+    log_.clear();
+    log_.reserve(
+      record_size(journal_op_e::clear)
+      + record_size(journal_op_e::add) * std::size_t(table.size()));
+    record_clear();
+    for (const auto& key_handle : table.handle_iteration()) {
+      table.call(key_handle.second, [this, &key_handle](const Value& value) {
+        append(journal_op_e::add, key_handle.second, &key_handle.first, &value);
+      });
+    }
+  }
+
+  template<typename Key, typename Value, typename Tag>
+  template<typename Table>
+  std::size_t journal_replayer_t<Key, Value, Tag>::replay(
+    const std::byte* data, const std::size_t size, Table& table)
+  {
+    using journal_t = packed_hashtable_journal_t<Key, Value, Tag>;
+    std::size_t offset = 0;
+    while (size - offset >= sizeof(header_t)) {
+      const auto* record = data + offset;
+      const auto header = journal_read<header_t>(record);
+      const auto record_size = journal_t::record_size(header.op_);
+      if (size - offset < record_size) {
+        break;
+      }
+      offset += record_size;
+      record += sizeof(header_t);
+      const auto id = static_cast<std::size_t>(header.handle_.id_);
+      switch (header.op_) {
+        case journal_op_e::add: {
+          auto key = journal_read<Key>(record);
+          if (id >= keys_.size()) {
+            keys_.resize(id + 1);
+          }
+          keys_[id] = key;
+          table.add_or_update(
+            {std::move(key), journal_read<Value>(record + sizeof(Key))});
+        } break;
+        case journal_op_e::update:
+          if (id < keys_.size() && keys_[id].has_value()) {
+            table.call(*keys_[id], [record](Value& value) {
+              value = journal_read<Value>(record);
+            });
+          }
+          break;
+        case journal_op_e::remove:
+          if (id < keys_.size() && keys_[id].has_value()) {
+            table.remove(*keys_[id]);
+            keys_[id].reset();
+          }
+          break;
+        case journal_op_e::clear:
+          table.clear();
+          keys_.clear();
+          break;
+      }
+    }
+    return offset;
+  }
+
+  template<typename Key, typename Value, typename Tag>
+  void journal_replayer_t<Key, Value, Tag>::reset()
+  {
+    keys_.clear();
+  }
+} // namespace thh
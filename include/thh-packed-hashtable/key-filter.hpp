@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace thh
+{
+  // key filter used by packed hashtables by default, every key may be present
+  // (every function is an empty noop so lookups always search the key index)
+  // note: this is the interface base_packed_hashtable_t calls to skip
+  // searching the key index for missing keys, blocked_bloom_filter_t
+  // implements the same functions
+  template<typename Key, typename Hash, typename Allocator>
+  class no_key_filter_t
+  {
+  public:
+    // if lookups of missing keys can be rejected (see key_filter_policy_t)
+    static constexpr bool enabled_v = false;
+
+    no_key_filter_t() = default;
+    explicit no_key_filter_t(const Allocator&) {}
+
+    [[nodiscard]] bool may_contain(const Key&) const { return true; }
+    template<typename Index>
+    void insert(const Key&, const Index&)
+    {
+    }
+    template<typename Index>
+    void rebuild(const Index&)
+    {
+    }
+    void clear() {}
+  };
+
+  // blocked bloom filter of the keys in the key index (see
+  // key_filter_policy_t), each key sets four bits in a single 64 bit block so
+  // a lookup reads one word (instead of probing a cache line per bit) and a
+  // missing key is rejected unless all four bits are set
+  // the filter is sized for BitsPerKey bits per key and rebuilt from the key
+  // index (at twice the number of keys) once more keys have been inserted
+  // than it was sized for, removed keys are not cleared from the filter (they
+  // only count towards the next rebuild) so there are no counters to update
+  // note: records are written by base_packed_hashtable_t (the functions other
+  // than may_contain are not intended to be called directly)
+  template<typename Key, typename Hash, typename Allocator, int32_t BitsPerKey>
+  class blocked_bloom_filter_t
+  {
+    static_assert(BitsPerKey > 0, "BitsPerKey must be positive");
+
+    using block_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<uint64_t>;
+
+    static constexpr std::size_t block_bits_v = 64;
+
+    std::vector<uint64_t, block_allocator_type> blocks_;
+    // keys inserted since the last rebuild (including keys since removed)
+    std::size_t inserted_ = 0;
+    // keys the blocks are sized for
+    std::size_t capacity_ = 0;
+    Hash hash_;
+
+    // returns a well distributed 64 bit hash for the key (e.g. std::hash of
+    // an integer is the integer itself)
+    uint64_t hash(const Key& key) const;
+    // returns the bits to test or set in the block
+    static uint64_t mask(uint64_t hash);
+    // returns the block for the hash
+    std::size_t block(uint64_t hash) const;
+    // sets the bits of the key (the filter must have at least one block)
+    void set(const Key& key);
+
+  public:
+    static constexpr bool enabled_v = true;
+
+    blocked_bloom_filter_t() = default;
+    explicit blocked_bloom_filter_t(const Allocator& allocator);
+
+    // returns false if the key is definitely not in the key index, true if it
+    // may be (false positives are rare, around 0.1-0.5% at 16 bits per key
+    // depending on how full the filter is)
+    [[nodiscard]] bool may_contain(const Key& key) const;
+    // adds a key inserted into index to the filter, the filter is rebuilt
+    // from index if more keys have been inserted than it is sized for
+    template<typename Index>
+    void insert(const Key& key, const Index& index);
+    // rebuilds the filter from the keys in index, sized for twice as many
+    // keys (clears the bits of removed keys)
+    template<typename Index>
+    void rebuild(const Index& index);
+    // removes every key (the blocks are kept)
+    void clear();
+    // returns the number of bytes used by the blocks
+    [[nodiscard]] std::size_t bytes() const;
+  };
+} // namespace thh
+
+#include "key-filter.inl"
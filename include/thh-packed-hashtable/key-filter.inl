@@ -0,0 +1,104 @@
+namespace thh
+{
+  template<typename Key, typename Hash, typename Allocator, int32_t BitsPerKey>
+  blocked_bloom_filter_t<Key, Hash, Allocator, BitsPerKey>::
+    blocked_bloom_filter_t(const Allocator& allocator)
+    : blocks_(block_allocator_type(allocator))
+  {
+  }
+
+  template<typename Key, typename Hash, typename Allocator, int32_t BitsPerKey>
+  uint64_t blocked_bloom_filter_t<Key, Hash, Allocator, BitsPerKey>::hash(
+    const Key& key) const
+  {
+    // 64 bit finalizer from MurmurHash3
+    auto mixed = static_cast<uint64_t>(hash_(key));
+    mixed ^= mixed >> 33;
+    mixed *= 0xff51afd7ed558ccdULL;
+    mixed ^= mixed >> 33;
+    mixed *= 0xc4ceb9fe1a85ec53ULL;
+    mixed ^= mixed >> 33;
+    return mixed;
+  }
+
+  template<typename Key, typename Hash, typename Allocator, int32_t BitsPerKey>
+  uint64_t blocked_bloom_filter_t<Key, Hash, Allocator, BitsPerKey>::mask(
+    const uint64_t hash)
+  {
+    // four 6 bit fields of the lower half select the bits (the upper half
+    // selects the block)
+    return (uint64_t(1) << (hash & 63)) | (uint64_t(1) << ((hash >> 6) & 63))
+         | (uint64_t(1) << ((hash >> 12) & 63))
+         | (uint64_t(1) << ((hash >> 18) & 63));
+  }
+
+  template<typename Key, typename Hash, typename Allocator, int32_t BitsPerKey>
+  std::size_t blocked_bloom_filter_t<Key, Hash, Allocator, BitsPerKey>::block(
+    const uint64_t hash) const
+  {
+    // maps the upper 32 bits to [0, blocks_.size()) without a division
+    return static_cast<std::size_t>(((hash >> 32) * blocks_.size()) >> 32);
+  }
+
+  template<typename Key, typename Hash, typename Allocator, int32_t BitsPerKey>
+  void blocked_bloom_filter_t<Key, Hash, Allocator, BitsPerKey>::set(
+    const Key& key)
+  {
+    const auto hashed = hash(key);
+    blocks_[block(hashed)] |= mask(hashed);
+  }
+
+  template<typename Key, typename Hash, typename Allocator, int32_t BitsPerKey>
+  bool blocked_bloom_filter_t<Key, Hash, Allocator, BitsPerKey>::may_contain(
+    const Key& key) const
+  {
+    if (blocks_.empty()) {
+      return false;
+    }
+    const auto hashed = hash(key);
+    const auto bits = mask(hashed);
+    return (blocks_[block(hashed)] & bits) == bits;
+  }
+
+  template<typename Key, typename Hash, typename Allocator, int32_t BitsPerKey>
+  template<typename Index>
+  void blocked_bloom_filter_t<Key, Hash, Allocator, BitsPerKey>::insert(
+    const Key& key, const Index& index)
+  {
+    if (++inserted_ > capacity_) {
+      rebuild(index);
+      return;
+    }
+    set(key);
+  }
+
+  template<typename Key, typename Hash, typename Allocator, int32_t BitsPerKey>
+  template<typename Index>
+  void blocked_bloom_filter_t<Key, Hash, Allocator, BitsPerKey>::rebuild(
+    const Index& index)
+  {
+    const auto keys = static_cast<std::size_t>(index.size());
+    const auto bits = std::max<std::size_t>(keys * 2 * BitsPerKey, 1);
+    const auto block_count = (bits + block_bits_v - 1) / block_bits_v;
+    blocks_.assign(block_count, 0);
+    capacity_ = block_count * block_bits_v / BitsPerKey;
+    inserted_ = keys;
+    for (const auto& key_handle : index) {
+      set(key_handle.first);
+    }
+  }
+
+  template<typename Key, typename Hash, typename Allocator, int32_t BitsPerKey>
+  void blocked_bloom_filter_t<Key, Hash, Allocator, BitsPerKey>::clear()
+  {
+    std::fill(blocks_.begin(), blocks_.end(), uint64_t(0));
+    inserted_ = 0;
+  }
+
+  template<typename Key, typename Hash, typename Allocator, int32_t BitsPerKey>
+  std::size_t blocked_bloom_filter_t<Key, Hash, Allocator, BitsPerKey>::bytes()
+    const
+  {
+    return blocks_.size() * sizeof(uint64_t);
+  }
+} // namespace thh
@@ -0,0 +1,155 @@
+#pragma once
+
+#if __has_include(<sys/mman.h>)
+
+#include "value-storage.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <new>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace thh
+{
+  // directory for the files backing mapped_storage_t (the system temporary
+  // directory), provide a type with a static path() function returning a
+  // different directory to customize this (see mapped_policy_t)
+  struct temp_directory_t
+  {
+    static std::string path()
+    {
+      return std::filesystem::temp_directory_path().string();
+    }
+  };
+
+  // value storage for non-empty value types, values are tightly packed in a
+  // memory mapped file (MAP_SHARED) in the same order as the dense slot ids so
+  // the kernel can page cold values out to the file instead of keeping them
+  // in memory
+  // note: the interface matches handle_vector_t so it can be used in its place
+  // note: the file is created (and immediately unlinked) in the directory
+  // returned from Directory::path() when the first value is added, growth
+  // extends the file with ftruncate and remaps it (mremap where available) so
+  // values are never copied
+  // note: value iteration (begin) advises the kernel of sequential access and
+  // call/call_return advise random access (madvise is only issued when the
+  // access pattern changes)
+  // note: values must be trivially relocatable (they are moved by remapping)
+  // note: Allocator is rebound for the handle slots only, throws
+  // std::bad_alloc if the file cannot be created or mapped
+  template<
+    typename Value, typename Tag, typename Allocator = std::allocator<Value>,
+    typename Directory = temp_directory_t,
+    typename Slots = handle_slots_t<Tag, Allocator>>
+  class mapped_storage_t
+  {
+    static_assert(
+      is_trivially_relocatable_v<Value>,
+      "Mapped storage requires trivially relocatable values");
+
+  public:
+    using handle_type = typename Slots::handle_type;
+    using size_type = typename Slots::size_type;
+
+  private:
+    // kernel access pattern advice last given for the mapping
+    enum class advice_e
+    {
+      normal,
+      sequential,
+      random
+    };
+
+    Slots slots_;
+    int file_ = -1;
+    Value* values_ = nullptr;
+    size_type value_capacity_ = 0;
+    mutable advice_e advice_ = advice_e::normal;
+
+    // returns the number of bytes mapped for capacity values (rounded up to a
+    // whole number of pages)
+    static std::size_t mapping_bytes(size_type capacity);
+    // resizes the file and the mapping to hold capacity values
+    void remap(size_type capacity);
+    // unmaps and closes the file (values must already be destroyed)
+    void release();
+    // destroys all values (slots are unchanged)
+    void destroy_values();
+    // gives the kernel access pattern advice for the mapping (if it changed)
+    void advise(advice_e advice) const;
+
+  public:
+    using iterator = Value*;
+    using const_iterator = const Value*;
+
+    mapped_storage_t() = default;
+    explicit mapped_storage_t(const Allocator& allocator);
+    mapped_storage_t(const mapped_storage_t& other);
+    mapped_storage_t(mapped_storage_t&& other) noexcept;
+    mapped_storage_t& operator=(const mapped_storage_t& other);
+    mapped_storage_t& operator=(mapped_storage_t&& other) noexcept;
+    ~mapped_storage_t();
+
+    template<typename... Args>
+    handle_type add(Args&&... args);
+    bool remove(handle_type handle);
+    void clear();
+    void reserve(size_type capacity);
+    // releases file space (and slots) not needed for the values stored
+    void shrink_to_fit();
+    // returns the number of bytes shrink_to_fit would release
+    [[nodiscard]] std::size_t reclaimable_bytes() const;
+    [[nodiscard]] bool has(handle_type handle) const;
+    [[nodiscard]] size_type size() const;
+    [[nodiscard]] size_type capacity() const;
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] handle_type handle_from_index(size_type index) const;
+    [[nodiscard]] std::optional<size_type> index_from_handle(
+      handle_type handle) const;
+    template<typename Fn>
+    void call(handle_type handle, Fn&& fn);
+    template<typename Fn>
+    void call(handle_type handle, Fn&& fn) const;
+    template<typename Fn>
+    decltype(auto) call_return(handle_type handle, Fn&& fn);
+    template<typename Fn>
+    decltype(auto) call_return(handle_type handle, Fn&& fn) const;
+    // sorts the values in the specified range (compare is passed indices)
+    template<typename Compare>
+    void sort(size_type begin, size_type end, Compare&& compare);
+    // partitions the values (predicate is passed an index)
+    // returns index of the first element for the second group
+    template<typename Predicate>
+    size_type partition(Predicate&& predicate);
+    // reorders the values (and slots) so position begin + i holds the value
+    // previously at order[i]
+    template<typename OrderAllocator>
+    void reorder(
+      size_type begin, const std::vector<size_type, OrderAllocator>& order);
+    [[nodiscard]] auto begin() -> iterator;
+    [[nodiscard]] auto begin() const -> const_iterator;
+    [[nodiscard]] auto cbegin() const -> const_iterator;
+    [[nodiscard]] auto end() -> iterator;
+    [[nodiscard]] auto end() const -> const_iterator;
+    [[nodiscard]] auto cend() const -> const_iterator;
+  };
+
+  // memory mapped storage used for the values of a packed hashtable
+  // empty value types use empty_value_storage_t (no memory is used for the
+  // values themselves), all other types use mapped_storage_t
+  template<
+    typename Value, typename Tag, typename Allocator = std::allocator<Value>,
+    typename Directory = temp_directory_t,
+    typename Slots = handle_slots_t<Tag, Allocator>>
+  using mapped_value_storage_t = std::conditional_t<
+    std::is_empty_v<Value>, empty_value_storage_t<Value, Tag, Allocator, Slots>,
+    mapped_storage_t<Value, Tag, Allocator, Directory, Slots>>;
+} // namespace thh
+
+#include "mapped-storage.inl"
+
+#endif
@@ -0,0 +1,508 @@
+namespace thh
+{
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  std::size_t mapped_storage_t<
+    Value, Tag, Allocator, Directory, Slots>::mapping_bytes(
+    const size_type capacity)
+  {
+    const auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    const auto bytes = static_cast<std::size_t>(capacity) * sizeof(Value);
+    return (bytes + page_size - 1) / page_size * page_size;
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  void mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::remap(
+    const size_type capacity)
+  {
+    if (file_ == -1) {
+      auto path = Directory::path() + "/thh-mapped-storage-XXXXXX";
+      file_ = ::mkstemp(path.data());
+      if (file_ == -1) {
+        throw std::bad_alloc();
+      }
+      // the file is removed when it is closed
+      ::unlink(path.c_str());
+    }
+    const auto old_bytes = mapping_bytes(value_capacity_);
+    const auto bytes = mapping_bytes(capacity);
+    if (::ftruncate(file_, static_cast<off_t>(bytes)) != 0) {
+      throw std::bad_alloc();
+    }
+    void* values = MAP_FAILED;
+    if (values_ == nullptr) {
+      values = ::mmap(
+        nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file_, 0);
+    } else {
+#ifdef MREMAP_MAYMOVE
+      values = ::mremap(values_, old_bytes, bytes, MREMAP_MAYMOVE);
+#else
+      // values are stored in the file so a new mapping of it holds them too
+      ::munmap(values_, old_bytes);
+      values = ::mmap(
+        nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file_, 0);
+#endif
+    }
+    if (values == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    values_ = static_cast<Value*>(values);
+    value_capacity_ = static_cast<size_type>(bytes / sizeof(Value));
+    advice_ = advice_e::normal;
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  void mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::release()
+  {
+    if (values_ != nullptr) {
+      ::munmap(values_, mapping_bytes(value_capacity_));
+      values_ = nullptr;
+      value_capacity_ = 0;
+    }
+    if (file_ != -1) {
+      ::close(file_);
+      file_ = -1;
+    }
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  void mapped_storage_t<
+    Value, Tag, Allocator, Directory, Slots>::destroy_values()
+  {
+    if constexpr (!std::is_trivially_destructible_v<Value>) {
+      std::destroy(values_, values_ + slots_.size());
+    }
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  void mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::advise(
+    const advice_e advice) const
+  {
+    if (advice_ == advice || values_ == nullptr) {
+      return;
+    }
+    ::madvise(
+      static_cast<void*>(values_), mapping_bytes(value_capacity_),
+      advice == advice_e::sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    advice_ = advice;
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  template<typename OrderAllocator>
+  void mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::reorder(
+    const size_type begin,
+    const std::vector<size_type, OrderAllocator>& order)
+  {
+    const auto count = static_cast<size_type>(order.size());
+    using placed_allocator_type = typename std::allocator_traits<
+      OrderAllocator>::template rebind_alloc<bool>;
+    auto placed = std::vector<bool, placed_allocator_type>(
+      count, false, placed_allocator_type(order.get_allocator()));
+    alignas(Value) std::byte temp[sizeof(Value)];
+    for (size_type start = 0; start < count; ++start) {
+      if (placed[start] || order[start] == begin + start) {
+        continue;
+      }
+      // lift out the value at the start of the cycle and fill the hole it
+      // leaves by following the cycle until it is closed again
+      relocate_at(reinterpret_cast<Value*>(temp), values_ + begin + start);
+      size_type hole = start;
+      while (order[hole] != begin + start) {
+        const auto next = order[hole] - begin;
+        relocate_at(values_ + begin + hole, values_ + begin + next);
+        placed[hole] = true;
+        hole = next;
+      }
+      relocate_at(values_ + begin + hole, reinterpret_cast<Value*>(temp));
+      placed[hole] = true;
+    }
+    slots_.reorder(begin, order);
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::mapped_storage_t(
+    const Allocator& allocator)
+    : slots_(allocator)
+  {
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::mapped_storage_t(
+    const mapped_storage_t& other)
+    : slots_(other.slots_)
+  {
+    if (other.size() > 0) {
+      remap(other.size());
+      std::uninitialized_copy(other.begin(), other.end(), values_);
+    }
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::mapped_storage_t(
+    mapped_storage_t&& other) noexcept
+    : slots_(std::move(other.slots_)),
+      file_(std::exchange(other.file_, -1)),
+      values_(std::exchange(other.values_, nullptr)),
+      value_capacity_(std::exchange(other.value_capacity_, 0)),
+      advice_(other.advice_)
+  {
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  mapped_storage_t<Value, Tag, Allocator, Directory, Slots>& mapped_storage_t<
+    Value, Tag, Allocator, Directory,
+    Slots>::operator=(const mapped_storage_t& other)
+  {
+    if (this == &other) {
+      return *this;
+    }
+    destroy_values();
+    slots_.clear();
+    if (value_capacity_ < other.size()) {
+      remap(other.size());
+    }
+    std::uninitialized_copy(other.begin(), other.end(), values_);
+    slots_ = other.slots_;
+    return *this;
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  mapped_storage_t<Value, Tag, Allocator, Directory, Slots>& mapped_storage_t<
+    Value, Tag, Allocator,
+    Directory, Slots>::operator=(mapped_storage_t&& other) noexcept
+  {
+    if (this == &other) {
+      return *this;
+    }
+    destroy_values();
+    release();
+    slots_ = std::move(other.slots_);
+    file_ = std::exchange(other.file_, -1);
+    values_ = std::exchange(other.values_, nullptr);
+    value_capacity_ = std::exchange(other.value_capacity_, 0);
+    advice_ = other.advice_;
+    return *this;
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::~mapped_storage_t()
+  {
+    destroy_values();
+    release();
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  template<typename... Args>
+  auto mapped_storage_t<
+    Value, Tag, Allocator, Directory, Slots>::add(
+    Args&&... args) -> handle_type
+  {
+    const auto size = slots_.size();
+    if (size == value_capacity_) {
+      // construct the new value before remapping in case args refer to a
+      // value in the container (the mapping may move)
+      alignas(Value) std::byte value[sizeof(Value)];
+      ::new (static_cast<void*>(value)) Value(std::forward<Args>(args)...);
+      remap(value_capacity_ == 0 ? 1 : value_capacity_ * 2);
+      relocate_at(values_ + size, reinterpret_cast<Value*>(value));
+    } else {
+      ::new (static_cast<void*>(values_ + size))
+        Value(std::forward<Args>(args)...);
+    }
+    return slots_.add();
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  bool mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::remove(
+    const handle_type handle)
+  {
+    const auto index = slots_.remove(handle);
+    if (!index.has_value()) {
+      return false;
+    }
+    // slots_ has already been updated so the size is the index of the last
+    // value, relocate it into the position of the removed value
+    const auto last = slots_.size();
+    std::destroy_at(values_ + *index);
+    if (*index != last) {
+      relocate_at(values_ + *index, values_ + last);
+    }
+    return true;
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  void mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::clear()
+  {
+    destroy_values();
+    slots_.clear();
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  void mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::reserve(
+    const size_type capacity)
+  {
+    slots_.reserve(capacity);
+    if (capacity > value_capacity_) {
+      remap(capacity);
+    }
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  void mapped_storage_t<
+    Value, Tag, Allocator, Directory, Slots>::shrink_to_fit()
+  {
+    slots_.shrink_to_fit();
+    const auto size = slots_.size();
+    if (size == 0) {
+      release();
+    } else if (mapping_bytes(size) < mapping_bytes(value_capacity_)) {
+      remap(size);
+    }
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  std::size_t mapped_storage_t<
+    Value, Tag, Allocator, Directory, Slots>::reclaimable_bytes() const
+  {
+    return slots_.reclaimable_bytes() + mapping_bytes(value_capacity_)
+         - mapping_bytes(slots_.size());
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  bool mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::has(
+    const handle_type handle) const
+  {
+    return slots_.has(handle);
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  auto mapped_storage_t<
+    Value, Tag, Allocator, Directory, Slots>::size() const -> size_type
+  {
+    return slots_.size();
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  auto mapped_storage_t<
+    Value, Tag, Allocator, Directory, Slots>::capacity() const -> size_type
+  {
+    return slots_.capacity();
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  bool mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::empty() const
+  {
+    return slots_.size() == 0;
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  auto mapped_storage_t<
+    Value, Tag, Allocator, Directory,
+    Slots>::handle_from_index(const size_type index) const -> handle_type
+  {
+    return slots_.handle_from_index(index);
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  auto mapped_storage_t<
+    Value, Tag, Allocator,
+    Directory, Slots>::index_from_handle(const handle_type handle) const
+    -> std::optional<size_type>
+  {
+    return slots_.index_from_handle(handle);
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  template<typename Fn>
+  void mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::call(
+    const handle_type handle, Fn&& fn)
+  {
+    if (const auto index = slots_.index_from_handle(handle);
+        index.has_value()) {
+      advise(advice_e::random);
+      fn(values_[*index]);
+    }
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  template<typename Fn>
+  void mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::call(
+    const handle_type handle, Fn&& fn) const
+  {
+    if (const auto index = slots_.index_from_handle(handle);
+        index.has_value()) {
+      advise(advice_e::random);
+      fn(std::as_const(values_[*index]));
+    }
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  template<typename Fn>
+  decltype(auto) mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::
+    call_return(const handle_type handle, Fn&& fn)
+  {
+    using result_t = decltype(fn(*values_));
+    if (const auto index = slots_.index_from_handle(handle);
+        index.has_value()) {
+      advise(advice_e::random);
+      return std::optional<result_t>(fn(values_[*index]));
+    }
+    return std::optional<result_t>{};
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  template<typename Fn>
+  decltype(auto) mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::
+    call_return(const handle_type handle, Fn&& fn) const
+  {
+    using result_t = decltype(fn(std::as_const(*values_)));
+    if (const auto index = slots_.index_from_handle(handle);
+        index.has_value()) {
+      advise(advice_e::random);
+      return std::optional<result_t>(fn(std::as_const(values_[*index])));
+    }
+    return std::optional<result_t>{};
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  template<typename Compare>
+  void mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::sort(
+    const size_type begin, const size_type end, Compare&& compare)
+  {
+    auto order = std::vector<size_type, typename Slots::order_allocator_type>(
+      end - begin, size_type(0), slots_.get_allocator());
+    std::iota(order.begin(), order.end(), begin);
+    std::sort(order.begin(), order.end(), std::forward<Compare>(compare));
+    reorder(begin, order);
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  template<typename Predicate>
+  auto mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::partition(
+    Predicate&& predicate) -> size_type
+  {
+    auto order = std::vector<size_type, typename Slots::order_allocator_type>(
+      slots_.size(), size_type(0), slots_.get_allocator());
+    std::iota(order.begin(), order.end(), 0);
+    const auto second = std::partition(
+      order.begin(), order.end(), std::forward<Predicate>(predicate));
+    reorder(0, order);
+    return static_cast<size_type>(std::distance(order.begin(), second));
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  auto mapped_storage_t<
+    Value, Tag, Allocator, Directory, Slots>::begin() -> iterator
+  {
+    advise(advice_e::sequential);
+    return values_;
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  auto mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::begin() const
+    -> const_iterator
+  {
+    advise(advice_e::sequential);
+    return values_;
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  auto mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::cbegin() const
+    -> const_iterator
+  {
+    advise(advice_e::sequential);
+    return values_;
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  auto mapped_storage_t<
+    Value, Tag, Allocator, Directory, Slots>::end() -> iterator
+  {
+    return values_ + slots_.size();
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  auto mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::end() const
+    -> const_iterator
+  {
+    return values_ + slots_.size();
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, typename Directory,
+    typename Slots>
+  auto mapped_storage_t<Value, Tag, Allocator, Directory, Slots>::cend() const
+    -> const_iterator
+  {
+    return values_ + slots_.size();
+  }
+} // namespace thh
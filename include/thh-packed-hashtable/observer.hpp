@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace thh
+{
+  // type of change reported to an observer
+  enum class observer_event_e : uint8_t
+  {
+    // element added, the event holds its handle
+    add,
+    // element removed, the event holds its (now invalid) handle
+    remove,
+    // all elements removed, the event holds an invalid handle
+    clear
+  };
+
+  // change reported to an observer (see batched_observer_t)
+  template<typename Handle>
+  struct observer_event_t
+  {
+    observer_event_e event_;
+    Handle handle_;
+  };
+
+  // observer used by packed hashtables by default, records nothing (every
+  // function is an empty noop so the hooks compile away)
+  // note: this is the interface base_packed_hashtable_t calls to report adds
+  // and removes, batched_observer_t implements the same functions
+  template<typename Handle, typename Allocator>
+  class no_observer_t
+  {
+  public:
+    // if events are recorded (see observed_policy_t)
+    static constexpr bool enabled_v = false;
+
+    no_observer_t() = default;
+    explicit no_observer_t(const Allocator&) {}
+
+    void record_add(Handle) {}
+    void record_remove(Handle) {}
+    void record_clear() {}
+    template<typename Fn>
+    void deliver(Fn&&)
+    {
+    }
+  };
+
+  // observer appending each add and remove to a contiguous buffer so they can
+  // be delivered in batches (see observed_policy_t), e.g. to mirror elements
+  // into a spatial index or queue them for upload without looking them up
+  // again
+  // note: events are delivered in the order they happened, a handle may be
+  // added and removed within the same batch
+  // note: records are written by base_packed_hashtable_t (the record_
+  // functions are not intended to be called directly)
+  template<typename Handle, typename Allocator>
+  class batched_observer_t
+  {
+  public:
+    using event_type = observer_event_t<Handle>;
+
+  private:
+    using event_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<event_type>;
+
+    // events recorded since the last delivery
+    std::vector<event_type, event_allocator_type> events_;
+
+  public:
+    static constexpr bool enabled_v = true;
+
+    batched_observer_t() = default;
+    explicit batched_observer_t(const Allocator& allocator);
+
+    // records an element was added
+    void record_add(Handle handle);
+    // records an element was removed
+    void record_remove(Handle handle);
+    // records all elements were removed
+    void record_clear();
+    // returns the number of events waiting for delivery
+    [[nodiscard]] std::size_t size() const;
+    // invokes fn with the range [first, last) of events recorded since the
+    // last delivery (if there are any), then discards them
+    // note: the buffer capacity is kept for the next batch
+    template<typename Fn>
+    void deliver(Fn&& fn);
+  };
+} // namespace thh
+
+#include "observer.inl"
@@ -0,0 +1,48 @@
+namespace thh
+{
+  template<typename Handle, typename Allocator>
+  batched_observer_t<Handle, Allocator>::batched_observer_t(
+    const Allocator& allocator)
+    : events_(event_allocator_type(allocator))
+  {
+  }
+
+  template<typename Handle, typename Allocator>
+  void batched_observer_t<Handle, Allocator>::record_add(const Handle handle)
+  {
+    events_.push_back({observer_event_e::add, handle});
+  }
+
+  template<typename Handle, typename Allocator>
+  void batched_observer_t<Handle, Allocator>::record_remove(
+    const Handle handle)
+  {
+    events_.push_back({observer_event_e::remove, handle});
+  }
+
+  template<typename Handle, typename Allocator>
+  void batched_observer_t<Handle, Allocator>::record_clear()
+  {
+    // earlier events are superseded (every element they refer to is gone)
+    events_.clear();
+    events_.push_back({observer_event_e::clear, Handle{}});
+  }
+
+  template<typename Handle, typename Allocator>
+  std::size_t batched_observer_t<Handle, Allocator>::size() const
+  {
+    return events_.size();
+  }
+
+  template<typename Handle, typename Allocator>
+  template<typename Fn>
+  void batched_observer_t<Handle, Allocator>::deliver(Fn&& fn)
+  {
+    if (events_.empty()) {
+      return;
+    }
+    fn(static_cast<const event_type*>(events_.data()),
+       static_cast<const event_type*>(events_.data() + events_.size()));
+    events_.clear();
+  }
+} // namespace thh
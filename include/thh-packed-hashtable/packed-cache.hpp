@@ -0,0 +1,137 @@
+#pragma once
+
+#include "packed-hashtable.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace thh
+{
+  // bounded cache built on packed_hashtable_rl_t, adding a key to a full cache
+  // evicts an element chosen with the CLOCK algorithm (an approximation of
+  // least recently used)
+  // each value has a reference bit (in a dense array parallel to the values)
+  // set when the value is found, the clock hand sweeps the dense array
+  // clearing set bits and evicts the first value found without one
+  // note: evictions use the swap and pop removal of the table, the reference
+  // bit of the last value is moved with it
+  // note: handles and value pointers are invalidated when their element is
+  // evicted
+  // note: deferred_removal_policy_t is not supported (evicted values must be
+  // released immediately), with static_policy_t the capacity must be at least
+  // one more than the maximum size
+  template<
+    typename Key, typename Value, typename Hash = std::hash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Tag = packed_hashtable_tag_t,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>,
+    typename Policy = packed_hashtable_policy_t>
+  class packed_cache_t
+  {
+    using table_t = packed_hashtable_rl_t<
+      Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>;
+    using referenced_allocator_type =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<uint8_t>;
+
+    static_assert(
+      !table_t::deferred_removal_v,
+      "Packed caches do not support deferred removals");
+
+    table_t table_;
+    // reference bit of each value (indexed by dense position)
+    std::vector<uint8_t, referenced_allocator_type> referenced_;
+    // dense position of the next value the clock hand will inspect
+    typename table_t::size_type hand_ = 0;
+    typename table_t::size_type max_size_ = 0;
+    // number of elements evicted since construction (or the last clear)
+    int64_t evictions_ = 0;
+
+    // removes the value at the dense index, the last value and its reference
+    // bit are moved into its place
+    void remove_at(typename table_t::size_type index);
+    // advances the clock hand to the first value without its reference bit
+    // set (clearing set bits on the way and skipping the value at pinned) and
+    // evicts it
+    void sweep(typename table_t::size_type pinned);
+
+  public:
+    using table_type = table_t;
+    using key_value_type = typename table_t::key_value_type;
+    using handle_type = typename table_t::handle_type;
+    using size_type = typename table_t::size_type;
+
+    // approximate bytes used by each element (the value, the key and handle
+    // in the key index, the handle slot, dense id, key pointer and reference
+    // bit), used to turn a byte budget into a maximum size
+    static constexpr std::size_t element_bytes_v = sizeof(Key) + sizeof(Value)
+                                                 + sizeof(handle_type) * 2
+                                                 + sizeof(int32_t)
+                                                 + sizeof(void*) * 3
+                                                 + sizeof(uint8_t);
+
+    // constructs an empty cache holding at most max_size elements (storage for
+    // every element is reserved up front)
+    // note: max_size must not be negative
+    explicit packed_cache_t(
+      size_type max_size, const Allocator& allocator = Allocator());
+    // constructs an empty cache holding as many elements as fit in max_bytes
+    // (see element_bytes_v)
+    [[nodiscard]] static packed_cache_t with_byte_budget(
+      std::size_t max_bytes, const Allocator& allocator = Allocator());
+
+    // adds a value to the cache or updates it if the key already exists, if
+    // the cache was full another element is evicted to make room
+    // returns a pair consisting of the handle of the inserted or updated
+    // element and a bool indicating whether the insertion took place
+    // type P should conform to key_value_type
+    // note: a new element starts without its reference bit set (it is evicted
+    // on the next sweep unless it is found before then), an updated element
+    // has its reference bit set
+    // note: returns an invalid handle and false if the maximum size is zero
+    template<typename P>
+    std::pair<handle_type, bool> add_or_update(P&& key_value);
+    // adds a value to the cache or updates it if the key already exists
+    // (rvalue reference)
+    // note: supports .add_or_update({key, value}) syntax
+    std::pair<handle_type, bool> add_or_update(key_value_type&& key_value);
+    // returns a pointer to the value with the equivalent key and sets its
+    // reference bit, or nullptr if the key is not cached
+    // note: the pointer is valid until the element is evicted or removed
+    [[nodiscard]] Value* find(const Key& key);
+    // returns a pointer to the value with the equivalent key without setting
+    // its reference bit, or nullptr if the key is not cached
+    [[nodiscard]] const Value* peek(const Key& key) const;
+    // returns if the cache has an element with the equivalent key (the
+    // reference bit is not set)
+    [[nodiscard]] bool has(const Key& key) const;
+    // removes the element with the equivalent key (if one exists)
+    // returns if an element was removed or not
+    bool remove(const Key& key);
+    // evicts one element chosen by the clock hand (e.g. to make room when the
+    // budget is shared with other data)
+    // returns false if the cache is empty
+    bool evict();
+    // removes all elements from the cache (the maximum size is unchanged)
+    void clear();
+    // returns if the reference bit of the value at the index is set
+    [[nodiscard]] bool referenced(size_type index) const;
+    // returns the number of elements in the cache
+    [[nodiscard]] size_type size() const;
+    // returns the maximum number of elements the cache can hold
+    [[nodiscard]] size_type max_size() const;
+    // returns if the cache has any elements or not
+    [[nodiscard]] bool empty() const;
+    // returns the number of elements evicted since construction (or the last
+    // clear)
+    [[nodiscard]] int64_t evictions() const;
+    // returns the underlying table (for iteration and handle lookups)
+    [[nodiscard]] auto table() const -> const table_type&;
+  };
+} // namespace thh
+
+#include "packed-cache.inl"
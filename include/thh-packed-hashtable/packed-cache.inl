@@ -0,0 +1,245 @@
+namespace thh
+{
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  packed_cache_t<Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::
+    packed_cache_t(const size_type max_size, const Allocator& allocator)
+    : table_(allocator),
+      referenced_(referenced_allocator_type(allocator)),
+      max_size_(max_size)
+  {
+    // one extra element as a new element is added before making room
+    table_.reserve(max_size_ + 1);
+    referenced_.reserve(static_cast<std::size_t>(max_size_) + 1);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  auto packed_cache_t<Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::
+    with_byte_budget(const std::size_t max_bytes, const Allocator& allocator)
+      -> packed_cache_t
+  {
+    return packed_cache_t(
+      static_cast<size_type>(max_bytes / element_bytes_v), allocator);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  void packed_cache_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::remove_at(const size_type index)
+  {
+    table_.remove(table_.handle_from_index(index));
+    // mirror the swap and pop of the value storage
+    const auto position = static_cast<std::size_t>(index);
+    referenced_[position] = referenced_.back();
+    referenced_.pop_back();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  void packed_cache_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::sweep(const size_type pinned)
+  {
+    const auto size = table_.size();
+    // at most one full sweep, every reference bit is clear after it
+    for (;; ++hand_) {
+      if (hand_ >= size) {
+        hand_ = 0;
+      }
+      if (hand_ == pinned) {
+        continue;
+      }
+      auto& referenced = referenced_[static_cast<std::size_t>(hand_)];
+      if (referenced == 0) {
+        break;
+      }
+      referenced = 0;
+    }
+    // the last value is moved under the hand and inspected next
+    remove_at(hand_);
+    ++evictions_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  template<typename P>
+  auto packed_cache_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::add_or_update(P&& key_value) -> std::pair<handle_type, bool>
+  {
+    if (max_size_ <= 0) {
+      return {handle_type{}, false};
+    }
+    const auto [it, added] = table_.add_or_update(std::forward<P>(key_value));
+    if (it == table_.hend()) {
+      return {handle_type{}, false};
+    }
+    const auto handle = it->second;
+    if (!added) {
+      referenced_[static_cast<std::size_t>(
+        *table_.index_from_handle(handle))] = 1;
+      return {handle, false};
+    }
+    // the new element is added first (so the key is only looked up once)
+    // and is skipped by the eviction making room for it
+    referenced_.push_back(0);
+    if (const auto size = table_.size(); size > max_size_) {
+      sweep(size - 1);
+    }
+    return {handle, true};
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  auto packed_cache_t<Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::
+    add_or_update(key_value_type&& key_value) -> std::pair<handle_type, bool>
+  {
+    return add_or_update<key_value_type>(std::move(key_value));
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  Value* packed_cache_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::find(const Key& key)
+  {
+    const auto it = table_.find(key);
+    if (it == table_.hend()) {
+      return nullptr;
+    }
+    const auto index = *table_.index_from_handle(it->second);
+    referenced_[static_cast<std::size_t>(index)] = 1;
+    return &*std::next(table_.vbegin(), index);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  const Value* packed_cache_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::peek(const Key& key)
+    const
+  {
+    const auto it = table_.find(key);
+    if (it == table_.hcend()) {
+      return nullptr;
+    }
+    const auto index = *table_.index_from_handle(it->second);
+    return &*std::next(table_.vcbegin(), index);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  bool packed_cache_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::has(const Key& key)
+    const
+  {
+    return table_.has(key);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  bool packed_cache_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::remove(const Key& key)
+  {
+    const auto it = table_.find(key);
+    if (it == table_.hend()) {
+      return false;
+    }
+    remove_at(*table_.index_from_handle(it->second));
+    return true;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  bool packed_cache_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::evict()
+  {
+    if (table_.size() == 0) {
+      return false;
+    }
+    sweep(-1);
+    return true;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  void packed_cache_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::clear()
+  {
+    table_.clear();
+    referenced_.clear();
+    hand_ = 0;
+    evictions_ = 0;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  bool packed_cache_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::referenced(const size_type index) const
+  {
+    return index >= 0 && index < table_.size()
+        && referenced_[static_cast<std::size_t>(index)] != 0;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  auto packed_cache_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::size() const
+    -> size_type
+  {
+    return table_.size();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  auto packed_cache_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::max_size() const
+    -> size_type
+  {
+    return max_size_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  bool packed_cache_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::empty() const
+  {
+    return table_.empty();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  int64_t packed_cache_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::evictions() const
+  {
+    return evictions_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  auto packed_cache_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::table() const
+    -> const table_type&
+  {
+    return table_;
+  }
+} // namespace thh
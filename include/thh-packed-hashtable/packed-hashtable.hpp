@@ -1,8 +1,29 @@
 #pragma once
 
 #include <thh-handle-vector/handle-vector.hpp>
+#include <numeric>
 #include <unordered_map>
 
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+
+#include "access-profiler.hpp"
+#include "change-tracker.hpp"
+#include "compact-handle.hpp"
+#include "compressed-member.hpp"
+#include "incremental-hash-map.hpp"
+#include "journal.hpp"
+#include "key-filter.hpp"
+#include "mapped-storage.hpp"
+#include "observer.hpp"
+#include "radix-sort.hpp"
+#include "segmented-storage.hpp"
+#include "static-hash-map.hpp"
+#include "static-storage.hpp"
+#include "tombstones.hpp"
+#include "value-storage.hpp"
+
 namespace thh
 {
   // hash function implementation for typed_handle_t
@@ -28,6 +49,21 @@ namespace thh
     }
   };
 
+  // hash function implementation for wide_handle_t (combined in the same way
+  // as typed_handle_hash_t)
+  template<typename Tag>
+  struct wide_handle_hash_t
+  {
+    std::size_t operator()(const wide_handle_t<Tag>& handle) const
+    {
+      const std::hash<int64_t> hasher;
+      std::size_t seed = 0;
+      seed ^= hasher(handle.gen_) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+      seed ^= hasher(handle.id_) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+      return seed;
+    }
+  };
+
   // default tag for packed_hashtable handles
   struct packed_hashtable_tag_t
   {
@@ -36,37 +72,501 @@ namespace thh
   // alias for default packed hashtable handle if a custom tag is not used
   using packed_hashtable_handle_t = typed_handle_t<packed_hashtable_tag_t>;
 
+  // value type for packed hashtables that only need to store keys (see
+  // packed_hashset_t)
+  struct empty_value_t
+  {
+  };
+
+  // default policy for packed hashtables, values are stored in a single
+  // contiguous buffer (see value_storage_t)
+  // note: derive from this type and replace member templates to customize the
+  // internals of a packed hashtable (see segmented_policy_t)
+  struct packed_hashtable_policy_t
+  {
+    // storage for the values of the container
+    template<typename Value, typename Tag, typename Allocator>
+    using value_storage_t = thh::value_storage_t<Value, Tag, Allocator>;
+    // sparse handle slots of the value storage (see handle_slots_t)
+    template<typename Tag, typename Allocator>
+    using handle_slots_t = thh::handle_slots_t<Tag, Allocator>;
+    // handle stored in the key index
+    template<typename Tag>
+    using handle_t = typed_handle_t<Tag>;
+    // index mapping keys to handles
+    template<
+      typename Key, typename Mapped, typename Hash, typename KeyEqual,
+      typename Allocator>
+    using key_index_t =
+      std::unordered_map<Key, Mapped, Hash, KeyEqual, Allocator>;
+    // filter rejecting lookups of missing keys before the key index is
+    // searched (every lookup searches the key index by default)
+    template<typename Key, typename Hash, typename Allocator>
+    using key_filter_t = no_key_filter_t<Key, Hash, Allocator>;
+    // log of changes made to the container (records nothing by default)
+    template<typename Key, typename Value, typename Tag, typename Allocator>
+    using journal_t = no_journal_t<Key, Value, Tag, Allocator>;
+    // profile of lookups made in the container (records nothing by default)
+    template<typename Tag, typename Allocator>
+    using access_profiler_t = no_access_profiler_t<Tag, Allocator>;
+    // marks for removed values still stored (removals are immediate by
+    // default)
+    template<typename Allocator>
+    using tombstones_t = no_tombstones_t<Allocator>;
+    // version stamps of changed values (records nothing by default)
+    template<typename Allocator>
+    using change_tracker_t = no_change_tracker_t<Allocator>;
+    // observer of adds and removes (records nothing by default)
+    template<typename Handle, typename Allocator>
+    using observer_t = no_observer_t<Handle, Allocator>;
+  };
+
+  // policy storing values in fixed size chunks (see segmented_storage_t),
+  // growth appends a chunk instead of reallocating and moving every value
+  // note: ChunkSize is the number of values per chunk (must be a power of two),
+  // 0 selects default_chunk_size_v (roughly 64KiB per chunk)
+  // note: other policy members are taken from BasePolicy
+  template<
+    int32_t ChunkSize = 0, typename BasePolicy = packed_hashtable_policy_t>
+  struct segmented_policy_t : BasePolicy
+  {
+    template<typename Value, typename Tag, typename Allocator>
+    using value_storage_t = segmented_value_storage_t<
+      Value, Tag, Allocator,
+      ChunkSize == 0 ? default_chunk_size_v<Value> : ChunkSize,
+      typename BasePolicy::template handle_slots_t<Tag, Allocator>>;
+  };
+
+#if __has_include(<sys/mman.h>)
+  // policy storing values in a memory mapped file (see mapped_storage_t) so
+  // values that do not fit in memory are paged in and out by the kernel, the
+  // key index and handle slots remain in memory
+  // note: Directory::path() returns the directory the (unlinked) file is
+  // created in, defaults to the system temporary directory
+  // note: other policy members are taken from BasePolicy
+  template<
+    typename Directory = temp_directory_t,
+    typename BasePolicy = packed_hashtable_policy_t>
+  struct mapped_policy_t : BasePolicy
+  {
+    template<typename Value, typename Tag, typename Allocator>
+    using value_storage_t = mapped_value_storage_t<
+      Value, Tag, Allocator, Directory,
+      typename BasePolicy::template handle_slots_t<Tag, Allocator>>;
+  };
+#endif
+
+  // policy packing handles into a single Word (see compact_handle_t), the low
+  // IndexBits bits are the id and the remaining bits (at most 31) the
+  // generation, e.g. the default 24/8 split addresses 16M elements and halves
+  // the handle slots and the handles in the key index
+  // note: the public interface still takes and returns typed_handle_t (the
+  // compact handles convert implicitly), only the stored handles shrink
+  // note: with few generation bits a stale handle may refer to a new element
+  // once its slot has been reused 2^(bits - IndexBits) times
+  // note: replaces the handle slots, so must be the innermost BasePolicy when
+  // composed with a policy replacing the value storage (e.g.
+  // segmented_policy_t<0, compact_handle_policy_t<>>)
+  template<
+    typename Word = uint32_t, int32_t IndexBits = 24,
+    typename BasePolicy = packed_hashtable_policy_t>
+  struct compact_handle_policy_t : BasePolicy
+  {
+    template<typename Tag, typename Allocator>
+    using handle_slots_t =
+      compact_handle_slots_t<Tag, Allocator, Word, IndexBits>;
+    template<typename Tag>
+    using handle_t = compact_handle_t<Tag, Word, IndexBits>;
+
+    template<typename Value, typename Tag, typename Allocator>
+    using value_storage_t = thh::value_storage_t<
+      Value, Tag, Allocator, handle_slots_t<Tag, Allocator>>;
+  };
+
+  // policy using 64 bit handles (see wide_handle_t), sizes and indices (see
+  // base_packed_hashtable_t::size_type) for containers of more than 2^31
+  // elements, the default policy keeps 32 bit handles and sizes
+  // note: each element uses 20 more bytes than with the default policy (in
+  // the handle slots, dense ids and key index)
+  // note: replaces the handle slots, so must be the innermost BasePolicy when
+  // composed with a policy replacing the value storage (e.g.
+  // segmented_policy_t<0, wide_size_policy_t<>>)
+  // note: journals, snapshots, checkpoints and shared tables record 32 bit
+  // handles and are not supported
+  template<typename BasePolicy = packed_hashtable_policy_t>
+  struct wide_size_policy_t : BasePolicy
+  {
+    template<typename Tag, typename Allocator>
+    using handle_slots_t =
+      thh::handle_slots_t<Tag, Allocator, wide_handle_t<Tag>>;
+    template<typename Tag>
+    using handle_t = wide_handle_t<Tag>;
+
+    template<typename Value, typename Tag, typename Allocator>
+    using value_storage_t = thh::value_storage_t<
+      Value, Tag, Allocator, handle_slots_t<Tag, Allocator>>;
+  };
+
+  // policy using an incrementally rehashed key index (see
+  // incremental_hash_map_t), when the index grows MigrateBuckets buckets are
+  // moved to the new table per insert/remove instead of rehashing every key at
+  // once
+  // note: other policy members are taken from BasePolicy
+  template<
+    int32_t MigrateBuckets = 8, typename BasePolicy = packed_hashtable_policy_t>
+  struct incremental_rehash_policy_t : BasePolicy
+  {
+    template<
+      typename Key, typename Mapped, typename Hash, typename KeyEqual,
+      typename Allocator>
+    using key_index_t = incremental_hash_map_t<
+      Key, Mapped, Hash, KeyEqual, Allocator, MigrateBuckets>;
+  };
+
+  // policy recording every add, update and remove in an append-only log (see
+  // packed_hashtable_journal_t) so changes can be checkpointed or replicated
+  // (see journal_replayer_t) at a cost proportional to the number of changes
+  // note: other policy members are taken from BasePolicy
+  template<typename BasePolicy = packed_hashtable_policy_t>
+  struct journaled_policy_t : BasePolicy
+  {
+    template<typename Key, typename Value, typename Tag, typename Allocator>
+    using journal_t = packed_hashtable_journal_t<Key, Value, Tag, Allocator>;
+  };
+
+  // policy sampling one in every SampleInterval lookups (find, call and
+  // call_return) to estimate how often each element is accessed (see
+  // sampling_access_profiler_t), reorder_by_hotness then moves the most
+  // frequently accessed values to the front of the dense array
+  // note: each element uses 4 more bytes (the sampled count)
+  // note: lookups through const functions update the profile, so concurrent
+  // readers need external synchronization
+  // note: other policy members are taken from BasePolicy
+  template<
+    int32_t SampleInterval = 16,
+    typename BasePolicy = packed_hashtable_policy_t>
+  struct hotness_policy_t : BasePolicy
+  {
+    template<typename Tag, typename Allocator>
+    using access_profiler_t =
+      sampling_access_profiler_t<Tag, Allocator, SampleInterval>;
+  };
+
+  // policy deferring removals, remove erases the key and marks the value with
+  // a tombstone bit (see tombstone_bits_t) instead of moving the last value
+  // into its place, so values can be removed while iterating
+  // value_iteration() (which skips tombstones), compact_removals then closes
+  // every hole in one pass (optionally keeping the order of the values)
+  // note: size() is the number of live elements, vbegin()/vend() still cover
+  // the removed values until compaction (see tombstoned)
+  // note: sort, partition and the reorder functions require compaction first
+  // note: other policy members are taken from BasePolicy
+  template<typename BasePolicy = packed_hashtable_policy_t>
+  struct deferred_removal_policy_t : BasePolicy
+  {
+    template<typename Allocator>
+    using tombstones_t = tombstone_bits_t<Allocator>;
+  };
+
+  // policy stamping each value with a version when it is added or modified
+  // (see change_tracker_t) so consumers (e.g. replication or render sync) can
+  // visit only the values changed since the version they last saw with
+  // for_each_changed_since instead of scanning every value
+  // note: each element uses 8 more bytes (the stamp)
+  // note: values dereferenced through mutable value_iteration(),
+  // kv_iteration() and dense_iteration() are stamped (whether modified or
+  // not), changes made through vbegin()/vend() are not seen, use
+  // record_update on the table after modifying a value this way
+  // note: removals are never reported (see observed_policy_t)
+  // note: other policy members are taken from BasePolicy
+  template<typename BasePolicy = packed_hashtable_policy_t>
+  struct change_tracking_policy_t : BasePolicy
+  {
+    template<typename Allocator>
+    using change_tracker_t = thh::change_tracker_t<Allocator>;
+  };
+
+  // policy recording every add and remove as an event in a contiguous buffer
+  // (see batched_observer_t) delivered in batches with deliver_events, so
+  // other structures (e.g. spatial indices or upload queues) can mirror the
+  // container without wrapping add and remove
+  // note: other policy members are taken from BasePolicy
+  template<typename BasePolicy = packed_hashtable_policy_t>
+  struct observed_policy_t : BasePolicy
+  {
+    template<typename Handle, typename Allocator>
+    using observer_t = batched_observer_t<Handle, Allocator>;
+  };
+
+  // policy placing a blocked bloom filter of the keys in front of the key
+  // index (see blocked_bloom_filter_t), lookups of missing keys (find, has,
+  // call, call_return, remove by key and add of a new key) are rejected after
+  // reading a single word instead of searching the key index, for miss heavy
+  // workloads (e.g. deduplication or checking a cache before loading)
+  // note: BitsPerKey is the size of the filter per key (the filter is rebuilt
+  // for twice the number of keys so uses up to 2 * BitsPerKey bits per key),
+  // 16 rejects all but roughly 0.1-0.5% of misses
+  // note: removed keys stay in the filter until it is rebuilt (after as many
+  // adds as there were keys, or by shrink_to_fit)
+  // note: lookups of keys that are present read the filter as well, which is
+  // slower when most lookups succeed
+  // note: other policy members are taken from BasePolicy
+  template<
+    int32_t BitsPerKey = 16, typename BasePolicy = packed_hashtable_policy_t>
+  struct key_filter_policy_t : BasePolicy
+  {
+    template<typename Key, typename Hash, typename Allocator>
+    using key_filter_t =
+      blocked_bloom_filter_t<Key, Hash, Allocator, BitsPerKey>;
+  };
+
+  // order of the values after deferred removals are compacted (see
+  // base_packed_hashtable_t::compact_removals)
+  enum class compaction_order_e
+  {
+    // the last value is moved into each hole (fewest moves)
+    swap,
+    // values keep their relative order (e.g. insertion order)
+    preserve
+  };
+
+  // policy with a capacity fixed at compile time, the values, handle slots and
+  // key index are stored inline (see static_storage_t and static_hash_map_t)
+  // so the container never allocates, add fails once Capacity elements are
+  // stored
+  // note: for embedded, real-time or hot paths where allocation is not allowed
+  // (see static_packed_hashtable_t), the container is large (roughly Capacity
+  // values, keys and 40 bytes of bookkeeping per element) so should usually
+  // be a member or static rather than on the stack
+  // note: replaces both the value storage and the key index of BasePolicy,
+  // packed_hashtable_rl_t still allocates its handle to key mapping
+  template<
+    int32_t Capacity, typename BasePolicy = packed_hashtable_policy_t>
+  struct static_policy_t : BasePolicy
+  {
+    template<typename Value, typename Tag, typename Allocator>
+    using value_storage_t = static_storage_t<Value, Tag, Allocator, Capacity>;
+
+    template<
+      typename Key, typename Mapped, typename Hash, typename KeyEqual,
+      typename Allocator>
+    using key_index_t =
+      static_hash_map_t<Key, Mapped, Hash, KeyEqual, Allocator, Capacity>;
+  };
+
+  // number of elements ahead of the current one that values are prefetched
+  // when visiting values by dense index (see
+  // base_packed_hashtable_t::for_each_handle)
+  inline constexpr std::size_t prefetch_distance_v = 8;
+
+  // hints that the memory at address will be read soon
+  // note: does nothing if the compiler has no prefetch builtin
+  inline void prefetch(const void* address)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+  }
+
+  // types of the policy members of a packed hashtable (see
+  // packed_hashtable_policy_t)
+  template<
+    typename Key, typename Value, typename Hash, typename Tag,
+    typename Allocator, typename Policy>
+  struct packed_hashtable_policy_types_t
+  {
+    // allocator passed to each policy member (rebound as needed)
+    using allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<std::byte>;
+    using handle_type = typename Policy::template value_storage_t<
+      Value, Tag,
+      typename std::allocator_traits<Allocator>::template rebind_alloc<
+        Value>>::handle_type;
+    using key_filter_type =
+      typename Policy::template key_filter_t<Key, Hash, allocator_type>;
+    using journal_type =
+      typename Policy::template journal_t<Key, Value, Tag, allocator_type>;
+    using access_profiler_type =
+      typename Policy::template access_profiler_t<Tag, allocator_type>;
+    using tombstones_type =
+      typename Policy::template tombstones_t<allocator_type>;
+    using change_tracker_type =
+      typename Policy::template change_tracker_t<allocator_type>;
+    using observer_type =
+      typename Policy::template observer_t<handle_type, allocator_type>;
+  };
+
+  // policy members of a packed hashtable (Types is a
+  // packed_hashtable_policy_types_t), each held through compressed_member_t
+  // so the noop default policies take no space in the container
+  template<typename Types>
+  class packed_hashtable_policies_t
+    : compressed_member_t<typename Types::key_filter_type, 0>,
+      compressed_member_t<typename Types::journal_type, 1>,
+      compressed_member_t<typename Types::access_profiler_type, 2, true>,
+      compressed_member_t<typename Types::tombstones_type, 3>,
+      compressed_member_t<typename Types::change_tracker_type, 4>,
+      compressed_member_t<typename Types::observer_type, 5>
+  {
+    using key_filter_member_t =
+      compressed_member_t<typename Types::key_filter_type, 0>;
+    using journal_member_t =
+      compressed_member_t<typename Types::journal_type, 1>;
+    using profiler_member_t =
+      compressed_member_t<typename Types::access_profiler_type, 2, true>;
+    using tombstones_member_t =
+      compressed_member_t<typename Types::tombstones_type, 3>;
+    using changes_member_t =
+      compressed_member_t<typename Types::change_tracker_type, 4>;
+    using observer_member_t =
+      compressed_member_t<typename Types::observer_type, 5>;
+
+  protected:
+    packed_hashtable_policies_t() = default;
+    explicit packed_hashtable_policies_t(
+      const typename Types::allocator_type& allocator);
+
+    // filter of the keys in the key index (see key_filter_policy_t)
+    auto key_filter_ref() -> typename Types::key_filter_type&;
+    auto key_filter_ref() const -> const typename Types::key_filter_type&;
+    // log of changes (see journaled_policy_t)
+    auto journal_ref() -> typename Types::journal_type&;
+    auto journal_ref() const -> const typename Types::journal_type&;
+    // profile of lookups (see hotness_policy_t), updated by const lookups
+    auto profiler_ref() const -> typename Types::access_profiler_type&;
+    // values removed but not yet compacted (see deferred_removal_policy_t)
+    auto tombstones_ref() -> typename Types::tombstones_type&;
+    auto tombstones_ref() const -> const typename Types::tombstones_type&;
+    // version stamps of changed values (see change_tracking_policy_t)
+    auto changes_ref() -> typename Types::change_tracker_type&;
+    auto changes_ref() const -> const typename Types::change_tracker_type&;
+    // adds and removes waiting for delivery (see observed_policy_t)
+    auto observer_ref() -> typename Types::observer_type&;
+    auto observer_ref() const -> const typename Types::observer_type&;
+  };
+
   // base type for hybrid lookup container for efficient element iteration at
   // the cost of additional memory usage
   // values are stored in a handle_vector_t (elements are tightly packed and are
   // accessible through an indirect handle as well as direct iteration) keys are
   // stored in an unordered_map and its values are the handles to the underlying
   // elements stored in the handle_vector_t
+  // note: Allocator (value type std::pair<const Key, Value>, matching
+  // std::unordered_map) is rebound for the values, handles and keys
+  // note: Policy selects internal data structures (see
+  // packed_hashtable_policy_t)
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy = struct empty_t>
+    typename Tag, typename Allocator, typename Policy,
+    typename RemovalPolicy = struct empty_t>
   class base_packed_hashtable_t
+    : protected packed_hashtable_policies_t<packed_hashtable_policy_types_t<
+        Key, Value, Hash, Tag, Allocator, Policy>>
   {
+    using policy_types_t =
+      packed_hashtable_policy_types_t<Key, Value, Hash, Tag, Allocator, Policy>;
+    using policies_t = packed_hashtable_policies_t<policy_types_t>;
+    using value_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Value>;
+    using index_handle_type = typename Policy::template handle_t<Tag>;
+    using key_allocator_type = typename std::allocator_traits<Allocator>::
+      template rebind_alloc<std::pair<const Key, index_handle_type>>;
+    using journal_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<std::byte>;
+
   protected:
     // store for underlying values
-    handle_vector_t<Value, Tag> values_;
+    // note: empty value types only store handles (see value_storage_t)
+    typename Policy::template value_storage_t<Value, Tag, value_allocator_type>
+      values_;
     // key to handle mapping (key -> handle -> value)
-    std::unordered_map<Key, typed_handle_t<Tag>, Hash, KeyEqual>
+    typename Policy::template key_index_t<
+      Key, index_handle_type, Hash, KeyEqual, key_allocator_type>
       keys_to_handles_;
+    // note: the policy members (key filter, journal, access profiler,
+    // tombstones, change tracker and observer) are held by the
+    // packed_hashtable_policies_t base (see key_filter_ref() etc.)
+    using policies_t::changes_ref;
+    using policies_t::journal_ref;
+    using policies_t::key_filter_ref;
+    using policies_t::observer_ref;
+    using policies_t::profiler_ref;
+    using policies_t::tombstones_ref;
+
+    // returns the number of bytes rehash(0) would release from a hash index
+    // (the excess bucket array)
+    template<typename Index>
+    static std::size_t reclaimable_index_bytes(const Index& index);
+    // returns 0, a fixed capacity index has no memory to release
+    template<
+      typename K, typename M, typename H, typename E, typename A,
+      int32_t Capacity>
+    static std::size_t reclaimable_index_bytes(
+      const static_hash_map_t<K, M, H, E, A, Capacity>& index);
 
   public:
     using key_value_type = std::pair<const Key, Value>;
+    using allocator_type = Allocator;
     using value_iterator = typename decltype(values_)::iterator;
     using const_value_iterator = typename decltype(values_)::const_iterator;
     using handle_iterator = typename decltype(keys_to_handles_)::iterator;
     using const_handle_iterator =
       typename decltype(keys_to_handles_)::const_iterator;
+    using journal_type = typename policy_types_t::journal_type;
+    using access_profiler_type = typename policy_types_t::access_profiler_type;
+    using change_tracker_type = typename policy_types_t::change_tracker_type;
+    using observer_type = typename policy_types_t::observer_type;
+    using key_filter_type = typename policy_types_t::key_filter_type;
+    using tombstones_type = typename policy_types_t::tombstones_type;
+    // if remove defers releasing values until compaction (see
+    // deferred_removal_policy_t)
+    static constexpr bool deferred_removal_v = tombstones_type::enabled_v;
+    // if the container never allocates (see static_policy_t), operations
+    // needing scratch memory use slower allocation free paths instead
+    static constexpr bool fixed_capacity_v =
+      is_static_storage_v<decltype(values_)>;
+    // value iterators stamping each value dereferenced as changed if changes
+    // are tracked (see change_tracking_policy_t)
+    using stamped_value_iterator = std::conditional_t<
+      change_tracker_type::enabled_v,
+      change_stamping_iterator_t<value_iterator, change_tracker_type>,
+      value_iterator>;
+    // iterators of value_iteration(), skip removed values waiting for
+    // compaction if removals are deferred and stamp values as changed if
+    // changes are tracked (value iterators otherwise)
+    using live_value_iterator = std::conditional_t<
+      deferred_removal_v,
+      tombstone_skipping_iterator_t<
+        stamped_value_iterator, tombstones_type>,
+      stamped_value_iterator>;
+    using const_live_value_iterator = std::conditional_t<
+      deferred_removal_v,
+      tombstone_skipping_iterator_t<
+        const_value_iterator, tombstones_type>,
+      const_value_iterator>;
+    // handle to an element (typed_handle_t unless the policy changes the
+    // handle slots, see wide_size_policy_t)
+    using handle_type = typename decltype(values_)::handle_type;
+    // type of sizes and indices (int32_t unless the policy changes the handle
+    // slots, see wide_size_policy_t)
+    using size_type = typename decltype(values_)::size_type;
+
+    base_packed_hashtable_t() = default;
+    // constructs an empty container using the allocator provided for all
+    // internal allocations
+    explicit base_packed_hashtable_t(const Allocator& allocator);
 
+    // returns a copy of the allocator used by the container
+    [[nodiscard]] allocator_type get_allocator() const;
     // adds a value to the container (forwarding reference)
     // returns a pair consisting of an iterator to the inserted element (or to
     // the element that prevented the insertion) and a bool indicating whether
     // the insertion took place
     // type P should conform to key_value_type
+    // note: returns hend() and false if the container is full (see
+    // static_policy_t)
     template<typename P>
     std::pair<handle_iterator, bool> add(P&& key_value);
     // adds a value to the container (rvalue reference)
@@ -74,17 +574,23 @@ namespace thh
     // the element that prevented the insertion) and a bool indicating whether
     // the insertion took place
     // note: supports .add({key, value}) syntax
+    // note: returns hend() and false if the container is full (see
+    // static_policy_t)
     std::pair<handle_iterator, bool> add(key_value_type&& key_value);
     // adds a value to the container or updates it if the key already exists
     // returns a pair consisting of an iterator to the inserted or updated
     // element and a bool indicating whether the insertion took place
     // type P should conform to key_value_type
+    // note: returns hend() and false if the container is full (see
+    // static_policy_t)
     template<typename P>
     std::pair<handle_iterator, bool> add_or_update(P&& key_value);
     // adds a value to the container or updates it if the key already exists
     // returns a pair consisting of an iterator to the inserted or updated
     // element and a bool indicating whether the insertion took place
     // note: supports .add({key, value}) syntax
+    // note: returns hend() and false if the container is full (see
+    // static_policy_t)
     std::pair<handle_iterator, bool> add_or_update(key_value_type&& key_value);
     // finds a handle with the specified key
     // returns an iterator to the discovered element or one past the end if the
@@ -97,42 +603,110 @@ namespace thh
     // removes the element with the equivalent key (if one exists)
     // returns an iterator following the last removed element or one past the
     // end if the element was not found (hend())
+    // note: with deferred_removal_policy_t the value is released by
+    // compact_removals
     handle_iterator remove(const Key& key);
     // removes the element at position
     // returns an iterator following the last removed element (position must
     // be valid and dereferenceable)
+    // note: with deferred_removal_policy_t the value is released by
+    // compact_removals
     handle_iterator remove(handle_iterator position);
     // returns if the container has an element with the equivalent key
     [[nodiscard]] bool has(const Key& key) const;
     // returns the handle for a value at a given index
     // note: will return an invalid handle if the index is out of range
-    [[nodiscard]] typed_handle_t<Tag> handle_from_index(int32_t index) const;
+    [[nodiscard]] handle_type handle_from_index(size_type index) const;
     // returns the index (position) of a value for a given handle
-    // note: will return an empty optional if the handle is invalid
-    [[nodiscard]] std::optional<int32_t> index_from_handle(
-      typed_handle_t<Tag> handle) const;
+    // note: will return an empty optional if the handle is invalid (or its
+    // value has been removed and is waiting for compaction)
+    [[nodiscard]] std::optional<size_type> index_from_handle(
+      handle_type handle) const;
     // returns the number of available handles (includes element storage that is
     // reserved but not yet in use)
     // the capacity refers to the values underlying storage, not the key-handle
     // pairs
-    [[nodiscard]] int32_t capacity() const;
+    [[nodiscard]] size_type capacity() const;
     // removes all elements from the container
     // note: will invalidate all handles
-    // note: capacity remains unchanged, internal handles are not cleared
+    // note: capacity remains unchanged, internal handles are not cleared (see
+    // shrink_to_fit)
     void clear();
     // reserves underlying memory for the number of elements specified
     // note: will attempt to reserve capacity for the key-handle pairs as well
-    void reserve(int32_t capacity);
+    void reserve(size_type capacity);
+    // releases memory not needed for the elements currently in the container
+    // (values, handle slots and the key index buckets), the key filter is
+    // rebuilt for the keys in the container (see key_filter_policy_t)
+    // note: outstanding handles remain valid, handle slots after the highest
+    // handle id in use are released but earlier free slots are kept
+    // note: value iterators are invalidated
+    void shrink_to_fit();
+    // performs shrink_to_fit in steps, each internal buffer is reallocated in
+    // turn until roughly max_bytes_per_call bytes have been copied (at least
+    // one buffer is reallocated per call)
+    // returns true if no more memory can be released (call repeatedly, e.g.
+    // once per frame, until it returns true)
+    bool compact(std::size_t max_bytes_per_call);
+    // returns if the value at the index has been removed and is waiting for
+    // compaction (always false unless removals are deferred, see
+    // deferred_removal_policy_t)
+    [[nodiscard]] bool tombstoned(size_type index) const;
+    // returns the number of removed values waiting for compaction
+    [[nodiscard]] size_type pending_removals() const;
+    // releases every value removed since the last compaction in one pass over
+    // the values, either moving the last value into each hole or shifting
+    // values down to keep their order (see compaction_order_e)
+    // note: value iterators and indices are invalidated, handles are not
+    // note: does nothing unless removals are deferred
+    void compact_removals(compaction_order_e order = compaction_order_e::swap);
+    // returns the journal of changes made to the container (see
+    // journaled_policy_t)
+    [[nodiscard]] auto journal() -> journal_type&;
+    // returns the journal of changes made to the container (const overload)
+    [[nodiscard]] auto journal() const -> const journal_type&;
+    // returns the observer of adds and removes (see observed_policy_t)
+    [[nodiscard]] auto observer() -> observer_type&;
+    // returns the observer of adds and removes (const overload)
+    [[nodiscard]] auto observer() const -> const observer_type&;
+    // returns the filter of the keys in the container (see
+    // key_filter_policy_t)
+    [[nodiscard]] auto key_filter() const -> const key_filter_type&;
+    // invokes fn with the range [first, last) of add and remove events
+    // recorded since the last delivery (see observed_policy_t), then discards
+    // them, does nothing without an observer or if there are no events
+    template<typename Fn>
+    void deliver_events(Fn&& fn);
+    // records the current value of an element in the journal and stamps it as
+    // changed (for values modified through value iterators), does nothing
+    // without journaling or change tracking
+    void record_update(handle_type handle);
+    // returns the version of the most recent change (see
+    // change_tracking_policy_t), pass it to for_each_changed_since later to
+    // visit the values changed after this point
+    // note: always 0 without change tracking
+    [[nodiscard]] uint64_t version() const;
+    // invokes a callable object on each value added or modified after version
+    // (in dense order), fn is passed the value and its handle
+    // returns the number of values visited
+    // note: requires change_tracking_policy_t
+    // note: removals are never reported, consumers mirroring the container
+    // also need the add and remove events of observed_policy_t
+    template<typename Fn>
+    size_type for_each_changed_since(uint64_t version, Fn&& fn) const;
     // returns the number of elements currently stored in the container
-    [[nodiscard]] int32_t size() const;
+    // note: removed values waiting for compaction are not counted
+    [[nodiscard]] size_type size() const;
     // returns if the container has any elements or not
     [[nodiscard]] bool empty() const;
     // invokes a callable object on an element in the container using a key
+    // note: with journaling the value is recorded as updated (use the const
+    // overloads to read values without recording them)
     template<typename Fn>
     void call(const Key& key, Fn&& fn);
     // invokes a callable object on an element in the container using a handle
     template<typename Fn>
-    void call(typed_handle_t<Tag> handle, Fn&& fn);
+    void call(handle_type handle, Fn&& fn);
     // invokes a callable object on an element in the container using a key
     // (const overload)
     template<typename Fn>
@@ -140,7 +714,7 @@ namespace thh
     // invokes a callable object on an element in the container using a handle
     // (const overload)
     template<typename Fn>
-    void call(typed_handle_t<Tag> handle, Fn&& fn) const;
+    void call(handle_type handle, Fn&& fn) const;
     // invokes a callable object on an element in the container and returns a
     // std::optional containing either the result or an empty optional (as the
     // key may not have been found)
@@ -150,7 +724,7 @@ namespace thh
     // std::optional containing either the result or an empty optional (as the
     // handle may not have been successfully resolved)
     template<typename Fn>
-    decltype(auto) call_return(typed_handle_t<Tag> handle, Fn&& fn);
+    decltype(auto) call_return(handle_type handle, Fn&& fn);
     // invokes a callable object on an element in the container and returns a
     // std::optional containing either the result or an empty optional (as the
     // key may not have been found)
@@ -162,7 +736,28 @@ namespace thh
     // handle may not have been successfully resolved)
     // (const overload)
     template<typename Fn>
-    decltype(auto) call_return(typed_handle_t<Tag> handle, Fn&& fn) const;
+    decltype(auto) call_return(handle_type handle, Fn&& fn) const;
+    // invokes a callable object on the element for each handle in
+    // [first, last), the handles are resolved and sorted by dense index first
+    // so values are visited in memory order (with prefetching) instead of
+    // handle order, fn is passed the value and the position of its handle in
+    // the range (e.g. to find the update for the element)
+    // returns the number of elements visited (invalid handles are skipped)
+    // note: with journaling each value is recorded as updated
+    template<typename HandleIt, typename Fn>
+    size_type for_each_handle(HandleIt first, HandleIt last, Fn&& fn);
+    // invokes a callable object on the element for each handle in
+    // [first, last) in memory order (const overload)
+    template<typename HandleIt, typename Fn>
+    size_type for_each_handle(HandleIt first, HandleIt last, Fn&& fn) const;
+    // copies the value for each handle in [first, last) to out, the value for
+    // the handle at position i in the range is written to out[i] (the caller's
+    // order is kept) while values are read in memory order
+    // returns the number of values copied (out[i] is not written for invalid
+    // handles)
+    // note: OutputIt must be a random access iterator
+    template<typename HandleIt, typename OutputIt>
+    size_type gather(HandleIt first, HandleIt last, OutputIt out) const;
     // returns an iterator to the beginning of the values (contiguous)
     [[nodiscard]] auto vbegin() -> value_iterator;
     // returns a const iterator to the beginning of the values (contiguous)
@@ -194,11 +789,22 @@ namespace thh
     // provided comparison
     // begin - inclusive, end - exclusive
     template<typename Compare>
-    void sort(int32_t begin, int32_t end, Compare&& compare);
+    void sort(size_type begin, size_type end, Compare&& compare);
     // partitions elements in the container according to the provided predicate
     // returns index of the first element for the second group
     template<typename Predicate>
-    int32_t partition(Predicate&& predicate);
+    size_type partition(Predicate&& predicate);
+    // reorders elements in the container so values are in ascending key order
+    // (a radix sort for integral and typed_handle_t keys, otherwise keys are
+    // compared with operator<)
+    // note: with static_policy_t the values are sorted in place (the key of
+    // each element is held on the stack) so no memory is allocated
+    void reorder_by_key();
+    // reorders elements in the container so the values looked up most often
+    // are at the front (in descending order of sampled lookups), then halves
+    // the profile so it follows changes in the access pattern
+    // note: requires hotness_policy_t
+    void reorder_by_hotness();
 
     // proxy to support friendly iteration for handles (see handle_iteration())
     // note: to be used with range based for loop
@@ -238,8 +844,8 @@ namespace thh
 
     public:
       explicit value_iterator_wrapper_t(base_packed_hashtable_t& pht);
-      [[nodiscard]] auto begin() -> value_iterator;
-      [[nodiscard]] auto end() -> value_iterator;
+      [[nodiscard]] auto begin() -> live_value_iterator;
+      [[nodiscard]] auto end() -> live_value_iterator;
     };
 
     // proxy to support friendly iteration for values (see value_iteration())
@@ -252,10 +858,10 @@ namespace thh
     public:
       explicit const_value_iterator_wrapper_t(
         const base_packed_hashtable_t& pht);
-      [[nodiscard]] auto begin() const -> const_value_iterator;
-      [[nodiscard]] auto cbegin() const -> const_value_iterator;
-      [[nodiscard]] auto end() const -> const_value_iterator;
-      [[nodiscard]] auto cend() const -> const_value_iterator;
+      [[nodiscard]] auto begin() const -> const_live_value_iterator;
+      [[nodiscard]] auto cbegin() const -> const_live_value_iterator;
+      [[nodiscard]] auto end() const -> const_live_value_iterator;
+      [[nodiscard]] auto cend() const -> const_live_value_iterator;
     };
 
     // returns a proxy object to the container to provide begin/end iterators
@@ -267,13 +873,38 @@ namespace thh
       -> const_handle_iterator_wrapper_t;
     // returns a proxy object to container to provide begin/end iterators for
     // values (to be used with range based for loop)
+    // note: with deferred_removal_policy_t removed values are skipped and the
+    // current value can be removed while iterating
     [[nodiscard]] auto value_iteration() -> value_iterator_wrapper_t;
     // returns a proxy object to container to provide begin/end iterators for
     // values (to be used with range based for loop) (const overload)
     [[nodiscard]] auto value_iteration() const
       -> const_value_iterator_wrapper_t;
 
+  protected:
+    // returns the number of values stored, including removed values waiting
+    // for compaction (see deferred_removal_policy_t)
+    size_type dense_size() const;
+    // returns if the handle refers to a value waiting for compaction
+    bool tombstoned_handle(handle_type handle) const;
+    // removes the value with the handle from the value storage, or marks it
+    // with a tombstone if removals are deferred (the removal is reported to
+    // the observer)
+    void remove_value(handle_type handle);
+
   private:
+    // dense index of an element paired with the position of its handle in the
+    // range passed to for_each_handle
+    using handle_index_t = std::pair<size_type, std::size_t>;
+    using handle_index_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<handle_index_t>;
+    using handle_indices_t =
+      std::vector<handle_index_t, handle_index_allocator_type>;
+    // dense indices in their new order (see reorder)
+    using order_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<size_type>;
+    using order_t = std::vector<size_type, order_allocator_type>;
+
     // internal implementation of add, used by both public add overloads
     template<typename P>
     std::pair<handle_iterator, bool> add_internal(P&& key_value);
@@ -281,6 +912,38 @@ namespace thh
     // add_or_update overloads
     template<typename P>
     std::pair<handle_iterator, bool> add_or_update_internal(P&& key_value);
+    // searches the key index for the key, unless the key filter rejects it
+    // (see key_filter_policy_t)
+    handle_iterator find_key(const Key& key);
+    // searches the key index for the key (const overload)
+    const_handle_iterator find_key(const Key& key) const;
+    // reports a lookup of the element with the handle specified to the access
+    // profiler (see hotness_policy_t)
+    void profile_access(handle_type handle) const;
+    // reorders all elements so position i holds the element previously at
+    // order[i]
+    void reorder(const order_t& order);
+    // wraps value (the value at the dense index) so values are stamped as
+    // changed when dereferenced if changes are tracked (see
+    // stamped_value_iterator)
+    stamped_value_iterator stamped(value_iterator value, size_type index);
+    // stamps the element with the handle as changed (see
+    // change_tracking_policy_t)
+    void record_change(handle_type handle);
+    // removes the element at the dense index from the value storage (the last
+    // value is moved into its place)
+    void remove_at(size_type index);
+    // resolves the handles in [first, last) to the dense indices of their
+    // elements sorted in memory order (invalid handles are dropped), uses a
+    // counting sort when there are enough handles
+    template<typename HandleIt>
+    handle_indices_t sorted_handle_indices(
+      HandleIt first, HandleIt last) const;
+    // invokes fn on the value at each index in turn, prefetching the value
+    // prefetch_distance_v indices ahead
+    template<typename ValueIt, typename Fn>
+    static void visit_handle_indices(
+      ValueIt values, const handle_indices_t& indices, Fn&& fn);
   };
 
   // packed_hashtable_t - a hybrid lookup container for efficient element
@@ -288,22 +951,54 @@ namespace thh
   template<
     typename Key, typename Value, typename Hash = std::hash<Key>,
     typename KeyEqual = std::equal_to<Key>,
-    typename Tag = packed_hashtable_tag_t>
+    typename Tag = packed_hashtable_tag_t,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>,
+    typename Policy = packed_hashtable_policy_t>
   class packed_hashtable_t
     : public base_packed_hashtable_t<
-        Key, Value, Hash, KeyEqual, Tag,
-        packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>>
+        Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+        packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>>
   {
-    friend class base_packed_hashtable_t<
-      Key, Value, Hash, KeyEqual, Tag,
-      packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>>;
+    using base_t = base_packed_hashtable_t<
+      Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+      packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>>;
+    friend base_t;
 
     // empty noop functions, unused in packed_hashtable_t
-    void add_mapping(typed_handle_t<Tag>, const Key*) {}
-    void remove_mapping(typed_handle_t<Tag>) {}
+    void add_mapping(typename base_t::handle_type, const Key*) {}
+    void remove_mapping(typename base_t::handle_type) {}
     void clear_mappings() {}
+    void shrink_mappings() {}
+    std::size_t reclaimable_mapping_bytes() const { return 0; }
+
+  public:
+    // bring base constructors into scope
+    using base_t::base_t;
   };
 
+  // packed_hashset_t - a packed_hashtable_t storing keys only, no memory is
+  // used for values (the empty value type is detected at compile time)
+  // note: use add({key, {}}) to insert a key
+  template<
+    typename Key, typename Hash = std::hash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Tag = packed_hashtable_tag_t,
+    typename Allocator = std::allocator<std::pair<const Key, empty_value_t>>,
+    typename Policy = packed_hashtable_policy_t>
+  using packed_hashset_t = packed_hashtable_t<
+    Key, empty_value_t, Hash, KeyEqual, Tag, Allocator, Policy>;
+
+  // static_packed_hashtable_t - a packed_hashtable_t with storage for Capacity
+  // elements inside the object, it never allocates (see static_policy_t)
+  // note: add returns hend() (and false) once Capacity elements are stored
+  template<
+    typename Key, typename Value, int32_t Capacity,
+    typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>,
+    typename Tag = packed_hashtable_tag_t>
+  using static_packed_hashtable_t = packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag,
+    std::allocator<std::pair<const Key, Value>>, static_policy_t<Capacity>>;
+
   // hybrid lookup container for efficient element iteration at the cost of
   // additional memory usage
   // packed_hashtable_rl_t - rl signifies 'reverse lookup', this variant of
@@ -313,42 +1008,229 @@ namespace thh
   template<
     typename Key, typename Value, typename Hash = std::hash<Key>,
     typename KeyEqual = std::equal_to<Key>,
-    typename Tag = packed_hashtable_tag_t>
+    typename Tag = packed_hashtable_tag_t,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>,
+    typename Policy = packed_hashtable_policy_t>
   class packed_hashtable_rl_t
     : public base_packed_hashtable_t<
-        Key, Value, Hash, KeyEqual, Tag,
-        packed_hashtable_rl_t<Key, Value, Hash, KeyEqual, Tag>>
+        Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+        packed_hashtable_rl_t<
+          Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>>
   {
-    friend class base_packed_hashtable_t<
-      Key, Value, Hash, KeyEqual, Tag,
-      packed_hashtable_rl_t<Key, Value, Hash, KeyEqual, Tag>>;
+    using base_t = base_packed_hashtable_t<
+      Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+      packed_hashtable_rl_t<
+        Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>>;
+    friend base_t;
+
+  public:
+    using typename base_t::handle_type;
+    using typename base_t::size_type;
+
+  private:
+    using key_ptr_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<const Key*>;
 
-    // key to handle mapping (value -> handle -> key)
-    std::unordered_map<
-      typed_handle_t<Tag>, const Key*, typed_handle_hash_t<Tag>>
-      handles_to_keys_;
+    // handle to key mapping (value -> handle -> key), indexed by handle id so
+    // no hashing is required (entries for free handles are stale)
+    std::vector<const Key*, key_ptr_allocator_type> keys_;
 
     // adds a mapping from a handle to a key
-    void add_mapping(typed_handle_t<Tag> handle, const Key* key);
+    void add_mapping(handle_type handle, const Key* key);
     // removes a mapping from a handle to a key
-    void remove_mapping(typed_handle_t<Tag> handle);
+    void remove_mapping(handle_type handle);
     // clears all handle to key mappings from the container
     void clear_mappings();
+    // releases mappings for handle ids no longer in the value storage
+    void shrink_mappings();
+    // returns the number of bytes shrink_mappings would release
+    std::size_t reclaimable_mapping_bytes() const;
+    // points the mappings at the keys of the key index (after the key index
+    // was copied, or moved to new storage e.g. by an unequal allocator)
+    void rebind_mappings();
 
   public:
+    // element of dense iteration (see dense_iteration()), references to the
+    // key and value and the handle of an element
+    // note: supports structured bindings
+    // e.g. for (auto [key, handle, value] : pht_rl.dense_iteration())
+    template<bool Const>
+    struct dense_element_t
+    {
+      const Key& key_;
+      handle_type handle_;
+      std::conditional_t<Const, const Value&, Value&> value_;
+    };
+
+    // forward iterator for key/value iteration (see kv_iteration()), yields a
+    // pair of references to the key and value at each dense position (or a
+    // dense_element_t including the handle when WithHandle is set, see
+    // dense_iteration())
+    template<bool Const, bool WithHandle = false>
+    class key_value_iterator_t
+    {
+      using table_t = std::conditional_t<
+        Const, const packed_hashtable_rl_t, packed_hashtable_rl_t>;
+      using value_iterator_t = std::conditional_t<
+        Const, typename base_t::const_value_iterator,
+        typename base_t::value_iterator>;
+
+      table_t* table_ = nullptr;
+      value_iterator_t value_;
+      size_type index_ = 0;
+
+      // advances past removed values waiting for compaction (see
+      // deferred_removal_policy_t)
+      void skip()
+      {
+        if constexpr (base_t::deferred_removal_v) {
+          while (index_ < table_->dense_size() && table_->tombstoned(index_)) {
+            ++value_;
+            ++index_;
+          }
+        }
+      }
+
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = std::conditional_t<
+        WithHandle, dense_element_t<Const>,
+        std::pair<
+          const Key&, std::conditional_t<Const, const Value&, Value&>>>;
+      using difference_type = std::ptrdiff_t;
+      using pointer = void;
+      using reference = value_type;
+
+      key_value_iterator_t() = default;
+      key_value_iterator_t(
+        table_t* table, value_iterator_t value, const size_type index)
+        : table_(table), value_(value), index_(index)
+      {
+        skip();
+      }
+
+      [[nodiscard]] reference operator*() const
+      {
+        // values dereferenced through mutable iteration are stamped (see
+        // change_tracking_policy_t)
+        if constexpr (!Const && base_t::change_tracker_type::enabled_v) {
+          table_->changes_ref().record_change(
+            static_cast<std::size_t>(index_));
+        }
+        const auto handle = table_->handle_from_index(index_);
+        const Key& key = *table_->keys_[static_cast<std::size_t>(handle.id_)];
+        if constexpr (WithHandle) {
+          return {key, handle, *value_};
+        } else {
+          return {key, *value_};
+        }
+      }
+
+      key_value_iterator_t& operator++()
+      {
+        ++value_;
+        ++index_;
+        skip();
+        return *this;
+      }
+      key_value_iterator_t operator++(int)
+      {
+        auto it = *this;
+        ++*this;
+        return it;
+      }
+
+      [[nodiscard]] bool operator==(const key_value_iterator_t& rhs) const
+      {
+        return index_ == rhs.index_;
+      }
+      [[nodiscard]] bool operator!=(const key_value_iterator_t& rhs) const
+      {
+        return index_ != rhs.index_;
+      }
+    };
+
+    // proxy to support friendly iteration for keys and values (see
+    // kv_iteration() and dense_iteration())
+    // note: to be used with range based for loop
+    // e.g. for (auto [key, value] : packed_hashtable_rl.kv_iteration())
+    template<bool Const, bool WithHandle = false>
+    class key_value_iterator_wrapper_t
+    {
+      using table_t = std::conditional_t<
+        Const, const packed_hashtable_rl_t, packed_hashtable_rl_t>;
+      using iterator_t = key_value_iterator_t<Const, WithHandle>;
+
+      table_t* pht_ = nullptr;
+
+    public:
+      explicit key_value_iterator_wrapper_t(table_t& pht) : pht_(&pht) {}
+      [[nodiscard]] auto begin() const -> iterator_t
+      {
+        return {pht_, pht_->vbegin(), 0};
+      }
+      [[nodiscard]] auto end() const -> iterator_t
+      {
+        return {pht_, pht_->vend(), pht_->dense_size()};
+      }
+    };
+
+    packed_hashtable_rl_t() = default;
+    // constructs an empty container using the allocator provided for all
+    // internal allocations
+    explicit packed_hashtable_rl_t(const Allocator& allocator);
+    // note: the mappings point into the key index so are rebound to the keys
+    // of the new container (see rebind_mappings)
+    packed_hashtable_rl_t(const packed_hashtable_rl_t& other);
+    packed_hashtable_rl_t(packed_hashtable_rl_t&& other) noexcept(
+      std::is_nothrow_move_constructible_v<base_t>);
+    packed_hashtable_rl_t& operator=(const packed_hashtable_rl_t& other);
+    packed_hashtable_rl_t& operator=(packed_hashtable_rl_t&& other) noexcept(
+      std::is_nothrow_move_assignable_v<base_t>
+      && std::is_nothrow_move_assignable_v<decltype(keys_)>);
+
     // bring base remove function into scope
-    using base_packed_hashtable_t<
-      Key, Value, Hash, KeyEqual, Tag,
-      packed_hashtable_rl_t<Key, Value, Hash, KeyEqual, Tag>>::remove;
+    using base_t::remove;
 
     // removes the element with equivalent handle
-    bool remove(typed_handle_t<Tag> handle);
+    bool remove(handle_type handle);
     // returns the key for a given handle
     // note: will return an empty optional if the handle is invalid
-    std::optional<Key> key_from_handle(typed_handle_t<Tag> handle) const;
+    // note: returns a copy of the key (see key_ptr_from_handle)
+    std::optional<Key> key_from_handle(handle_type handle) const;
     // returns the key for a given index
     // note: will return an empty optional if the index is out of range
-    std::optional<Key> key_from_index(int32_t index) const;
+    // note: returns a copy of the key (see key_ptr_from_index)
+    std::optional<Key> key_from_index(size_type index) const;
+    // returns a pointer to the key for a given handle (no copy is made)
+    // note: will return nullptr if the handle is invalid
+    // note: the pointer is valid until the element is removed
+    [[nodiscard]] const Key* key_ptr_from_handle(handle_type handle) const;
+    // returns a pointer to the key for a given index (no copy is made)
+    // note: will return nullptr if the index is out of range (or the value is
+    // waiting for compaction, see deferred_removal_policy_t)
+    // note: the pointer is valid until the element is removed
+    [[nodiscard]] const Key* key_ptr_from_index(size_type index) const;
+    // returns a proxy object to the container to provide begin/end iterators
+    // for keys and values in dense value order, each element is a pair of
+    // references (to be used with range based for loop)
+    // note: no hashing is required and keys are not copied
+    [[nodiscard]] auto kv_iteration() -> key_value_iterator_wrapper_t<false>;
+    // returns a proxy object to the container to provide begin/end iterators
+    // for keys and values in dense value order (const overload)
+    [[nodiscard]] auto kv_iteration() const
+      -> key_value_iterator_wrapper_t<true>;
+    // returns a proxy object to the container to provide begin/end iterators
+    // for keys, handles and values in dense value order, each element is a
+    // dense_element_t (to be used with range based for loop)
+    // note: unlike handle_iteration() (key index order) values are visited in
+    // memory order
+    [[nodiscard]] auto dense_iteration()
+      -> key_value_iterator_wrapper_t<false, true>;
+    // returns a proxy object to the container to provide begin/end iterators
+    // for keys, handles and values in dense value order (const overload)
+    [[nodiscard]] auto dense_iteration() const
+      -> key_value_iterator_wrapper_t<true, true>;
   };
 
   // removes all elements that pass the given predicate from the container
@@ -356,20 +1238,63 @@ namespace thh
   // from values to keys so performance is improved
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename Pred>
-  int32_t remove_when(
-    packed_hashtable_rl_t<Key, Value, Hash, KeyEqual, Tag>& packed_hashtable_rl,
-    Pred pred);
+    typename Tag, typename Allocator, typename Policy, typename Pred>
+  auto remove_when(
+    packed_hashtable_rl_t<Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>&
+      packed_hashtable_rl,
+    Pred pred) -> typename packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::size_type;
 
   // removes all elements that pass the given predicate from the container
   // note: using packed_hashtable_t must iterate via handles to remove elements
-  // which is much slower than using packed_hashtable_rl_t
+  // which is slower than using packed_hashtable_rl_t (the predicate is
+  // evaluated in dense order first so the walk over the key index only reads
+  // the handles, not the values)
+  // note: with static_policy_t the predicate is evaluated while walking the
+  // key index instead (marking the handles would need an allocation)
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename Pred>
-  int32_t remove_when(
-    packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>& packed_hashtable,
-    Pred pred);
+    typename Tag, typename Allocator, typename Policy, typename Pred>
+  auto remove_when(
+    packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>&
+      packed_hashtable,
+    Pred pred) -> typename packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::size_type;
+
+#if __has_include(<memory_resource>)
+  // aliases for packed hashtables using std::pmr::polymorphic_allocator
+  // e.g. to allocate from a std::pmr::monotonic_buffer_resource (arena)
+  namespace pmr
+  {
+    template<
+      typename Key, typename Value, typename Hash = std::hash<Key>,
+      typename KeyEqual = std::equal_to<Key>,
+      typename Tag = packed_hashtable_tag_t,
+      typename Policy = packed_hashtable_policy_t>
+    using packed_hashtable_t = thh::packed_hashtable_t<
+      Key, Value, Hash, KeyEqual, Tag,
+      std::pmr::polymorphic_allocator<std::pair<const Key, Value>>, Policy>;
+
+    template<
+      typename Key, typename Value, typename Hash = std::hash<Key>,
+      typename KeyEqual = std::equal_to<Key>,
+      typename Tag = packed_hashtable_tag_t,
+      typename Policy = packed_hashtable_policy_t>
+    using packed_hashtable_rl_t = thh::packed_hashtable_rl_t<
+      Key, Value, Hash, KeyEqual, Tag,
+      std::pmr::polymorphic_allocator<std::pair<const Key, Value>>, Policy>;
+
+    template<
+      typename Key, typename Hash = std::hash<Key>,
+      typename KeyEqual = std::equal_to<Key>,
+      typename Tag = packed_hashtable_tag_t,
+      typename Policy = packed_hashtable_policy_t>
+    using packed_hashset_t = thh::packed_hashset_t<
+      Key, Hash, KeyEqual, Tag,
+      std::pmr::polymorphic_allocator<std::pair<const Key, empty_value_t>>,
+      Policy>;
+  } // namespace pmr
+#endif
 } // namespace thh
 
 #include "packed-hashtable.inl"
@@ -1,63 +1,416 @@
 namespace thh
 {
+  template<typename Types>
+  packed_hashtable_policies_t<Types>::packed_hashtable_policies_t(
+    const typename Types::allocator_type& allocator)
+    : key_filter_member_t(allocator),
+      journal_member_t(allocator),
+      profiler_member_t(allocator),
+      tombstones_member_t(allocator),
+      changes_member_t(allocator),
+      observer_member_t(allocator)
+  {
+  }
+
+  template<typename Types>
+  auto packed_hashtable_policies_t<Types>::key_filter_ref()
+    -> typename Types::key_filter_type&
+  {
+    return key_filter_member_t::get();
+  }
+
+  template<typename Types>
+  auto packed_hashtable_policies_t<Types>::key_filter_ref() const
+    -> const typename Types::key_filter_type&
+  {
+    return key_filter_member_t::get();
+  }
+
+  template<typename Types>
+  auto packed_hashtable_policies_t<Types>::journal_ref()
+    -> typename Types::journal_type&
+  {
+    return journal_member_t::get();
+  }
+
+  template<typename Types>
+  auto packed_hashtable_policies_t<Types>::journal_ref() const
+    -> const typename Types::journal_type&
+  {
+    return journal_member_t::get();
+  }
+
+  template<typename Types>
+  auto packed_hashtable_policies_t<Types>::profiler_ref() const
+    -> typename Types::access_profiler_type&
+  {
+    return profiler_member_t::get();
+  }
+
+  template<typename Types>
+  auto packed_hashtable_policies_t<Types>::tombstones_ref()
+    -> typename Types::tombstones_type&
+  {
+    return tombstones_member_t::get();
+  }
+
+  template<typename Types>
+  auto packed_hashtable_policies_t<Types>::tombstones_ref() const
+    -> const typename Types::tombstones_type&
+  {
+    return tombstones_member_t::get();
+  }
+
+  template<typename Types>
+  auto packed_hashtable_policies_t<Types>::changes_ref()
+    -> typename Types::change_tracker_type&
+  {
+    return changes_member_t::get();
+  }
+
+  template<typename Types>
+  auto packed_hashtable_policies_t<Types>::changes_ref() const
+    -> const typename Types::change_tracker_type&
+  {
+    return changes_member_t::get();
+  }
+
+  template<typename Types>
+  auto packed_hashtable_policies_t<Types>::observer_ref()
+    -> typename Types::observer_type&
+  {
+    return observer_member_t::get();
+  }
+
+  template<typename Types>
+  auto packed_hashtable_policies_t<Types>::observer_ref() const
+    -> const typename Types::observer_type&
+  {
+    return observer_member_t::get();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::base_packed_hashtable_t(const Allocator& allocator)
+    : policies_t(journal_allocator_type(allocator)),
+      values_(value_allocator_type(allocator)),
+      keys_to_handles_(key_allocator_type(allocator))
+  {
+  }
+
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  typename base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::allocator_type
+  base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::get_allocator()
+    const
+  {
+    return allocator_type(keys_to_handles_.get_allocator());
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   template<typename P>
   std::pair<
     typename base_packed_hashtable_t<
-      Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::handle_iterator,
+      Key, Value, Hash, KeyEqual, Tag, Allocator,
+      Policy, RemovalPolicy>::handle_iterator,
     bool>
   base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::add_internal(P&& key_value)
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::add_internal(P&& key_value)
   {
-    if (auto lookup = keys_to_handles_.find(key_value.first);
+    if (auto lookup = find_key(key_value.first);
         lookup != keys_to_handles_.end()) {
       return {lookup, false};
     }
+    if (keys_to_handles_.size() >= keys_to_handles_.max_size()) {
+      return {keys_to_handles_.end(), false};
+    }
     const auto handle = values_.add(std::forward<Value>(key_value.second));
     const auto inserted = keys_to_handles_.insert(
       {std::forward<const Key>(key_value.first), handle});
     static_cast<RemovalPolicy&>(*this).add_mapping(
       handle, &inserted.first->first);
+    key_filter_ref().insert(inserted.first->first, keys_to_handles_);
+    observer_ref().record_add(handle);
+    journal_ref().record_add(handle, inserted.first->first, values_);
+    profiler_ref().record_add(static_cast<std::size_t>(handle.id_));
+    changes_ref().record_change(static_cast<std::size_t>(values_.size() - 1));
     return inserted;
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   template<typename P>
   std::pair<
     typename base_packed_hashtable_t<
-      Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::handle_iterator,
+      Key, Value, Hash, KeyEqual, Tag, Allocator,
+      Policy, RemovalPolicy>::handle_iterator,
     bool>
-  base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
+  base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
     add_or_update_internal(P&& key_value)
   {
-    if (auto lookup = keys_to_handles_.find(key_value.first);
+    if (auto lookup = find_key(key_value.first);
         lookup != keys_to_handles_.end()) {
       values_.call(lookup->second, [&key_value](Value& value) {
         value = std::forward<Value>(key_value.second);
       });
+      journal_ref().record_update(lookup->second, values_);
+      record_change(lookup->second);
       return {lookup, false};
     }
+    if (keys_to_handles_.size() >= keys_to_handles_.max_size()) {
+      return {keys_to_handles_.end(), false};
+    }
     const auto handle = values_.add(std::forward<Value>(key_value.second));
     const auto inserted = keys_to_handles_.insert(
       {std::forward<const Key>(key_value.first), handle});
     static_cast<RemovalPolicy&>(*this).add_mapping(
       handle, &inserted.first->first);
+    key_filter_ref().insert(inserted.first->first, keys_to_handles_);
+    observer_ref().record_add(handle);
+    journal_ref().record_add(handle, inserted.first->first, values_);
+    profiler_ref().record_add(static_cast<std::size_t>(handle.id_));
+    changes_ref().record_change(static_cast<std::size_t>(values_.size() - 1));
     return inserted;
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::dense_size() const -> size_type
+  {
+    return values_.size();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  bool base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::tombstoned_handle(const handle_type handle) const
+  {
+    if constexpr (deferred_removal_v) {
+      const auto index = values_.index_from_handle(handle);
+      return index && tombstones_ref().test(static_cast<std::size_t>(*index));
+    } else {
+      (void)handle;
+      return false;
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::remove_value(const handle_type handle)
+  {
+    observer_ref().record_remove(handle);
+    if constexpr (deferred_removal_v) {
+      const auto index = values_.index_from_handle(handle);
+      assert(index);
+      tombstones_ref().mark(static_cast<std::size_t>(*index));
+      changes_ref().record_discard(static_cast<std::size_t>(*index));
+    } else if constexpr (change_tracker_type::enabled_v) {
+      const auto index = values_.index_from_handle(handle);
+      assert(index);
+      remove_at(*index);
+    } else {
+      [[maybe_unused]] const auto removed = values_.remove(handle);
+      assert(removed);
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::stamped(const value_iterator value, const size_type index)
+    -> stamped_value_iterator
+  {
+    if constexpr (change_tracker_type::enabled_v) {
+      return stamped_value_iterator(
+        value, static_cast<std::size_t>(index), changes_ref());
+    } else {
+      (void)index;
+      return value;
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::record_change(const handle_type handle)
+  {
+    if constexpr (change_tracker_type::enabled_v) {
+      if (const auto index = values_.index_from_handle(handle)) {
+        changes_ref().record_change(static_cast<std::size_t>(*index));
+      }
+    } else {
+      (void)handle;
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::remove_at(const size_type index)
+  {
+    values_.remove(values_.handle_from_index(index));
+    changes_ref().record_swap_remove(static_cast<std::size_t>(index));
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::profile_access(const handle_type handle) const
+  {
+    if constexpr (access_profiler_type::enabled_v) {
+      // invalid handles may hold any id, only count ids of existing slots
+      if (handle.id_ >= 0 && handle.id_ < values_.capacity()) {
+        profiler_ref().record_access(static_cast<std::size_t>(handle.id_));
+      }
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::find_key(const Key& key) -> handle_iterator
+  {
+    if (!key_filter_ref().may_contain(key)) {
+      return keys_to_handles_.end();
+    }
+    return keys_to_handles_.find(key);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::find_key(const Key& key) const -> const_handle_iterator
+  {
+    if (!key_filter_ref().may_contain(key)) {
+      return keys_to_handles_.end();
+    }
+    return keys_to_handles_.find(key);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::reorder(const order_t& order)
+  {
+    assert(tombstones_ref().count() == 0);
+    values_.reorder(0, order);
+    changes_ref().record_reorder(size_type(0), order);
+    journal_ref().record_reorder(size_type(0), size());
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  template<typename HandleIt>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::sorted_handle_indices(HandleIt first, HandleIt last) const
+    -> handle_indices_t
+  {
+    auto indices =
+      handle_indices_t(handle_index_allocator_type(get_allocator()));
+    if constexpr (std::is_base_of_v<
+                    std::forward_iterator_tag,
+                    typename std::iterator_traits<
+                      HandleIt>::iterator_category>) {
+      indices.reserve(static_cast<std::size_t>(std::distance(first, last)));
+    }
+    std::size_t position = 0;
+    for (; first != last; ++first, ++position) {
+      if (const auto index = values_.index_from_handle(*first);
+          index && !tombstones_ref().test(static_cast<std::size_t>(*index))) {
+        indices.push_back({*index, position});
+      }
+    }
+    // a counting sort is linear in the size of the container so is used when
+    // the handles cover enough of it, otherwise a comparison sort is cheaper
+    // (both order repeated handles by position)
+    const auto count = indices.size();
+    const auto range = static_cast<std::size_t>(dense_size());
+    if (count * 16 < range) {
+      std::sort(indices.begin(), indices.end());
+      return indices;
+    }
+    using offset_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<std::size_t>;
+    auto offsets = std::vector<std::size_t, offset_allocator_type>(
+      range + 1, 0, offset_allocator_type(get_allocator()));
+    for (const auto& index : indices) {
+      ++offsets[static_cast<std::size_t>(index.first) + 1];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    auto sorted = handle_indices_t(
+      count, handle_index_t{}, handle_index_allocator_type(get_allocator()));
+    for (const auto& index : indices) {
+      sorted[offsets[static_cast<std::size_t>(index.first)]++] = index;
+    }
+    return sorted;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  template<typename ValueIt, typename Fn>
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
+    visit_handle_indices(
+      ValueIt values, const handle_indices_t& indices, Fn&& fn)
+  {
+    const auto count = indices.size();
+    for (std::size_t i = 0; i < count; ++i) {
+      if (i + prefetch_distance_v < count) {
+        prefetch(&values[indices[i + prefetch_distance_v].first]);
+      }
+      fn(values[indices[i].first], indices[i].second);
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   template<typename P>
   std::pair<
     typename base_packed_hashtable_t<
-      Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::handle_iterator,
+      Key, Value, Hash, KeyEqual, Tag, Allocator,
+      Policy, RemovalPolicy>::handle_iterator,
     bool>
-  base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::add(
+  base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::add(
     P&& key_value)
   {
     return add_internal(std::forward<P>(key_value));
@@ -65,12 +418,14 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   std::pair<
     typename base_packed_hashtable_t<
-      Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::handle_iterator,
+      Key, Value, Hash, KeyEqual, Tag, Allocator,
+      Policy, RemovalPolicy>::handle_iterator,
     bool>
-  base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::add(
+  base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::add(
     key_value_type&& key_value)
   {
     return add_internal(std::move(key_value));
@@ -78,13 +433,15 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   template<typename P>
   std::pair<
     typename base_packed_hashtable_t<
-      Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::handle_iterator,
+      Key, Value, Hash, KeyEqual, Tag, Allocator,
+      Policy, RemovalPolicy>::handle_iterator,
     bool>
-  base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
+  base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
     add_or_update(P&& key_value)
   {
     return add_or_update_internal(std::forward<P>(key_value));
@@ -92,12 +449,14 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   std::pair<
     typename base_packed_hashtable_t<
-      Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::handle_iterator,
+      Key, Value, Hash, KeyEqual, Tag, Allocator,
+      Policy, RemovalPolicy>::handle_iterator,
     bool>
-  base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
+  base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
     add_or_update(key_value_type&& key_value)
   {
     return add_or_update_internal(std::move(key_value));
@@ -105,38 +464,51 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   typename base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::handle_iterator
-  base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::find(
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::handle_iterator
+  base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::find(
     const Key& key)
   {
-    return keys_to_handles_.find(key);
+    const auto lookup = find_key(key);
+    if (lookup != keys_to_handles_.end()) {
+      profile_access(lookup->second);
+    }
+    return lookup;
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   typename base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::const_handle_iterator
-  base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::find(
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::const_handle_iterator
+  base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::find(
     const Key& key) const
   {
-    return keys_to_handles_.find(key);
+    const auto lookup = find_key(key);
+    if (lookup != keys_to_handles_.end()) {
+      profile_access(lookup->second);
+    }
+    return lookup;
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   typename base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::handle_iterator
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::handle_iterator
   base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::remove(const Key& key)
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::remove(const Key& key)
   {
-    if (auto position = keys_to_handles_.find(key);
-        position != keys_to_handles_.end()) {
-      [[maybe_unused]] const auto removed = values_.remove(position->second);
-      assert(removed);
+    if (auto position = find_key(key); position != keys_to_handles_.end()) {
+      journal_ref().record_remove(position->second, values_);
+      remove_value(position->second);
       static_cast<RemovalPolicy&>(*this).remove_mapping(position->second);
       return keys_to_handles_.erase(position);
     }
@@ -145,72 +517,92 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   typename base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::handle_iterator
-  base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::handle_iterator
+  base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
     remove(handle_iterator position)
   {
-    [[maybe_unused]] const auto removed = values_.remove(position->second);
-    assert(removed);
+    journal_ref().record_remove(position->second, values_);
+    remove_value(position->second);
     static_cast<RemovalPolicy&>(*this).remove_mapping(position->second);
     return keys_to_handles_.erase(position);
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   bool base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::has(const Key& key) const
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::has(const Key& key) const
   {
-    return keys_to_handles_.find(key) != keys_to_handles_.end();
+    return find_key(key) != keys_to_handles_.end();
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  typed_handle_t<Tag> base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag,
-    RemovalPolicy>::handle_from_index(const int32_t index) const
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::handle_from_index(const size_type index) const
+    -> handle_type
   {
     return values_.handle_from_index(index);
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  [[nodiscard]] std::optional<int32_t> base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag,
-    RemovalPolicy>::index_from_handle(typed_handle_t<Tag> handle) const
-  {
-    return values_.index_from_handle(handle);
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::index_from_handle(const handle_type handle) const
+    -> std::optional<size_type>
+  {
+    const auto index = values_.index_from_handle(handle);
+    if constexpr (deferred_removal_v) {
+      // removed values waiting for compaction are no longer valid
+      if (index && tombstones_ref().test(static_cast<std::size_t>(*index))) {
+        return {};
+      }
+    }
+    return index;
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  int32_t base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::capacity() const
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::capacity() const -> size_type
   {
     return values_.capacity();
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   void base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::clear()
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::clear()
   {
     values_.clear();
     keys_to_handles_.clear();
+    key_filter_ref().clear();
     static_cast<RemovalPolicy&>(*this).clear_mappings();
+    journal_ref().record_clear();
+    profiler_ref().record_clear();
+    tombstones_ref().clear();
+    changes_ref().record_clear();
+    observer_ref().record_clear();
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  void base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
-    reserve(const int32_t capacity)
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
+    reserve(const size_type capacity)
   {
     assert(capacity > 0);
     values_.reserve(capacity);
@@ -219,86 +611,265 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::shrink_to_fit()
+  {
+    values_.shrink_to_fit();
+    keys_to_handles_.rehash(0);
+    key_filter_ref().rebuild(keys_to_handles_);
+    static_cast<RemovalPolicy&>(*this).shrink_mappings();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  bool base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::compact(const std::size_t max_bytes_per_call)
+  {
+    auto& derived = static_cast<RemovalPolicy&>(*this);
+    std::size_t bytes = 0;
+    bool reallocated = false;
+    bool complete = true;
+    // reallocates a buffer if it has memory to release and the budget allows
+    // (cost is an estimate of the bytes copied)
+    const auto step = [&](
+                        const std::size_t reclaimable, const std::size_t cost,
+                        const auto& shrink) {
+      if (reclaimable == 0) {
+        return;
+      }
+      if (reallocated && bytes + cost > max_bytes_per_call) {
+        complete = false;
+        return;
+      }
+      shrink();
+      bytes += cost;
+      reallocated = true;
+    };
+    const auto size = static_cast<std::size_t>(values_.size());
+    step(values_.reclaimable_bytes(), size * sizeof(Value), [this] {
+      values_.shrink_to_fit();
+    });
+    step(
+      reclaimable_index_bytes(keys_to_handles_), size * sizeof(void*),
+      [this] { keys_to_handles_.rehash(0); });
+    step(derived.reclaimable_mapping_bytes(), size * sizeof(void*), [&derived] {
+      derived.shrink_mappings();
+    });
+    return complete;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  bool base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::tombstoned(const size_type index) const
+  {
+    return index >= 0 && tombstones_ref().test(static_cast<std::size_t>(index));
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::pending_removals() const -> size_type
+  {
+    return static_cast<size_type>(tombstones_ref().count());
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::compact_removals(const compaction_order_e order)
+  {
+    if constexpr (deferred_removal_v) {
+      const auto removals = static_cast<size_type>(tombstones_ref().count());
+      if (removals == 0) {
+        return;
+      }
+      if (order == compaction_order_e::preserve) {
+        // live values move down in order and the removed values collect at
+        // the end, where they are popped without moving anything else
+        const auto size = dense_size();
+        auto reordered = order_t(order_allocator_type(get_allocator()));
+        reordered.reserve(static_cast<std::size_t>(size));
+        for (size_type index = 0; index < size; ++index) {
+          if (!tombstones_ref().test(static_cast<std::size_t>(index))) {
+            reordered.push_back(index);
+          }
+        }
+        for (size_type index = 0; index < size; ++index) {
+          if (tombstones_ref().test(static_cast<std::size_t>(index))) {
+            reordered.push_back(index);
+          }
+        }
+        values_.reorder(0, reordered);
+        changes_ref().record_reorder(size_type(0), reordered);
+        journal_ref().record_reorder(size_type(0), size - removals);
+        for (size_type index = size; index > size - removals; --index) {
+          remove_at(index - 1);
+        }
+      } else {
+        // visiting the highest index first means the value moved into each
+        // hole is always live
+        tombstones_ref().for_each_reverse([this](const std::size_t index) {
+          remove_at(static_cast<size_type>(index));
+        });
+      }
+      tombstones_ref().clear();
+    } else {
+      (void)order;
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  template<typename Index>
+  std::size_t base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::reclaimable_index_bytes(const Index& index)
+  {
+    // bucket counts are rounded (to a prime or power of two) so only report
+    // memory to release when at least half of the buckets are excess
+    const auto needed =
+      static_cast<std::size_t>(index.size() / index.max_load_factor()) + 1;
+    const auto bucket_count = index.bucket_count();
+    return bucket_count > std::max<std::size_t>(needed * 2, 8)
+           ? (bucket_count - needed) * sizeof(void*)
+           : 0;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  template<
+    typename K, typename M, typename H, typename E, typename A,
+    int32_t Capacity>
+  std::size_t base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
+    reclaimable_index_bytes(
+      [[maybe_unused]] const static_hash_map_t<K, M, H, E, A, Capacity>& index)
+  {
+    return 0;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   template<typename Fn>
-  void base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
     call(const Key& key, Fn&& fn)
   {
-    if (auto lookup = keys_to_handles_.find(key);
-        lookup != keys_to_handles_.end()) {
+    if (auto lookup = find_key(key); lookup != keys_to_handles_.end()) {
+      profile_access(lookup->second);
       values_.call(lookup->second, std::forward<Fn>(fn));
+      journal_ref().record_update(lookup->second, values_);
+      record_change(lookup->second);
     }
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   template<typename Fn>
-  void base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
-    call(const typed_handle_t<Tag> handle, Fn&& fn)
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
+    call(const handle_type handle, Fn&& fn)
   {
+    if (tombstoned_handle(handle)) {
+      return;
+    }
+    profile_access(handle);
     values_.call(handle, std::forward<Fn>(fn));
+    journal_ref().record_update(handle, values_);
+    record_change(handle);
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   template<typename Fn>
-  void base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
     call(const Key& key, Fn&& fn) const
   {
-    if (auto lookup = keys_to_handles_.find(key);
-        lookup != keys_to_handles_.end()) {
+    if (auto lookup = find_key(key); lookup != keys_to_handles_.end()) {
+      profile_access(lookup->second);
       values_.call(lookup->second, std::forward<Fn>(fn));
     }
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   template<typename Fn>
-  void base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
-    call(const typed_handle_t<Tag> handle, Fn&& fn) const
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
+    call(const handle_type handle, Fn&& fn) const
   {
+    if (tombstoned_handle(handle)) {
+      return;
+    }
+    profile_access(handle);
     values_.call(handle, std::forward<Fn>(fn));
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   template<typename Fn>
   decltype(auto) base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag,
-    RemovalPolicy>::call_return(const Key& key, Fn&& fn)
-  {
-    if (auto lookup = keys_to_handles_.find(key);
-        lookup != keys_to_handles_.end()) {
-      return values_.call_return(lookup->second, std::forward<Fn>(fn));
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::call_return(const Key& key, Fn&& fn)
+  {
+    if (auto lookup = find_key(key); lookup != keys_to_handles_.end()) {
+      profile_access(lookup->second);
+      auto result = values_.call_return(lookup->second, std::forward<Fn>(fn));
+      journal_ref().record_update(lookup->second, values_);
+      record_change(lookup->second);
+      return result;
     }
     return std::optional<decltype(fn(*(static_cast<Value*>(nullptr))))>{};
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   template<typename Fn>
   decltype(auto) base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag,
-    RemovalPolicy>::call_return(const typed_handle_t<Tag> handle, Fn&& fn)
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::call_return(
+    const handle_type handle, Fn&& fn)
   {
-    return values_.call_return(handle, std::forward<Fn>(fn));
+    if (tombstoned_handle(handle)) {
+      return decltype(values_.call_return(handle, std::forward<Fn>(fn))){};
+    }
+    profile_access(handle);
+    auto result = values_.call_return(handle, std::forward<Fn>(fn));
+    journal_ref().record_update(handle, values_);
+    record_change(handle);
+    return result;
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   template<typename Fn>
   decltype(auto) base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag,
-    RemovalPolicy>::call_return(const Key& key, Fn&& fn) const
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::call_return(const Key& key, Fn&& fn) const
   {
-    if (auto lookup = keys_to_handles_.find(key);
-        lookup != keys_to_handles_.end()) {
+    if (auto lookup = find_key(key); lookup != keys_to_handles_.end()) {
+      profile_access(lookup->second);
       return values_.call_return(lookup->second, std::forward<Fn>(fn));
     }
     return std::optional<decltype(fn(*(static_cast<Value*>(nullptr))))>{};
@@ -306,50 +877,212 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   template<typename Fn>
   decltype(auto) base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag,
-    RemovalPolicy>::call_return(const typed_handle_t<Tag> handle, Fn&& fn) const
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::call_return(
+    const handle_type handle, Fn&& fn) const
   {
+    if (tombstoned_handle(handle)) {
+      return decltype(values_.call_return(handle, std::forward<Fn>(fn))){};
+    }
+    profile_access(handle);
     return values_.call_return(handle, std::forward<Fn>(fn));
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  int32_t base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::size() const
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  template<typename HandleIt, typename Fn>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::for_each_handle(HandleIt first, HandleIt last, Fn&& fn)
+    -> size_type
+  {
+    const auto indices = sorted_handle_indices(first, last);
+    visit_handle_indices(values_.begin(), indices, fn);
+    for (const auto& index : indices) {
+      journal_ref().record_update(
+        values_.handle_from_index(index.first), values_);
+      changes_ref().record_change(static_cast<std::size_t>(index.first));
+    }
+    return static_cast<size_type>(indices.size());
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  template<typename HandleIt, typename Fn>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
+    for_each_handle(HandleIt first, HandleIt last, Fn&& fn) const -> size_type
+  {
+    const auto indices = sorted_handle_indices(first, last);
+    visit_handle_indices(values_.begin(), indices, fn);
+    return static_cast<size_type>(indices.size());
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  template<typename HandleIt, typename OutputIt>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::gather(HandleIt first, HandleIt last, OutputIt out) const
+    -> size_type
+  {
+    return for_each_handle(
+      first, last, [&out](const Value& value, const std::size_t position) {
+        out[static_cast<std::ptrdiff_t>(position)] = value;
+      });
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::journal() -> journal_type&
+  {
+    return journal_ref();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::journal() const -> const journal_type&
+  {
+    return journal_ref();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::observer() -> observer_type&
+  {
+    return observer_ref();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::observer() const -> const observer_type&
+  {
+    return observer_ref();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::key_filter() const -> const key_filter_type&
+  {
+    return key_filter_ref();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  template<typename Fn>
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::deliver_events(Fn&& fn)
+  {
+    observer_ref().deliver(std::forward<Fn>(fn));
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::record_update(const handle_type handle)
   {
-    assert(keys_to_handles_.size() == static_cast<size_t>(values_.size()));
-    assert(values_.size() <= std::numeric_limits<int32_t>::max());
-    return static_cast<int32_t>(values_.size());
+    journal_ref().record_update(handle, values_);
+    record_change(handle);
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  uint64_t base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::version() const
+  {
+    return changes_ref().version();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  template<typename Fn>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
+    for_each_changed_since(const uint64_t version, Fn&& fn) const -> size_type
+  {
+    static_assert(
+      change_tracker_type::enabled_v,
+      "for_each_changed_since requires a change tracker (see "
+      "change_tracking_policy_t)");
+    size_type visited = 0;
+    const auto values = values_.begin();
+    changes_ref().for_each_changed_since(
+      version, [this, &fn, &values, &visited](const std::size_t index) {
+        const auto position = static_cast<size_type>(index);
+        fn(values[position], values_.handle_from_index(position));
+        ++visited;
+      });
+    return visited;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::size() const -> size_type
+  {
+    const auto size =
+      values_.size() - static_cast<size_type>(tombstones_ref().count());
+    assert(keys_to_handles_.size() == static_cast<size_t>(size));
+    return size;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   bool base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::empty() const
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::empty() const
   {
-    assert(keys_to_handles_.empty() == values_.empty());
-    return values_.empty();
+    assert(keys_to_handles_.empty() == (size() == 0));
+    return size() == 0;
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   auto base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::vbegin() -> value_iterator
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::vbegin() -> value_iterator
   {
     return values_.begin();
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   auto base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::vbegin() const
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::vbegin() const
     -> const_value_iterator
   {
     return values_.begin();
@@ -357,9 +1090,10 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   auto base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::vcbegin() const
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::vcbegin() const
     -> const_value_iterator
   {
     return values_.cbegin();
@@ -367,18 +1101,20 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   auto base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::vend() -> value_iterator
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::vend() -> value_iterator
   {
     return values_.end();
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   auto base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::vend() const
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::vend() const
     -> const_value_iterator
   {
     return values_.end();
@@ -386,9 +1122,10 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   auto base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::vcend() const
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::vcend() const
     -> const_value_iterator
   {
     return values_.cend();
@@ -396,18 +1133,20 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   auto base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::hbegin() -> handle_iterator
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::hbegin() -> handle_iterator
   {
     return keys_to_handles_.begin();
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   auto base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::hbegin() const
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::hbegin() const
     -> const_handle_iterator
   {
     return keys_to_handles_.begin();
@@ -415,9 +1154,10 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   auto base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::hcbegin() const
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::hcbegin() const
     -> const_handle_iterator
   {
     return keys_to_handles_.cbegin();
@@ -425,18 +1165,20 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   auto base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::hend() -> handle_iterator
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::hend() -> handle_iterator
   {
     return keys_to_handles_.end();
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   auto base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::hend() const
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::hend() const
     -> const_handle_iterator
   {
     return keys_to_handles_.end();
@@ -444,9 +1186,10 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   auto base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::hcend() const
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::hcend() const
     -> const_handle_iterator
   {
     return keys_to_handles_.cend();
@@ -454,8 +1197,9 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
     handle_iterator_wrapper_t::handle_iterator_wrapper_t(
       base_packed_hashtable_t& pht)
     : pht_(&pht)
@@ -464,8 +1208,9 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  auto base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
     handle_iterator_wrapper_t::begin() -> handle_iterator
   {
     return pht_->hbegin();
@@ -473,8 +1218,9 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  auto base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
     handle_iterator_wrapper_t::end() -> handle_iterator
   {
     return pht_->hend();
@@ -482,8 +1228,9 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
     const_handle_iterator_wrapper_t::const_handle_iterator_wrapper_t(
       const base_packed_hashtable_t& pht)
     : pht_(&pht)
@@ -492,8 +1239,9 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  auto base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
     const_handle_iterator_wrapper_t::begin() const -> const_handle_iterator
   {
     return pht_->hbegin();
@@ -501,8 +1249,9 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  auto base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
     const_handle_iterator_wrapper_t::cbegin() const -> const_handle_iterator
   {
     return pht_->hcbegin();
@@ -510,8 +1259,9 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  auto base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
     const_handle_iterator_wrapper_t::end() const -> const_handle_iterator
   {
     return pht_->hend();
@@ -519,8 +1269,9 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  auto base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
     const_handle_iterator_wrapper_t::cend() const -> const_handle_iterator
   {
     return pht_->hcend();
@@ -528,8 +1279,9 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
     value_iterator_wrapper_t::value_iterator_wrapper_t(
       base_packed_hashtable_t& pht)
     : pht_(&pht)
@@ -538,26 +1290,41 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  auto base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
-    value_iterator_wrapper_t::begin() -> value_iterator
-  {
-    return pht_->vbegin();
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
+    value_iterator_wrapper_t::begin() -> live_value_iterator
+  {
+    const auto value = pht_->stamped(pht_->vbegin(), 0);
+    if constexpr (deferred_removal_v) {
+      const auto size = static_cast<std::size_t>(pht_->dense_size());
+      return live_value_iterator(value, 0, size, pht_->tombstones_ref());
+    } else {
+      return value;
+    }
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  auto base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
-    value_iterator_wrapper_t::end() -> value_iterator
-  {
-    return pht_->vend();
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
+    value_iterator_wrapper_t::end() -> live_value_iterator
+  {
+    const auto value = pht_->stamped(pht_->vend(), pht_->dense_size());
+    if constexpr (deferred_removal_v) {
+      const auto size = static_cast<std::size_t>(pht_->dense_size());
+      return live_value_iterator(value, size, size, pht_->tombstones_ref());
+    } else {
+      return value;
+    }
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
     const_value_iterator_wrapper_t::const_value_iterator_wrapper_t(
       const base_packed_hashtable_t& pht)
     : pht_(&pht)
@@ -566,45 +1333,74 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  auto base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
-    const_value_iterator_wrapper_t::begin() const -> const_value_iterator
-  {
-    return pht_->vbegin();
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
+    const_value_iterator_wrapper_t::begin() const -> const_live_value_iterator
+  {
+    if constexpr (deferred_removal_v) {
+      const auto size = static_cast<std::size_t>(pht_->dense_size());
+      return const_live_value_iterator(
+        pht_->vbegin(), 0, size, pht_->tombstones_ref());
+    } else {
+      return pht_->vbegin();
+    }
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  auto base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
-    const_value_iterator_wrapper_t::cbegin() const -> const_value_iterator
-  {
-    return pht_->vcbegin();
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
+    const_value_iterator_wrapper_t::cbegin() const -> const_live_value_iterator
+  {
+    if constexpr (deferred_removal_v) {
+      const auto size = static_cast<std::size_t>(pht_->dense_size());
+      return const_live_value_iterator(
+        pht_->vcbegin(), 0, size, pht_->tombstones_ref());
+    } else {
+      return pht_->vcbegin();
+    }
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  auto base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
-    const_value_iterator_wrapper_t::end() const -> const_value_iterator
-  {
-    return pht_->vend();
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
+    const_value_iterator_wrapper_t::end() const -> const_live_value_iterator
+  {
+    if constexpr (deferred_removal_v) {
+      const auto size = static_cast<std::size_t>(pht_->dense_size());
+      return const_live_value_iterator(
+        pht_->vend(), size, size, pht_->tombstones_ref());
+    } else {
+      return pht_->vend();
+    }
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
-  auto base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
-    const_value_iterator_wrapper_t::cend() const -> const_value_iterator
-  {
-    return pht_->vcend();
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
+    const_value_iterator_wrapper_t::cend() const -> const_live_value_iterator
+  {
+    if constexpr (deferred_removal_v) {
+      const auto size = static_cast<std::size_t>(pht_->dense_size());
+      return const_live_value_iterator(
+        pht_->vcend(), size, size, pht_->tombstones_ref());
+    } else {
+      return pht_->vcend();
+    }
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   auto base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::handle_iteration()
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::handle_iteration()
     -> handle_iterator_wrapper_t
   {
     return handle_iterator_wrapper_t(*this);
@@ -612,9 +1408,10 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   auto base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::handle_iteration() const
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::handle_iteration() const
     -> const_handle_iterator_wrapper_t
   {
     return const_handle_iterator_wrapper_t(*this);
@@ -622,9 +1419,10 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   auto base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::value_iteration()
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::value_iteration()
     -> value_iterator_wrapper_t
   {
     return value_iterator_wrapper_t(*this);
@@ -632,9 +1430,10 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   auto base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::value_iteration() const
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::value_iteration() const
     -> const_value_iterator_wrapper_t
   {
     return const_value_iterator_wrapper_t(*this);
@@ -642,137 +1441,508 @@ namespace thh
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   template<typename Compare>
   void base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::sort(Compare&& compare)
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy, RemovalPolicy>::sort(Compare&& compare)
   {
     sort(0, size(), std::forward<Compare>(compare));
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   template<typename Compare>
-  void base_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::
-    sort(const int32_t begin, const int32_t end, Compare&& compare)
-  {
-    values_.sort(begin, end, std::forward<Compare>(compare));
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>::
+    sort(const size_type begin, const size_type end, Compare&& compare)
+  {
+    assert(tombstones_ref().count() == 0);
+    if constexpr (change_tracker_type::enabled_v) {
+      // the stamps are permuted with the values so the order is needed here
+      auto order = order_t(
+        static_cast<std::size_t>(end - begin), size_type(0),
+        order_allocator_type(get_allocator()));
+      std::iota(order.begin(), order.end(), begin);
+      std::sort(order.begin(), order.end(), std::forward<Compare>(compare));
+      values_.reorder(begin, order);
+      changes_ref().record_reorder(begin, order);
+    } else {
+      values_.sort(begin, end, std::forward<Compare>(compare));
+    }
+    journal_ref().record_reorder(begin, end);
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename RemovalPolicy>
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
   template<typename Predicate>
-  int32_t base_packed_hashtable_t<
-    Key, Value, Hash, KeyEqual, Tag, RemovalPolicy>::partition(Predicate&&
-                                                                 predicate)
+  auto base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::partition(Predicate&& predicate) -> size_type
+  {
+    assert(tombstones_ref().count() == 0);
+    if constexpr (change_tracker_type::enabled_v) {
+      // the stamps are permuted with the values so the order is needed here
+      auto order = order_t(
+        static_cast<std::size_t>(size()), size_type(0),
+        order_allocator_type(get_allocator()));
+      std::iota(order.begin(), order.end(), size_type(0));
+      const auto second = std::partition(
+        order.begin(), order.end(), std::forward<Predicate>(predicate));
+      values_.reorder(0, order);
+      changes_ref().record_reorder(size_type(0), order);
+      journal_ref().record_reorder(size_type(0), size());
+      return static_cast<size_type>(std::distance(order.begin(), second));
+    } else {
+      const auto second =
+        values_.partition(std::forward<Predicate>(predicate));
+      journal_ref().record_reorder(size_type(0), size());
+      return second;
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::reorder_by_key()
+  {
+    assert(tombstones_ref().count() == 0);
+    const auto count = static_cast<std::size_t>(size());
+    if constexpr (
+      fixed_capacity_v && is_static_hash_map_v<decltype(keys_to_handles_)>
+      && !change_tracker_type::enabled_v) {
+      // the nodes of the key index are sorted by key in place of the dense
+      // ids of the value storage and then replaced by the handle ids of the
+      // nodes, so no memory is allocated
+      values_.reorder_ids([this](int32_t* const first, int32_t* const last) {
+        auto* id = first;
+        for (auto it = keys_to_handles_.cbegin(); it != keys_to_handles_.cend();
+             ++it) {
+          *id++ = keys_to_handles_.node_id(it);
+        }
+        std::sort(first, last, [this](const int32_t lhs, const int32_t rhs) {
+          const auto& lhs_key = keys_to_handles_.node_value(lhs).first;
+          const auto& rhs_key = keys_to_handles_.node_value(rhs).first;
+          if constexpr (has_radix_key_v<Key>) {
+            return radix_key(lhs_key) < radix_key(rhs_key);
+          } else {
+            return lhs_key < rhs_key;
+          }
+        });
+        std::transform(first, last, first, [this](const int32_t node) {
+          return handle_type(keys_to_handles_.node_value(node).second).id_;
+        });
+      });
+      journal_ref().record_reorder(size_type(0), size());
+    } else if constexpr (has_radix_key_v<Key>) {
+      // key of the element at each dense index (walking the key index once)
+      using radix_key_allocator_type = typename std::allocator_traits<
+        Allocator>::template rebind_alloc<uint64_t>;
+      auto keys = std::vector<uint64_t, radix_key_allocator_type>(
+        count, uint64_t(0), radix_key_allocator_type(get_allocator()));
+      for (const auto& [key, handle] : keys_to_handles_) {
+        keys[static_cast<std::size_t>(*values_.index_from_handle(handle))] =
+          radix_key(key);
+      }
+      reorder(radix_sort_order<size_type>(keys));
+    } else {
+      using key_ptr_allocator_type = typename std::allocator_traits<
+        Allocator>::template rebind_alloc<const Key*>;
+      auto keys = std::vector<const Key*, key_ptr_allocator_type>(
+        count, nullptr, key_ptr_allocator_type(get_allocator()));
+      for (const auto& [key, handle] : keys_to_handles_) {
+        keys[static_cast<std::size_t>(*values_.index_from_handle(handle))] =
+          &key;
+      }
+      auto order =
+        order_t(count, size_type(0), order_allocator_type(get_allocator()));
+      std::iota(order.begin(), order.end(), size_type(0));
+      std::sort(
+        order.begin(), order.end(),
+        [&keys](const size_type lhs, const size_type rhs) {
+          return *keys[static_cast<std::size_t>(lhs)]
+               < *keys[static_cast<std::size_t>(rhs)];
+        });
+      reorder(order);
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  void base_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy,
+    RemovalPolicy>::reorder_by_hotness()
+  {
+    static_assert(
+      access_profiler_type::enabled_v,
+      "reorder_by_hotness requires an access profiler (see hotness_policy_t)");
+    assert(tombstones_ref().count() == 0);
+    // inverting the counts sorts the most accessed first (ties keep their
+    // current order)
+    using radix_key_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<uint64_t>;
+    auto keys = std::vector<uint64_t, radix_key_allocator_type>(
+      static_cast<std::size_t>(size()), uint64_t(0),
+      radix_key_allocator_type(get_allocator()));
+    for (std::size_t index = 0; index < keys.size(); ++index) {
+      const auto handle =
+        values_.handle_from_index(static_cast<size_type>(index));
+      keys[index] = std::numeric_limits<uint32_t>::max()
+                  - profiler_ref().hits(static_cast<std::size_t>(handle.id_));
+    }
+    reorder(radix_sort_order<size_type>(keys));
+    profiler_ref().decay();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  packed_hashtable_rl_t<Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::
+    packed_hashtable_rl_t(const Allocator& allocator)
+    : base_t(allocator), keys_(key_ptr_allocator_type(allocator))
   {
-    return values_.partition(std::forward<Predicate>(predicate));
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag>
-  void packed_hashtable_rl_t<Key, Value, Hash, KeyEqual, Tag>::add_mapping(
-    const typed_handle_t<Tag> handle, const Key* key)
+    typename Tag, typename Allocator, typename Policy>
+  packed_hashtable_rl_t<Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::
+    packed_hashtable_rl_t(const packed_hashtable_rl_t& other)
+    : base_t(other), keys_(other.keys_)
   {
-    handles_to_keys_.insert({handle, key});
+    rebind_mappings();
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag>
-  void packed_hashtable_rl_t<Key, Value, Hash, KeyEqual, Tag>::remove_mapping(
-    const typed_handle_t<Tag> handle)
+    typename Tag, typename Allocator, typename Policy>
+  packed_hashtable_rl_t<Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::
+    packed_hashtable_rl_t(packed_hashtable_rl_t&& other) noexcept(
+      std::is_nothrow_move_constructible_v<base_t>)
+    : base_t(std::move(other)), keys_(std::move(other.keys_))
   {
-    handles_to_keys_.erase(handle);
+    rebind_mappings();
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag>
-  void packed_hashtable_rl_t<Key, Value, Hash, KeyEqual, Tag>::clear_mappings()
+    typename Tag, typename Allocator, typename Policy>
+  auto packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::operator=(const packed_hashtable_rl_t& other)
+    -> packed_hashtable_rl_t&
   {
-    handles_to_keys_.clear();
+    if (this != &other) {
+      base_t::operator=(other);
+      keys_ = other.keys_;
+      rebind_mappings();
+    }
+    return *this;
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag>
-  bool packed_hashtable_rl_t<Key, Value, Hash, KeyEqual, Tag>::remove(
-    const typed_handle_t<Tag> handle)
+    typename Tag, typename Allocator, typename Policy>
+  auto packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::operator=(packed_hashtable_rl_t&& other) noexcept(
+    std::is_nothrow_move_assignable_v<base_t>
+    && std::is_nothrow_move_assignable_v<decltype(keys_)>)
+    -> packed_hashtable_rl_t&
   {
-    if (this->values_.remove(handle)) {
-      if (const auto handle_key = handles_to_keys_.find(handle);
-          handle_key != handles_to_keys_.end()) {
-        const auto key = handle_key->second;
-        handles_to_keys_.erase(handle_key);
-        return this->keys_to_handles_.erase(*key) != 0;
-      }
+    if (this != &other) {
+      base_t::operator=(std::move(other));
+      keys_ = std::move(other.keys_);
+      rebind_mappings();
+    }
+    return *this;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  void packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::add_mapping(const handle_type handle, const Key* key)
+  {
+    const auto id = static_cast<std::size_t>(handle.id_);
+    if (id >= keys_.size()) {
+      // grow with the value storage (so the mapping is resized as rarely)
+      keys_.resize(std::max(
+        id + 1, static_cast<std::size_t>(this->values_.capacity())));
+    }
+    keys_[id] = key;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  void packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::remove_mapping(const handle_type handle)
+  {
+    keys_[static_cast<std::size_t>(handle.id_)] = nullptr;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  void packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::clear_mappings()
+  {
+    std::fill(keys_.begin(), keys_.end(), nullptr);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  void packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::shrink_mappings()
+  {
+    keys_.resize(std::min(
+      keys_.size(), static_cast<std::size_t>(this->values_.capacity())));
+    keys_.shrink_to_fit();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  std::size_t packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::reclaimable_mapping_bytes() const
+  {
+    const auto used = std::min(
+      keys_.size(), static_cast<std::size_t>(this->values_.capacity()));
+    return (keys_.capacity() - used) * sizeof(const Key*);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  void packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::rebind_mappings()
+  {
+    // the key index may hold compact handles (see compact_handle_policy_t)
+    const auto id = [](const handle_type handle) {
+      return static_cast<std::size_t>(handle.id_);
+    };
+    const auto first = this->keys_to_handles_.begin();
+    if (
+      first == this->keys_to_handles_.end()
+      || keys_[id(first->second)] == &first->first) {
+      // the keys were not relocated (e.g. a node based key index was moved)
+      return;
+    }
+    clear_mappings();
+    for (const auto& [key, handle] : this->keys_to_handles_) {
+      keys_[id(handle)] = &key;
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  bool packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::remove(const handle_type handle)
+  {
+    if (this->values_.has(handle) && !this->tombstoned_handle(handle)) {
+      this->journal_ref().record_remove(handle, this->values_);
+      this->remove_value(handle);
+      const auto key = keys_[static_cast<std::size_t>(handle.id_)];
+      keys_[static_cast<std::size_t>(handle.id_)] = nullptr;
+      return this->keys_to_handles_.erase(*key) != 0;
     }
     return false;
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag>
-  std::optional<Key> packed_hashtable_rl_t<Key, Value, Hash, KeyEqual, Tag>::
-    key_from_handle(const typed_handle_t<Tag> handle) const
+    typename Tag, typename Allocator, typename Policy>
+  std::optional<Key> packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::
+    key_from_handle(const handle_type handle) const
   {
-    if (auto key_it = handles_to_keys_.find(handle);
-        key_it != handles_to_keys_.end()) {
-      return *key_it->second;
+    if (const Key* key = key_ptr_from_handle(handle)) {
+      return *key;
     }
     return {};
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag>
+    typename Tag, typename Allocator, typename Policy>
   std::optional<Key> packed_hashtable_rl_t<
-    Key, Value, Hash, KeyEqual, Tag>::key_from_index(const int32_t index) const
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::key_from_index(const size_type index) const
+  {
+    if (const Key* key = key_ptr_from_index(index)) {
+      return *key;
+    }
+    return {};
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  const Key* packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::
+    key_ptr_from_handle(const handle_type handle) const
+  {
+    if (this->values_.has(handle)) {
+      return keys_[static_cast<std::size_t>(handle.id_)];
+    }
+    return nullptr;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  const Key* packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator,
+    Policy>::key_ptr_from_index(const size_type index) const
+  {
+    if (index < 0 || index >= this->dense_size()) {
+      return nullptr;
+    }
+    return keys_[static_cast<std::size_t>(this->handle_from_index(index).id_)];
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  auto packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::kv_iteration()
+    -> key_value_iterator_wrapper_t<false>
+  {
+    return key_value_iterator_wrapper_t<false>(*this);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  auto packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::kv_iteration() const
+    -> key_value_iterator_wrapper_t<true>
+  {
+    return key_value_iterator_wrapper_t<true>(*this);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy>
+  auto packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::dense_iteration()
+    -> key_value_iterator_wrapper_t<false, true>
   {
-    return key_from_handle(this->handle_from_index(index));
+    return key_value_iterator_wrapper_t<false, true>(*this);
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename Pred>
-  int32_t remove_when(
-    packed_hashtable_rl_t<Key, Value, Hash, KeyEqual, Tag>& packed_hashtable_rl,
-    const Pred pred)
+    typename Tag, typename Allocator, typename Policy>
+  auto packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::dense_iteration()
+    const -> key_value_iterator_wrapper_t<true, true>
   {
+    return key_value_iterator_wrapper_t<true, true>(*this);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename Pred>
+  auto remove_when(
+    packed_hashtable_rl_t<Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>&
+      packed_hashtable_rl,
+    const Pred pred) -> typename packed_hashtable_rl_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::size_type
+  {
+    using size_type = typename packed_hashtable_rl_t<
+      Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::size_type;
     const auto old_size = packed_hashtable_rl.size();
     for (auto it = packed_hashtable_rl.vbegin();
          it != packed_hashtable_rl.vend();) {
-      if (pred(*it)) {
-        const auto handle =
-          packed_hashtable_rl.handle_from_index(static_cast<int32_t>(
-            std::distance(packed_hashtable_rl.vbegin(), it)));
-        packed_hashtable_rl.remove(handle);
+      const auto index = static_cast<size_type>(
+        std::distance(packed_hashtable_rl.vbegin(), it));
+      if (!packed_hashtable_rl.tombstoned(index) && pred(*it)) {
+        packed_hashtable_rl.remove(
+          packed_hashtable_rl.handle_from_index(index));
+        // a deferred removal leaves the value in place
+        if constexpr (packed_hashtable_rl_t<
+                        Key, Value, Hash, KeyEqual, Tag, Allocator,
+                        Policy>::deferred_removal_v) {
+          ++it;
+        }
       } else {
         ++it;
       }
     }
-    return static_cast<int32_t>(old_size - packed_hashtable_rl.size());
+    return old_size - packed_hashtable_rl.size();
   }
 
   template<
     typename Key, typename Value, typename Hash, typename KeyEqual,
-    typename Tag, typename Pred>
-  int32_t remove_when(
-    packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>& packed_hashtable,
-    Pred pred)
+    typename Tag, typename Allocator, typename Policy, typename Pred>
+  auto remove_when(
+    packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>&
+      packed_hashtable,
+    Pred pred) -> typename packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>::size_type
   {
+    using packed_hashtable_type =
+      packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag, Allocator, Policy>;
     const auto old_size = packed_hashtable.size();
-    for (auto it = packed_hashtable.hbegin(); it != packed_hashtable.hend();) {
-      if (const auto result = packed_hashtable.call_return(
-            it->second, [&pred](const auto& value) { return pred(value); });
-          result.has_value() && result.value()) {
-        it = packed_hashtable.remove(it);
-      } else {
-        ++it;
+    if constexpr (packed_hashtable_type::fixed_capacity_v) {
+      for (auto it = packed_hashtable.hbegin();
+           it != packed_hashtable.hend();) {
+        if (const auto result = std::as_const(packed_hashtable).call_return(
+              it->second, [&pred](const auto& value) { return pred(value); });
+            result.has_value() && result.value()) {
+          it = packed_hashtable.remove(it);
+        } else {
+          ++it;
+        }
+      }
+    } else {
+      using size_type = typename packed_hashtable_type::size_type;
+      using handle_type = typename packed_hashtable_type::handle_type;
+      using mark_allocator_type =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<bool>;
+      // evaluate the predicate in dense (memory) order, marking the handle ids
+      // to remove, so walking the key index does not touch the values
+      const auto& values = std::as_const(packed_hashtable);
+      auto removals = std::vector<bool, mark_allocator_type>(
+        static_cast<std::size_t>(values.capacity()), false,
+        mark_allocator_type(packed_hashtable.get_allocator()));
+      size_type removal_count = 0;
+      size_type index = 0;
+      for (auto value = values.vbegin(); value != values.vend();
+           ++value, ++index) {
+        if (!values.tombstoned(index) && pred(*value)) {
+          const auto id =
+            static_cast<std::size_t>(values.handle_from_index(index).id_);
+          if (id >= removals.size()) {
+            removals.resize(id + 1);
+          }
+          removals[id] = true;
+          ++removal_count;
+        }
+      }
+      for (auto it = packed_hashtable.hbegin();
+           removal_count > 0 && it != packed_hashtable.hend();) {
+        const handle_type handle = it->second;
+        const auto id = static_cast<std::size_t>(handle.id_);
+        if (id < removals.size() && removals[id]) {
+          it = packed_hashtable.remove(it);
+          --removal_count;
+        } else {
+          ++it;
+        }
       }
     }
     return old_size - packed_hashtable.size();
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <thh-handle-vector/handle-vector.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace thh
+{
+  // detects keys that can be converted to an unsigned value with the same
+  // ordering (see radix_key), integral keys (other than bool) and
+  // typed_handle_t
+  template<typename Key>
+  struct has_radix_key
+    : std::bool_constant<
+        std::is_integral_v<Key> && !std::is_same_v<Key, bool>>
+  {
+  };
+
+  template<typename Tag>
+  struct has_radix_key<typed_handle_t<Tag>> : std::true_type
+  {
+  };
+
+  template<typename Key>
+  inline constexpr bool has_radix_key_v = has_radix_key<Key>::value;
+
+  // returns an unsigned value ordered the same way as an integral key (the
+  // sign bit of signed keys is flipped so negative keys come first)
+  template<typename Key>
+  constexpr uint64_t radix_key(Key key);
+
+  // returns an unsigned value ordered the same way as a handle key (by id then
+  // by generation)
+  template<typename Tag>
+  constexpr uint64_t radix_key(typed_handle_t<Tag> handle);
+
+  // returns the positions [0, keys.size()) stably sorted by key, a least
+  // significant digit radix sort taking 8 bits per pass (digits that are the
+  // same for every key are skipped, e.g. the upper bytes of small ids)
+  // note: memory is allocated with the allocator of keys
+  template<typename Index, typename Allocator>
+  auto radix_sort_order(const std::vector<uint64_t, Allocator>& keys)
+    -> std::vector<
+      Index,
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Index>>;
+} // namespace thh
+
+#include "radix-sort.inl"
@@ -0,0 +1,64 @@
+namespace thh
+{
+  template<typename Key>
+  constexpr uint64_t radix_key(const Key key)
+  {
+    static_assert(std::is_integral_v<Key>, "Key must be an integral type");
+    using unsigned_t = std::make_unsigned_t<Key>;
+    const auto bits = static_cast<uint64_t>(static_cast<unsigned_t>(key));
+    if constexpr (std::is_signed_v<Key>) {
+      constexpr auto sign = uint64_t(1)
+                          << (std::numeric_limits<unsigned_t>::digits - 1);
+      return bits ^ sign;
+    } else {
+      return bits;
+    }
+  }
+
+  template<typename Tag>
+  constexpr uint64_t radix_key(const typed_handle_t<Tag> handle)
+  {
+    return (radix_key(handle.id_) << 32) | uint32_t(radix_key(handle.gen_));
+  }
+
+  template<typename Index, typename Allocator>
+  auto radix_sort_order(const std::vector<uint64_t, Allocator>& keys)
+    -> std::vector<
+      Index,
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Index>>
+  {
+    using index_allocator_type =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Index>;
+    const auto allocator = index_allocator_type(keys.get_allocator());
+    auto order = std::vector<Index, index_allocator_type>(
+      keys.size(), Index(0), allocator);
+    std::iota(order.begin(), order.end(), Index(0));
+
+    // bits that differ between keys, digits with none set are already sorted
+    uint64_t any = 0;
+    uint64_t all = ~uint64_t(0);
+    for (const auto key : keys) {
+      any |= key;
+      all &= key;
+    }
+    const uint64_t varying = any ^ all;
+
+    auto sorted = std::vector<Index, index_allocator_type>(
+      keys.size(), Index(0), allocator);
+    for (int shift = 0; shift < 64; shift += 8) {
+      if (((varying >> shift) & 0xff) == 0) {
+        continue;
+      }
+      std::array<std::size_t, 257> offsets{};
+      for (const auto position : order) {
+        ++offsets[((keys[position] >> shift) & 0xff) + 1];
+      }
+      std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+      for (const auto position : order) {
+        sorted[offsets[(keys[position] >> shift) & 0xff]++] = position;
+      }
+      std::swap(order, sorted);
+    }
+    return order;
+  }
+} // namespace thh
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "value-storage.hpp"
+
+namespace thh
+{
+  // returns the largest power of two less than or equal to value (value > 0)
+  constexpr int32_t floor_pow2(int32_t value)
+  {
+    int32_t pow2 = 1;
+    while (pow2 <= value / 2) {
+      pow2 *= 2;
+    }
+    return pow2;
+  }
+
+  // default number of values per chunk for segmented_storage_t (roughly 64KiB
+  // per chunk rounded down to a power of two, with at least one value)
+  template<typename Value>
+  inline constexpr int32_t default_chunk_size_v =
+    floor_pow2(std::max<int32_t>(1, int32_t(65'536 / sizeof(Value))));
+
+  // random access iterator for segmented_storage_t, the index is split into a
+  // chunk and an offset within that chunk
+  template<typename Value, int32_t ChunkSize>
+  class segmented_iterator_t
+  {
+    template<typename, int32_t>
+    friend class segmented_iterator_t;
+
+    using chunk_t = std::remove_const_t<Value>*;
+
+    const chunk_t* chunks_ = nullptr;
+    std::ptrdiff_t index_ = 0;
+
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::remove_const_t<Value>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Value*;
+    using reference = Value&;
+
+    segmented_iterator_t() = default;
+    segmented_iterator_t(const chunk_t* chunks, std::ptrdiff_t index)
+      : chunks_(chunks), index_(index)
+    {
+    }
+
+    // support conversion from iterator to const_iterator
+    template<
+      typename Other,
+      typename = std::enable_if_t<std::is_same_v<const Other, Value>>>
+    segmented_iterator_t(const segmented_iterator_t<Other, ChunkSize>& other)
+      : chunks_(other.chunks_), index_(other.index_)
+    {
+    }
+
+    [[nodiscard]] reference operator*() const
+    {
+      return chunks_[index_ / ChunkSize][index_ % ChunkSize];
+    }
+    [[nodiscard]] pointer operator->() const { return &**this; }
+    [[nodiscard]] reference operator[](difference_type n) const
+    {
+      return *(*this + n);
+    }
+
+    segmented_iterator_t& operator++()
+    {
+      ++index_;
+      return *this;
+    }
+    segmented_iterator_t operator++(int)
+    {
+      auto it = *this;
+      ++index_;
+      return it;
+    }
+    segmented_iterator_t& operator--()
+    {
+      --index_;
+      return *this;
+    }
+    segmented_iterator_t operator--(int)
+    {
+      auto it = *this;
+      --index_;
+      return it;
+    }
+    segmented_iterator_t& operator+=(difference_type n)
+    {
+      index_ += n;
+      return *this;
+    }
+    segmented_iterator_t& operator-=(difference_type n)
+    {
+      index_ -= n;
+      return *this;
+    }
+    [[nodiscard]] segmented_iterator_t operator+(difference_type n) const
+    {
+      return segmented_iterator_t(chunks_, index_ + n);
+    }
+    [[nodiscard]] segmented_iterator_t operator-(difference_type n) const
+    {
+      return segmented_iterator_t(chunks_, index_ - n);
+    }
+    [[nodiscard]] difference_type operator-(
+      const segmented_iterator_t& rhs) const
+    {
+      return index_ - rhs.index_;
+    }
+
+    [[nodiscard]] bool operator==(const segmented_iterator_t& rhs) const
+    {
+      return index_ == rhs.index_;
+    }
+    [[nodiscard]] bool operator!=(const segmented_iterator_t& rhs) const
+    {
+      return index_ != rhs.index_;
+    }
+    [[nodiscard]] bool operator<(const segmented_iterator_t& rhs) const
+    {
+      return index_ < rhs.index_;
+    }
+    [[nodiscard]] bool operator>(const segmented_iterator_t& rhs) const
+    {
+      return index_ > rhs.index_;
+    }
+    [[nodiscard]] bool operator<=(const segmented_iterator_t& rhs) const
+    {
+      return index_ <= rhs.index_;
+    }
+    [[nodiscard]] bool operator>=(const segmented_iterator_t& rhs) const
+    {
+      return index_ >= rhs.index_;
+    }
+  };
+
+  // value storage for non-empty value types, values are packed in fixed size
+  // chunks (ChunkSize values each) in the same order as the dense slot ids
+  // note: the interface matches handle_vector_t so it can be used in its place
+  // note: growth only appends a new chunk, existing values are never moved (or
+  // copied) when the storage grows so there are no reallocation spikes and
+  // pointers to values remain stable until the value is removed (or the
+  // storage is reordered)
+  // note: the slot arrays (Slots, see value_storage_t) still grow
+  // geometrically (these are small compared to large values)
+  template<
+    typename Value, typename Tag, typename Allocator = std::allocator<Value>,
+    int32_t ChunkSize = default_chunk_size_v<Value>,
+    typename Slots = handle_slots_t<Tag, Allocator>>
+  class segmented_storage_t
+  {
+    static_assert(
+      ChunkSize > 0 && (ChunkSize & (ChunkSize - 1)) == 0,
+      "ChunkSize must be a power of two");
+
+  public:
+    using handle_type = typename Slots::handle_type;
+    using size_type = typename Slots::size_type;
+
+  private:
+    using allocator_traits = typename std::allocator_traits<
+      Allocator>::template rebind_traits<Value>;
+    using value_allocator_type = typename allocator_traits::allocator_type;
+    using chunk_allocator_type =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Value*>;
+
+    Slots slots_;
+    value_allocator_type allocator_;
+    std::vector<Value*, chunk_allocator_type> chunks_;
+
+    // returns the value at the given dense index
+    Value* at(size_type index) const;
+    // allocates chunks until there is room for capacity values
+    void grow(size_type capacity);
+    // frees all chunks (values must already be destroyed)
+    void release();
+    // destroys all values (slots are unchanged)
+    void destroy_values();
+
+  public:
+    using iterator = segmented_iterator_t<Value, ChunkSize>;
+    using const_iterator = segmented_iterator_t<const Value, ChunkSize>;
+
+    segmented_storage_t() = default;
+    explicit segmented_storage_t(const Allocator& allocator);
+    segmented_storage_t(const segmented_storage_t& other);
+    segmented_storage_t(segmented_storage_t&& other) noexcept;
+    // note: allocators are propagated according to std::allocator_traits, if
+    // allocators are not propagated and differ values are copied/relocated
+    segmented_storage_t& operator=(const segmented_storage_t& other);
+    segmented_storage_t& operator=(segmented_storage_t&& other) noexcept(
+      allocator_traits::propagate_on_container_move_assignment::value
+      || allocator_traits::is_always_equal::value);
+    ~segmented_storage_t();
+
+    template<typename... Args>
+    handle_type add(Args&&... args);
+    bool remove(handle_type handle);
+    void clear();
+    void reserve(size_type capacity);
+    // releases chunks (and slots) not needed for the values currently stored
+    void shrink_to_fit();
+    // returns the number of bytes shrink_to_fit would release
+    [[nodiscard]] std::size_t reclaimable_bytes() const;
+    [[nodiscard]] bool has(handle_type handle) const;
+    [[nodiscard]] size_type size() const;
+    [[nodiscard]] size_type capacity() const;
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] handle_type handle_from_index(size_type index) const;
+    [[nodiscard]] std::optional<size_type> index_from_handle(
+      handle_type handle) const;
+    template<typename Fn>
+    void call(handle_type handle, Fn&& fn);
+    template<typename Fn>
+    void call(handle_type handle, Fn&& fn) const;
+    template<typename Fn>
+    decltype(auto) call_return(handle_type handle, Fn&& fn);
+    template<typename Fn>
+    decltype(auto) call_return(handle_type handle, Fn&& fn) const;
+    // sorts the values in the specified range (compare is passed indices)
+    template<typename Compare>
+    void sort(size_type begin, size_type end, Compare&& compare);
+    // partitions the values (predicate is passed an index)
+    // returns index of the first element for the second group
+    template<typename Predicate>
+    size_type partition(Predicate&& predicate);
+    // reorders the values (and slots) so position begin + i holds the value
+    // previously at order[i]
+    template<typename OrderAllocator>
+    void reorder(
+      size_type begin, const std::vector<size_type, OrderAllocator>& order);
+    [[nodiscard]] auto begin() -> iterator;
+    [[nodiscard]] auto begin() const -> const_iterator;
+    [[nodiscard]] auto cbegin() const -> const_iterator;
+    [[nodiscard]] auto end() -> iterator;
+    [[nodiscard]] auto end() const -> const_iterator;
+    [[nodiscard]] auto cend() const -> const_iterator;
+  };
+
+  // segmented storage used for the values of a packed hashtable
+  // empty value types use empty_value_storage_t (no memory is used for the
+  // values themselves), all other types use segmented_storage_t
+  template<
+    typename Value, typename Tag, typename Allocator = std::allocator<Value>,
+    int32_t ChunkSize = default_chunk_size_v<Value>,
+    typename Slots = handle_slots_t<Tag, Allocator>>
+  using segmented_value_storage_t = std::conditional_t<
+    std::is_empty_v<Value>, empty_value_storage_t<Value, Tag, Allocator, Slots>,
+    segmented_storage_t<Value, Tag, Allocator, ChunkSize, Slots>>;
+} // namespace thh
+
+#include "segmented-storage.inl"
@@ -0,0 +1,493 @@
+namespace thh
+{
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  Value* segmented_storage_t<Value, Tag, Allocator, ChunkSize, Slots>::at(
+    const size_type index) const
+  {
+    return chunks_[index / ChunkSize] + index % ChunkSize;
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  void segmented_storage_t<Value, Tag, Allocator, ChunkSize, Slots>::grow(
+    const size_type capacity)
+  {
+    const auto chunk_count = (capacity + ChunkSize - 1) / ChunkSize;
+    if (chunk_count <= static_cast<size_type>(chunks_.size())) {
+      return;
+    }
+    while (static_cast<size_type>(chunks_.size()) < chunk_count) {
+      chunks_.push_back(allocator_traits::allocate(allocator_, ChunkSize));
+    }
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  void segmented_storage_t<Value, Tag, Allocator, ChunkSize, Slots>::release()
+  {
+    for (Value* chunk : chunks_) {
+      allocator_traits::deallocate(allocator_, chunk, ChunkSize);
+    }
+    chunks_.clear();
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  void segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>::destroy_values()
+  {
+    if constexpr (!std::is_trivially_destructible_v<Value>) {
+      const auto size = slots_.size();
+      for (size_type begin = 0; begin < size; begin += ChunkSize) {
+        Value* chunk = chunks_[begin / ChunkSize];
+        std::destroy(chunk, chunk + std::min(ChunkSize, size - begin));
+      }
+    }
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  template<typename OrderAllocator>
+  void segmented_storage_t<Value, Tag, Allocator, ChunkSize, Slots>::reorder(
+    const size_type begin,
+    const std::vector<size_type, OrderAllocator>& order)
+  {
+    const auto count = static_cast<size_type>(order.size());
+    using placed_allocator_type = typename std::allocator_traits<
+      OrderAllocator>::template rebind_alloc<bool>;
+    auto placed = std::vector<bool, placed_allocator_type>(
+      count, false, placed_allocator_type(order.get_allocator()));
+    Value* temp = nullptr;
+    for (size_type start = 0; start < count; ++start) {
+      if (placed[start] || order[start] == begin + start) {
+        continue;
+      }
+      if (temp == nullptr) {
+        temp = allocator_traits::allocate(allocator_, 1);
+      }
+      // lift out the value at the start of the cycle and fill the hole it
+      // leaves by following the cycle until it is closed again
+      relocate_at(temp, at(begin + start));
+      size_type hole = start;
+      while (order[hole] != begin + start) {
+        const auto next = order[hole] - begin;
+        relocate_at(at(begin + hole), at(begin + next));
+        placed[hole] = true;
+        hole = next;
+      }
+      relocate_at(at(begin + hole), temp);
+      placed[hole] = true;
+    }
+    if (temp != nullptr) {
+      allocator_traits::deallocate(allocator_, temp, 1);
+    }
+    slots_.reorder(begin, order);
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>::segmented_storage_t(
+    const Allocator& allocator)
+    : slots_(allocator),
+      allocator_(allocator),
+      chunks_(chunk_allocator_type(allocator))
+  {
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>::segmented_storage_t(
+    const segmented_storage_t& other)
+    : slots_(other.slots_),
+      allocator_(allocator_traits::select_on_container_copy_construction(
+        other.allocator_)),
+      chunks_(chunk_allocator_type(allocator_))
+  {
+    grow(other.size());
+    std::uninitialized_copy(other.begin(), other.end(), begin());
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>::segmented_storage_t(
+    segmented_storage_t&& other) noexcept
+    : slots_(std::move(other.slots_)),
+      allocator_(std::move(other.allocator_)),
+      chunks_(std::move(other.chunks_))
+  {
+    other.chunks_.clear();
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>& segmented_storage_t<
+    Value, Tag, Allocator,
+    ChunkSize, Slots>::operator=(const segmented_storage_t& other)
+  {
+    if (this == &other) {
+      return *this;
+    }
+    destroy_values();
+    slots_.clear();
+    if constexpr (allocator_traits::propagate_on_container_copy_assignment::
+                    value) {
+      if (allocator_ != other.allocator_) {
+        release();
+      }
+      allocator_ = other.allocator_;
+    }
+    grow(other.size());
+    std::uninitialized_copy(other.begin(), other.end(), begin());
+    slots_ = other.slots_;
+    return *this;
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>& segmented_storage_t<
+    Value, Tag, Allocator,
+    ChunkSize, Slots>::operator=(segmented_storage_t&& other) noexcept(
+    allocator_traits::propagate_on_container_move_assignment::value
+    || allocator_traits::is_always_equal::value)
+  {
+    if (this == &other) {
+      return *this;
+    }
+    destroy_values();
+    slots_.clear();
+    constexpr bool propagate =
+      allocator_traits::propagate_on_container_move_assignment::value;
+    if (propagate || allocator_ == other.allocator_) {
+      // take ownership of the other chunks
+      release();
+      if constexpr (propagate) {
+        allocator_ = std::move(other.allocator_);
+      }
+      chunks_ = std::move(other.chunks_);
+      other.chunks_.clear();
+      slots_ = std::move(other.slots_);
+    } else {
+      // memory owned by a different allocator cannot be adopted so values are
+      // relocated to memory from this allocator instead
+      const auto size = other.size();
+      grow(size);
+      for (size_type index = 0; index < size; ++index) {
+        relocate_at(at(index), other.at(index));
+      }
+      slots_ = std::move(other.slots_);
+      other.release();
+    }
+    return *this;
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>::~segmented_storage_t()
+  {
+    destroy_values();
+    release();
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  template<typename... Args>
+  auto segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>::add(Args&&... args) -> handle_type
+  {
+    const auto size = slots_.size();
+    // a full storage only appends a new chunk, existing values are not moved
+    grow(size + 1);
+    ::new (static_cast<void*>(at(size))) Value(std::forward<Args>(args)...);
+    return slots_.add();
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  bool segmented_storage_t<Value, Tag, Allocator, ChunkSize, Slots>::remove(
+    const handle_type handle)
+  {
+    const auto index = slots_.remove(handle);
+    if (!index.has_value()) {
+      return false;
+    }
+    // slots_ has already been updated so the size is the index of the last
+    // value, relocate it into the position of the removed value
+    const auto last = slots_.size();
+    std::destroy_at(at(*index));
+    if (*index != last) {
+      relocate_at(at(*index), at(last));
+    }
+    return true;
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  void segmented_storage_t<Value, Tag, Allocator, ChunkSize, Slots>::clear()
+  {
+    destroy_values();
+    slots_.clear();
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  void segmented_storage_t<Value, Tag, Allocator, ChunkSize, Slots>::reserve(
+    const size_type capacity)
+  {
+    slots_.reserve(capacity);
+    grow(capacity);
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  void segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>::shrink_to_fit()
+  {
+    slots_.shrink_to_fit();
+    const auto chunk_count = (slots_.size() + ChunkSize - 1) / ChunkSize;
+    while (static_cast<size_type>(chunks_.size()) > chunk_count) {
+      allocator_traits::deallocate(allocator_, chunks_.back(), ChunkSize);
+      chunks_.pop_back();
+    }
+    chunks_.shrink_to_fit();
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  std::size_t segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>::reclaimable_bytes() const
+  {
+    const auto chunk_count = (slots_.size() + ChunkSize - 1) / ChunkSize;
+    return slots_.reclaimable_bytes()
+         + (chunks_.size() - chunk_count) * ChunkSize * sizeof(Value)
+         + (chunks_.capacity() - chunk_count) * sizeof(Value*);
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  bool segmented_storage_t<Value, Tag, Allocator, ChunkSize, Slots>::has(
+    const handle_type handle) const
+  {
+    return slots_.has(handle);
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  auto segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>::size() const -> size_type
+  {
+    return slots_.size();
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  auto segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>::capacity() const -> size_type
+  {
+    return slots_.capacity();
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  bool segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>::empty() const
+  {
+    return slots_.size() == 0;
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  auto segmented_storage_t<
+    Value, Tag, Allocator,
+    ChunkSize, Slots>::handle_from_index(const size_type index) const
+    -> handle_type
+  {
+    return slots_.handle_from_index(index);
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  auto segmented_storage_t<
+    Value, Tag, Allocator,
+    ChunkSize, Slots>::index_from_handle(const handle_type handle) const
+    -> std::optional<size_type>
+  {
+    return slots_.index_from_handle(handle);
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  template<typename Fn>
+  void segmented_storage_t<Value, Tag, Allocator, ChunkSize, Slots>::call(
+    const handle_type handle, Fn&& fn)
+  {
+    if (const auto index = slots_.index_from_handle(handle);
+        index.has_value()) {
+      fn(*at(*index));
+    }
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  template<typename Fn>
+  void segmented_storage_t<Value, Tag, Allocator, ChunkSize, Slots>::call(
+    const handle_type handle, Fn&& fn) const
+  {
+    if (const auto index = slots_.index_from_handle(handle);
+        index.has_value()) {
+      fn(std::as_const(*at(*index)));
+    }
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  template<typename Fn>
+  decltype(auto) segmented_storage_t<
+    Value, Tag, Allocator,
+    ChunkSize, Slots>::call_return(const handle_type handle, Fn&& fn)
+  {
+    using result_t = decltype(fn(std::declval<Value&>()));
+    if (const auto index = slots_.index_from_handle(handle);
+        index.has_value()) {
+      return std::optional<result_t>(fn(*at(*index)));
+    }
+    return std::optional<result_t>{};
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  template<typename Fn>
+  decltype(auto) segmented_storage_t<
+    Value, Tag, Allocator,
+    ChunkSize,
+    Slots>::call_return(const handle_type handle, Fn&& fn) const
+  {
+    using result_t = decltype(fn(std::declval<const Value&>()));
+    if (const auto index = slots_.index_from_handle(handle);
+        index.has_value()) {
+      return std::optional<result_t>(fn(std::as_const(*at(*index))));
+    }
+    return std::optional<result_t>{};
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  template<typename Compare>
+  void segmented_storage_t<Value, Tag, Allocator, ChunkSize, Slots>::sort(
+    const size_type begin, const size_type end, Compare&& compare)
+  {
+    auto order = std::vector<size_type, typename Slots::order_allocator_type>(
+      end - begin, size_type(0), slots_.get_allocator());
+    std::iota(order.begin(), order.end(), begin);
+    std::sort(order.begin(), order.end(), std::forward<Compare>(compare));
+    reorder(begin, order);
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  template<typename Predicate>
+  auto segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>::partition(
+    Predicate&& predicate) -> size_type
+  {
+    auto order = std::vector<size_type, typename Slots::order_allocator_type>(
+      slots_.size(), size_type(0), slots_.get_allocator());
+    std::iota(order.begin(), order.end(), 0);
+    const auto second = std::partition(
+      order.begin(), order.end(), std::forward<Predicate>(predicate));
+    reorder(0, order);
+    return static_cast<size_type>(std::distance(order.begin(), second));
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  auto segmented_storage_t<Value, Tag, Allocator, ChunkSize, Slots>::begin()
+    -> iterator
+  {
+    return iterator(chunks_.data(), 0);
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  auto segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>::begin() const
+    -> const_iterator
+  {
+    return const_iterator(chunks_.data(), 0);
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  auto segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>::cbegin() const
+    -> const_iterator
+  {
+    return const_iterator(chunks_.data(), 0);
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  auto segmented_storage_t<Value, Tag, Allocator, ChunkSize, Slots>::end()
+    -> iterator
+  {
+    return iterator(chunks_.data(), slots_.size());
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  auto segmented_storage_t<Value, Tag, Allocator, ChunkSize, Slots>::end() const
+    -> const_iterator
+  {
+    return const_iterator(chunks_.data(), slots_.size());
+  }
+
+  template<
+    typename Value, typename Tag, typename Allocator, int32_t ChunkSize,
+    typename Slots>
+  auto segmented_storage_t<
+    Value, Tag, Allocator, ChunkSize, Slots>::cend() const
+    -> const_iterator
+  {
+    return const_iterator(chunks_.data(), slots_.size());
+  }
+} // namespace thh
@@ -0,0 +1,315 @@
+#pragma once
+
+#if __has_include(<sys/mman.h>)
+
+#include "snapshot.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace thh
+{
+  // current version of the shared memory segment layout
+  inline constexpr uint32_t shared_version_v = 1;
+
+  // pointer stored as an offset from the start of a shared memory segment,
+  // the segment may be mapped at a different address in each process
+  template<typename T>
+  struct shared_offset_t
+  {
+    uint64_t offset_ = 0;
+
+    // returns the address of the object in a segment mapped at base
+    [[nodiscard]] T* get(void* base) const;
+    // returns the address of the object in a segment mapped at base (const
+    // overload)
+    [[nodiscard]] const T* get(const void* base) const;
+  };
+
+  // header at the start of a shared memory segment holding a packed hashtable
+  // (see shared_packed_hashtable_t)
+  // note: sequence_ is odd while the writer is changing the table, readers
+  // retry if it was odd or changed while they were reading (a seqlock)
+  template<typename Key, typename Value, typename Tag>
+  struct shared_header_t
+  {
+    std::array<char, 8> magic_;
+    uint32_t version_;
+    uint32_t key_size_;
+    uint32_t value_size_;
+    uint32_t entry_size_;
+    int32_t capacity_;
+    int32_t index_shift_;
+    int64_t index_capacity_;
+    uint64_t segment_size_;
+    shared_offset_t<Value> values_;
+    shared_offset_t<int32_t> dense_ids_;
+    shared_offset_t<snapshot_slot_t> slots_;
+    shared_offset_t<snapshot_entry_t<Key, Tag>> index_;
+    std::atomic<uint64_t> sequence_;
+    int32_t size_;
+  };
+
+  // fixed capacity packed hashtable stored in a POSIX shared memory segment
+  // (shm_open) so one writer process can share it with many reader processes
+  // (see shared_packed_hashtable_reader_t) instead of each process building
+  // its own copy
+  // the segment holds the values (in dense order), the dense handle ids, the
+  // handle slots and a key index (keys are stored in the index so no section
+  // holds a pointer, sections are found with offsets from the header)
+  // note: every change is made inside a seqlock write section, readers never
+  // block the writer
+  // note: there must be only one writer for a segment, the segment name is
+  // unlinked when the writer is destroyed (readers that have already mapped
+  // it keep a valid mapping)
+  // note: the capacity is fixed when the segment is created (readers map the
+  // whole segment so it cannot grow)
+  // note: Key and Value must be trivially copyable
+  template<
+    typename Key, typename Value, typename Hash = std::hash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Tag = packed_hashtable_tag_t>
+  class shared_packed_hashtable_t
+  {
+    static_assert(
+      std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>,
+      "Shared packed hashtables require trivially copyable keys and values");
+    static_assert(
+      std::atomic<uint64_t>::is_always_lock_free,
+      "Shared packed hashtables require lock free 64 bit atomics");
+
+    using header_t = shared_header_t<Key, Value, Tag>;
+    using entry_t = snapshot_entry_t<Key, Tag>;
+
+    // makes the changes in its scope a single seqlock write section
+    class write_section_t
+    {
+      header_t* header_;
+
+    public:
+      explicit write_section_t(header_t* header);
+      write_section_t(const write_section_t&) = delete;
+      write_section_t& operator=(const write_section_t&) = delete;
+      ~write_section_t();
+    };
+
+    std::string name_;
+    void* mapping_ = nullptr;
+    std::size_t mapping_size_ = 0;
+    header_t* header_ = nullptr;
+    Value* values_ = nullptr;
+    int32_t* dense_ids_ = nullptr;
+    snapshot_slot_t* slots_ = nullptr;
+    entry_t* index_ = nullptr;
+    std::size_t index_mask_ = 0;
+    // position of each handle id in the key index (private to the writer)
+    std::vector<std::size_t> index_positions_;
+    Hash hash_;
+    KeyEqual key_equal_;
+
+    // returns the position of key in the key index (if found)
+    [[nodiscard]] std::optional<std::size_t> find_position(
+      const Key& key) const;
+    // removes the entry at position from the key index (later entries in the
+    // same probe sequence are shifted back)
+    void erase_position(std::size_t position);
+    // removes the element with handle (which must be valid)
+    void remove_handle(typed_handle_t<Tag> handle);
+    // unmaps the segment and unlinks its name (if mapped)
+    void release();
+
+  public:
+    shared_packed_hashtable_t() = default;
+    shared_packed_hashtable_t(const shared_packed_hashtable_t&) = delete;
+    shared_packed_hashtable_t(shared_packed_hashtable_t&& other) noexcept;
+    shared_packed_hashtable_t& operator=(
+      const shared_packed_hashtable_t&) = delete;
+    shared_packed_hashtable_t& operator=(
+      shared_packed_hashtable_t&& other) noexcept;
+    ~shared_packed_hashtable_t();
+
+    // creates a shared memory segment called name (see shm_open) with space
+    // for capacity elements
+    // returns an empty optional if the segment already exists or could not
+    // be created
+    [[nodiscard]] static std::optional<shared_packed_hashtable_t> create(
+      const char* name, int32_t capacity);
+    // removes a shared memory segment left behind by a writer that did not
+    // exit cleanly
+    static void unlink(const char* name);
+
+    // adds a key and value to the table
+    // returns an empty optional if the key already exists or the table is
+    // full
+    std::optional<typed_handle_t<Tag>> add(const Key& key, const Value& value);
+    // adds a key and value to the table, or updates the value if the key
+    // already exists
+    // returns an empty optional if the key was not found and the table is
+    // full
+    std::optional<typed_handle_t<Tag>> add_or_update(
+      const Key& key, const Value& value);
+    // removes the element with the equivalent key
+    // returns if an element was removed or not
+    bool remove(const Key& key);
+    // removes the element referred to by handle
+    // returns if an element was removed or not
+    bool remove(typed_handle_t<Tag> handle);
+    // removes all elements from the table
+    void clear();
+    // finds the handle for the specified key
+    // note: will return an empty optional if the key was not found
+    [[nodiscard]] std::optional<typed_handle_t<Tag>> find(
+      const Key& key) const;
+    // returns if the table has an element with the equivalent key
+    [[nodiscard]] bool has(const Key& key) const;
+    // returns if the handle refers to an element in the table
+    [[nodiscard]] bool has(typed_handle_t<Tag> handle) const;
+    // returns the number of elements in the table
+    [[nodiscard]] int32_t size() const;
+    // returns the maximum number of elements the table can hold
+    [[nodiscard]] int32_t capacity() const;
+    // returns if the table has any elements or not
+    [[nodiscard]] bool empty() const;
+    // invokes a callable object on an element in the table using a handle
+    // (the change is a single write section)
+    template<typename Fn>
+    void call(typed_handle_t<Tag> handle, Fn&& fn);
+    // invokes a callable object on an element in the table using a handle
+    // (const overload)
+    template<typename Fn>
+    void call(typed_handle_t<Tag> handle, Fn&& fn) const;
+    // invokes a callable object on an element in the table using a key (the
+    // change is a single write section)
+    template<typename Fn>
+    void call(const Key& key, Fn&& fn);
+    // invokes a callable object on an element in the table using a key
+    // (const overload)
+    template<typename Fn>
+    void call(const Key& key, Fn&& fn) const;
+    // invokes a callable object on an element in the table and returns a
+    // std::optional containing either the result or an empty optional (as the
+    // key may not have been found)
+    template<typename Fn>
+    decltype(auto) call_return(const Key& key, Fn&& fn) const;
+    // returns a const iterator to the beginning of the values (contiguous)
+    [[nodiscard]] auto vbegin() const -> const Value*;
+    // returns a const iterator to the end of the values (contiguous)
+    [[nodiscard]] auto vend() const -> const Value*;
+  };
+
+  // read only view of a packed hashtable in a shared memory segment (see
+  // shared_packed_hashtable_t), the segment is mapped read only so every
+  // reader process shares the same physical pages
+  // note: values are copied out of the segment (functions are never called on
+  // values in shared memory) and a read is retried if the writer changed the
+  // table while it was being read, a reader waits while the writer is in a
+  // write section (a writer that crashes in a write section blocks readers)
+  template<
+    typename Key, typename Value, typename Hash = std::hash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Tag = packed_hashtable_tag_t>
+  class shared_packed_hashtable_reader_t
+  {
+    static_assert(
+      std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>,
+      "Shared packed hashtables require trivially copyable keys and values");
+
+    using header_t = shared_header_t<Key, Value, Tag>;
+    using entry_t = snapshot_entry_t<Key, Tag>;
+
+    void* mapping_ = nullptr;
+    std::size_t mapping_size_ = 0;
+    const header_t* header_ = nullptr;
+    const Value* values_ = nullptr;
+    const snapshot_slot_t* slots_ = nullptr;
+    const entry_t* index_ = nullptr;
+    int32_t capacity_ = 0;
+    int32_t index_shift_ = 0;
+    std::size_t index_mask_ = 0;
+    Hash hash_;
+    KeyEqual key_equal_;
+
+    // invokes read until it completes without the writer changing the table
+    // and returns its result (read must tolerate inconsistent data)
+    template<typename Read>
+    auto consistent(Read&& read) const;
+    // returns the handle for key (unsynchronized, the result is only
+    // meaningful if the read is consistent)
+    [[nodiscard]] std::optional<typed_handle_t<Tag>> find_unsynchronized(
+      const Key& key) const;
+    // returns the dense index for handle (unsynchronized)
+    [[nodiscard]] std::optional<int32_t> index_unsynchronized(
+      typed_handle_t<Tag> handle) const;
+    // returns a copy of the value for handle (unsynchronized)
+    [[nodiscard]] std::optional<Value> value_unsynchronized(
+      typed_handle_t<Tag> handle) const;
+    // unmaps the segment (if mapped)
+    void release();
+
+  public:
+    shared_packed_hashtable_reader_t() = default;
+    shared_packed_hashtable_reader_t(
+      const shared_packed_hashtable_reader_t&) = delete;
+    shared_packed_hashtable_reader_t(
+      shared_packed_hashtable_reader_t&& other) noexcept;
+    shared_packed_hashtable_reader_t& operator=(
+      const shared_packed_hashtable_reader_t&) = delete;
+    shared_packed_hashtable_reader_t& operator=(
+      shared_packed_hashtable_reader_t&& other) noexcept;
+    ~shared_packed_hashtable_reader_t();
+
+    // maps the shared memory segment called name read only
+    // returns an empty optional if the segment does not exist or does not
+    // hold a table with the same key and value types
+    [[nodiscard]] static std::optional<shared_packed_hashtable_reader_t> open(
+      const char* name);
+
+    // finds the handle for the specified key
+    // note: will return an empty optional if the key was not found
+    [[nodiscard]] std::optional<typed_handle_t<Tag>> find(
+      const Key& key) const;
+    // returns if the table has an element with the equivalent key
+    [[nodiscard]] bool has(const Key& key) const;
+    // returns if the handle refers to an element in the table
+    [[nodiscard]] bool has(typed_handle_t<Tag> handle) const;
+    // returns a copy of the value for the specified key
+    // note: will return an empty optional if the key was not found
+    [[nodiscard]] std::optional<Value> get(const Key& key) const;
+    // returns a copy of the value referred to by handle
+    // note: will return an empty optional if the handle is invalid
+    [[nodiscard]] std::optional<Value> get(typed_handle_t<Tag> handle) const;
+    // invokes a callable object on a copy of an element in the table and
+    // returns a std::optional containing either the result or an empty
+    // optional (as the key may not have been found)
+    template<typename Fn>
+    decltype(auto) call_return(const Key& key, Fn&& fn) const;
+    // returns the number of elements in the table
+    [[nodiscard]] int32_t size() const;
+    // returns if the table has any elements or not
+    [[nodiscard]] bool empty() const;
+    // returns a number that changes whenever the writer changes the table
+    // (e.g. to detect if values cached by the reader are out of date)
+    [[nodiscard]] uint64_t version() const;
+  };
+} // namespace thh
+
+#include "shared-hashtable.inl"
+
+#endif
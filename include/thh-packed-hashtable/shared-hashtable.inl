@@ -0,0 +1,823 @@
+namespace thh
+{
+  template<typename T>
+  T* shared_offset_t<T>::get(void* base) const
+  {
+    return reinterpret_cast<T*>(static_cast<std::byte*>(base) + offset_);
+  }
+
+  template<typename T>
+  const T* shared_offset_t<T>::get(const void* base) const
+  {
+    return reinterpret_cast<const T*>(
+      static_cast<const std::byte*>(base) + offset_);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::write_section_t::
+    write_section_t(header_t* header)
+    : header_(header)
+  {
+    const auto sequence = header_->sequence_.load(std::memory_order_relaxed);
+    header_->sequence_.store(sequence + 1, std::memory_order_relaxed);
+    // readers that see the changes also see the odd sequence
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::write_section_t::
+    ~write_section_t()
+  {
+    header_->sequence_.fetch_add(1, std::memory_order_release);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::
+    shared_packed_hashtable_t(shared_packed_hashtable_t&& other) noexcept
+    : name_(std::move(other.name_)),
+      mapping_(std::exchange(other.mapping_, nullptr)),
+      mapping_size_(std::exchange(other.mapping_size_, 0)),
+      header_(std::exchange(other.header_, nullptr)),
+      values_(std::exchange(other.values_, nullptr)),
+      dense_ids_(std::exchange(other.dense_ids_, nullptr)),
+      slots_(std::exchange(other.slots_, nullptr)),
+      index_(std::exchange(other.index_, nullptr)),
+      index_mask_(std::exchange(other.index_mask_, 0)),
+      index_positions_(std::move(other.index_positions_)),
+      hash_(std::move(other.hash_)),
+      key_equal_(std::move(other.key_equal_))
+  {
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>&
+  shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::operator=(
+    shared_packed_hashtable_t&& other) noexcept
+  {
+    if (this != &other) {
+      release();
+      name_ = std::move(other.name_);
+      mapping_ = std::exchange(other.mapping_, nullptr);
+      mapping_size_ = std::exchange(other.mapping_size_, 0);
+      header_ = std::exchange(other.header_, nullptr);
+      values_ = std::exchange(other.values_, nullptr);
+      dense_ids_ = std::exchange(other.dense_ids_, nullptr);
+      slots_ = std::exchange(other.slots_, nullptr);
+      index_ = std::exchange(other.index_, nullptr);
+      index_mask_ = std::exchange(other.index_mask_, 0);
+      index_positions_ = std::move(other.index_positions_);
+      hash_ = std::move(other.hash_);
+      key_equal_ = std::move(other.key_equal_);
+    }
+    return *this;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  shared_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag>::~shared_packed_hashtable_t()
+  {
+    release();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  void shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::release()
+  {
+    if (mapping_ != nullptr) {
+      ::munmap(mapping_, mapping_size_);
+      ::shm_unlink(name_.c_str());
+      mapping_ = nullptr;
+      mapping_size_ = 0;
+      header_ = nullptr;
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  auto shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::create(
+    const char* name, const int32_t capacity)
+    -> std::optional<shared_packed_hashtable_t>
+  {
+    if (capacity < 0) {
+      return {};
+    }
+
+    // key index with a load factor of at most 0.5
+    int32_t index_shift = 63;
+    while ((uint64_t(1) << (64 - index_shift)) < uint64_t(capacity) * 2) {
+      --index_shift;
+    }
+    const auto index_capacity = uint64_t(1) << (64 - index_shift);
+
+    const auto align = [](const uint64_t offset) {
+      return (offset + snapshot_alignment_v - 1) & ~(snapshot_alignment_v - 1);
+    };
+    header_t layout{};
+    layout.values_.offset_ = align(sizeof(header_t));
+    layout.dense_ids_.offset_ =
+      align(layout.values_.offset_ + uint64_t(capacity) * sizeof(Value));
+    layout.slots_.offset_ =
+      align(layout.dense_ids_.offset_ + uint64_t(capacity) * sizeof(int32_t));
+    layout.index_.offset_ = align(
+      layout.slots_.offset_ + uint64_t(capacity) * sizeof(snapshot_slot_t));
+    const auto segment_size =
+      layout.index_.offset_ + index_capacity * sizeof(entry_t);
+
+    const int file = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (file == -1) {
+      return {};
+    }
+    void* mapping = MAP_FAILED;
+    if (::ftruncate(file, static_cast<off_t>(segment_size)) == 0) {
+      mapping = ::mmap(
+        nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    }
+    // the mapping keeps a reference to the segment
+    ::close(file);
+    if (mapping == MAP_FAILED) {
+      ::shm_unlink(name);
+      return {};
+    }
+
+    shared_packed_hashtable_t table;
+    table.name_ = name;
+    table.mapping_ = mapping;
+    table.mapping_size_ = segment_size;
+    // the segment is zero filled, the header is published with the magic
+    // set last
+    auto* header = new (mapping) header_t{};
+    header->version_ = shared_version_v;
+    header->key_size_ = sizeof(Key);
+    header->value_size_ = sizeof(Value);
+    header->entry_size_ = sizeof(entry_t);
+    header->capacity_ = capacity;
+    header->index_shift_ = index_shift;
+    header->index_capacity_ = static_cast<int64_t>(index_capacity);
+    header->segment_size_ = segment_size;
+    header->values_ = layout.values_;
+    header->dense_ids_ = layout.dense_ids_;
+    header->slots_ = layout.slots_;
+    header->index_ = layout.index_;
+    header->size_ = 0;
+    table.header_ = header;
+    table.values_ = header->values_.get(mapping);
+    table.dense_ids_ = header->dense_ids_.get(mapping);
+    table.slots_ = header->slots_.get(mapping);
+    table.index_ = header->index_.get(mapping);
+    table.index_mask_ = static_cast<std::size_t>(index_capacity) - 1;
+    table.index_positions_.resize(capacity);
+    // dense ids past size() hold the free handle ids
+    for (int32_t id = 0; id < capacity; ++id) {
+      table.dense_ids_[id] = id;
+      table.slots_[id] = snapshot_slot_t{-1, 0};
+    }
+    std::uninitialized_fill_n(table.index_, index_capacity, entry_t{});
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic_ = {'T', 'H', 'H', 'P', 'H', 'T', 'S', 'H'};
+    return table;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  void shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::unlink(
+    const char* name)
+  {
+    ::shm_unlink(name);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  std::optional<std::size_t> shared_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag>::find_position(const Key& key) const
+  {
+    if (header_ == nullptr) {
+      return {};
+    }
+    for (auto position =
+           snapshot_index_position(hash_(key), header_->index_shift_);
+         index_[position].handle_.id_ != -1;
+         position = (position + 1) & index_mask_) {
+      if (key_equal_(index_[position].key_, key)) {
+        return position;
+      }
+    }
+    return {};
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  void shared_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag>::erase_position(std::size_t position)
+  {
+    // backward shift deletion keeps every probe sequence unbroken
+    for (auto next = (position + 1) & index_mask_;
+         index_[next].handle_.id_ != -1; next = (next + 1) & index_mask_) {
+      const auto home = snapshot_index_position(
+        hash_(index_[next].key_), header_->index_shift_);
+      // move the entry back if its home is not in (position, next]
+      if (((next - home) & index_mask_) >= ((next - position) & index_mask_)) {
+        index_[position] = index_[next];
+        index_positions_[index_[position].handle_.id_] = position;
+        position = next;
+      }
+    }
+    index_[position] = entry_t{};
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  void shared_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag>::remove_handle(typed_handle_t<Tag> handle)
+  {
+    // the last value is moved into the gap and the freed id is kept past the
+    // end of the dense ids
+    const auto last = header_->size_ - 1;
+    const auto index = slots_[handle.id_].lookup_;
+    if (index != last) {
+      values_[index] = values_[last];
+      dense_ids_[index] = dense_ids_[last];
+      slots_[dense_ids_[index]].lookup_ = index;
+    }
+    dense_ids_[last] = handle.id_;
+    slots_[handle.id_] = snapshot_slot_t{-1, handle.gen_ + 1};
+    header_->size_ = last;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  std::optional<typed_handle_t<Tag>> shared_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag>::add(const Key& key, const Value& value)
+  {
+    if (
+      header_ == nullptr || header_->size_ == header_->capacity_
+      || find_position(key).has_value()) {
+      return {};
+    }
+    write_section_t write(header_);
+    const auto index = header_->size_;
+    typed_handle_t<Tag> handle;
+    handle.id_ = dense_ids_[index];
+    handle.gen_ = slots_[handle.id_].gen_;
+    values_[index] = value;
+    slots_[handle.id_].lookup_ = index;
+    header_->size_ = index + 1;
+    auto position = snapshot_index_position(hash_(key), header_->index_shift_);
+    while (index_[position].handle_.id_ != -1) {
+      position = (position + 1) & index_mask_;
+    }
+    index_[position] = entry_t{key, handle};
+    index_positions_[handle.id_] = position;
+    return handle;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  std::optional<typed_handle_t<Tag>> shared_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag>::add_or_update(const Key& key,
+    const Value& value)
+  {
+    if (const auto position = find_position(key); position.has_value()) {
+      const auto handle = index_[*position].handle_;
+      write_section_t write(header_);
+      values_[slots_[handle.id_].lookup_] = value;
+      return handle;
+    }
+    return add(key, value);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  bool shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::remove(
+    const Key& key)
+  {
+    const auto position = find_position(key);
+    if (!position.has_value()) {
+      return false;
+    }
+    write_section_t write(header_);
+    remove_handle(index_[*position].handle_);
+    erase_position(*position);
+    return true;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  bool shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::remove(
+    const typed_handle_t<Tag> handle)
+  {
+    if (!has(handle)) {
+      return false;
+    }
+    write_section_t write(header_);
+    remove_handle(handle);
+    erase_position(index_positions_[handle.id_]);
+    return true;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  void shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::clear()
+  {
+    if (header_ == nullptr) {
+      return;
+    }
+    write_section_t write(header_);
+    for (int32_t index = 0; index < header_->size_; ++index) {
+      auto& slot = slots_[dense_ids_[index]];
+      slot = snapshot_slot_t{-1, slot.gen_ + 1};
+    }
+    std::fill_n(index_, index_mask_ + 1, entry_t{});
+    header_->size_ = 0;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  std::optional<typed_handle_t<Tag>> shared_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag>::find(const Key& key) const
+  {
+    if (const auto position = find_position(key); position.has_value()) {
+      return index_[*position].handle_;
+    }
+    return {};
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  bool shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::has(
+    const Key& key) const
+  {
+    return find_position(key).has_value();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  bool shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::has(
+    const typed_handle_t<Tag> handle) const
+  {
+    return header_ != nullptr && handle.id_ >= 0
+        && handle.id_ < header_->capacity_
+        && slots_[handle.id_].lookup_ >= 0
+        && slots_[handle.id_].gen_ == handle.gen_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  int32_t shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::size()
+    const
+  {
+    return header_ == nullptr ? 0 : header_->size_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  int32_t shared_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag>::capacity() const
+  {
+    return header_ == nullptr ? 0 : header_->capacity_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  bool shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::empty()
+    const
+  {
+    return size() == 0;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  template<typename Fn>
+  void shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::call(
+    const typed_handle_t<Tag> handle, Fn&& fn)
+  {
+    if (has(handle)) {
+      write_section_t write(header_);
+      fn(values_[slots_[handle.id_].lookup_]);
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  template<typename Fn>
+  void shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::call(
+    const typed_handle_t<Tag> handle, Fn&& fn) const
+  {
+    if (has(handle)) {
+      fn(std::as_const(values_[slots_[handle.id_].lookup_]));
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  template<typename Fn>
+  void shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::call(
+    const Key& key, Fn&& fn)
+  {
+    if (const auto handle = find(key); handle.has_value()) {
+      call(*handle, std::forward<Fn>(fn));
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  template<typename Fn>
+  void shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::call(
+    const Key& key, Fn&& fn) const
+  {
+    if (const auto handle = find(key); handle.has_value()) {
+      call(*handle, std::forward<Fn>(fn));
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  template<typename Fn>
+  decltype(auto) shared_packed_hashtable_t<
+    Key, Value, Hash, KeyEqual, Tag>::call_return(const Key& key, Fn&& fn)
+    const
+  {
+    using result_t = decltype(fn(std::declval<const Value&>()));
+    if (const auto handle = find(key); handle.has_value()) {
+      return std::optional<result_t>(
+        fn(std::as_const(values_[slots_[handle->id_].lookup_])));
+    }
+    return std::optional<result_t>{};
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  auto shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::vbegin()
+    const -> const Value*
+  {
+    return values_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  auto shared_packed_hashtable_t<Key, Value, Hash, KeyEqual, Tag>::vend()
+    const -> const Value*
+  {
+    return values_ + size();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  shared_packed_hashtable_reader_t<Key, Value, Hash, KeyEqual, Tag>::
+    shared_packed_hashtable_reader_t(
+      shared_packed_hashtable_reader_t&& other) noexcept
+    : mapping_(std::exchange(other.mapping_, nullptr)),
+      mapping_size_(std::exchange(other.mapping_size_, 0)),
+      header_(std::exchange(other.header_, nullptr)),
+      values_(std::exchange(other.values_, nullptr)),
+      slots_(std::exchange(other.slots_, nullptr)),
+      index_(std::exchange(other.index_, nullptr)),
+      capacity_(std::exchange(other.capacity_, 0)),
+      index_shift_(std::exchange(other.index_shift_, 0)),
+      index_mask_(std::exchange(other.index_mask_, 0)),
+      hash_(std::move(other.hash_)),
+      key_equal_(std::move(other.key_equal_))
+  {
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  shared_packed_hashtable_reader_t<Key, Value, Hash, KeyEqual, Tag>&
+  shared_packed_hashtable_reader_t<Key, Value, Hash, KeyEqual, Tag>::operator=(
+    shared_packed_hashtable_reader_t&& other) noexcept
+  {
+    if (this != &other) {
+      release();
+      mapping_ = std::exchange(other.mapping_, nullptr);
+      mapping_size_ = std::exchange(other.mapping_size_, 0);
+      header_ = std::exchange(other.header_, nullptr);
+      values_ = std::exchange(other.values_, nullptr);
+      slots_ = std::exchange(other.slots_, nullptr);
+      index_ = std::exchange(other.index_, nullptr);
+      capacity_ = std::exchange(other.capacity_, 0);
+      index_shift_ = std::exchange(other.index_shift_, 0);
+      index_mask_ = std::exchange(other.index_mask_, 0);
+      hash_ = std::move(other.hash_);
+      key_equal_ = std::move(other.key_equal_);
+    }
+    return *this;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  shared_packed_hashtable_reader_t<
+    Key, Value, Hash, KeyEqual, Tag>::~shared_packed_hashtable_reader_t()
+  {
+    release();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  void shared_packed_hashtable_reader_t<
+    Key, Value, Hash, KeyEqual, Tag>::release()
+  {
+    if (mapping_ != nullptr) {
+      ::munmap(mapping_, mapping_size_);
+      mapping_ = nullptr;
+      mapping_size_ = 0;
+      header_ = nullptr;
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  auto shared_packed_hashtable_reader_t<
+    Key, Value, Hash, KeyEqual, Tag>::open(const char* name)
+    -> std::optional<shared_packed_hashtable_reader_t>
+  {
+    const int file = ::shm_open(name, O_RDONLY, 0);
+    if (file == -1) {
+      return {};
+    }
+    struct stat status;
+    if (
+      ::fstat(file, &status) != 0
+      || status.st_size < static_cast<off_t>(sizeof(header_t))) {
+      ::close(file);
+      return {};
+    }
+    const auto mapping_size = static_cast<std::size_t>(status.st_size);
+    void* mapping =
+      ::mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, file, 0);
+    // the mapping keeps a reference to the segment
+    ::close(file);
+    if (mapping == MAP_FAILED) {
+      return {};
+    }
+
+    shared_packed_hashtable_reader_t reader;
+    reader.mapping_ = mapping;
+    reader.mapping_size_ = mapping_size;
+
+    const auto* header = static_cast<const header_t*>(mapping);
+    const std::array<char, 8> magic = {'T', 'H', 'H', 'P', 'H', 'T', 'S', 'H'};
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // returns if a section lies within the segment
+    const auto section_valid = [mapping_size](
+                                 const uint64_t offset, const int64_t count,
+                                 const std::size_t size) {
+      return offset <= mapping_size
+          && uint64_t(count) <= (mapping_size - offset) / size;
+    };
+    if (
+      header->magic_ != magic || header->version_ != shared_version_v
+      || header->key_size_ != sizeof(Key)
+      || header->value_size_ != sizeof(Value)
+      || header->entry_size_ != sizeof(entry_t)
+      || header->segment_size_ != mapping_size || header->capacity_ < 0
+      || header->index_capacity_ < 2
+      || header->index_capacity_ != int64_t(1) << (64 - header->index_shift_)
+      || !section_valid(
+        header->values_.offset_, header->capacity_, sizeof(Value))
+      || !section_valid(
+        header->slots_.offset_, header->capacity_, sizeof(snapshot_slot_t))
+      || !section_valid(
+        header->index_.offset_, header->index_capacity_, sizeof(entry_t))) {
+      return {};
+    }
+
+    reader.header_ = header;
+    reader.values_ = header->values_.get(mapping);
+    reader.slots_ = header->slots_.get(mapping);
+    reader.index_ = header->index_.get(mapping);
+    reader.capacity_ = header->capacity_;
+    reader.index_shift_ = header->index_shift_;
+    reader.index_mask_ = static_cast<std::size_t>(header->index_capacity_) - 1;
+    return reader;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  template<typename Read>
+  auto shared_packed_hashtable_reader_t<
+    Key, Value, Hash, KeyEqual, Tag>::consistent(Read&& read) const
+  {
+    for (;;) {
+      const auto begin = header_->sequence_.load(std::memory_order_acquire);
+      if ((begin & 1) == 0) {
+        auto result = read();
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header_->sequence_.load(std::memory_order_relaxed) == begin) {
+          return result;
+        }
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  std::optional<typed_handle_t<Tag>> shared_packed_hashtable_reader_t<
+    Key, Value, Hash, KeyEqual, Tag>::find_unsynchronized(const Key& key) const
+  {
+    // entries are copied before use as the writer may be changing them, the
+    // probe is bounded in case the index is seen mid change
+    auto position = snapshot_index_position(hash_(key), index_shift_);
+    for (std::size_t probe = 0; probe <= index_mask_; ++probe) {
+      alignas(entry_t) std::byte bytes[sizeof(entry_t)];
+      std::memcpy(bytes, index_ + position, sizeof(entry_t));
+      const auto& entry = *std::launder(reinterpret_cast<entry_t*>(bytes));
+      if (entry.handle_.id_ == -1) {
+        break;
+      }
+      if (key_equal_(entry.key_, key)) {
+        return entry.handle_;
+      }
+      position = (position + 1) & index_mask_;
+    }
+    return {};
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  std::optional<int32_t> shared_packed_hashtable_reader_t<
+    Key, Value, Hash, KeyEqual, Tag>::index_unsynchronized(
+    const typed_handle_t<Tag> handle) const
+  {
+    if (handle.id_ < 0 || handle.id_ >= capacity_) {
+      return {};
+    }
+    const auto slot = slots_[handle.id_];
+    if (slot.lookup_ < 0 || slot.lookup_ >= capacity_
+        || slot.gen_ != handle.gen_) {
+      return {};
+    }
+    return slot.lookup_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  std::optional<Value> shared_packed_hashtable_reader_t<
+    Key, Value, Hash, KeyEqual, Tag>::value_unsynchronized(
+    const typed_handle_t<Tag> handle) const
+  {
+    const auto index = index_unsynchronized(handle);
+    if (!index.has_value()) {
+      return {};
+    }
+    alignas(Value) std::byte bytes[sizeof(Value)];
+    std::memcpy(bytes, values_ + *index, sizeof(Value));
+    return *std::launder(reinterpret_cast<Value*>(bytes));
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  std::optional<typed_handle_t<Tag>> shared_packed_hashtable_reader_t<
+    Key, Value, Hash, KeyEqual, Tag>::find(const Key& key) const
+  {
+    if (header_ == nullptr) {
+      return {};
+    }
+    return consistent([this, &key] { return find_unsynchronized(key); });
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  bool shared_packed_hashtable_reader_t<Key, Value, Hash, KeyEqual, Tag>::has(
+    const Key& key) const
+  {
+    return find(key).has_value();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  bool shared_packed_hashtable_reader_t<Key, Value, Hash, KeyEqual, Tag>::has(
+    const typed_handle_t<Tag> handle) const
+  {
+    if (header_ == nullptr) {
+      return false;
+    }
+    return consistent([this, handle] {
+      return index_unsynchronized(handle).has_value();
+    });
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  std::optional<Value> shared_packed_hashtable_reader_t<
+    Key, Value, Hash, KeyEqual, Tag>::get(const Key& key) const
+  {
+    if (header_ == nullptr) {
+      return {};
+    }
+    return consistent([this, &key]() -> std::optional<Value> {
+      if (const auto handle = find_unsynchronized(key); handle.has_value()) {
+        return value_unsynchronized(*handle);
+      }
+      return {};
+    });
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  std::optional<Value> shared_packed_hashtable_reader_t<
+    Key, Value, Hash, KeyEqual, Tag>::get(const typed_handle_t<Tag> handle)
+    const
+  {
+    if (header_ == nullptr) {
+      return {};
+    }
+    return consistent([this, handle] { return value_unsynchronized(handle); });
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  template<typename Fn>
+  decltype(auto) shared_packed_hashtable_reader_t<
+    Key, Value, Hash, KeyEqual, Tag>::call_return(const Key& key, Fn&& fn)
+    const
+  {
+    using result_t = decltype(fn(std::declval<const Value&>()));
+    if (const auto value = get(key); value.has_value()) {
+      return std::optional<result_t>(fn(std::as_const(*value)));
+    }
+    return std::optional<result_t>{};
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  int32_t shared_packed_hashtable_reader_t<
+    Key, Value, Hash, KeyEqual, Tag>::size() const
+  {
+    if (header_ == nullptr) {
+      return 0;
+    }
+    return consistent([this] { return header_->size_; });
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  bool shared_packed_hashtable_reader_t<
+    Key, Value, Hash, KeyEqual, Tag>::empty() const
+  {
+    return size() == 0;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag>
+  uint64_t shared_packed_hashtable_reader_t<
+    Key, Value, Hash, KeyEqual, Tag>::version() const
+  {
+    if (header_ == nullptr) {
+      return 0;
+    }
+    // an odd sequence (a write in progress) reports the version before it
+    return header_->sequence_.load(std::memory_order_acquire) & ~uint64_t(1);
+  }
+} // namespace thh
@@ -0,0 +1,246 @@
+#pragma once
+
+#include "packed-hashtable.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace thh
+{
+  // current version of the snapshot file format (see save_snapshot)
+  inline constexpr uint32_t snapshot_version_v = 1;
+  // alignment of each section in a snapshot file
+  inline constexpr uint64_t snapshot_alignment_v = 64;
+
+  // header at the start of a snapshot file, section offsets are from the start
+  // of the file
+  // note: sizes of the key, value and index entry types are recorded so a
+  // snapshot is rejected if it is loaded with different types
+  struct snapshot_header_t
+  {
+    std::array<char, 8> magic_;
+    uint32_t version_;
+    uint32_t key_size_;
+    uint32_t value_size_;
+    uint32_t entry_size_;
+    int64_t size_;
+    int64_t slot_count_;
+    int64_t index_capacity_;
+    uint64_t values_offset_;
+    uint64_t dense_ids_offset_;
+    uint64_t slots_offset_;
+    uint64_t index_offset_;
+    uint64_t file_size_;
+  };
+
+  // handle slot stored in a snapshot (indexed by handle id), lookup_ is the
+  // dense index of the element or -1 if the slot is free
+  struct snapshot_slot_t
+  {
+    int32_t lookup_;
+    int32_t gen_;
+  };
+
+  // key index entry stored in a snapshot (open addressing with linear
+  // probing), unused entries have a handle with an id of -1
+  template<typename Key, typename Tag>
+  struct snapshot_entry_t
+  {
+    Key key_;
+    typed_handle_t<Tag> handle_;
+  };
+
+  // returns the position of a hash in a snapshot key index (fibonacci
+  // hashing, the index has 1 << (64 - shift) entries)
+  inline std::size_t snapshot_index_position(std::size_t hash, int32_t shift);
+
+  // writes the contents of a packed hashtable to a snapshot file at path
+  // the file is a header followed by flat sections for the values (in dense
+  // order), the dense handle ids, the handle slots and a key index
+  // note: Key and Value must be trivially copyable
+  // note: handles are preserved (a handle from the table resolves to the same
+  // value in the loaded snapshot)
+  // note: values removed but waiting for compaction are not written (see
+  // deferred_removal_policy_t), indices in the snapshot are then compacted
+  // note: the key index is built with Hash, a snapshot must be loaded with a
+  // Hash that produces the same results (e.g. the same build)
+  // returns false if the file could not be written
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  bool save_snapshot(
+    const base_packed_hashtable_t<
+      Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>&
+      packed_hashtable,
+    const char* path);
+
+#if __has_include(<sys/mman.h>)
+  // how the sections of a snapshot are mapped into memory
+  enum class snapshot_access_e
+  {
+    // values cannot be modified
+    read_only,
+    // values can be modified in place, changes are private to the process
+    // and are not written back to the file
+    copy_on_write
+  };
+
+  // view of a packed hashtable saved with save_snapshot, the file is memory
+  // mapped and used in place (no per-element deserialization)
+  // note: elements cannot be added or removed, values may only be modified if
+  // Access is snapshot_access_e::copy_on_write
+  template<
+    typename Key, typename Value, typename Hash = std::hash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Tag = packed_hashtable_tag_t,
+    snapshot_access_e Access = snapshot_access_e::read_only>
+  class packed_hashtable_snapshot_t
+  {
+    static_assert(
+      std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>,
+      "Snapshots require trivially copyable keys and values");
+
+    using entry_t = snapshot_entry_t<Key, Tag>;
+
+  public:
+    using value_iterator = std::conditional_t<
+      Access == snapshot_access_e::copy_on_write, Value*, const Value*>;
+    using const_value_iterator = const Value*;
+
+  private:
+    void* mapping_ = nullptr;
+    std::size_t mapping_size_ = 0;
+    int32_t size_ = 0;
+    int32_t slot_count_ = 0;
+    int32_t index_shift_ = 0;
+    std::size_t index_mask_ = 0;
+    value_iterator values_ = nullptr;
+    const int32_t* dense_ids_ = nullptr;
+    const snapshot_slot_t* slots_ = nullptr;
+    const entry_t* index_ = nullptr;
+    Hash hash_;
+    KeyEqual key_equal_;
+
+    // unmaps the file (if mapped)
+    void release();
+
+  public:
+    // proxy to support friendly iteration for values (see value_iteration())
+    // note: to be used with range based for loop
+    // e.g. for (const auto& value : snapshot.value_iteration())
+    template<typename Iterator>
+    class value_iterator_wrapper_t
+    {
+      Iterator begin_;
+      Iterator end_;
+
+    public:
+      value_iterator_wrapper_t(Iterator begin, Iterator end)
+        : begin_(begin), end_(end)
+      {
+      }
+      [[nodiscard]] Iterator begin() const { return begin_; }
+      [[nodiscard]] Iterator end() const { return end_; }
+    };
+
+    packed_hashtable_snapshot_t() = default;
+    packed_hashtable_snapshot_t(const packed_hashtable_snapshot_t&) = delete;
+    packed_hashtable_snapshot_t(packed_hashtable_snapshot_t&& other) noexcept;
+    packed_hashtable_snapshot_t& operator=(
+      const packed_hashtable_snapshot_t&) = delete;
+    packed_hashtable_snapshot_t& operator=(
+      packed_hashtable_snapshot_t&& other) noexcept;
+    ~packed_hashtable_snapshot_t();
+
+    // maps a snapshot file (see save_snapshot) into memory
+    // returns an empty optional if the file could not be mapped or is not a
+    // snapshot of a table with the same key and value types
+    [[nodiscard]] static std::optional<packed_hashtable_snapshot_t> load_mmap(
+      const char* path);
+
+    // finds the handle for the specified key
+    // note: will return an empty optional if the key was not found
+    [[nodiscard]] std::optional<typed_handle_t<Tag>> find(
+      const Key& key) const;
+    // returns if the snapshot has an element with the equivalent key
+    [[nodiscard]] bool has(const Key& key) const;
+    // returns if the handle refers to an element in the snapshot
+    [[nodiscard]] bool has(typed_handle_t<Tag> handle) const;
+    // returns the handle for a value at a given index
+    // note: will return an invalid handle if the index is out of range
+    [[nodiscard]] typed_handle_t<Tag> handle_from_index(int32_t index) const;
+    // returns the index (position) of a value for a given handle
+    // note: will return an empty optional if the handle is invalid
+    [[nodiscard]] std::optional<int32_t> index_from_handle(
+      typed_handle_t<Tag> handle) const;
+    // returns the number of elements in the snapshot
+    [[nodiscard]] int32_t size() const;
+    // returns if the snapshot has any elements or not
+    [[nodiscard]] bool empty() const;
+    // invokes a callable object on an element in the snapshot using a handle
+    // note: values are only mutable with snapshot_access_e::copy_on_write
+    template<typename Fn>
+    void call(typed_handle_t<Tag> handle, Fn&& fn);
+    // invokes a callable object on an element in the snapshot using a handle
+    // (const overload)
+    template<typename Fn>
+    void call(typed_handle_t<Tag> handle, Fn&& fn) const;
+    // invokes a callable object on an element in the snapshot using a key
+    // (const overload)
+    template<typename Fn>
+    void call(const Key& key, Fn&& fn) const;
+    // invokes a callable object on an element in the snapshot and returns a
+    // std::optional containing either the result or an empty optional (as the
+    // handle may not have been successfully resolved)
+    template<typename Fn>
+    decltype(auto) call_return(typed_handle_t<Tag> handle, Fn&& fn) const;
+    // invokes a callable object on an element in the snapshot and returns a
+    // std::optional containing either the result or an empty optional (as the
+    // key may not have been found)
+    template<typename Fn>
+    decltype(auto) call_return(const Key& key, Fn&& fn) const;
+    // returns an iterator to the beginning of the values (contiguous)
+    // note: values are only mutable with snapshot_access_e::copy_on_write
+    [[nodiscard]] auto vbegin() -> value_iterator;
+    // returns a const iterator to the beginning of the values (contiguous)
+    [[nodiscard]] auto vbegin() const -> const_value_iterator;
+    // returns a const iterator to the beginning of the values (contiguous)
+    [[nodiscard]] auto vcbegin() const -> const_value_iterator;
+    // returns an iterator to the end of the values (contiguous)
+    // note: values are only mutable with snapshot_access_e::copy_on_write
+    [[nodiscard]] auto vend() -> value_iterator;
+    // returns a const iterator to the end of the values (contiguous)
+    [[nodiscard]] auto vend() const -> const_value_iterator;
+    // returns a const iterator to the end of the values (contiguous)
+    [[nodiscard]] auto vcend() const -> const_value_iterator;
+    // returns a proxy object to the snapshot to provide begin/end iterators
+    // for values (to be used with range based for loop)
+    // note: values are only mutable with snapshot_access_e::copy_on_write
+    [[nodiscard]] auto value_iteration()
+      -> value_iterator_wrapper_t<value_iterator>;
+    // returns a proxy object to the snapshot to provide begin/end iterators
+    // for values (to be used with range based for loop) (const overload)
+    [[nodiscard]] auto value_iteration() const
+      -> value_iterator_wrapper_t<const_value_iterator>;
+  };
+#endif
+} // namespace thh
+
+#include "snapshot.inl"
@@ -0,0 +1,539 @@
+namespace thh
+{
+  inline std::size_t snapshot_index_position(
+    const std::size_t hash, const int32_t shift)
+  {
+    return static_cast<std::size_t>(
+      (static_cast<uint64_t>(hash) * 11400714819323198485ull) >> shift);
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, typename Allocator, typename Policy, typename RemovalPolicy>
+  bool save_snapshot(
+    const base_packed_hashtable_t<
+      Key, Value, Hash, KeyEqual, Tag, Allocator, Policy, RemovalPolicy>&
+      packed_hashtable,
+    const char* path)
+  {
+    static_assert(
+      std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>,
+      "Snapshots require trivially copyable keys and values");
+
+    using entry_t = snapshot_entry_t<Key, Tag>;
+
+    const auto size = packed_hashtable.size();
+    const auto slot_count = packed_hashtable.capacity();
+
+    // rebuild the slots from the live handles, free slots can never be
+    // resolved as elements cannot be added to a snapshot
+    // note: values removed but waiting for compaction are skipped (see
+    // deferred_removal_policy_t), the snapshot is written compacted
+    const auto dense_size = size + packed_hashtable.pending_removals();
+    std::vector<int32_t> dense_ids(size);
+    std::vector<snapshot_slot_t> slots(slot_count, snapshot_slot_t{-1, 0});
+    int32_t position = 0;
+    for (int32_t index = 0; index < dense_size; ++index) {
+      if (packed_hashtable.tombstoned(index)) {
+        continue;
+      }
+      const auto handle = packed_hashtable.handle_from_index(index);
+      dense_ids[position] = handle.id_;
+      slots[handle.id_] = snapshot_slot_t{position, handle.gen_};
+      ++position;
+    }
+
+    // key index with a load factor of at most 0.5
+    int32_t index_shift = 63;
+    while ((uint64_t(1) << (64 - index_shift)) < uint64_t(size) * 2) {
+      --index_shift;
+    }
+    const std::size_t index_capacity = std::size_t(1) << (64 - index_shift);
+    std::vector<entry_t> index(index_capacity);
+    const Hash hash;
+    for (const auto& key_handle : packed_hashtable.handle_iteration()) {
+      auto position =
+        snapshot_index_position(hash(key_handle.first), index_shift);
+      while (index[position].handle_.id_ != -1) {
+        position = (position + 1) & (index_capacity - 1);
+      }
+      index[position].key_ = key_handle.first;
+      index[position].handle_ = key_handle.second;
+    }
+
+    const auto align = [](const uint64_t offset) {
+      return (offset + snapshot_alignment_v - 1) & ~(snapshot_alignment_v - 1);
+    };
+    snapshot_header_t header{};
+    header.magic_ = {'T', 'H', 'H', 'P', 'H', 'T', 'S', 'N'};
+    header.version_ = snapshot_version_v;
+    header.key_size_ = sizeof(Key);
+    header.value_size_ = sizeof(Value);
+    header.entry_size_ = sizeof(entry_t);
+    header.size_ = size;
+    header.slot_count_ = slot_count;
+    header.index_capacity_ = static_cast<int64_t>(index_capacity);
+    header.values_offset_ = align(sizeof(snapshot_header_t));
+    header.dense_ids_offset_ =
+      align(header.values_offset_ + uint64_t(size) * sizeof(Value));
+    header.slots_offset_ =
+      align(header.dense_ids_offset_ + uint64_t(size) * sizeof(int32_t));
+    header.index_offset_ = align(
+      header.slots_offset_ + uint64_t(slot_count) * sizeof(snapshot_slot_t));
+    header.file_size_ =
+      header.index_offset_ + uint64_t(index_capacity) * sizeof(entry_t);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    uint64_t offset = 0;
+    const auto write = [&file, &offset](
+                         const void* data, const uint64_t bytes) {
+      file.write(
+        static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+      offset += bytes;
+    };
+    const auto pad = [&write, &offset](const uint64_t to) {
+      const std::array<char, snapshot_alignment_v> zeros{};
+      write(zeros.data(), to - offset);
+    };
+
+    write(&header, sizeof(header));
+    pad(header.values_offset_);
+    // value_iteration skips values waiting for compaction
+    const auto write_values = [&packed_hashtable, &write] {
+      for (const auto& value : packed_hashtable.value_iteration()) {
+        write(&value, sizeof(Value));
+      }
+    };
+    if constexpr (std::is_pointer_v<decltype(packed_hashtable.vbegin())>) {
+      if (packed_hashtable.pending_removals() == 0) {
+        write(packed_hashtable.vbegin(), uint64_t(size) * sizeof(Value));
+      } else {
+        write_values();
+      }
+    } else {
+      write_values();
+    }
+    pad(header.dense_ids_offset_);
+    write(dense_ids.data(), dense_ids.size() * sizeof(int32_t));
+    pad(header.slots_offset_);
+    write(slots.data(), slots.size() * sizeof(snapshot_slot_t));
+    pad(header.index_offset_);
+    write(index.data(), index.size() * sizeof(entry_t));
+    file.flush();
+    return file.good();
+  }
+
+#if __has_include(<sys/mman.h>)
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  void packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::release()
+  {
+    if (mapping_ != nullptr) {
+      ::munmap(mapping_, mapping_size_);
+      mapping_ = nullptr;
+      mapping_size_ = 0;
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  packed_hashtable_snapshot_t<Key, Value, Hash, KeyEqual, Tag, Access>::
+    packed_hashtable_snapshot_t(packed_hashtable_snapshot_t&& other) noexcept
+    : mapping_(std::exchange(other.mapping_, nullptr)),
+      mapping_size_(std::exchange(other.mapping_size_, 0)),
+      size_(std::exchange(other.size_, 0)),
+      slot_count_(std::exchange(other.slot_count_, 0)),
+      index_shift_(std::exchange(other.index_shift_, 0)),
+      index_mask_(std::exchange(other.index_mask_, 0)),
+      values_(std::exchange(other.values_, nullptr)),
+      dense_ids_(std::exchange(other.dense_ids_, nullptr)),
+      slots_(std::exchange(other.slots_, nullptr)),
+      index_(std::exchange(other.index_, nullptr)),
+      hash_(std::move(other.hash_)),
+      key_equal_(std::move(other.key_equal_))
+  {
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  packed_hashtable_snapshot_t<Key, Value, Hash, KeyEqual, Tag, Access>&
+  packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::operator=(
+    packed_hashtable_snapshot_t&& other) noexcept
+  {
+    if (this != &other) {
+      release();
+      mapping_ = std::exchange(other.mapping_, nullptr);
+      mapping_size_ = std::exchange(other.mapping_size_, 0);
+      size_ = std::exchange(other.size_, 0);
+      slot_count_ = std::exchange(other.slot_count_, 0);
+      index_shift_ = std::exchange(other.index_shift_, 0);
+      index_mask_ = std::exchange(other.index_mask_, 0);
+      values_ = std::exchange(other.values_, nullptr);
+      dense_ids_ = std::exchange(other.dense_ids_, nullptr);
+      slots_ = std::exchange(other.slots_, nullptr);
+      index_ = std::exchange(other.index_, nullptr);
+      hash_ = std::move(other.hash_);
+      key_equal_ = std::move(other.key_equal_);
+    }
+    return *this;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::~packed_hashtable_snapshot_t()
+  {
+    release();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  auto packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::load_mmap(
+    const char* path)
+    -> std::optional<packed_hashtable_snapshot_t>
+  {
+    const int file = ::open(path, O_RDONLY);
+    if (file == -1) {
+      return {};
+    }
+    struct stat status;
+    if (::fstat(file, &status) != 0
+        || status.st_size < static_cast<off_t>(sizeof(snapshot_header_t))) {
+      ::close(file);
+      return {};
+    }
+    constexpr auto writable = Access == snapshot_access_e::copy_on_write;
+    const auto mapping_size = static_cast<std::size_t>(status.st_size);
+    void* mapping = ::mmap(
+      nullptr, mapping_size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+      MAP_PRIVATE, file, 0);
+    // the mapping keeps a reference to the file
+    ::close(file);
+    if (mapping == MAP_FAILED) {
+      return {};
+    }
+
+    packed_hashtable_snapshot_t snapshot;
+    snapshot.mapping_ = mapping;
+    snapshot.mapping_size_ = mapping_size;
+
+    snapshot_header_t header;
+    std::memcpy(&header, mapping, sizeof(header));
+    const std::array<char, 8> magic = {'T', 'H', 'H', 'P', 'H', 'T', 'S', 'N'};
+    // returns if a section lies within the file and is suitably aligned
+    const auto section_valid = [mapping_size](
+                                 const uint64_t offset, const int64_t count,
+                                 const std::size_t size,
+                                 const std::size_t alignment) {
+      return count >= 0 && offset % alignment == 0 && offset <= mapping_size
+          && uint64_t(count) <= (mapping_size - offset) / size;
+    };
+    if (
+      header.magic_ != magic || header.version_ != snapshot_version_v
+      || header.key_size_ != sizeof(Key) || header.value_size_ != sizeof(Value)
+      || header.entry_size_ != sizeof(entry_t)
+      || header.file_size_ != mapping_size
+      || header.size_ > std::numeric_limits<int32_t>::max()
+      || header.slot_count_ > std::numeric_limits<int32_t>::max()
+      || header.index_capacity_ < 2
+      || (header.index_capacity_ & (header.index_capacity_ - 1)) != 0
+      || !section_valid(
+        header.values_offset_, header.size_, sizeof(Value), alignof(Value))
+      || !section_valid(
+        header.dense_ids_offset_, header.size_, sizeof(int32_t),
+        alignof(int32_t))
+      || !section_valid(
+        header.slots_offset_, header.slot_count_, sizeof(snapshot_slot_t),
+        alignof(snapshot_slot_t))
+      || !section_valid(
+        header.index_offset_, header.index_capacity_, sizeof(entry_t),
+        alignof(entry_t))) {
+      return {};
+    }
+
+    auto* bytes = static_cast<std::byte*>(mapping);
+    snapshot.size_ = static_cast<int32_t>(header.size_);
+    snapshot.slot_count_ = static_cast<int32_t>(header.slot_count_);
+    snapshot.index_mask_ = static_cast<std::size_t>(header.index_capacity_) - 1;
+    snapshot.index_shift_ = 64;
+    for (auto capacity = header.index_capacity_; capacity > 1; capacity /= 2) {
+      --snapshot.index_shift_;
+    }
+    snapshot.values_ =
+      reinterpret_cast<value_iterator>(bytes + header.values_offset_);
+    snapshot.dense_ids_ =
+      reinterpret_cast<const int32_t*>(bytes + header.dense_ids_offset_);
+    snapshot.slots_ =
+      reinterpret_cast<const snapshot_slot_t*>(bytes + header.slots_offset_);
+    snapshot.index_ =
+      reinterpret_cast<const entry_t*>(bytes + header.index_offset_);
+
+    // ids and positions read from the file are used as indices, reject a
+    // corrupt file instead of reading out of bounds
+    const auto dense_ids_valid = std::all_of(
+      snapshot.dense_ids_, snapshot.dense_ids_ + snapshot.size_,
+      [&snapshot](const int32_t id) {
+        return id >= 0 && id < snapshot.slot_count_;
+      });
+    const auto slots_valid = std::all_of(
+      snapshot.slots_, snapshot.slots_ + snapshot.slot_count_,
+      [&snapshot](const snapshot_slot_t slot) {
+        return slot.lookup_ < snapshot.size_;
+      });
+    // lookups end at an unused entry so the index must have one
+    const auto index_terminated = std::any_of(
+      snapshot.index_, snapshot.index_ + header.index_capacity_,
+      [](const entry_t& entry) { return entry.handle_.id_ == -1; });
+    if (!dense_ids_valid || !slots_valid || !index_terminated) {
+      return {};
+    }
+    return snapshot;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  std::optional<typed_handle_t<Tag>> packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::find(const Key& key) const
+  {
+    if (index_ == nullptr) {
+      return {};
+    }
+    for (auto position = snapshot_index_position(hash_(key), index_shift_);
+         index_[position].handle_.id_ != -1;
+         position = (position + 1) & index_mask_) {
+      if (key_equal_(index_[position].key_, key)) {
+        return index_[position].handle_;
+      }
+    }
+    return {};
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  bool packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::has(
+    const Key& key) const
+  {
+    return find(key).has_value();
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  bool packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::has(
+    const typed_handle_t<Tag> handle) const
+  {
+    return handle.id_ >= 0 && handle.id_ < slot_count_
+        && slots_[handle.id_].lookup_ >= 0
+        && slots_[handle.id_].gen_ == handle.gen_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  typed_handle_t<Tag> packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag,
+    Access>::handle_from_index(const int32_t index) const
+  {
+    typed_handle_t<Tag> handle;
+    if (index >= 0 && index < size_) {
+      handle.id_ = dense_ids_[index];
+      handle.gen_ = slots_[handle.id_].gen_;
+    }
+    return handle;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  std::optional<int32_t> packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag,
+    Access>::index_from_handle(const typed_handle_t<Tag> handle) const
+  {
+    if (!has(handle)) {
+      return {};
+    }
+    return slots_[handle.id_].lookup_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  int32_t packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::size()
+    const
+  {
+    return size_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  bool packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::empty()
+    const
+  {
+    return size_ == 0;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  template<typename Fn>
+  void packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::call(
+    const typed_handle_t<Tag> handle, Fn&& fn)
+  {
+    if (const auto index = index_from_handle(handle); index.has_value()) {
+      fn(values_[*index]);
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  template<typename Fn>
+  void packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::call(
+    const typed_handle_t<Tag> handle, Fn&& fn) const
+  {
+    if (const auto index = index_from_handle(handle); index.has_value()) {
+      fn(std::as_const(values_[*index]));
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  template<typename Fn>
+  void packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::call(
+    const Key& key, Fn&& fn) const
+  {
+    if (const auto handle = find(key); handle.has_value()) {
+      call(*handle, std::forward<Fn>(fn));
+    }
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  template<typename Fn>
+  decltype(auto) packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::call_return(
+    const typed_handle_t<Tag> handle, Fn&& fn) const
+  {
+    using result_t = decltype(fn(std::as_const(*values_)));
+    if (const auto index = index_from_handle(handle); index.has_value()) {
+      return std::optional<result_t>(fn(std::as_const(values_[*index])));
+    }
+    return std::optional<result_t>{};
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  template<typename Fn>
+  decltype(auto) packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag,
+    Access>::call_return(const Key& key, Fn&& fn) const
+  {
+    using result_t = decltype(fn(std::as_const(*values_)));
+    if (const auto handle = find(key); handle.has_value()) {
+      return call_return(*handle, std::forward<Fn>(fn));
+    }
+    return std::optional<result_t>{};
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  auto packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::vbegin()
+    -> value_iterator
+  {
+    return values_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  auto packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::vbegin()
+    const -> const_value_iterator
+  {
+    return values_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  auto packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::vcbegin()
+    const -> const_value_iterator
+  {
+    return values_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  auto packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::vend()
+    -> value_iterator
+  {
+    return values_ + size_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  auto packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::vend()
+    const -> const_value_iterator
+  {
+    return values_ + size_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  auto packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::vcend()
+    const -> const_value_iterator
+  {
+    return values_ + size_;
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  auto packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::value_iteration()
+    -> value_iterator_wrapper_t<value_iterator>
+  {
+    return {vbegin(), vend()};
+  }
+
+  template<
+    typename Key, typename Value, typename Hash, typename KeyEqual,
+    typename Tag, snapshot_access_e Access>
+  auto packed_hashtable_snapshot_t<
+    Key, Value, Hash, KeyEqual, Tag, Access>::value_iteration() const
+    -> value_iterator_wrapper_t<const_value_iterator>
+  {
+    return {vbegin(), vend()};
+  }
+#endif
+} // namespace thh
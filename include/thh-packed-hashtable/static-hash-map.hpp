@@ -0,0 +1,237 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace thh
+{
+  // returns the smallest power of two greater than or equal to value
+  constexpr std::size_t ceil_pow2(const std::size_t value)
+  {
+    std::size_t pow2 = 1;
+    while (pow2 < value) {
+      pow2 <<= 1;
+    }
+    return pow2;
+  }
+
+  // hash map with a capacity fixed at compile time, all memory is part of the
+  // object (no allocations are ever made)
+  // elements are stored in an array of Capacity nodes and an open addressing
+  // index (linear probing, at most half full) maps keys to nodes, erase shifts
+  // later entries in the probe sequence back so no tombstones are left
+  // note: the interface is the subset of std::unordered_map used by
+  // base_packed_hashtable_t so it can be used in its place
+  // note: insert fails (returns end() and false) when the map is full
+  // note: nodes are never moved (pointers to keys and values remain stable
+  // and iterators are only invalidated when the element is erased), iteration
+  // order is node order
+  // note: Allocator is accepted for compatibility and is never used
+  template<
+    typename Key, typename Mapped, typename Hash = std::hash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Allocator = std::allocator<std::pair<const Key, Mapped>>,
+    int32_t Capacity = 1024>
+  class static_hash_map_t
+  {
+    static_assert(Capacity > 0, "Capacity must be positive");
+
+  public:
+    using key_type = Key;
+    using mapped_type = Mapped;
+    using value_type = std::pair<const Key, Mapped>;
+    using size_type = std::size_t;
+    using allocator_type = Allocator;
+
+  private:
+    // number of positions in the index (a power of two at least twice the
+    // capacity to keep probe sequences short)
+    static constexpr std::size_t index_capacity_v =
+      ceil_pow2(std::size_t(Capacity) * 2);
+    // shift to take the top bits of a Fibonacci hash as the index position
+    static constexpr int index_shift_v = [] {
+      int bits = 0;
+      while ((std::size_t(1) << bits) < index_capacity_v) {
+        ++bits;
+      }
+      return std::numeric_limits<uint64_t>::digits - bits;
+    }();
+
+    template<bool Const>
+    class iterator_t
+    {
+      template<bool>
+      friend class iterator_t;
+      friend class static_hash_map_t;
+
+      using map_t =
+        std::conditional_t<Const, const static_hash_map_t, static_hash_map_t>;
+
+      map_t* map_ = nullptr;
+      int32_t node_ = Capacity;
+
+      iterator_t(map_t* map, const int32_t node) : map_(map), node_(node) {}
+
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = static_hash_map_t::value_type;
+      using difference_type = std::ptrdiff_t;
+      using pointer =
+        std::conditional_t<Const, const value_type*, value_type*>;
+      using reference =
+        std::conditional_t<Const, const value_type&, value_type&>;
+
+      iterator_t() = default;
+
+      // support conversion from iterator to const_iterator
+      template<
+        bool OtherConst, typename = std::enable_if_t<Const && !OtherConst>>
+      iterator_t(const iterator_t<OtherConst>& other)
+        : map_(other.map_), node_(other.node_)
+      {
+      }
+
+      [[nodiscard]] reference operator*() const { return *map_->node(node_); }
+      [[nodiscard]] pointer operator->() const { return map_->node(node_); }
+
+      iterator_t& operator++()
+      {
+        node_ = map_->next_node(node_ + 1);
+        return *this;
+      }
+      iterator_t operator++(int)
+      {
+        auto it = *this;
+        node_ = map_->next_node(node_ + 1);
+        return it;
+      }
+
+      [[nodiscard]] bool operator==(const iterator_t& rhs) const
+      {
+        return node_ == rhs.node_;
+      }
+      [[nodiscard]] bool operator!=(const iterator_t& rhs) const
+      {
+        return node_ != rhs.node_;
+      }
+    };
+
+  public:
+    using iterator = iterator_t<false>;
+    using const_iterator = iterator_t<true>;
+
+  private:
+    // uninitialized storage for the nodes (node i is live if occupied_[i])
+    alignas(value_type)
+      std::array<std::byte, sizeof(value_type) * Capacity> nodes_;
+    // hash of the key of each node (so lookups and erase do not rehash keys)
+    std::array<std::size_t, Capacity> hashes_;
+    std::array<bool, Capacity> occupied_{};
+    // stack of erased nodes available for reuse
+    std::array<int32_t, Capacity> free_nodes_;
+    int32_t free_count_ = 0;
+    // one past the highest node ever used (nodes after it are free)
+    int32_t used_nodes_ = 0;
+    // node for each index position (-1 if the position is empty)
+    std::array<int32_t, index_capacity_v> index_;
+    size_type size_ = 0;
+    Hash hash_;
+    KeyEqual key_equal_;
+
+    // returns the node with the id specified
+    value_type* node(int32_t id);
+    // returns the node with the id specified (const overload)
+    const value_type* node(int32_t id) const;
+    // returns the first live node at or after id (Capacity if there is none)
+    int32_t next_node(int32_t id) const;
+    // returns the home index position for a hash
+    static std::size_t home(std::size_t hash);
+    // returns the index position of the node with an equivalent key or the
+    // empty position ending the probe sequence if there is not one
+    std::size_t find_position(const Key& key, std::size_t hash) const;
+    // adds a node for value (the key must not already exist)
+    template<typename P>
+    std::pair<iterator, bool> insert_internal(P&& value);
+    // copies (or moves) all elements from other (the map must be empty)
+    template<typename Map>
+    void assign(Map&& other);
+
+  public:
+    static_hash_map_t();
+    explicit static_hash_map_t(const Allocator& allocator);
+    static_hash_map_t(const static_hash_map_t& other);
+    static_hash_map_t(static_hash_map_t&& other) noexcept(
+      std::is_nothrow_move_constructible_v<value_type>);
+    static_hash_map_t& operator=(const static_hash_map_t& other);
+    static_hash_map_t& operator=(static_hash_map_t&& other) noexcept(
+      std::is_nothrow_move_constructible_v<value_type>);
+    ~static_hash_map_t();
+
+    [[nodiscard]] allocator_type get_allocator() const;
+
+    // inserts value if an element with an equivalent key does not exist
+    std::pair<iterator, bool> insert(const value_type& value);
+    // inserts value if an element with an equivalent key does not exist
+    std::pair<iterator, bool> insert(value_type&& value);
+    // removes the element at position, returns the following element
+    iterator erase(const_iterator position);
+    // removes the element with an equivalent key (if one exists), returns the
+    // number of elements removed
+    size_type erase(const Key& key);
+    [[nodiscard]] iterator find(const Key& key);
+    [[nodiscard]] const_iterator find(const Key& key) const;
+    void clear();
+    // does nothing (the capacity is fixed)
+    void reserve(size_type count);
+    // does nothing (the capacity is fixed)
+    void rehash(size_type count);
+    [[nodiscard]] size_type size() const;
+    [[nodiscard]] bool empty() const;
+    // returns the maximum number of elements (Capacity)
+    [[nodiscard]] static constexpr size_type max_size() { return Capacity; }
+    // returns the number of index positions
+    [[nodiscard]] static constexpr size_type bucket_count()
+    {
+      return index_capacity_v;
+    }
+    // returns the maximum fraction of index positions in use
+    [[nodiscard]] static constexpr float max_load_factor()
+    {
+      return float(Capacity) / float(index_capacity_v);
+    }
+    [[nodiscard]] auto begin() -> iterator;
+    [[nodiscard]] auto begin() const -> const_iterator;
+    [[nodiscard]] auto cbegin() const -> const_iterator;
+    [[nodiscard]] auto end() -> iterator;
+    [[nodiscard]] auto end() const -> const_iterator;
+    [[nodiscard]] auto cend() const -> const_iterator;
+    // returns the id of the node holding the element at position (the id is
+    // stable until the element is erased, see node_value)
+    [[nodiscard]] static int32_t node_id(const_iterator position);
+    // returns the element held by the node with the id specified (the node
+    // must hold an element)
+    [[nodiscard]] const value_type& node_value(int32_t id) const;
+  };
+
+  // if the map has a capacity fixed at compile time and never allocates (see
+  // static_hash_map_t)
+  template<typename Map>
+  inline constexpr bool is_static_hash_map_v = false;
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  inline constexpr bool is_static_hash_map_v<
+    static_hash_map_t<Key, Mapped, Hash, KeyEqual, Allocator, Capacity>> =
+    true;
+} // namespace thh
+
+#include "static-hash-map.inl"
@@ -0,0 +1,437 @@
+namespace thh
+{
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::node(const int32_t id)
+    -> value_type*
+  {
+    return std::launder(
+      reinterpret_cast<value_type*>(nodes_.data() + sizeof(value_type) * id));
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::node(
+    const int32_t id) const -> const value_type*
+  {
+    return std::launder(reinterpret_cast<const value_type*>(
+      nodes_.data() + sizeof(value_type) * id));
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  int32_t static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::next_node(
+    int32_t id) const
+  {
+    for (; id < used_nodes_; ++id) {
+      if (occupied_[id]) {
+        return id;
+      }
+    }
+    return Capacity;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  std::size_t static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::home(
+    const std::size_t hash)
+  {
+    // Fibonacci hashing (the top bits of the product are well mixed even if
+    // the hash is not, e.g. std::hash for integers)
+    return static_cast<std::size_t>(
+      (static_cast<uint64_t>(hash) * 0x9e3779b97f4a7c15ULL) >> index_shift_v);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  std::size_t static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::find_position(
+    const Key& key, const std::size_t hash) const
+  {
+    // the index is never more than half full so the probe always ends
+    auto position = home(hash);
+    for (int32_t id = index_[position]; id != -1; id = index_[position]) {
+      if (hashes_[id] == hash && key_equal_(node(id)->first, key)) {
+        return position;
+      }
+      position = (position + 1) & (index_capacity_v - 1);
+    }
+    return position;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  template<typename P>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::insert_internal(
+    P&& value) -> std::pair<iterator, bool>
+  {
+    const auto hash = hash_(value.first);
+    const auto position = find_position(value.first, hash);
+    if (index_[position] != -1) {
+      return {iterator(this, index_[position]), false};
+    }
+    if (size_ == Capacity) {
+      return {end(), false};
+    }
+    const auto id =
+      free_count_ > 0 ? free_nodes_[--free_count_] : used_nodes_++;
+    ::new (static_cast<void*>(node(id))) value_type(std::forward<P>(value));
+    hashes_[id] = hash;
+    occupied_[id] = true;
+    index_[position] = id;
+    ++size_;
+    return {iterator(this, id), true};
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  template<typename Map>
+  void static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::assign(Map&& other)
+  {
+    // nodes keep their ids so the index and free nodes are copied as is
+    for (int32_t id = 0; id < other.used_nodes_; ++id) {
+      if (other.occupied_[id]) {
+        if constexpr (std::is_rvalue_reference_v<Map&&>) {
+          ::new (static_cast<void*>(node(id)))
+            value_type(std::move(*other.node(id)));
+        } else {
+          ::new (static_cast<void*>(node(id))) value_type(*other.node(id));
+        }
+      }
+    }
+    hashes_ = other.hashes_;
+    occupied_ = other.occupied_;
+    free_nodes_ = other.free_nodes_;
+    free_count_ = other.free_count_;
+    used_nodes_ = other.used_nodes_;
+    index_ = other.index_;
+    size_ = other.size_;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::static_hash_map_t()
+  {
+    index_.fill(-1);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  static_hash_map_t<Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::
+    static_hash_map_t([[maybe_unused]] const Allocator& allocator)
+    : static_hash_map_t()
+  {
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  static_hash_map_t<Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::
+    static_hash_map_t(const static_hash_map_t& other)
+    : hash_(other.hash_), key_equal_(other.key_equal_)
+  {
+    assign(other);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  static_hash_map_t<Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::
+    static_hash_map_t(static_hash_map_t&& other) noexcept(
+      std::is_nothrow_move_constructible_v<value_type>)
+    : hash_(other.hash_), key_equal_(other.key_equal_)
+  {
+    assign(std::move(other));
+    other.clear();
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::
+    operator=(const static_hash_map_t& other) -> static_hash_map_t&
+  {
+    if (this != &other) {
+      clear();
+      hash_ = other.hash_;
+      key_equal_ = other.key_equal_;
+      assign(other);
+    }
+    return *this;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::
+    operator=(static_hash_map_t&& other) noexcept(
+      std::is_nothrow_move_constructible_v<value_type>) -> static_hash_map_t&
+  {
+    if (this != &other) {
+      clear();
+      hash_ = other.hash_;
+      key_equal_ = other.key_equal_;
+      assign(std::move(other));
+      other.clear();
+    }
+    return *this;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::~static_hash_map_t()
+  {
+    clear();
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::get_allocator() const
+    -> allocator_type
+  {
+    return allocator_type();
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::insert(
+    const value_type& value) -> std::pair<iterator, bool>
+  {
+    return insert_internal(value);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::insert(
+    value_type&& value) -> std::pair<iterator, bool>
+  {
+    return insert_internal(std::move(value));
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::erase(
+    const const_iterator position) -> iterator
+  {
+    const auto id = position.node_;
+    constexpr auto mask = index_capacity_v - 1;
+    auto hole = home(hashes_[id]);
+    while (index_[hole] != id) {
+      hole = (hole + 1) & mask;
+    }
+    // shift back later entries in the probe sequence that may move into the
+    // hole (their home position is not between the hole and themselves)
+    for (auto next = (hole + 1) & mask; index_[next] != -1;
+         next = (next + 1) & mask) {
+      const auto distance = (next - home(hashes_[index_[next]])) & mask;
+      if (distance >= ((next - hole) & mask)) {
+        index_[hole] = index_[next];
+        hole = next;
+      }
+    }
+    index_[hole] = -1;
+    std::destroy_at(node(id));
+    occupied_[id] = false;
+    free_nodes_[free_count_++] = id;
+    --size_;
+    return iterator(this, next_node(id + 1));
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::erase(const Key& key)
+    -> size_type
+  {
+    if (const auto position = find(key); position != end()) {
+      erase(position);
+      return 1;
+    }
+    return 0;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::find(const Key& key)
+    -> iterator
+  {
+    const auto id = index_[find_position(key, hash_(key))];
+    return iterator(this, id == -1 ? Capacity : id);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::find(
+    const Key& key) const -> const_iterator
+  {
+    const auto id = index_[find_position(key, hash_(key))];
+    return const_iterator(this, id == -1 ? Capacity : id);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  void static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::clear()
+  {
+    if constexpr (!std::is_trivially_destructible_v<value_type>) {
+      for (int32_t id = 0; id < used_nodes_; ++id) {
+        if (occupied_[id]) {
+          std::destroy_at(node(id));
+        }
+      }
+    }
+    std::fill(occupied_.begin(), occupied_.begin() + used_nodes_, false);
+    free_count_ = 0;
+    used_nodes_ = 0;
+    index_.fill(-1);
+    size_ = 0;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  void static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::reserve(
+    [[maybe_unused]] const size_type count)
+  {
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  void static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::rehash(
+    [[maybe_unused]] const size_type count)
+  {
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::size() const
+    -> size_type
+  {
+    return size_;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  bool static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::empty() const
+  {
+    return size_ == 0;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::begin() -> iterator
+  {
+    return iterator(this, next_node(0));
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::begin() const
+    -> const_iterator
+  {
+    return const_iterator(this, next_node(0));
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::cbegin() const
+    -> const_iterator
+  {
+    return const_iterator(this, next_node(0));
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::end() -> iterator
+  {
+    return iterator(this, Capacity);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::end() const
+    -> const_iterator
+  {
+    return const_iterator(this, Capacity);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::cend() const
+    -> const_iterator
+  {
+    return const_iterator(this, Capacity);
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  int32_t static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::node_id(
+    const const_iterator position)
+  {
+    return position.node_;
+  }
+
+  template<
+    typename Key, typename Mapped, typename Hash, typename KeyEqual,
+    typename Allocator, int32_t Capacity>
+  auto static_hash_map_t<
+    Key, Mapped, Hash, KeyEqual, Allocator, Capacity>::node_value(
+    const int32_t id) const -> const value_type&
+  {
+    assert(occupied_[id]);
+    return *node(id);
+  }
+} // namespace thh
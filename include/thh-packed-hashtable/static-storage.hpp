@@ -0,0 +1,135 @@
+#pragma once
+
+#include "value-storage.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <new>
+
+namespace thh
+{
+  // value storage with a capacity fixed at compile time, the values, handle
+  // slots and dense slot ids are all part of the object (no allocations are
+  // ever made)
+  // note: the interface matches handle_vector_t so it can be used in its place
+  // note: add must not be called when the storage is full (see
+  // static_policy_t, the key index rejects new elements first)
+  // note: slot ids not in use are kept in dense order after the live elements
+  // (the slot id of a removed element becomes the next one reused)
+  // note: values of empty types still use one byte each (a single shared
+  // instance would need no storage, see empty_value_storage_t)
+  // note: Allocator is accepted for compatibility and is never used
+  template<
+    typename Value, typename Tag, typename Allocator = std::allocator<Value>,
+    int32_t Capacity = 1024>
+  class static_storage_t
+  {
+    static_assert(Capacity > 0, "Capacity must be positive");
+
+    // internal slot for each handle (lookup_ is -1 when the slot is free)
+    struct slot_t
+    {
+      int32_t lookup_ = -1;
+      int32_t gen_ = 0;
+    };
+
+    // uninitialized storage for the values (the first size_ are live)
+    alignas(Value) std::array<std::byte, sizeof(Value) * Capacity> storage_;
+    // sparse handle slots (indexed by handle id)
+    std::array<slot_t, Capacity> slots_{};
+    // dense slot ids (indexed by element position), ids after size_ are free
+    std::array<int32_t, Capacity> dense_ids_;
+    int32_t size_ = 0;
+
+    // returns the first value
+    Value* values();
+    // returns the first value (const overload)
+    const Value* values() const;
+    // moves the values in [begin, end) to match dense_ids_ after the ids
+    // were reordered (the slots still hold the previous positions)
+    // note: each value is relocated at most once (cycles are followed using a
+    // single temporary)
+    void reorder(int32_t begin, int32_t end);
+    // copies (or moves) all elements from other (the storage must be empty)
+    template<typename Storage>
+    void assign(Storage&& other);
+
+  public:
+    using handle_type = typed_handle_t<Tag>;
+    using size_type = int32_t;
+    using iterator = Value*;
+    using const_iterator = const Value*;
+
+    static_storage_t();
+    explicit static_storage_t(const Allocator& allocator);
+    static_storage_t(const static_storage_t& other);
+    static_storage_t(static_storage_t&& other) noexcept(
+      std::is_nothrow_move_constructible_v<Value>);
+    static_storage_t& operator=(const static_storage_t& other);
+    static_storage_t& operator=(static_storage_t&& other) noexcept(
+      std::is_nothrow_move_constructible_v<Value>);
+    ~static_storage_t();
+
+    template<typename... Args>
+    typed_handle_t<Tag> add(Args&&... args);
+    bool remove(typed_handle_t<Tag> handle);
+    void clear();
+    // does nothing (the capacity is fixed)
+    void reserve(int32_t capacity);
+    // does nothing (the capacity is fixed)
+    void shrink_to_fit();
+    // returns 0 (the capacity is fixed)
+    [[nodiscard]] std::size_t reclaimable_bytes() const;
+    [[nodiscard]] bool has(typed_handle_t<Tag> handle) const;
+    [[nodiscard]] int32_t size() const;
+    [[nodiscard]] static constexpr int32_t capacity() { return Capacity; }
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] typed_handle_t<Tag> handle_from_index(int32_t index) const;
+    [[nodiscard]] std::optional<int32_t> index_from_handle(
+      typed_handle_t<Tag> handle) const;
+    template<typename Fn>
+    void call(typed_handle_t<Tag> handle, Fn&& fn);
+    template<typename Fn>
+    void call(typed_handle_t<Tag> handle, Fn&& fn) const;
+    template<typename Fn>
+    decltype(auto) call_return(typed_handle_t<Tag> handle, Fn&& fn);
+    template<typename Fn>
+    decltype(auto) call_return(typed_handle_t<Tag> handle, Fn&& fn) const;
+    // sorts the values in the specified range (compare is passed indices)
+    template<typename Compare>
+    void sort(int32_t begin, int32_t end, Compare&& compare);
+    // partitions the values (predicate is passed an index)
+    // returns index of the first element for the second group
+    template<typename Predicate>
+    int32_t partition(Predicate&& predicate);
+    // reorders the values so position begin + i holds the value previously at
+    // order[i]
+    template<typename OrderAllocator>
+    void reorder(
+      int32_t begin, const std::vector<int32_t, OrderAllocator>& order);
+    // reorders the values to the handle ids written by fill to the range of
+    // int32_t it is passed (the ids of every value in the new order), the ids
+    // are written in place of the dense ids so no memory is allocated
+    // note: fill may use the range as scratch space before writing the ids
+    template<typename Fill>
+    void reorder_ids(Fill&& fill);
+    [[nodiscard]] auto begin() -> iterator;
+    [[nodiscard]] auto begin() const -> const_iterator;
+    [[nodiscard]] auto cbegin() const -> const_iterator;
+    [[nodiscard]] auto end() -> iterator;
+    [[nodiscard]] auto end() const -> const_iterator;
+    [[nodiscard]] auto cend() const -> const_iterator;
+  };
+
+  // if the value storage has a capacity fixed at compile time and never
+  // allocates (see static_storage_t)
+  template<typename Storage>
+  inline constexpr bool is_static_storage_v = false;
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  inline constexpr bool
+    is_static_storage_v<static_storage_t<Value, Tag, Allocator, Capacity>> =
+      true;
+} // namespace thh
+
+#include "static-storage.inl"
@@ -0,0 +1,372 @@
+namespace thh
+{
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  Value* static_storage_t<Value, Tag, Allocator, Capacity>::values()
+  {
+    return std::launder(reinterpret_cast<Value*>(storage_.data()));
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  const Value* static_storage_t<Value, Tag, Allocator, Capacity>::values()
+    const
+  {
+    return std::launder(reinterpret_cast<const Value*>(storage_.data()));
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  void static_storage_t<Value, Tag, Allocator, Capacity>::reorder(
+    const int32_t begin, const int32_t end)
+  {
+    alignas(Value) std::byte temp[sizeof(Value)];
+    auto* const held = reinterpret_cast<Value*>(temp);
+    for (int32_t start = begin; start < end; ++start) {
+      if (slots_[dense_ids_[start]].lookup_ == start) {
+        continue;
+      }
+      // lift out the value at the start of the cycle and fill the hole it
+      // leaves with the value now belonging there (found through its slot,
+      // which is updated as the value is placed)
+      relocate_at(held, values() + start);
+      int32_t hole = start;
+      while (true) {
+        auto& slot = slots_[dense_ids_[hole]];
+        const auto next = std::exchange(slot.lookup_, hole);
+        if (next == start) {
+          relocate_at(values() + hole, std::launder(held));
+          break;
+        }
+        relocate_at(values() + hole, values() + next);
+        hole = next;
+      }
+    }
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  template<typename Storage>
+  void static_storage_t<Value, Tag, Allocator, Capacity>::assign(
+    Storage&& other)
+  {
+    for (int32_t index = 0; index < other.size_; ++index) {
+      if constexpr (std::is_rvalue_reference_v<Storage&&>) {
+        ::new (static_cast<void*>(values() + index))
+          Value(std::move(other.values()[index]));
+      } else {
+        ::new (static_cast<void*>(values() + index))
+          Value(other.values()[index]);
+      }
+    }
+    slots_ = other.slots_;
+    dense_ids_ = other.dense_ids_;
+    size_ = other.size_;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  static_storage_t<Value, Tag, Allocator, Capacity>::static_storage_t()
+  {
+    std::iota(dense_ids_.begin(), dense_ids_.end(), 0);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  static_storage_t<Value, Tag, Allocator, Capacity>::static_storage_t(
+    [[maybe_unused]] const Allocator& allocator)
+    : static_storage_t()
+  {
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  static_storage_t<Value, Tag, Allocator, Capacity>::static_storage_t(
+    const static_storage_t& other)
+  {
+    assign(other);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  static_storage_t<Value, Tag, Allocator, Capacity>::static_storage_t(
+    static_storage_t&& other) noexcept(
+    std::is_nothrow_move_constructible_v<Value>)
+  {
+    assign(std::move(other));
+    other.clear();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  auto static_storage_t<Value, Tag, Allocator, Capacity>::operator=(
+    const static_storage_t& other) -> static_storage_t&
+  {
+    if (this != &other) {
+      clear();
+      assign(other);
+    }
+    return *this;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  auto static_storage_t<Value, Tag, Allocator, Capacity>::operator=(
+    static_storage_t&& other) noexcept(
+    std::is_nothrow_move_constructible_v<Value>) -> static_storage_t&
+  {
+    if (this != &other) {
+      clear();
+      assign(std::move(other));
+      other.clear();
+    }
+    return *this;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  static_storage_t<Value, Tag, Allocator, Capacity>::~static_storage_t()
+  {
+    std::destroy_n(values(), size_);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  template<typename... Args>
+  typed_handle_t<Tag> static_storage_t<Value, Tag, Allocator, Capacity>::add(
+    Args&&... args)
+  {
+    assert(size_ < Capacity);
+    const auto id = dense_ids_[size_];
+    ::new (static_cast<void*>(values() + size_))
+      Value(std::forward<Args>(args)...);
+    auto& slot = slots_[id];
+    slot.lookup_ = size_++;
+    typed_handle_t<Tag> handle;
+    handle.id_ = id;
+    handle.gen_ = slot.gen_;
+    return handle;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  bool static_storage_t<Value, Tag, Allocator, Capacity>::remove(
+    const typed_handle_t<Tag> handle)
+  {
+    if (!has(handle)) {
+      return false;
+    }
+    auto& slot = slots_[handle.id_];
+    const auto index = slot.lookup_;
+    const auto last = --size_;
+    std::destroy_at(values() + index);
+    if (index != last) {
+      relocate_at(values() + index, values() + last);
+      std::swap(dense_ids_[index], dense_ids_[last]);
+      slots_[dense_ids_[index]].lookup_ = index;
+    }
+    slot.lookup_ = -1;
+    slot.gen_++;
+    return true;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  void static_storage_t<Value, Tag, Allocator, Capacity>::clear()
+  {
+    std::destroy_n(values(), size_);
+    for (int32_t index = 0; index < size_; ++index) {
+      auto& slot = slots_[dense_ids_[index]];
+      slot.lookup_ = -1;
+      slot.gen_++;
+    }
+    size_ = 0;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  void static_storage_t<Value, Tag, Allocator, Capacity>::reserve(
+    [[maybe_unused]] const int32_t capacity)
+  {
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  void static_storage_t<Value, Tag, Allocator, Capacity>::shrink_to_fit()
+  {
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  std::size_t static_storage_t<
+    Value, Tag, Allocator, Capacity>::reclaimable_bytes() const
+  {
+    return 0;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  bool static_storage_t<Value, Tag, Allocator, Capacity>::has(
+    const typed_handle_t<Tag> handle) const
+  {
+    return handle.id_ >= 0 && handle.id_ < Capacity
+        && slots_[handle.id_].lookup_ >= 0
+        && slots_[handle.id_].gen_ == handle.gen_;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  int32_t static_storage_t<Value, Tag, Allocator, Capacity>::size() const
+  {
+    return size_;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  bool static_storage_t<Value, Tag, Allocator, Capacity>::empty() const
+  {
+    return size_ == 0;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  typed_handle_t<Tag> static_storage_t<
+    Value, Tag, Allocator, Capacity>::handle_from_index(const int32_t index)
+    const
+  {
+    typed_handle_t<Tag> handle;
+    if (index >= 0 && index < size_) {
+      handle.id_ = dense_ids_[index];
+      handle.gen_ = slots_[handle.id_].gen_;
+    }
+    return handle;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  std::optional<int32_t> static_storage_t<
+    Value, Tag, Allocator,
+    Capacity>::index_from_handle(const typed_handle_t<Tag> handle) const
+  {
+    if (!has(handle)) {
+      return {};
+    }
+    return slots_[handle.id_].lookup_;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  template<typename Fn>
+  void static_storage_t<Value, Tag, Allocator, Capacity>::call(
+    const typed_handle_t<Tag> handle, Fn&& fn)
+  {
+    if (const auto index = index_from_handle(handle); index.has_value()) {
+      fn(values()[*index]);
+    }
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  template<typename Fn>
+  void static_storage_t<Value, Tag, Allocator, Capacity>::call(
+    const typed_handle_t<Tag> handle, Fn&& fn) const
+  {
+    if (const auto index = index_from_handle(handle); index.has_value()) {
+      fn(values()[*index]);
+    }
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  template<typename Fn>
+  decltype(auto) static_storage_t<Value, Tag, Allocator, Capacity>::call_return(
+    const typed_handle_t<Tag> handle, Fn&& fn)
+  {
+    using result_t = decltype(fn(*values()));
+    if (const auto index = index_from_handle(handle); index.has_value()) {
+      return std::optional<result_t>(fn(values()[*index]));
+    }
+    return std::optional<result_t>{};
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  template<typename Fn>
+  decltype(auto) static_storage_t<Value, Tag, Allocator, Capacity>::call_return(
+    const typed_handle_t<Tag> handle, Fn&& fn) const
+  {
+    using result_t = decltype(fn(*values()));
+    if (const auto index = index_from_handle(handle); index.has_value()) {
+      return std::optional<result_t>(fn(values()[*index]));
+    }
+    return std::optional<result_t>{};
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  template<typename Compare>
+  void static_storage_t<Value, Tag, Allocator, Capacity>::sort(
+    const int32_t begin, const int32_t end, Compare&& compare)
+  {
+    // sort the slot ids in place (each id still knows the position of its
+    // value) instead of an order buffer so no memory is allocated
+    std::sort(
+      dense_ids_.begin() + begin, dense_ids_.begin() + end,
+      [this, &compare](const int32_t lhs, const int32_t rhs) {
+        return compare(slots_[lhs].lookup_, slots_[rhs].lookup_);
+      });
+    reorder(begin, end);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  template<typename Predicate>
+  int32_t static_storage_t<Value, Tag, Allocator, Capacity>::partition(
+    Predicate&& predicate)
+  {
+    const auto second = std::partition(
+      dense_ids_.begin(), dense_ids_.begin() + size_,
+      [this, &predicate](const int32_t id) {
+        return predicate(slots_[id].lookup_);
+      });
+    reorder(0, size_);
+    return static_cast<int32_t>(std::distance(dense_ids_.begin(), second));
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  template<typename OrderAllocator>
+  void static_storage_t<Value, Tag, Allocator, Capacity>::reorder(
+    const int32_t begin,
+    const std::vector<int32_t, OrderAllocator>& order)
+  {
+    const auto end = begin + static_cast<int32_t>(order.size());
+    auto ids = std::vector<int32_t, OrderAllocator>(
+      order.size(), 0, order.get_allocator());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      ids[i] = dense_ids_[order[i]];
+    }
+    std::copy(ids.begin(), ids.end(), dense_ids_.begin() + begin);
+    reorder(begin, end);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  template<typename Fill>
+  void static_storage_t<Value, Tag, Allocator, Capacity>::reorder_ids(
+    Fill&& fill)
+  {
+    fill(dense_ids_.data(), dense_ids_.data() + size_);
+    reorder(0, size_);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  auto static_storage_t<Value, Tag, Allocator, Capacity>::begin() -> iterator
+  {
+    return values();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  auto static_storage_t<Value, Tag, Allocator, Capacity>::begin() const
+    -> const_iterator
+  {
+    return values();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  auto static_storage_t<Value, Tag, Allocator, Capacity>::cbegin() const
+    -> const_iterator
+  {
+    return values();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  auto static_storage_t<Value, Tag, Allocator, Capacity>::end() -> iterator
+  {
+    return values() + size_;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  auto static_storage_t<Value, Tag, Allocator, Capacity>::end() const
+    -> const_iterator
+  {
+    return values() + size_;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, int32_t Capacity>
+  auto static_storage_t<Value, Tag, Allocator, Capacity>::cend() const
+    -> const_iterator
+  {
+    return values() + size_;
+  }
+} // namespace thh
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace thh
+{
+  // hierarchical timing wheel scheduling handles to expire at a deadline (in
+  // caller defined ticks), each level has 64 slots covering 64 times the span
+  // of the level below (4 levels cover 2^24 ticks, later deadlines wait in an
+  // overflow list), entries are moved down a level when the wheel reaches
+  // their slot so advancing does work proportional to the entries expired
+  // (plus one step per occupied slot)
+  // note: each handle has at most one deadline, scheduling it again (or
+  // cancelling it) leaves the earlier entry in the wheel to be discarded when
+  // it is reached
+  // note: handles are indexed by id, a handle that has been removed (and its
+  // id reused) is still reported, the caller checks the handle is valid
+  template<typename Handle, typename Allocator = std::allocator<Handle>>
+  class timing_wheel_t
+  {
+    struct entry_t
+    {
+      Handle handle_;
+      // no deadline if 0 (see scheduled_)
+      uint64_t deadline_ = 0;
+    };
+
+    using entry_allocator_type =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<entry_t>;
+    using entries_t = std::vector<entry_t, entry_allocator_type>;
+    using slot_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<entries_t>;
+
+    static constexpr int32_t slot_bits_v = 6;
+    static constexpr int32_t slot_count_v = 1 << slot_bits_v;
+    static constexpr int32_t level_count_v = 4;
+
+    // entries of each slot (level * slot_count_v + slot)
+    std::vector<entries_t, slot_allocator_type> slots_;
+    // entries with a deadline beyond the top level
+    entries_t overflow_;
+    // bit for each slot holding entries (one word per level)
+    std::array<uint64_t, level_count_v> occupied_{};
+    // current deadline of each handle (indexed by handle id)
+    entries_t scheduled_;
+    // next tick to be advanced over (every earlier tick has expired)
+    uint64_t next_ = 1;
+
+    // returns the entries of the slot at the level
+    entries_t& slot(int32_t level, int32_t slot);
+    // adds an entry to the slot for its deadline relative to next_
+    void place(const entry_t& entry);
+    // moves the entries of every level whose slot starts at tick down a level
+    // (or more)
+    void cascade(uint64_t tick);
+    // returns the first tick from next_ where entries expire or move down a
+    // level (max if there are none)
+    [[nodiscard]] uint64_t next_event() const;
+
+  public:
+    timing_wheel_t();
+    explicit timing_wheel_t(const Allocator& allocator);
+
+    // schedules the handle to expire at the deadline (replacing any earlier
+    // deadline), deadlines before now() + 1 expire on the next advance
+    void schedule(Handle handle, uint64_t deadline);
+    // removes the deadline of the handle (if it has one)
+    void cancel(Handle handle);
+    // returns the deadline of the handle (0 if it has none)
+    [[nodiscard]] uint64_t deadline(Handle handle) const;
+    // returns the last tick advanced to
+    [[nodiscard]] uint64_t now() const;
+    // advances the wheel to now, invoking fn with each handle whose deadline
+    // is at or before now (in deadline order)
+    // returns the number of handles expired
+    // note: does nothing if now is before now()
+    template<typename Fn>
+    std::size_t advance(uint64_t now, Fn&& fn);
+    // removes every deadline (the current tick is unchanged)
+    void clear();
+  };
+} // namespace thh
+
+#include "timing-wheel.inl"
@@ -0,0 +1,198 @@
+namespace thh
+{
+  template<typename Handle, typename Allocator>
+  timing_wheel_t<Handle, Allocator>::timing_wheel_t()
+    : timing_wheel_t(Allocator())
+  {
+  }
+
+  template<typename Handle, typename Allocator>
+  timing_wheel_t<Handle, Allocator>::timing_wheel_t(const Allocator& allocator)
+    : slots_(
+      level_count_v * slot_count_v, entries_t(entry_allocator_type(allocator)),
+      slot_allocator_type(allocator)),
+      overflow_(entry_allocator_type(allocator)),
+      scheduled_(entry_allocator_type(allocator))
+  {
+  }
+
+  template<typename Handle, typename Allocator>
+  auto timing_wheel_t<Handle, Allocator>::slot(
+    const int32_t level, const int32_t slot) -> entries_t&
+  {
+    return slots_[static_cast<std::size_t>(level * slot_count_v + slot)];
+  }
+
+  template<typename Handle, typename Allocator>
+  void timing_wheel_t<Handle, Allocator>::place(const entry_t& entry)
+  {
+    // the lowest level whose next span contains the deadline, the deadline
+    // and next_ differ at this level so the slot is reached in the future
+    for (int32_t level = 0; level < level_count_v; ++level) {
+      const auto shift = slot_bits_v * level;
+      if (
+        (entry.deadline_ >> (shift + slot_bits_v))
+        == (next_ >> (shift + slot_bits_v))) {
+        const auto position =
+          static_cast<int32_t>((entry.deadline_ >> shift) & (slot_count_v - 1));
+        slot(level, position).push_back(entry);
+        occupied_[static_cast<std::size_t>(level)] |= uint64_t(1) << position;
+        return;
+      }
+    }
+    overflow_.push_back(entry);
+  }
+
+  template<typename Handle, typename Allocator>
+  void timing_wheel_t<Handle, Allocator>::cascade(const uint64_t tick)
+  {
+    constexpr auto top_shift = slot_bits_v * level_count_v;
+    if ((tick & ((uint64_t(1) << top_shift) - 1)) == 0 && !overflow_.empty()) {
+      auto overflow = std::move(overflow_);
+      overflow_.clear();
+      for (const auto& entry : overflow) {
+        place(entry);
+      }
+    }
+    for (int32_t level = level_count_v - 1; level > 0; --level) {
+      const auto shift = slot_bits_v * level;
+      if ((tick & ((uint64_t(1) << shift) - 1)) != 0) {
+        continue;
+      }
+      const auto position =
+        static_cast<int32_t>((tick >> shift) & (slot_count_v - 1));
+      auto& occupied = occupied_[static_cast<std::size_t>(level)];
+      if ((occupied & (uint64_t(1) << position)) == 0) {
+        continue;
+      }
+      occupied &= ~(uint64_t(1) << position);
+      // entries always move to a lower level (their deadline is in the span
+      // starting at tick)
+      auto& entries = slot(level, position);
+      for (const auto& entry : entries) {
+        place(entry);
+      }
+      entries.clear();
+    }
+  }
+
+  template<typename Handle, typename Allocator>
+  uint64_t timing_wheel_t<Handle, Allocator>::next_event() const
+  {
+    for (int32_t level = 0; level < level_count_v; ++level) {
+      const auto shift = slot_bits_v * level;
+      const auto span_shift = shift + slot_bits_v;
+      // first slot boundary at this level from next_
+      const auto boundary = ((next_ + (uint64_t(1) << shift) - 1) >> shift)
+                         << shift;
+      // occupied slots are in the current span of the level above
+      if ((boundary >> span_shift) != (next_ >> span_shift)) {
+        continue;
+      }
+      const auto first =
+        static_cast<int32_t>((boundary >> shift) & (slot_count_v - 1));
+      auto bits = occupied_[static_cast<std::size_t>(level)] >> first;
+      if (bits == 0) {
+        continue;
+      }
+      auto position = first;
+      for (; (bits & 1) == 0; bits >>= 1) {
+        ++position;
+      }
+      return ((boundary >> span_shift) << span_shift)
+           + (uint64_t(position) << shift);
+    }
+    if (!overflow_.empty()) {
+      constexpr auto top_shift = slot_bits_v * level_count_v;
+      return ((next_ >> top_shift) + 1) << top_shift;
+    }
+    return std::numeric_limits<uint64_t>::max();
+  }
+
+  template<typename Handle, typename Allocator>
+  void timing_wheel_t<Handle, Allocator>::schedule(
+    const Handle handle, const uint64_t deadline)
+  {
+    const auto id = static_cast<std::size_t>(handle.id_);
+    if (id >= scheduled_.size()) {
+      scheduled_.resize(id + 1);
+    }
+    const auto entry = entry_t{handle, deadline < next_ ? next_ : deadline};
+    scheduled_[id] = entry;
+    place(entry);
+  }
+
+  template<typename Handle, typename Allocator>
+  void timing_wheel_t<Handle, Allocator>::cancel(const Handle handle)
+  {
+    const auto id = static_cast<std::size_t>(handle.id_);
+    if (id < scheduled_.size() && scheduled_[id].handle_ == handle) {
+      scheduled_[id].deadline_ = 0;
+    }
+  }
+
+  template<typename Handle, typename Allocator>
+  uint64_t timing_wheel_t<Handle, Allocator>::deadline(
+    const Handle handle) const
+  {
+    const auto id = static_cast<std::size_t>(handle.id_);
+    return id < scheduled_.size() && scheduled_[id].handle_ == handle
+           ? scheduled_[id].deadline_
+           : 0;
+  }
+
+  template<typename Handle, typename Allocator>
+  uint64_t timing_wheel_t<Handle, Allocator>::now() const
+  {
+    return next_ - 1;
+  }
+
+  template<typename Handle, typename Allocator>
+  template<typename Fn>
+  std::size_t timing_wheel_t<Handle, Allocator>::advance(
+    const uint64_t now, Fn&& fn)
+  {
+    std::size_t expired = 0;
+    // jump from event to event, empty slots are never visited
+    for (auto tick = next_event(); tick <= now; tick = next_event()) {
+      next_ = tick;
+      cascade(tick);
+      const auto position = static_cast<int32_t>(tick & (slot_count_v - 1));
+      if ((occupied_[0] & (uint64_t(1) << position)) != 0) {
+        // indexed as fn may schedule a handle (which expires in this pass)
+        auto& entries = slot(0, position);
+        for (std::size_t index = 0; index < entries.size(); ++index) {
+          const auto entry = entries[index];
+          // entries replaced by a later schedule or cancel are discarded
+          auto& scheduled =
+            scheduled_[static_cast<std::size_t>(entry.handle_.id_)];
+          if (
+            scheduled.handle_ == entry.handle_
+            && scheduled.deadline_ == entry.deadline_) {
+            scheduled.deadline_ = 0;
+            fn(entry.handle_);
+            ++expired;
+          }
+        }
+        entries.clear();
+        occupied_[0] &= ~(uint64_t(1) << position);
+      }
+      next_ = tick + 1;
+    }
+    if (now >= next_) {
+      next_ = now + 1;
+    }
+    return expired;
+  }
+
+  template<typename Handle, typename Allocator>
+  void timing_wheel_t<Handle, Allocator>::clear()
+  {
+    for (auto& entries : slots_) {
+      entries.clear();
+    }
+    overflow_.clear();
+    occupied_.fill(0);
+    scheduled_.clear();
+  }
+} // namespace thh
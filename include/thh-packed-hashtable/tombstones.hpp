@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace thh
+{
+  // removal marks used by packed hashtables by default, removals are applied
+  // immediately so no element is ever marked (every function is an empty noop
+  // so the checks compile away)
+  // note: this is the interface base_packed_hashtable_t calls to defer
+  // removals, tombstone_bits_t implements the same functions
+  template<typename Allocator>
+  class no_tombstones_t
+  {
+  public:
+    // if removals are deferred (see deferred_removal_policy_t)
+    static constexpr bool enabled_v = false;
+
+    no_tombstones_t() = default;
+    explicit no_tombstones_t(const Allocator&) {}
+
+    void mark(std::size_t) {}
+    [[nodiscard]] bool test(std::size_t) const { return false; }
+    [[nodiscard]] std::size_t count() const { return 0; }
+    void clear() {}
+    template<typename Fn>
+    void for_each_reverse(Fn&&) const
+    {
+    }
+  };
+
+  // one bit per dense index marking values that have been removed but are
+  // still stored (see deferred_removal_policy_t), the values are released
+  // when the container is compacted
+  // note: marks are written by base_packed_hashtable_t (the functions are not
+  // intended to be called directly)
+  template<typename Allocator>
+  class tombstone_bits_t
+  {
+    using word_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<uint64_t>;
+
+    static constexpr std::size_t word_bits_v = 64;
+
+    // marks packed 64 per word (indexed by dense index)
+    std::vector<uint64_t, word_allocator_type> words_;
+    // number of marked indices
+    std::size_t count_ = 0;
+
+  public:
+    static constexpr bool enabled_v = true;
+
+    tombstone_bits_t() = default;
+    explicit tombstone_bits_t(const Allocator& allocator);
+
+    // marks the value at the dense index specified as removed
+    void mark(std::size_t index);
+    // returns if the value at the dense index specified is marked
+    [[nodiscard]] bool test(std::size_t index) const;
+    // returns the number of marked values
+    [[nodiscard]] std::size_t count() const;
+    // removes all marks (memory is kept for the next batch of removals)
+    void clear();
+    // invokes fn with each marked index from the highest to the lowest
+    template<typename Fn>
+    void for_each_reverse(Fn&& fn) const;
+  };
+
+  // forward iterator over a range of values that skips the values marked in
+  // Tombstones (see base_packed_hashtable_t::value_iteration())
+  // note: marks made while iterating are respected, so the value at the
+  // current position can be removed without disturbing iteration
+  template<typename ValueIt, typename Tombstones>
+  class tombstone_skipping_iterator_t
+  {
+    ValueIt value_;
+    std::size_t index_ = 0;
+    std::size_t size_ = 0;
+    const Tombstones* tombstones_ = nullptr;
+
+    // advances past marked values
+    void skip();
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename std::iterator_traits<ValueIt>::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = typename std::iterator_traits<ValueIt>::pointer;
+    using reference = typename std::iterator_traits<ValueIt>::reference;
+
+    tombstone_skipping_iterator_t() = default;
+    // value is the value at index in a range of size values
+    tombstone_skipping_iterator_t(
+      ValueIt value, std::size_t index, std::size_t size,
+      const Tombstones& tombstones);
+
+    [[nodiscard]] reference operator*() const;
+    [[nodiscard]] pointer operator->() const;
+    tombstone_skipping_iterator_t& operator++();
+    tombstone_skipping_iterator_t operator++(int);
+
+    [[nodiscard]] bool operator==(
+      const tombstone_skipping_iterator_t& rhs) const;
+    [[nodiscard]] bool operator!=(
+      const tombstone_skipping_iterator_t& rhs) const;
+  };
+} // namespace thh
+
+#include "tombstones.inl"
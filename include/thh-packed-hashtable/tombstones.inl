@@ -0,0 +1,124 @@
+namespace thh
+{
+  template<typename Allocator>
+  tombstone_bits_t<Allocator>::tombstone_bits_t(const Allocator& allocator)
+    : words_(word_allocator_type(allocator))
+  {
+  }
+
+  template<typename Allocator>
+  void tombstone_bits_t<Allocator>::mark(const std::size_t index)
+  {
+    const auto word = index / word_bits_v;
+    const auto bit = uint64_t(1) << (index % word_bits_v);
+    if (word >= words_.size()) {
+      words_.resize(word + 1, 0);
+    }
+    if ((words_[word] & bit) == 0) {
+      words_[word] |= bit;
+      ++count_;
+    }
+  }
+
+  template<typename Allocator>
+  bool tombstone_bits_t<Allocator>::test(const std::size_t index) const
+  {
+    const auto word = index / word_bits_v;
+    return word < words_.size()
+        && (words_[word] & (uint64_t(1) << (index % word_bits_v))) != 0;
+  }
+
+  template<typename Allocator>
+  std::size_t tombstone_bits_t<Allocator>::count() const
+  {
+    return count_;
+  }
+
+  template<typename Allocator>
+  void tombstone_bits_t<Allocator>::clear()
+  {
+    std::fill(words_.begin(), words_.end(), 0);
+    count_ = 0;
+  }
+
+  template<typename Allocator>
+  template<typename Fn>
+  void tombstone_bits_t<Allocator>::for_each_reverse(Fn&& fn) const
+  {
+    for (auto word = words_.size(); word > 0; --word) {
+      const auto bits = words_[word - 1];
+      // skip whole words with no marks
+      for (auto bit = word_bits_v; bits != 0 && bit > 0; --bit) {
+        if ((bits & (uint64_t(1) << (bit - 1))) != 0) {
+          fn((word - 1) * word_bits_v + bit - 1);
+        }
+      }
+    }
+  }
+
+  template<typename ValueIt, typename Tombstones>
+  tombstone_skipping_iterator_t<ValueIt, Tombstones>::
+    tombstone_skipping_iterator_t(
+      const ValueIt value, const std::size_t index, const std::size_t size,
+      const Tombstones& tombstones)
+    : value_(value), index_(index), size_(size), tombstones_(&tombstones)
+  {
+    skip();
+  }
+
+  template<typename ValueIt, typename Tombstones>
+  void tombstone_skipping_iterator_t<ValueIt, Tombstones>::skip()
+  {
+    while (index_ < size_ && tombstones_->test(index_)) {
+      ++value_;
+      ++index_;
+    }
+  }
+
+  template<typename ValueIt, typename Tombstones>
+  auto tombstone_skipping_iterator_t<ValueIt, Tombstones>::operator*() const
+    -> reference
+  {
+    return *value_;
+  }
+
+  template<typename ValueIt, typename Tombstones>
+  auto tombstone_skipping_iterator_t<ValueIt, Tombstones>::operator->() const
+    -> pointer
+  {
+    return &*value_;
+  }
+
+  template<typename ValueIt, typename Tombstones>
+  auto tombstone_skipping_iterator_t<ValueIt, Tombstones>::operator++()
+    -> tombstone_skipping_iterator_t&
+  {
+    ++value_;
+    ++index_;
+    skip();
+    return *this;
+  }
+
+  template<typename ValueIt, typename Tombstones>
+  auto tombstone_skipping_iterator_t<ValueIt, Tombstones>::operator++(int)
+    -> tombstone_skipping_iterator_t
+  {
+    auto it = *this;
+    ++*this;
+    return it;
+  }
+
+  template<typename ValueIt, typename Tombstones>
+  bool tombstone_skipping_iterator_t<ValueIt, Tombstones>::operator==(
+    const tombstone_skipping_iterator_t& rhs) const
+  {
+    return index_ == rhs.index_;
+  }
+
+  template<typename ValueIt, typename Tombstones>
+  bool tombstone_skipping_iterator_t<ValueIt, Tombstones>::operator!=(
+    const tombstone_skipping_iterator_t& rhs) const
+  {
+    return index_ != rhs.index_;
+  }
+} // namespace thh
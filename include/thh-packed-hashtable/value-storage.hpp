@@ -0,0 +1,453 @@
+#pragma once
+
+#include <thh-handle-vector/handle-vector.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace thh
+{
+  // trait for types that can be relocated (moved to a new address with the
+  // source considered destroyed) with a plain memcpy
+  // note: defaults to std::is_trivially_copyable, specialize to opt-in types
+  // that are safe to relocate but are not trivially copyable (e.g. types
+  // holding a std::unique_ptr), or to opt-out a type
+  template<typename T>
+  struct is_trivially_relocatable : std::is_trivially_copyable<T>
+  {
+  };
+
+  template<typename T>
+  inline constexpr bool is_trivially_relocatable_v =
+    is_trivially_relocatable<T>::value;
+
+  // moves the value at src to the uninitialized memory at dest and ends the
+  // lifetime of the value at src (uses memcpy for trivially relocatable types)
+  template<typename T>
+  void relocate_at(T* dest, T* src);
+
+  // handle with a 64 bit id and generation for containers of more than 2^31
+  // elements (see wide_size_policy_t), otherwise matches typed_handle_t
+  template<typename Tag>
+  struct wide_handle_t
+  {
+    int64_t id_ = -1;
+    int64_t gen_ = -1;
+  };
+
+  template<typename Tag>
+  bool operator==(const wide_handle_t<Tag>& lhs, const wide_handle_t<Tag>& rhs);
+  template<typename Tag>
+  bool operator!=(const wide_handle_t<Tag>& lhs, const wide_handle_t<Tag>& rhs);
+
+  // sparse set of handle slots mapping handles to dense indices (and dense
+  // indices back to slots)
+  // note: this is the bookkeeping part of handle_vector_t without the elements,
+  // value storage types own an instance and keep their values in the same
+  // dense order
+  // note: Allocator is rebound for the slot and slot id arrays
+  // note: indices, sizes and generations have the type of Handle::id_ (32 bit
+  // for typed_handle_t, 64 bit for wide_handle_t)
+  template<
+    typename Tag, typename Allocator = std::allocator<int32_t>,
+    typename Handle = typed_handle_t<Tag>>
+  class handle_slots_t
+  {
+  public:
+    using handle_type = Handle;
+    using size_type = decltype(Handle::id_);
+
+  private:
+    // internal slot for each handle
+    // lookup_ is the dense index of the element when the slot is in use, when
+    // the slot is free it encodes the next free slot (see free_lookup())
+    struct slot_t
+    {
+      size_type lookup_ = -1;
+      size_type gen_ = 0;
+    };
+
+    using slot_allocator_type =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<slot_t>;
+    using id_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<size_type>;
+
+    // sparse handle slots (indexed by handle id)
+    std::vector<slot_t, slot_allocator_type> slots_;
+    // dense slot ids (indexed by element position)
+    std::vector<size_type, id_allocator_type> dense_ids_;
+    // head of the free slot list (-1 if there are no free slots)
+    size_type next_free_ = -1;
+    // generation of new slots, greater than the generation of any slot
+    // released by shrink_to_fit so stale handles are never revalidated
+    size_type min_gen_ = 0;
+
+    // encodes/decodes the next free slot so it can be stored in lookup_
+    // note: free slots always have a negative lookup_ value
+    static size_type free_lookup(size_type next_free);
+    // grows slots_ so there is always at least one free slot available
+    void try_grow_slots();
+    // returns one past the highest slot id in use
+    size_type used_slots() const;
+
+  public:
+    // allocator for scratch index buffers (e.g. the order passed to reorder)
+    using order_allocator_type = id_allocator_type;
+
+    handle_slots_t() = default;
+    explicit handle_slots_t(const Allocator& allocator);
+    handle_slots_t(const handle_slots_t& other) = default;
+    handle_slots_t(handle_slots_t&& other) noexcept;
+    handle_slots_t& operator=(const handle_slots_t& other) = default;
+    handle_slots_t& operator=(handle_slots_t&& other) noexcept;
+    ~handle_slots_t() = default;
+
+    // allocates a new slot and returns its handle
+    // note: the new element is positioned at the end of the dense range
+    handle_type add();
+    // frees the slot for the handle, swapping the last dense element into
+    // the position of the removed element
+    // returns the dense index of the removed element or an empty optional if
+    // the handle is invalid
+    std::optional<size_type> remove(handle_type handle);
+    // frees all slots, invalidating all handles
+    void clear();
+    // reserves slots for the number of elements specified
+    void reserve(size_type capacity);
+    // releases free slots after the highest slot id in use and unused dense
+    // id capacity
+    // note: slots before the highest slot id in use are kept so outstanding
+    // handles remain valid
+    void shrink_to_fit();
+    // returns the number of bytes shrink_to_fit would release
+    [[nodiscard]] std::size_t reclaimable_bytes() const;
+    // returns if the handle refers to a live element
+    [[nodiscard]] bool has(handle_type handle) const;
+    // returns the number of live elements
+    [[nodiscard]] size_type size() const;
+    // returns the number of available slots
+    [[nodiscard]] size_type capacity() const;
+    // returns the handle for the element at a given index
+    // note: will return an invalid handle if the index is out of range
+    [[nodiscard]] handle_type handle_from_index(size_type index) const;
+    // returns the index of the element for a given handle
+    // note: will return an empty optional if the handle is invalid
+    [[nodiscard]] std::optional<size_type> index_from_handle(
+      handle_type handle) const;
+    // returns the allocator for scratch index buffers
+    [[nodiscard]] order_allocator_type get_allocator() const;
+    // reorders the dense range starting at begin so position begin + i holds
+    // the element previously at order[i]
+    template<typename OrderAllocator>
+    void reorder(
+      size_type begin, const std::vector<size_type, OrderAllocator>& order);
+  };
+
+  // random access iterator for storage of empty value types, every position
+  // refers to the same (stateless) value instance
+  template<typename Value>
+  class shared_value_iterator_t
+  {
+    template<typename>
+    friend class shared_value_iterator_t;
+
+    Value* value_ = nullptr;
+    std::ptrdiff_t index_ = 0;
+
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::remove_const_t<Value>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Value*;
+    using reference = Value&;
+
+    shared_value_iterator_t() = default;
+    shared_value_iterator_t(Value* value, std::ptrdiff_t index)
+      : value_(value), index_(index)
+    {
+    }
+
+    // support conversion from iterator to const_iterator
+    template<
+      typename Other,
+      typename = std::enable_if_t<std::is_same_v<const Other, Value>>>
+    shared_value_iterator_t(const shared_value_iterator_t<Other>& other)
+      : value_(other.value_), index_(other.index_)
+    {
+    }
+
+    [[nodiscard]] reference operator*() const { return *value_; }
+    [[nodiscard]] pointer operator->() const { return value_; }
+    [[nodiscard]] reference operator[](difference_type) const
+    {
+      return *value_;
+    }
+
+    shared_value_iterator_t& operator++()
+    {
+      ++index_;
+      return *this;
+    }
+    shared_value_iterator_t operator++(int)
+    {
+      auto it = *this;
+      ++index_;
+      return it;
+    }
+    shared_value_iterator_t& operator--()
+    {
+      --index_;
+      return *this;
+    }
+    shared_value_iterator_t operator--(int)
+    {
+      auto it = *this;
+      --index_;
+      return it;
+    }
+    shared_value_iterator_t& operator+=(difference_type n)
+    {
+      index_ += n;
+      return *this;
+    }
+    shared_value_iterator_t& operator-=(difference_type n)
+    {
+      index_ -= n;
+      return *this;
+    }
+    [[nodiscard]] shared_value_iterator_t operator+(difference_type n) const
+    {
+      return shared_value_iterator_t(value_, index_ + n);
+    }
+    [[nodiscard]] shared_value_iterator_t operator-(difference_type n) const
+    {
+      return shared_value_iterator_t(value_, index_ - n);
+    }
+    [[nodiscard]] difference_type operator-(
+      const shared_value_iterator_t& rhs) const
+    {
+      return index_ - rhs.index_;
+    }
+
+    [[nodiscard]] bool operator==(const shared_value_iterator_t& rhs) const
+    {
+      return index_ == rhs.index_;
+    }
+    [[nodiscard]] bool operator!=(const shared_value_iterator_t& rhs) const
+    {
+      return index_ != rhs.index_;
+    }
+    [[nodiscard]] bool operator<(const shared_value_iterator_t& rhs) const
+    {
+      return index_ < rhs.index_;
+    }
+    [[nodiscard]] bool operator>(const shared_value_iterator_t& rhs) const
+    {
+      return index_ > rhs.index_;
+    }
+    [[nodiscard]] bool operator<=(const shared_value_iterator_t& rhs) const
+    {
+      return index_ <= rhs.index_;
+    }
+    [[nodiscard]] bool operator>=(const shared_value_iterator_t& rhs) const
+    {
+      return index_ >= rhs.index_;
+    }
+  };
+
+  // value storage for empty value types (e.g. tag components or sets)
+  // only handles are stored, all values resolve to a single shared instance
+  // note: the interface matches handle_vector_t so it can be used in its place
+  // note: empty value types are assumed to be stateless (any value passed to
+  // add is discarded)
+  template<
+    typename Value, typename Tag, typename Allocator = std::allocator<Value>,
+    typename Slots = handle_slots_t<Tag, Allocator>>
+  class empty_value_storage_t
+  {
+    static_assert(std::is_empty_v<Value>, "Value must be an empty type");
+
+  public:
+    using handle_type = typename Slots::handle_type;
+    using size_type = typename Slots::size_type;
+
+  private:
+    Slots slots_;
+    Value value_{};
+
+  public:
+    using iterator = shared_value_iterator_t<Value>;
+    using const_iterator = shared_value_iterator_t<const Value>;
+
+    empty_value_storage_t() = default;
+    explicit empty_value_storage_t(const Allocator& allocator);
+
+    template<typename... Args>
+    handle_type add(Args&&... args);
+    bool remove(handle_type handle);
+    void clear();
+    void reserve(size_type capacity);
+    // releases slots not needed for the handles currently in use
+    void shrink_to_fit();
+    // returns the number of bytes shrink_to_fit would release
+    [[nodiscard]] std::size_t reclaimable_bytes() const;
+    [[nodiscard]] bool has(handle_type handle) const;
+    [[nodiscard]] size_type size() const;
+    [[nodiscard]] size_type capacity() const;
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] handle_type handle_from_index(size_type index) const;
+    [[nodiscard]] std::optional<size_type> index_from_handle(
+      handle_type handle) const;
+    template<typename Fn>
+    void call(handle_type handle, Fn&& fn);
+    template<typename Fn>
+    void call(handle_type handle, Fn&& fn) const;
+    template<typename Fn>
+    decltype(auto) call_return(handle_type handle, Fn&& fn);
+    template<typename Fn>
+    decltype(auto) call_return(handle_type handle, Fn&& fn) const;
+    // sorts the handles in the specified range (compare is passed indices)
+    template<typename Compare>
+    void sort(size_type begin, size_type end, Compare&& compare);
+    // partitions the handles (predicate is passed an index)
+    // returns index of the first element for the second group
+    template<typename Predicate>
+    size_type partition(Predicate&& predicate);
+    // reorders the handles so position begin + i holds the handle previously
+    // at order[i]
+    template<typename OrderAllocator>
+    void reorder(
+      size_type begin, const std::vector<size_type, OrderAllocator>& order);
+    [[nodiscard]] auto begin() -> iterator;
+    [[nodiscard]] auto begin() const -> const_iterator;
+    [[nodiscard]] auto cbegin() const -> const_iterator;
+    [[nodiscard]] auto end() -> iterator;
+    [[nodiscard]] auto end() const -> const_iterator;
+    [[nodiscard]] auto cend() const -> const_iterator;
+  };
+
+  // value storage for non-empty value types, values are tightly packed in a
+  // single buffer in the same order as the dense slot ids
+  // note: the interface matches handle_vector_t so it can be used in its place
+  // note: growth, removal (swap and pop), clear and reordering (sort and
+  // partition) use memcpy and skip constructors and destructors for types
+  // satisfying is_trivially_relocatable, other types are move constructed
+  // (values only need to be move constructible)
+  // note: Allocator is rebound for the values and the handle slots
+  template<
+    typename Value, typename Tag, typename Allocator = std::allocator<Value>,
+    typename Slots = handle_slots_t<Tag, Allocator>>
+  class dense_storage_t
+  {
+  public:
+    using handle_type = typename Slots::handle_type;
+    using size_type = typename Slots::size_type;
+
+  private:
+    using allocator_traits = typename std::allocator_traits<
+      Allocator>::template rebind_traits<Value>;
+    using value_allocator_type = typename allocator_traits::allocator_type;
+
+    Slots slots_;
+    value_allocator_type allocator_;
+    Value* values_ = nullptr;
+    size_type value_capacity_ = 0;
+
+    // allocates uninitialized memory for count values
+    Value* allocate(size_type count);
+    // frees memory returned from allocate
+    void deallocate(Value* values, size_type count);
+    // frees the value buffer (values must already be destroyed)
+    void release();
+    // relocates count values from src to the uninitialized memory at dest
+    static void relocate_range(Value* dest, Value* src, size_type count);
+    // destroys count values starting at values
+    static void destroy_range(Value* values, size_type count);
+    // reallocates the value buffer with the capacity specified
+    void reallocate(size_type capacity);
+
+  public:
+    using iterator = Value*;
+    using const_iterator = const Value*;
+
+    dense_storage_t() = default;
+    explicit dense_storage_t(const Allocator& allocator);
+    dense_storage_t(const dense_storage_t& other);
+    dense_storage_t(dense_storage_t&& other) noexcept;
+    // note: allocators are propagated according to std::allocator_traits, if
+    // allocators are not propagated and differ values are copied/relocated
+    dense_storage_t& operator=(const dense_storage_t& other);
+    dense_storage_t& operator=(dense_storage_t&& other) noexcept(
+      allocator_traits::propagate_on_container_move_assignment::value
+      || allocator_traits::is_always_equal::value);
+    ~dense_storage_t();
+
+    template<typename... Args>
+    handle_type add(Args&&... args);
+    bool remove(handle_type handle);
+    void clear();
+    void reserve(size_type capacity);
+    // releases memory not needed for the values currently stored
+    void shrink_to_fit();
+    // returns the number of bytes shrink_to_fit would release
+    [[nodiscard]] std::size_t reclaimable_bytes() const;
+    [[nodiscard]] bool has(handle_type handle) const;
+    [[nodiscard]] size_type size() const;
+    [[nodiscard]] size_type capacity() const;
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] handle_type handle_from_index(size_type index) const;
+    [[nodiscard]] std::optional<size_type> index_from_handle(
+      handle_type handle) const;
+    template<typename Fn>
+    void call(handle_type handle, Fn&& fn);
+    template<typename Fn>
+    void call(handle_type handle, Fn&& fn) const;
+    template<typename Fn>
+    decltype(auto) call_return(handle_type handle, Fn&& fn);
+    template<typename Fn>
+    decltype(auto) call_return(handle_type handle, Fn&& fn) const;
+    // sorts the values in the specified range (compare is passed indices)
+    template<typename Compare>
+    void sort(size_type begin, size_type end, Compare&& compare);
+    // partitions the values (predicate is passed an index)
+    // returns index of the first element for the second group
+    template<typename Predicate>
+    size_type partition(Predicate&& predicate);
+    // reorders the values (and slots) so position begin + i holds the value
+    // previously at order[i]
+    // note: each value is relocated at most once (cycles are followed using a
+    // single temporary)
+    template<typename OrderAllocator>
+    void reorder(
+      size_type begin, const std::vector<size_type, OrderAllocator>& order);
+    [[nodiscard]] auto begin() -> iterator;
+    [[nodiscard]] auto begin() const -> const_iterator;
+    [[nodiscard]] auto cbegin() const -> const_iterator;
+    [[nodiscard]] auto end() -> iterator;
+    [[nodiscard]] auto end() const -> const_iterator;
+    [[nodiscard]] auto cend() const -> const_iterator;
+  };
+
+  // storage used for the values of a packed hashtable
+  // empty value types use empty_value_storage_t (no memory is used for the
+  // values themselves), all other types use dense_storage_t
+  // note: Slots tracks handles and dense positions (handle_slots_t or a type
+  // with the same interface, see compact_handle_slots_t)
+  template<
+    typename Value, typename Tag, typename Allocator = std::allocator<Value>,
+    typename Slots = handle_slots_t<Tag, Allocator>>
+  using value_storage_t = std::conditional_t<
+    std::is_empty_v<Value>, empty_value_storage_t<Value, Tag, Allocator, Slots>,
+    dense_storage_t<Value, Tag, Allocator, Slots>>;
+} // namespace thh
+
+#include "value-storage.inl"
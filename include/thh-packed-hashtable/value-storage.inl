@@ -0,0 +1,894 @@
+namespace thh
+{
+  template<typename T>
+  void relocate_at(T* dest, T* src)
+  {
+    if constexpr (is_trivially_relocatable_v<T>) {
+      std::memcpy(
+        static_cast<void*>(dest), static_cast<const void*>(src), sizeof(T));
+    } else {
+      ::new (static_cast<void*>(dest)) T(std::move(*src));
+      src->~T();
+    }
+  }
+
+  template<typename Tag>
+  bool operator==(const wide_handle_t<Tag>& lhs, const wide_handle_t<Tag>& rhs)
+  {
+    return lhs.id_ == rhs.id_ && lhs.gen_ == rhs.gen_;
+  }
+
+  template<typename Tag>
+  bool operator!=(const wide_handle_t<Tag>& lhs, const wide_handle_t<Tag>& rhs)
+  {
+    return !(lhs == rhs);
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  auto handle_slots_t<Tag, Allocator, Handle>::free_lookup(
+    const size_type next_free) -> size_type
+  {
+    // maps -1 (no next free slot) to -1 and all other slots to values < -1
+    return -2 - next_free;
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  void handle_slots_t<Tag, Allocator, Handle>::try_grow_slots()
+  {
+    if (next_free_ == -1) {
+      const auto slot_count = static_cast<size_type>(slots_.size());
+      reserve(slot_count == 0 ? 1 : slot_count * 2);
+    }
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  auto handle_slots_t<Tag, Allocator, Handle>::used_slots() const -> size_type
+  {
+    size_type used = 0;
+    for (const auto id : dense_ids_) {
+      used = std::max(used, id + 1);
+    }
+    return used;
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  handle_slots_t<Tag, Allocator, Handle>::handle_slots_t(
+    const Allocator& allocator)
+    : slots_(slot_allocator_type(allocator)),
+      dense_ids_(id_allocator_type(allocator))
+  {
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  handle_slots_t<Tag, Allocator, Handle>::handle_slots_t(
+    handle_slots_t&& other) noexcept
+    : slots_(std::move(other.slots_)),
+      dense_ids_(std::move(other.dense_ids_)),
+      next_free_(std::exchange(other.next_free_, -1)),
+      min_gen_(other.min_gen_)
+  {
+    other.slots_.clear();
+    other.dense_ids_.clear();
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  auto handle_slots_t<Tag, Allocator, Handle>::operator=(
+    handle_slots_t&& other) noexcept -> handle_slots_t&
+  {
+    slots_ = std::move(other.slots_);
+    dense_ids_ = std::move(other.dense_ids_);
+    next_free_ = std::exchange(other.next_free_, -1);
+    min_gen_ = other.min_gen_;
+    other.slots_.clear();
+    other.dense_ids_.clear();
+    return *this;
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  auto handle_slots_t<Tag, Allocator, Handle>::add() -> handle_type
+  {
+    try_grow_slots();
+    const auto id = next_free_;
+    auto& slot = slots_[id];
+    next_free_ = free_lookup(slot.lookup_);
+    slot.lookup_ = static_cast<size_type>(dense_ids_.size());
+    dense_ids_.push_back(id);
+    handle_type handle;
+    handle.id_ = id;
+    handle.gen_ = slot.gen_;
+    return handle;
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  auto handle_slots_t<Tag, Allocator, Handle>::remove(
+    const handle_type handle) -> std::optional<size_type>
+  {
+    if (!has(handle)) {
+      return {};
+    }
+    auto& slot = slots_[handle.id_];
+    const auto index = slot.lookup_;
+    const auto last = static_cast<size_type>(dense_ids_.size()) - 1;
+    if (index != last) {
+      dense_ids_[index] = dense_ids_[last];
+      slots_[dense_ids_[index]].lookup_ = index;
+    }
+    dense_ids_.pop_back();
+    slot.gen_++;
+    slot.lookup_ = free_lookup(next_free_);
+    next_free_ = handle.id_;
+    return index;
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  void handle_slots_t<Tag, Allocator, Handle>::clear()
+  {
+    for (const auto id : dense_ids_) {
+      auto& slot = slots_[id];
+      slot.gen_++;
+      slot.lookup_ = free_lookup(next_free_);
+      next_free_ = id;
+    }
+    dense_ids_.clear();
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  void handle_slots_t<Tag, Allocator, Handle>::reserve(const size_type capacity)
+  {
+    const auto slot_count = static_cast<size_type>(slots_.size());
+    if (capacity <= slot_count) {
+      return;
+    }
+    slots_.resize(capacity);
+    // link new slots in order, the last new slot links to the previous head
+    for (size_type id = slot_count; id < capacity - 1; ++id) {
+      slots_[id].lookup_ = free_lookup(id + 1);
+      slots_[id].gen_ = min_gen_;
+    }
+    slots_[capacity - 1].gen_ = min_gen_;
+    slots_[capacity - 1].lookup_ = free_lookup(next_free_);
+    next_free_ = slot_count;
+    dense_ids_.reserve(capacity);
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  void handle_slots_t<Tag, Allocator, Handle>::shrink_to_fit()
+  {
+    const auto used = used_slots();
+    for (size_type id = used; id < static_cast<size_type>(slots_.size());
+         ++id) {
+      min_gen_ = std::max(min_gen_, slots_[id].gen_);
+    }
+    slots_.resize(used);
+    slots_.shrink_to_fit();
+    dense_ids_.shrink_to_fit();
+    // relink the remaining free slots in order (lowest ids are reused first)
+    next_free_ = -1;
+    for (size_type id = used - 1; id >= 0; --id) {
+      if (slots_[id].lookup_ < 0) {
+        slots_[id].lookup_ = free_lookup(next_free_);
+        next_free_ = id;
+      }
+    }
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  std::size_t handle_slots_t<Tag, Allocator, Handle>::reclaimable_bytes() const
+  {
+    return (slots_.capacity() - used_slots()) * sizeof(slot_t)
+         + (dense_ids_.capacity() - dense_ids_.size()) * sizeof(size_type);
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  bool handle_slots_t<Tag, Allocator, Handle>::has(
+    const handle_type handle) const
+  {
+    return handle.id_ >= 0 && handle.id_ < static_cast<size_type>(slots_.size())
+        && slots_[handle.id_].lookup_ >= 0
+        && slots_[handle.id_].gen_ == handle.gen_;
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  auto handle_slots_t<Tag, Allocator, Handle>::size() const -> size_type
+  {
+    return static_cast<size_type>(dense_ids_.size());
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  auto handle_slots_t<Tag, Allocator, Handle>::capacity() const -> size_type
+  {
+    return static_cast<size_type>(slots_.size());
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  auto handle_slots_t<Tag, Allocator, Handle>::handle_from_index(
+    const size_type index) const -> handle_type
+  {
+    handle_type handle;
+    if (index >= 0 && index < size()) {
+      handle.id_ = dense_ids_[index];
+      handle.gen_ = slots_[handle.id_].gen_;
+    }
+    return handle;
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  auto handle_slots_t<Tag, Allocator, Handle>::index_from_handle(
+    const handle_type handle) const -> std::optional<size_type>
+  {
+    if (!has(handle)) {
+      return {};
+    }
+    return slots_[handle.id_].lookup_;
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  auto handle_slots_t<Tag, Allocator, Handle>::get_allocator() const
+    -> order_allocator_type
+  {
+    return dense_ids_.get_allocator();
+  }
+
+  template<typename Tag, typename Allocator, typename Handle>
+  template<typename OrderAllocator>
+  void handle_slots_t<Tag, Allocator, Handle>::reorder(
+    const size_type begin,
+    const std::vector<size_type, OrderAllocator>& order)
+  {
+    auto ids = std::vector<size_type, id_allocator_type>(get_allocator());
+    ids.reserve(order.size());
+    for (const auto index : order) {
+      ids.push_back(dense_ids_[index]);
+    }
+    for (size_type offset = 0; offset < static_cast<size_type>(ids.size());
+         ++offset) {
+      dense_ids_[begin + offset] = ids[offset];
+      slots_[ids[offset]].lookup_ = begin + offset;
+    }
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  empty_value_storage_t<Value, Tag, Allocator, Slots>::empty_value_storage_t(
+    const Allocator& allocator)
+    : slots_(allocator)
+  {
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  template<typename... Args>
+  auto empty_value_storage_t<Value, Tag, Allocator, Slots>::add(
+    [[maybe_unused]] Args&&... args) -> handle_type
+  {
+    return slots_.add();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  bool empty_value_storage_t<Value, Tag, Allocator, Slots>::remove(
+    const handle_type handle)
+  {
+    return slots_.remove(handle).has_value();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  void empty_value_storage_t<Value, Tag, Allocator, Slots>::clear()
+  {
+    slots_.clear();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  void empty_value_storage_t<Value, Tag, Allocator, Slots>::reserve(
+    const size_type capacity)
+  {
+    slots_.reserve(capacity);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  void empty_value_storage_t<Value, Tag, Allocator, Slots>::shrink_to_fit()
+  {
+    slots_.shrink_to_fit();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  std::size_t empty_value_storage_t<
+    Value, Tag, Allocator, Slots>::reclaimable_bytes()
+    const
+  {
+    return slots_.reclaimable_bytes();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  bool empty_value_storage_t<Value, Tag, Allocator, Slots>::has(
+    const handle_type handle) const
+  {
+    return slots_.has(handle);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto empty_value_storage_t<Value, Tag, Allocator, Slots>::size() const
+    -> size_type
+  {
+    return slots_.size();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto empty_value_storage_t<Value, Tag, Allocator, Slots>::capacity() const
+    -> size_type
+  {
+    return slots_.capacity();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  bool empty_value_storage_t<Value, Tag, Allocator, Slots>::empty() const
+  {
+    return slots_.size() == 0;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto empty_value_storage_t<Value, Tag, Allocator, Slots>::handle_from_index(
+    const size_type index) const -> handle_type
+  {
+    return slots_.handle_from_index(index);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto empty_value_storage_t<
+    Value, Tag, Allocator,
+    Slots>::index_from_handle(const handle_type handle) const
+    -> std::optional<size_type>
+  {
+    return slots_.index_from_handle(handle);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  template<typename Fn>
+  void empty_value_storage_t<Value, Tag, Allocator, Slots>::call(
+    const handle_type handle, Fn&& fn)
+  {
+    if (slots_.has(handle)) {
+      fn(value_);
+    }
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  template<typename Fn>
+  void empty_value_storage_t<Value, Tag, Allocator, Slots>::call(
+    const handle_type handle, Fn&& fn) const
+  {
+    if (slots_.has(handle)) {
+      fn(value_);
+    }
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  template<typename Fn>
+  decltype(auto) empty_value_storage_t<
+    Value, Tag, Allocator, Slots>::call_return(
+    const handle_type handle, Fn&& fn)
+  {
+    using result_t = decltype(fn(value_));
+    if (slots_.has(handle)) {
+      return std::optional<result_t>(fn(value_));
+    }
+    return std::optional<result_t>{};
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  template<typename Fn>
+  decltype(auto) empty_value_storage_t<
+    Value, Tag, Allocator, Slots>::call_return(
+    const handle_type handle, Fn&& fn) const
+  {
+    using result_t = decltype(fn(value_));
+    if (slots_.has(handle)) {
+      return std::optional<result_t>(fn(value_));
+    }
+    return std::optional<result_t>{};
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  template<typename Compare>
+  void empty_value_storage_t<Value, Tag, Allocator, Slots>::sort(
+    const size_type begin, const size_type end, Compare&& compare)
+  {
+    auto order = std::vector<size_type, typename Slots::order_allocator_type>(
+      end - begin, size_type(0), slots_.get_allocator());
+    std::iota(order.begin(), order.end(), begin);
+    std::sort(order.begin(), order.end(), std::forward<Compare>(compare));
+    slots_.reorder(begin, order);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  template<typename Predicate>
+  auto empty_value_storage_t<Value, Tag, Allocator, Slots>::partition(
+    Predicate&& predicate) -> size_type
+  {
+    auto order = std::vector<size_type, typename Slots::order_allocator_type>(
+      slots_.size(), size_type(0), slots_.get_allocator());
+    std::iota(order.begin(), order.end(), 0);
+    const auto second = std::partition(
+      order.begin(), order.end(), std::forward<Predicate>(predicate));
+    slots_.reorder(0, order);
+    return static_cast<size_type>(std::distance(order.begin(), second));
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  template<typename OrderAllocator>
+  void empty_value_storage_t<Value, Tag, Allocator, Slots>::reorder(
+    const size_type begin,
+    const std::vector<size_type, OrderAllocator>& order)
+  {
+    slots_.reorder(begin, order);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto empty_value_storage_t<Value, Tag, Allocator, Slots>::begin() -> iterator
+  {
+    return iterator(&value_, 0);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto empty_value_storage_t<Value, Tag, Allocator, Slots>::begin() const
+    -> const_iterator
+  {
+    return const_iterator(&value_, 0);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto empty_value_storage_t<Value, Tag, Allocator, Slots>::cbegin() const
+    -> const_iterator
+  {
+    return const_iterator(&value_, 0);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto empty_value_storage_t<Value, Tag, Allocator, Slots>::end() -> iterator
+  {
+    return iterator(&value_, slots_.size());
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto empty_value_storage_t<Value, Tag, Allocator, Slots>::end() const
+    -> const_iterator
+  {
+    return const_iterator(&value_, slots_.size());
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto empty_value_storage_t<Value, Tag, Allocator, Slots>::cend() const
+    -> const_iterator
+  {
+    return const_iterator(&value_, slots_.size());
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  Value* dense_storage_t<
+    Value, Tag, Allocator, Slots>::allocate(const size_type count)
+  {
+    return allocator_traits::allocate(allocator_, count);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  void dense_storage_t<Value, Tag, Allocator, Slots>::deallocate(
+    Value* values, const size_type count)
+  {
+    if (values != nullptr) {
+      allocator_traits::deallocate(allocator_, values, count);
+    }
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  void dense_storage_t<Value, Tag, Allocator, Slots>::release()
+  {
+    deallocate(values_, value_capacity_);
+    values_ = nullptr;
+    value_capacity_ = 0;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  void dense_storage_t<Value, Tag, Allocator, Slots>::relocate_range(
+    Value* dest, Value* src, const size_type count)
+  {
+    if constexpr (is_trivially_relocatable_v<Value>) {
+      if (count > 0) {
+        std::memcpy(
+          static_cast<void*>(dest), static_cast<const void*>(src),
+          sizeof(Value) * count);
+      }
+    } else {
+      for (size_type i = 0; i < count; ++i) {
+        relocate_at(dest + i, src + i);
+      }
+    }
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  void dense_storage_t<Value, Tag, Allocator, Slots>::destroy_range(
+    [[maybe_unused]] Value* values, [[maybe_unused]] const size_type count)
+  {
+    if constexpr (!std::is_trivially_destructible_v<Value>) {
+      std::destroy(values, values + count);
+    }
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  void dense_storage_t<Value, Tag, Allocator, Slots>::reallocate(
+    const size_type capacity)
+  {
+    Value* values = allocate(capacity);
+    relocate_range(values, values_, slots_.size());
+    deallocate(values_, value_capacity_);
+    values_ = values;
+    value_capacity_ = capacity;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  template<typename OrderAllocator>
+  void dense_storage_t<Value, Tag, Allocator, Slots>::reorder(
+    const size_type begin,
+    const std::vector<size_type, OrderAllocator>& order)
+  {
+    const auto count = static_cast<size_type>(order.size());
+    using placed_allocator_type = typename std::allocator_traits<
+      OrderAllocator>::template rebind_alloc<bool>;
+    auto placed = std::vector<bool, placed_allocator_type>(
+      count, false, placed_allocator_type(order.get_allocator()));
+    Value* temp = nullptr;
+    for (size_type start = 0; start < count; ++start) {
+      if (placed[start] || order[start] == begin + start) {
+        continue;
+      }
+      if (temp == nullptr) {
+        temp = allocate(1);
+      }
+      // lift out the value at the start of the cycle and fill the hole it
+      // leaves by following the cycle until it is closed again
+      relocate_at(temp, values_ + begin + start);
+      size_type hole = start;
+      while (order[hole] != begin + start) {
+        const auto next = order[hole] - begin;
+        relocate_at(values_ + begin + hole, values_ + begin + next);
+        placed[hole] = true;
+        hole = next;
+      }
+      relocate_at(values_ + begin + hole, temp);
+      placed[hole] = true;
+    }
+    deallocate(temp, 1);
+    slots_.reorder(begin, order);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  dense_storage_t<Value, Tag, Allocator, Slots>::dense_storage_t(
+    const Allocator& allocator)
+    : slots_(allocator), allocator_(allocator)
+  {
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  dense_storage_t<Value, Tag, Allocator, Slots>::dense_storage_t(
+    const dense_storage_t& other)
+    : slots_(other.slots_),
+      allocator_(allocator_traits::select_on_container_copy_construction(
+        other.allocator_))
+  {
+    values_ = allocate(other.size());
+    value_capacity_ = other.size();
+    std::uninitialized_copy(other.begin(), other.end(), values_);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  dense_storage_t<Value, Tag, Allocator, Slots>::dense_storage_t(
+    dense_storage_t&& other) noexcept
+    : slots_(std::move(other.slots_)),
+      allocator_(std::move(other.allocator_)),
+      values_(std::exchange(other.values_, nullptr)),
+      value_capacity_(std::exchange(other.value_capacity_, 0))
+  {
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  dense_storage_t<Value, Tag, Allocator, Slots>& dense_storage_t<
+    Value, Tag, Allocator, Slots>::operator=(const dense_storage_t& other)
+  {
+    if (this == &other) {
+      return *this;
+    }
+    destroy_range(values_, slots_.size());
+    slots_.clear();
+    if constexpr (allocator_traits::propagate_on_container_copy_assignment::
+                    value) {
+      if (allocator_ != other.allocator_) {
+        release();
+      }
+      allocator_ = other.allocator_;
+    }
+    if (value_capacity_ < other.size()) {
+      release();
+      values_ = allocate(other.size());
+      value_capacity_ = other.size();
+    }
+    std::uninitialized_copy(other.begin(), other.end(), values_);
+    slots_ = other.slots_;
+    return *this;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  dense_storage_t<Value, Tag, Allocator, Slots>& dense_storage_t<
+    Value, Tag, Allocator, Slots>::operator=(dense_storage_t&& other) noexcept(
+    allocator_traits::propagate_on_container_move_assignment::value
+    || allocator_traits::is_always_equal::value)
+  {
+    if (this == &other) {
+      return *this;
+    }
+    destroy_range(values_, slots_.size());
+    slots_.clear();
+    constexpr bool propagate =
+      allocator_traits::propagate_on_container_move_assignment::value;
+    if (propagate || allocator_ == other.allocator_) {
+      // take ownership of the other value buffer
+      release();
+      if constexpr (propagate) {
+        allocator_ = std::move(other.allocator_);
+      }
+      values_ = std::exchange(other.values_, nullptr);
+      value_capacity_ = std::exchange(other.value_capacity_, 0);
+      slots_ = std::move(other.slots_);
+    } else {
+      // memory owned by a different allocator cannot be adopted so values are
+      // relocated to memory from this allocator instead
+      if (value_capacity_ < other.size()) {
+        release();
+        values_ = allocate(other.size());
+        value_capacity_ = other.size();
+      }
+      relocate_range(values_, other.values_, other.size());
+      slots_ = std::move(other.slots_);
+      other.release();
+    }
+    return *this;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  dense_storage_t<Value, Tag, Allocator, Slots>::~dense_storage_t()
+  {
+    destroy_range(values_, slots_.size());
+    release();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  template<typename... Args>
+  auto dense_storage_t<Value, Tag, Allocator, Slots>::add(
+    Args&&... args) -> handle_type
+  {
+    const auto size = slots_.size();
+    if (size == value_capacity_) {
+      // construct the new value before relocating the existing values in case
+      // args refer to a value in the container
+      const auto capacity = value_capacity_ == 0 ? 1 : value_capacity_ * 2;
+      Value* values = allocate(capacity);
+      ::new (static_cast<void*>(values + size))
+        Value(std::forward<Args>(args)...);
+      relocate_range(values, values_, size);
+      deallocate(values_, value_capacity_);
+      values_ = values;
+      value_capacity_ = capacity;
+    } else {
+      ::new (static_cast<void*>(values_ + size))
+        Value(std::forward<Args>(args)...);
+    }
+    return slots_.add();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  bool dense_storage_t<Value, Tag, Allocator, Slots>::remove(
+    const handle_type handle)
+  {
+    const auto index = slots_.remove(handle);
+    if (!index.has_value()) {
+      return false;
+    }
+    // slots_ has already been updated so the size is the index of the last
+    // value, relocate it into the position of the removed value
+    const auto last = slots_.size();
+    std::destroy_at(values_ + *index);
+    if (*index != last) {
+      relocate_at(values_ + *index, values_ + last);
+    }
+    return true;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  void dense_storage_t<Value, Tag, Allocator, Slots>::clear()
+  {
+    destroy_range(values_, slots_.size());
+    slots_.clear();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  void dense_storage_t<
+    Value, Tag, Allocator, Slots>::reserve(const size_type capacity)
+  {
+    slots_.reserve(capacity);
+    if (capacity > value_capacity_) {
+      reallocate(capacity);
+    }
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  void dense_storage_t<Value, Tag, Allocator, Slots>::shrink_to_fit()
+  {
+    slots_.shrink_to_fit();
+    const auto size = slots_.size();
+    if (size == 0) {
+      release();
+    } else if (value_capacity_ > size) {
+      reallocate(size);
+    }
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  std::size_t dense_storage_t<
+    Value, Tag, Allocator, Slots>::reclaimable_bytes() const
+  {
+    return slots_.reclaimable_bytes()
+         + (value_capacity_ - slots_.size()) * sizeof(Value);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  bool dense_storage_t<Value, Tag, Allocator, Slots>::has(
+    const handle_type handle) const
+  {
+    return slots_.has(handle);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto dense_storage_t<Value, Tag, Allocator, Slots>::size() const -> size_type
+  {
+    return slots_.size();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto dense_storage_t<Value, Tag, Allocator, Slots>::capacity() const
+    -> size_type
+  {
+    return slots_.capacity();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  bool dense_storage_t<Value, Tag, Allocator, Slots>::empty() const
+  {
+    return slots_.size() == 0;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto dense_storage_t<
+    Value, Tag, Allocator, Slots>::handle_from_index(
+    const size_type index) const -> handle_type
+  {
+    return slots_.handle_from_index(index);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto dense_storage_t<
+    Value, Tag, Allocator,
+    Slots>::index_from_handle(const handle_type handle) const
+    -> std::optional<size_type>
+  {
+    return slots_.index_from_handle(handle);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  template<typename Fn>
+  void dense_storage_t<Value, Tag, Allocator, Slots>::call(
+    const handle_type handle, Fn&& fn)
+  {
+    if (const auto index = slots_.index_from_handle(handle);
+        index.has_value()) {
+      fn(values_[*index]);
+    }
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  template<typename Fn>
+  void dense_storage_t<Value, Tag, Allocator, Slots>::call(
+    const handle_type handle, Fn&& fn) const
+  {
+    if (const auto index = slots_.index_from_handle(handle);
+        index.has_value()) {
+      fn(std::as_const(values_[*index]));
+    }
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  template<typename Fn>
+  decltype(auto) dense_storage_t<Value, Tag, Allocator, Slots>::call_return(
+    const handle_type handle, Fn&& fn)
+  {
+    using result_t = decltype(fn(*values_));
+    if (const auto index = slots_.index_from_handle(handle);
+        index.has_value()) {
+      return std::optional<result_t>(fn(values_[*index]));
+    }
+    return std::optional<result_t>{};
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  template<typename Fn>
+  decltype(auto) dense_storage_t<Value, Tag, Allocator, Slots>::call_return(
+    const handle_type handle, Fn&& fn) const
+  {
+    using result_t = decltype(fn(std::as_const(*values_)));
+    if (const auto index = slots_.index_from_handle(handle);
+        index.has_value()) {
+      return std::optional<result_t>(fn(std::as_const(values_[*index])));
+    }
+    return std::optional<result_t>{};
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  template<typename Compare>
+  void dense_storage_t<Value, Tag, Allocator, Slots>::sort(
+    const size_type begin, const size_type end, Compare&& compare)
+  {
+    auto order = std::vector<size_type, typename Slots::order_allocator_type>(
+      end - begin, size_type(0), slots_.get_allocator());
+    std::iota(order.begin(), order.end(), begin);
+    std::sort(order.begin(), order.end(), std::forward<Compare>(compare));
+    reorder(begin, order);
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  template<typename Predicate>
+  auto dense_storage_t<Value, Tag, Allocator, Slots>::partition(
+    Predicate&& predicate) -> size_type
+  {
+    auto order = std::vector<size_type, typename Slots::order_allocator_type>(
+      slots_.size(), size_type(0), slots_.get_allocator());
+    std::iota(order.begin(), order.end(), 0);
+    const auto second = std::partition(
+      order.begin(), order.end(), std::forward<Predicate>(predicate));
+    reorder(0, order);
+    return static_cast<size_type>(std::distance(order.begin(), second));
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto dense_storage_t<Value, Tag, Allocator, Slots>::begin() -> iterator
+  {
+    return values_;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto dense_storage_t<
+    Value, Tag, Allocator, Slots>::begin() const -> const_iterator
+  {
+    return values_;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto dense_storage_t<
+    Value, Tag, Allocator, Slots>::cbegin() const -> const_iterator
+  {
+    return values_;
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto dense_storage_t<Value, Tag, Allocator, Slots>::end() -> iterator
+  {
+    return values_ + slots_.size();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto dense_storage_t<
+    Value, Tag, Allocator, Slots>::end() const -> const_iterator
+  {
+    return values_ + slots_.size();
+  }
+
+  template<typename Value, typename Tag, typename Allocator, typename Slots>
+  auto dense_storage_t<
+    Value, Tag, Allocator, Slots>::cend() const -> const_iterator
+  {
+    return values_ + slots_.size();
+  }
+} // namespace thh
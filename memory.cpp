@@ -4,6 +4,7 @@
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <memory_resource>
 #include <string>
 
 // debug memory tracking code
@@ -19,6 +20,30 @@ void operator delete(void* memory) noexcept
   free(memory);
 }
 
+// memory resource forwarding to the global operator new so upstream
+// allocations from std::pmr resources are tracked
+// note: also records the number of bytes currently allocated (live_)
+class tracked_resource_t : public std::pmr::memory_resource
+{
+  void* do_allocate(std::size_t bytes, std::size_t) override
+  {
+    live_ += bytes;
+    return ::operator new(bytes);
+  }
+  void do_deallocate(void* memory, std::size_t bytes, std::size_t) override
+  {
+    live_ -= bytes;
+    ::operator delete(memory);
+  }
+  bool do_is_equal(const memory_resource& other) const noexcept override
+  {
+    return this == &other;
+  }
+
+public:
+  std::size_t live_ = 0;
+};
+
 template<int32_t Size>
 void run_memory_tracking()
 {
@@ -142,6 +167,125 @@ void run_memory_tracking()
   }
 
   std::cout << '\n';
+
+  // 4 bytes (per handle slot, 8 with typed_handle_t)
+  // 4 bytes (per element id)
+  // 4 bytes (per handle in the key index, 8 with typed_handle_t)
+  using compact_packed_hashtable_t = thh::packed_hashtable_t<
+    std::string, object_t, std::hash<std::string>, std::equal_to<>,
+    thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const std::string, object_t>>,
+    thh::compact_handle_policy_t<>>;
+  const std::string compact_packed_hashtable_name =
+    "thh::packed_hashtable_t (compact 32 bit handles) - elem size: "s
+    + std::to_string(Size);
+  std::cout << compact_packed_hashtable_name << '\n'
+            << underline_fn(compact_packed_hashtable_name.size()) << '\n';
+  g_total = 0;
+  for (const int size : sizes) {
+    compact_packed_hashtable_t packed_hashtable;
+    packed_hashtable.reserve(size);
+    for (int i = 0; i < size; ++i) {
+      packed_hashtable.add(std::pair(std::to_string(i), object_t{}));
+    }
+    std::cout << std::left << std::setw(10) << g_total << std::right
+              << std::setw(2) << '(' << size << ")\n";
+    g_total = 0;
+  }
+
+  std::cout << '\n';
+
+  // memory requested from the heap by a monotonic arena (the arena grows
+  // geometrically so this includes unused space at the end of the last block)
+  const std::string pmr_packed_hashtable_name =
+    "thh::pmr::packed_hashtable_t (monotonic arena) - elem size: "s
+    + std::to_string(Size);
+  std::cout << pmr_packed_hashtable_name << '\n'
+            << underline_fn(pmr_packed_hashtable_name.size()) << '\n';
+  g_total = 0;
+  for (const int size : sizes) {
+    tracked_resource_t upstream;
+    std::pmr::monotonic_buffer_resource resource(&upstream);
+    thh::pmr::packed_hashtable_t<std::string, object_t> packed_hashtable(
+      &resource);
+    packed_hashtable.reserve(size);
+    for (int i = 0; i < size; ++i) {
+      packed_hashtable.add(std::pair(std::to_string(i), object_t{}));
+    }
+    std::cout << std::left << std::setw(10) << g_total << std::right
+              << std::setw(2) << '(' << size << ")\n";
+    g_total = 0;
+  }
+
+  std::cout << '\n';
+
+  // memory in use after adding elements, after removing all but 1/16 of them
+  // and after shrink_to_fit (removal alone does not release any capacity)
+  const std::string shrink_packed_hashtable_name =
+    "thh::pmr::packed_hashtable_t (add/remove/shrink_to_fit) - elem size: "s
+    + std::to_string(Size);
+  std::cout << shrink_packed_hashtable_name << '\n'
+            << underline_fn(shrink_packed_hashtable_name.size()) << '\n';
+  for (const int size : sizes) {
+    tracked_resource_t resource;
+    thh::pmr::packed_hashtable_t<std::string, object_t> packed_hashtable(
+      &resource);
+    for (int i = 0; i < size; ++i) {
+      packed_hashtable.add(std::pair(std::to_string(i), object_t{}));
+    }
+    const auto added = resource.live_;
+    for (int i = size / 16; i < size; ++i) {
+      packed_hashtable.remove(std::to_string(i));
+    }
+    const auto removed = resource.live_;
+    packed_hashtable.shrink_to_fit();
+    std::cout << std::left << std::setw(10) << added << std::setw(10)
+              << removed << std::setw(10) << resource.live_ << std::right
+              << std::setw(2) << '(' << size << ")\n";
+  }
+
+  std::cout << '\n';
+
+  // heap memory requested by a fixed capacity table while adding elements,
+  // then while removing half of them with remove_when and then while sorting
+  // the rest with reorder_by_key (always 0, the storage for every element is
+  // part of the object, which is static here as it is too large for the
+  // stack)
+  // note: short keys so std::string does not allocate either
+  constexpr int32_t static_capacity = 1024;
+  static thh::static_packed_hashtable_t<std::string, object_t, static_capacity>
+    static_packed_hashtable;
+  const std::string static_packed_hashtable_name =
+    "thh::static_packed_hashtable_t<"s + std::to_string(static_capacity)
+    + "> (object size: "s + std::to_string(sizeof(static_packed_hashtable))
+    + ") - elem size: "s + std::to_string(Size);
+  std::cout << static_packed_hashtable_name << '\n'
+            << underline_fn(static_packed_hashtable_name.size()) << '\n';
+  g_total = 0;
+  for (const int size : sizes) {
+    if (size > static_capacity) {
+      break;
+    }
+    static_packed_hashtable.clear();
+    for (int i = 0; i < size; ++i) {
+      static_packed_hashtable.add(std::pair(std::to_string(i), object_t{}));
+    }
+    const auto added = g_total;
+    g_total = 0;
+    int visited = 0;
+    thh::remove_when(static_packed_hashtable, [&visited](const object_t&) {
+      return visited++ % 2 == 0;
+    });
+    const auto removed = g_total;
+    g_total = 0;
+    static_packed_hashtable.reorder_by_key();
+    std::cout << std::left << std::setw(10) << added << std::setw(10)
+              << removed << std::setw(10) << g_total << std::right
+              << std::setw(2) << '(' << size << ")\n";
+    g_total = 0;
+  }
+
+  std::cout << '\n';
 }
 
 int main(int argc, char** argv)
@@ -2,8 +2,21 @@
 #include "doctest/doctest.h"
 
 #include <thh-packed-hashtable/packed-hashtable.hpp>
-
+#include <thh-packed-hashtable/checkpoint.hpp>
+#include <thh-packed-hashtable/frozen.hpp>
+#include <thh-packed-hashtable/expiring-hashtable.hpp>
+#include <thh-packed-hashtable/packed-cache.hpp>
+#include <thh-packed-hashtable/shared-hashtable.hpp>
+#include <thh-packed-hashtable/snapshot.hpp>
+
+#include <algorithm>
 #include <array>
+#include <cstddef>
+#include <filesystem>
+#include <memory_resource>
+#include <numeric>
+#include <random>
+#include <string>
 
 TEST_CASE("Can allocate packed hashtable")
 {
@@ -509,3 +522,2300 @@ TEST_CASE("Elements that satisfy predicate are removed")
 
   CHECK(packed_hashtable.size() == element_count / 2);
 }
+
+TEST_CASE("Packed hashset can add, find and remove keys")
+{
+  thh::packed_hashset_t<int> packed_hashset;
+  packed_hashset.add({1, {}});
+  packed_hashset.add({2, {}});
+  packed_hashset.add({3, {}});
+
+  CHECK(packed_hashset.size() == 3);
+  CHECK(packed_hashset.has(2));
+  CHECK(packed_hashset.find(3) != packed_hashset.hend());
+
+  packed_hashset.remove(2);
+
+  CHECK(packed_hashset.size() == 2);
+  CHECK(!packed_hashset.has(2));
+  CHECK(std::distance(
+          packed_hashset.value_iteration().begin(),
+          packed_hashset.value_iteration().end())
+        == 2);
+}
+
+TEST_CASE("Packed hashset handles are invalidated after remove")
+{
+  thh::packed_hashset_t<std::string> packed_hashset;
+  const auto handle = packed_hashset.add({"one", {}}).first->second;
+  packed_hashset.remove("one");
+  const auto reused_handle = packed_hashset.add({"two", {}}).first->second;
+
+  CHECK(!packed_hashset.index_from_handle(handle).has_value());
+  CHECK(packed_hashset.index_from_handle(reused_handle).value() == 0);
+  CHECK(packed_hashset.handle_from_index(0) == reused_handle);
+}
+
+TEST_CASE("Packed hashset keys can be sorted by handle")
+{
+  thh::packed_hashset_t<int> packed_hashset;
+  for (int i = 0; i < 8; ++i) {
+    packed_hashset.add({i, {}});
+  }
+
+  std::vector<thh::packed_hashtable_handle_t> handles;
+  for (int32_t index = 0; index < packed_hashset.size(); ++index) {
+    handles.push_back(packed_hashset.handle_from_index(index));
+  }
+
+  // reverse dense order
+  packed_hashset.sort([](const int32_t lhs, const int32_t rhs) {
+    return lhs > rhs;
+  });
+
+  for (int32_t index = 0; index < packed_hashset.size(); ++index) {
+    CHECK(
+      packed_hashset.handle_from_index(index)
+      == handles[handles.size() - 1 - index]);
+  }
+}
+
+TEST_CASE("Values are preserved when storage grows and elements are removed")
+{
+  thh::packed_hashtable_t<int, std::string> packed_hashtable;
+  for (int i = 0; i < 100; ++i) {
+    packed_hashtable.add({i, std::to_string(i)});
+  }
+  for (int i = 0; i < 100; i += 3) {
+    packed_hashtable.remove(i);
+  }
+
+  CHECK(packed_hashtable.size() == 66);
+  for (int i = 0; i < 100; ++i) {
+    const auto value = packed_hashtable.call_return(
+      i, [](const std::string& value) { return value; });
+    CHECK(value.has_value() == (i % 3 != 0));
+    if (value.has_value()) {
+      CHECK(value.value() == std::to_string(i));
+    }
+  }
+}
+
+TEST_CASE("Handles resolve to the same values after sort")
+{
+  struct position_t
+  {
+    int x_;
+    int y_;
+  };
+
+  static_assert(thh::is_trivially_relocatable_v<position_t>);
+  static_assert(!thh::is_trivially_relocatable_v<std::string>);
+
+  thh::packed_hashtable_t<int, position_t> positions;
+  thh::packed_hashtable_t<int, std::string> names;
+  for (int i = 0; i < 16; ++i) {
+    positions.add({i, position_t{i, -i}});
+    names.add({i, std::to_string(i)});
+  }
+
+  // reverse dense order
+  const auto reverse = [](const int32_t lhs, const int32_t rhs) {
+    return lhs > rhs;
+  };
+  positions.sort(reverse);
+  names.sort(reverse);
+
+  CHECK(positions.vbegin()->x_ == 15);
+  CHECK(*names.vbegin() == "15");
+  for (int i = 0; i < 16; ++i) {
+    positions.call(i, [i](const position_t& position) {
+      CHECK(position.x_ == i);
+      CHECK(position.y_ == -i);
+    });
+    names.call(
+      i, [i](const std::string& name) { CHECK(name == std::to_string(i)); });
+  }
+}
+
+TEST_CASE("Values are destroyed on remove and clear")
+{
+  struct counted_t
+  {
+    int* live_;
+    explicit counted_t(int* live) : live_(live) { ++*live_; }
+    counted_t(const counted_t& other) : live_(other.live_) { ++*live_; }
+    ~counted_t() { --*live_; }
+  };
+
+  int live = 0;
+  {
+    thh::packed_hashtable_t<int, counted_t> packed_hashtable;
+    for (int i = 0; i < 10; ++i) {
+      packed_hashtable.add({i, counted_t(&live)});
+    }
+    CHECK(live == 10);
+    packed_hashtable.remove(4);
+    CHECK(live == 9);
+    packed_hashtable.partition(
+      [](const int32_t index) { return index % 2 == 0; });
+    CHECK(live == 9);
+    packed_hashtable.clear();
+    CHECK(live == 0);
+    packed_hashtable.add({1, counted_t(&live)});
+  }
+  CHECK(live == 0);
+}
+
+TEST_CASE("Packed hashtable allocates from a memory resource")
+{
+  std::array<std::byte, 16'384> buffer;
+  // all allocations must come from the buffer (no fallback to the heap)
+  std::pmr::monotonic_buffer_resource resource(
+    buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+
+  thh::pmr::packed_hashtable_rl_t<int, int> packed_hashtable_rl(&resource);
+  CHECK(packed_hashtable_rl.get_allocator().resource() == &resource);
+  for (int i = 0; i < 100; ++i) {
+    packed_hashtable_rl.add({i, i * 10});
+  }
+  packed_hashtable_rl.remove(50);
+  CHECK(packed_hashtable_rl.size() == 99);
+  CHECK(packed_hashtable_rl.key_from_handle(
+    packed_hashtable_rl.find(99)->second) == 99);
+  CHECK(
+    packed_hashtable_rl.call_return(10, [](const int value) { return value; })
+    == 100);
+
+  thh::pmr::packed_hashset_t<int> packed_hashset(&resource);
+  packed_hashset.add({1, {}});
+  CHECK(packed_hashset.has(1));
+}
+
+TEST_CASE("Packed hashtable copy and move preserve values with allocators")
+{
+  std::pmr::monotonic_buffer_resource first_resource;
+  std::pmr::monotonic_buffer_resource second_resource;
+
+  thh::pmr::packed_hashtable_t<int, std::string> first(&first_resource);
+  for (int i = 0; i < 10; ++i) {
+    first.add({i, std::to_string(i)});
+  }
+
+  // allocators are not propagated and differ, values are moved element-wise
+  thh::pmr::packed_hashtable_t<int, std::string> second(&second_resource);
+  second = std::move(first);
+  CHECK(second.get_allocator().resource() == &second_resource);
+  CHECK(second.size() == 10);
+  CHECK(
+    second.call_return(5, [](const std::string& value) { return value; })
+    == "5");
+
+  auto third = second;
+  third.remove(5);
+  CHECK(third.size() == 9);
+  CHECK(second.size() == 10);
+  CHECK(std::find(third.vbegin(), third.vend(), "5") == third.vend());
+}
+
+TEST_CASE("Packed hashtable rl copy and move rebind keys to handles")
+{
+  const auto check_keys = [](const auto& packed_hashtable_rl) {
+    for (int i = 0; i < 10; ++i) {
+      CHECK(
+        packed_hashtable_rl.key_from_handle(
+          packed_hashtable_rl.find(i)->second)
+        == i);
+    }
+  };
+
+  auto copy = [&check_keys] {
+    thh::packed_hashtable_rl_t<int, std::string> original;
+    for (int i = 0; i < 10; ++i) {
+      original.add({i, std::to_string(i)});
+    }
+    thh::packed_hashtable_rl_t<int, std::string> copy(original);
+    thh::packed_hashtable_rl_t<int, std::string> assigned;
+    assigned = original;
+    original.clear();
+    check_keys(assigned);
+    return copy;
+  }();
+  check_keys(copy);
+  CHECK(thh::remove_when(copy, [](const std::string& value) {
+          return value == "3";
+        }) == 1);
+  CHECK(!copy.has(3));
+
+  // allocators are not propagated and differ, the keys are moved to nodes of
+  // the second resource (the first resource is released)
+  std::pmr::monotonic_buffer_resource second_resource;
+  thh::pmr::packed_hashtable_rl_t<int, std::string> second(&second_resource);
+  {
+    std::pmr::monotonic_buffer_resource first_resource;
+    thh::pmr::packed_hashtable_rl_t<int, std::string> first(&first_resource);
+    for (int i = 0; i < 10; ++i) {
+      first.add({i, std::to_string(i)});
+    }
+    second = std::move(first);
+  }
+  check_keys(second);
+  CHECK(thh::remove_when(second, [](const std::string& value) {
+          return value == "5";
+        }) == 1);
+  CHECK(second.size() == 9);
+
+  // compact handles in the key index
+  thh::packed_hashtable_rl_t<
+    int, int, std::hash<int>, std::equal_to<int>, thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int, int>>, thh::compact_handle_policy_t<>>
+    compact;
+  for (int i = 0; i < 10; ++i) {
+    compact.add({i, i});
+  }
+  const auto compact_copy = compact;
+  compact.clear();
+  check_keys(compact_copy);
+
+  // the keys of a static key index are stored in the container
+  using static_packed_hashtable_rl_t = thh::packed_hashtable_rl_t<
+    int, int, std::hash<int>, std::equal_to<int>, thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int, int>>, thh::static_policy_t<16>>;
+  auto fixed = std::make_unique<static_packed_hashtable_rl_t>();
+  for (int i = 0; i < 10; ++i) {
+    fixed->add({i, i});
+  }
+  auto moved = std::make_unique<static_packed_hashtable_rl_t>(*fixed);
+  *moved = std::move(*fixed);
+  fixed.reset();
+  check_keys(*moved);
+  CHECK(thh::remove_when(*moved, [](const int value) { return value < 5; })
+        == 5);
+  CHECK(moved->size() == 5);
+}
+
+// packed hashtable using segmented storage with small chunks (4 values)
+template<typename Key, typename Value>
+using segmented_packed_hashtable_t = thh::packed_hashtable_t<
+  Key, Value, std::hash<Key>, std::equal_to<Key>, thh::packed_hashtable_tag_t,
+  std::allocator<std::pair<const Key, Value>>, thh::segmented_policy_t<4>>;
+
+TEST_CASE("Segmented storage does not move values when growing")
+{
+  segmented_packed_hashtable_t<int, std::string> packed_hashtable;
+  packed_hashtable.add({0, "0"});
+  const std::string* first = nullptr;
+  packed_hashtable.call(0, [&first](const std::string& value) {
+    first = &value;
+  });
+  for (int i = 1; i < 100; ++i) {
+    packed_hashtable.add({i, std::to_string(i)});
+  }
+  const std::string* first_after_growth = nullptr;
+  packed_hashtable.call(0, [&first_after_growth](const std::string& value) {
+    first_after_growth = &value;
+  });
+  CHECK(first == first_after_growth);
+  CHECK(
+    std::distance(packed_hashtable.vbegin(), packed_hashtable.vend()) == 100);
+}
+
+TEST_CASE("Segmented storage preserves values across chunks")
+{
+  segmented_packed_hashtable_t<int, std::string> packed_hashtable;
+  for (int i = 0; i < 37; ++i) {
+    packed_hashtable.add({i, std::to_string(i)});
+  }
+  for (int i = 0; i < 37; i += 3) {
+    packed_hashtable.remove(i);
+  }
+  CHECK(packed_hashtable.size() == 24);
+  for (int i = 0; i < 37; ++i) {
+    CHECK(packed_hashtable.has(i) == (i % 3 != 0));
+    if (i % 3 != 0) {
+      CHECK(
+        packed_hashtable.call_return(
+          i, [](const std::string& value) { return value; })
+        == std::to_string(i));
+    }
+  }
+
+  const auto descending = [](const std::string& lhs, const std::string& rhs) {
+    return std::stoi(lhs) > std::stoi(rhs);
+  };
+  packed_hashtable.sort([&](const int32_t lhs, const int32_t rhs) {
+    return descending(
+      *(packed_hashtable.vbegin() + lhs), *(packed_hashtable.vbegin() + rhs));
+  });
+  CHECK(std::is_sorted(
+    packed_hashtable.vbegin(), packed_hashtable.vend(), descending));
+  for (auto handle : packed_hashtable.handle_iteration()) {
+    CHECK(
+      packed_hashtable.call_return(
+        handle.second, [](const std::string& value) { return value; })
+      == std::to_string(handle.first));
+  }
+
+  auto copy = packed_hashtable;
+  packed_hashtable.clear();
+  CHECK(packed_hashtable.empty());
+  CHECK(copy.size() == 24);
+  CHECK(std::is_sorted(copy.vbegin(), copy.vend(), descending));
+}
+
+TEST_CASE("Incremental hash map finds keys while migrating")
+{
+  thh::incremental_hash_map_t<int, int> map;
+  bool migrated = false;
+  for (int i = 0; i < 1000; ++i) {
+    map.insert({i, i * 2});
+    if (map.migrating()) {
+      migrated = true;
+      // elements are split across the old and new tables
+      for (int key = 0; key <= i; ++key) {
+        const auto it = map.find(key);
+        REQUIRE(it != map.end());
+        CHECK(it->second == key * 2);
+      }
+    }
+  }
+  CHECK(migrated);
+
+  // iteration order is insertion order
+  int expected = 0;
+  for (const auto& [key, value] : map) {
+    CHECK(key == expected++);
+  }
+
+  for (int i = 0; i < 1000; i += 2) {
+    CHECK(map.erase(i) == 1);
+  }
+  CHECK(map.erase(0) == 0);
+  CHECK(map.size() == 500);
+  for (int i = 0; i < 1000; ++i) {
+    CHECK((map.find(i) != map.end()) == (i % 2 != 0));
+  }
+}
+
+TEST_CASE("Packed hashtable rl works with incremental rehash policy")
+{
+  thh::packed_hashtable_rl_t<
+    std::string, int, std::hash<std::string>, std::equal_to<std::string>,
+    thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const std::string, int>>,
+    thh::incremental_rehash_policy_t<1, thh::segmented_policy_t<8>>>
+    packed_hashtable_rl;
+  for (int i = 0; i < 500; ++i) {
+    packed_hashtable_rl.add({std::to_string(i), i});
+  }
+  // reverse lookup holds pointers to keys in the index, these must remain
+  // valid while the index grows
+  for (int i = 0; i < 500; ++i) {
+    CHECK(
+      packed_hashtable_rl.key_from_index(i)
+      == std::to_string(*(packed_hashtable_rl.vbegin() + i)));
+  }
+  const auto removed = thh::remove_when(
+    packed_hashtable_rl, [](const int value) { return value % 3 == 0; });
+  CHECK(removed == 167);
+  CHECK(packed_hashtable_rl.size() == 333);
+  CHECK(!packed_hashtable_rl.has("3"));
+  CHECK(packed_hashtable_rl.has("4"));
+}
+
+TEST_CASE("Packed hashtable shrink_to_fit keeps outstanding handles valid")
+{
+  thh::packed_hashtable_rl_t<int, std::string> packed_hashtable_rl;
+  std::vector<thh::packed_hashtable_handle_t> handles;
+  for (int i = 0; i < 1000; ++i) {
+    handles.push_back(
+      packed_hashtable_rl.add({i, std::to_string(i)}).first->second);
+  }
+  for (int i = 100; i < 1000; ++i) {
+    packed_hashtable_rl.remove(i);
+  }
+  CHECK(packed_hashtable_rl.capacity() == 1024);
+  packed_hashtable_rl.shrink_to_fit();
+  CHECK(packed_hashtable_rl.capacity() == 100);
+  CHECK(packed_hashtable_rl.size() == 100);
+  for (int i = 0; i < 100; ++i) {
+    CHECK(packed_hashtable_rl.key_from_handle(handles[i]) == i);
+    CHECK(
+      packed_hashtable_rl.call_return(
+        handles[i], [](const std::string& value) { return value; })
+      == std::to_string(i));
+  }
+  // released slots are reused but handles to removed elements stay invalid
+  for (int i = 1000; i < 2000; ++i) {
+    packed_hashtable_rl.add({i, std::to_string(i)});
+  }
+  for (int i = 100; i < 1000; ++i) {
+    CHECK(!packed_hashtable_rl.key_from_handle(handles[i]).has_value());
+  }
+  CHECK(packed_hashtable_rl.key_from_handle(handles[99]) == 99);
+}
+
+TEST_CASE("Packed hashtable rl iterates keys and values without copying")
+{
+  thh::packed_hashtable_rl_t<std::string, int> packed_hashtable_rl;
+  std::vector<thh::packed_hashtable_handle_t> handles;
+  for (int i = 0; i < 10; ++i) {
+    handles.push_back(
+      packed_hashtable_rl.add({std::to_string(i), i}).first->second);
+  }
+
+  // key pointers refer to the key stored in the key index
+  const std::string* key = packed_hashtable_rl.key_ptr_from_handle(handles[3]);
+  REQUIRE(key != nullptr);
+  CHECK(*key == "3");
+  CHECK(key == &packed_hashtable_rl.find("3")->first);
+  CHECK(packed_hashtable_rl.key_ptr_from_index(3) == key);
+  CHECK(packed_hashtable_rl.key_ptr_from_index(-1) == nullptr);
+  CHECK(packed_hashtable_rl.key_ptr_from_index(10) == nullptr);
+
+  for (auto [k, value] : packed_hashtable_rl.kv_iteration()) {
+    CHECK(k == std::to_string(value));
+    value *= 2;
+  }
+
+  CHECK(packed_hashtable_rl.remove(handles[3]));
+  CHECK(packed_hashtable_rl.key_ptr_from_handle(handles[3]) == nullptr);
+  CHECK(!packed_hashtable_rl.key_from_handle(handles[3]).has_value());
+  packed_hashtable_rl.remove(std::string("0"));
+  packed_hashtable_rl.sort([&packed_hashtable_rl](
+                             const int32_t lhs, const int32_t rhs) {
+    return *packed_hashtable_rl.key_ptr_from_index(lhs)
+         > *packed_hashtable_rl.key_ptr_from_index(rhs);
+  });
+
+  // keys follow their values after removal and sorting
+  std::vector<std::string> keys;
+  for (const auto& [k, value] :
+       std::as_const(packed_hashtable_rl).kv_iteration()) {
+    CHECK(std::stoi(k) * 2 == value);
+    keys.push_back(k);
+  }
+  CHECK(
+    keys
+    == std::vector<std::string>{"9", "8", "7", "6", "5", "4", "2", "1"});
+  CHECK(*packed_hashtable_rl.key_ptr_from_index(0) == "9");
+
+  thh::packed_hashtable_rl_t<
+    int, int, std::hash<int>, std::equal_to<int>, thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int, int>>, thh::compact_handle_policy_t<>>
+    compact;
+  for (int i = 0; i < 100; ++i) {
+    compact.add({i, i});
+  }
+  thh::remove_when(compact, [](const int value) { return value % 2 == 0; });
+  compact.shrink_to_fit();
+  int count = 0;
+  for (const auto& [k, value] : compact.kv_iteration()) {
+    CHECK(k == value);
+    CHECK(k % 2 == 1);
+    ++count;
+  }
+  CHECK(count == 50);
+}
+
+TEST_CASE("Packed hashtable rl iterates keys, handles and values densely")
+{
+  thh::packed_hashtable_rl_t<std::string, int> packed_hashtable_rl;
+  for (int i = 0; i < 20; ++i) {
+    packed_hashtable_rl.add({std::to_string(i), i});
+  }
+  thh::remove_when(
+    packed_hashtable_rl, [](const int value) { return value % 3 == 0; });
+
+  int32_t index = 0;
+  for (auto [key, handle, value] : packed_hashtable_rl.dense_iteration()) {
+    CHECK(key == std::to_string(value));
+    CHECK(packed_hashtable_rl.handle_from_index(index) == handle);
+    CHECK(packed_hashtable_rl.find(key)->second == handle);
+    CHECK(&value == &*(packed_hashtable_rl.vbegin() + index));
+    value *= 10;
+    ++index;
+  }
+  CHECK(index == 13);
+
+  for (const auto& [key, handle, value] :
+       std::as_const(packed_hashtable_rl).dense_iteration()) {
+    CHECK(
+      packed_hashtable_rl.call_return(
+        handle, [](const int element) { return element; })
+      == value);
+    CHECK(std::stoi(key) * 10 == value);
+  }
+}
+
+TEST_CASE("Packed hashtable remove_when marks removals in dense order")
+{
+  thh::packed_hashtable_t<
+    int, int, std::hash<int>, std::equal_to<int>, thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int, int>>, thh::compact_handle_policy_t<>>
+    packed_hashtable;
+  for (int i = 0; i < 100; ++i) {
+    packed_hashtable.add({i, i});
+  }
+  CHECK(
+    thh::remove_when(packed_hashtable, [](const int) { return false; })
+    == 0);
+  int calls = 0;
+  CHECK(thh::remove_when(packed_hashtable, [&calls](const int value) {
+          ++calls;
+          return value % 2 == 0;
+        }) == 50);
+  CHECK(calls == 100);
+  CHECK(packed_hashtable.size() == 50);
+  for (int i = 0; i < 100; ++i) {
+    CHECK(packed_hashtable.has(i) == (i % 2 == 1));
+  }
+}
+
+TEST_CASE("Packed hashtable gathers and visits values by handle list")
+{
+  thh::packed_hashtable_t<int, int> packed_hashtable;
+  std::vector<thh::packed_hashtable_handle_t> handles;
+  for (int i = 0; i < 100; ++i) {
+    handles.push_back(packed_hashtable.add({i, i}).first->second);
+  }
+  // shuffle the dense order so handle order and memory order differ
+  packed_hashtable.sort([](const int32_t lhs, const int32_t rhs) {
+    return lhs > rhs;
+  });
+  packed_hashtable.remove(50);
+
+  // the caller's order is kept, invalid handles are skipped
+  const std::vector<thh::packed_hashtable_handle_t> requested = {
+    handles[7], handles[50], handles[3], handles[99], handles[3]};
+  std::vector<int> gathered(requested.size(), -1);
+  CHECK(
+    packed_hashtable.gather(
+      requested.begin(), requested.end(), gathered.begin())
+    == 4);
+  CHECK(gathered == std::vector<int>{7, -1, 3, 99, 3});
+
+  // values are visited in memory order and given their position in the range
+  std::vector<int32_t> indices;
+  std::vector<std::size_t> positions;
+  CHECK(
+    packed_hashtable.for_each_handle(
+      requested.begin(), requested.end(),
+      [&](int& value, const std::size_t position) {
+        indices.push_back(
+          static_cast<int32_t>(&value - &*packed_hashtable.vbegin()));
+        positions.push_back(position);
+        value += 1000;
+      })
+    == 4);
+  CHECK(std::is_sorted(indices.begin(), indices.end()));
+  CHECK(positions == std::vector<std::size_t>{3, 0, 2, 4});
+  CHECK(
+    packed_hashtable.call_return(7, [](const int value) { return value; })
+    == 1007);
+  CHECK(
+    packed_hashtable.call_return(3, [](const int value) { return value; })
+    == 2003);
+
+  // handles covering most of the container are ordered with a counting sort
+  indices.clear();
+  CHECK(
+    packed_hashtable.for_each_handle(
+      handles.rbegin(), handles.rend(),
+      [&](const int& value, const std::size_t position) {
+        indices.push_back(
+          static_cast<int32_t>(&value - &*packed_hashtable.vbegin()));
+        CHECK(value % 1000 == 99 - static_cast<int>(position));
+      })
+    == 99);
+  CHECK(std::is_sorted(indices.begin(), indices.end()));
+}
+
+// memory resource tracking the number of bytes currently allocated
+class counting_resource_t : public std::pmr::memory_resource
+{
+  void* do_allocate(const std::size_t bytes, const std::size_t alignment)
+    override
+  {
+    allocated_ += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+  void do_deallocate(
+    void* memory, const std::size_t bytes,
+    const std::size_t alignment) override
+  {
+    allocated_ -= bytes;
+    std::pmr::new_delete_resource()->deallocate(memory, bytes, alignment);
+  }
+  bool do_is_equal(const memory_resource& other) const noexcept override
+  {
+    return this == &other;
+  }
+
+public:
+  std::size_t allocated_ = 0;
+};
+
+TEST_CASE("Packed hashtable compact releases memory in steps")
+{
+  counting_resource_t resource;
+  thh::pmr::packed_hashtable_rl_t<
+    int, int64_t, std::hash<int>, std::equal_to<int>,
+    thh::packed_hashtable_tag_t,
+    thh::incremental_rehash_policy_t<8, thh::segmented_policy_t<64>>>
+    packed_hashtable_rl(&resource);
+  for (int i = 0; i < 10'000; ++i) {
+    packed_hashtable_rl.add({i, i});
+  }
+  for (int i = 500; i < 10'000; ++i) {
+    packed_hashtable_rl.remove(i);
+  }
+  const auto before = resource.allocated_;
+  int calls = 1;
+  while (!packed_hashtable_rl.compact(1)) {
+    ++calls;
+  }
+  // the value storage, key index and reverse lookup are shrunk in turn
+  CHECK(calls == 3);
+  CHECK(resource.allocated_ < before / 4);
+  CHECK(packed_hashtable_rl.compact(1));
+  CHECK(packed_hashtable_rl.size() == 500);
+  for (int i = 0; i < 500; ++i) {
+    CHECK(packed_hashtable_rl.key_from_index(i).has_value());
+    CHECK(
+      packed_hashtable_rl.call_return(i, [](const int64_t value) {
+        return value;
+      }) == i);
+  }
+}
+
+#if __has_include(<sys/mman.h>)
+TEST_CASE("Packed hashtable snapshot preserves handles and values")
+{
+  const auto path =
+    (std::filesystem::temp_directory_path() / "thh-snapshot-test.bin")
+      .string();
+
+  thh::packed_hashtable_t<int, int64_t> packed_hashtable;
+  std::vector<thh::packed_hashtable_handle_t> handles;
+  for (int i = 0; i < 1000; ++i) {
+    handles.push_back(packed_hashtable.add({i, i * 10}).first->second);
+  }
+  for (int i = 0; i < 1000; i += 4) {
+    packed_hashtable.remove(i);
+  }
+  packed_hashtable.sort(
+    [&packed_hashtable](const int32_t lhs, const int32_t rhs) {
+      return *(packed_hashtable.vbegin() + lhs)
+           > *(packed_hashtable.vbegin() + rhs);
+    });
+  REQUIRE(thh::save_snapshot(packed_hashtable, path.c_str()));
+
+  using snapshot_t = thh::packed_hashtable_snapshot_t<int, int64_t>;
+  auto snapshot = snapshot_t::load_mmap(path.c_str());
+  REQUIRE(snapshot.has_value());
+  CHECK(snapshot->size() == 750);
+  CHECK(std::equal(
+    snapshot->vbegin(), snapshot->vend(), packed_hashtable.vbegin(),
+    packed_hashtable.vend()));
+  int64_t total = 0;
+  for (const int64_t value : std::as_const(*snapshot).value_iteration()) {
+    total += value;
+  }
+  CHECK(
+    total == std::accumulate(
+      packed_hashtable.vbegin(), packed_hashtable.vend(), int64_t(0)));
+  for (int i = 0; i < 1000; ++i) {
+    CHECK(snapshot->has(i) == (i % 4 != 0));
+    CHECK(snapshot->has(handles[i]) == (i % 4 != 0));
+    if (i % 4 != 0) {
+      CHECK(snapshot->find(i) == handles[i]);
+      CHECK(
+        snapshot->call_return(handles[i], [](const int64_t value) {
+          return value;
+        }) == i * 10);
+      CHECK(
+        snapshot->index_from_handle(handles[i])
+        == packed_hashtable.index_from_handle(handles[i]));
+    }
+  }
+  CHECK(!snapshot->has(1000));
+
+  // changes to a copy on write snapshot are not written back to the file
+  auto copy_on_write = thh::packed_hashtable_snapshot_t<
+    int, int64_t, std::hash<int>, std::equal_to<int>,
+    thh::packed_hashtable_tag_t,
+    thh::snapshot_access_e::copy_on_write>::load_mmap(path.c_str());
+  REQUIRE(copy_on_write.has_value());
+  copy_on_write->call(handles[1], [](int64_t& value) { value = -1; });
+  CHECK(
+    copy_on_write->call_return(1, [](const int64_t value) { return value; })
+    == -1);
+  CHECK(
+    snapshot->call_return(1, [](const int64_t value) { return value; })
+    == 10);
+
+  // snapshots of different types are rejected
+  CHECK(!thh::packed_hashtable_snapshot_t<int, int32_t>::load_mmap(
+           path.c_str())
+           .has_value());
+
+  // ids and positions out of range are rejected (instead of being read out
+  // of bounds)
+  const auto corrupt = [&path](const auto offset, const int32_t bytes) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    thh::snapshot_header_t header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    file.seekp(static_cast<std::streamoff>(header.*offset));
+    file.write(reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+  };
+  REQUIRE(thh::save_snapshot(packed_hashtable, path.c_str()));
+  corrupt(&thh::snapshot_header_t::dense_ids_offset_, 1'000'000);
+  CHECK(!snapshot_t::load_mmap(path.c_str()).has_value());
+  REQUIRE(thh::save_snapshot(packed_hashtable, path.c_str()));
+  corrupt(&thh::snapshot_header_t::slots_offset_, 1'000'000);
+  CHECK(!snapshot_t::load_mmap(path.c_str()).has_value());
+  REQUIRE(thh::save_snapshot(packed_hashtable, path.c_str()));
+  CHECK(snapshot_t::load_mmap(path.c_str()).has_value());
+  std::filesystem::remove(path);
+  CHECK(!snapshot_t::load_mmap(path.c_str()).has_value());
+}
+
+TEST_CASE("Packed hashtable snapshot skips values waiting for compaction")
+{
+  const auto path =
+    (std::filesystem::temp_directory_path() / "thh-snapshot-deferred-test.bin")
+      .string();
+
+  thh::packed_hashtable_t<
+    int, int64_t, std::hash<int>, std::equal_to<int>,
+    thh::packed_hashtable_tag_t, std::allocator<std::pair<const int, int64_t>>,
+    thh::deferred_removal_policy_t<>>
+    packed_hashtable;
+  std::vector<thh::packed_hashtable_handle_t> handles;
+  for (int i = 0; i < 8; ++i) {
+    handles.push_back(packed_hashtable.add({i, i * 10}).first->second);
+  }
+  packed_hashtable.remove(0);
+  packed_hashtable.remove(3);
+  REQUIRE(packed_hashtable.pending_removals() == 2);
+  REQUIRE(thh::save_snapshot(packed_hashtable, path.c_str()));
+
+  const auto snapshot =
+    thh::packed_hashtable_snapshot_t<int, int64_t>::load_mmap(path.c_str());
+  REQUIRE(snapshot.has_value());
+  CHECK(snapshot->size() == 6);
+  const std::vector<int64_t> values(snapshot->vbegin(), snapshot->vend());
+  CHECK(values == std::vector<int64_t>{10, 20, 40, 50, 60, 70});
+  for (int i = 0; i < 8; ++i) {
+    const auto removed = i == 0 || i == 3;
+    CHECK(snapshot->has(i) == !removed);
+    CHECK(snapshot->has(handles[i]) == !removed);
+    if (!removed) {
+      CHECK(
+        snapshot->call_return(handles[i], [](const int64_t value) {
+          return value;
+        }) == i * 10);
+    }
+  }
+  std::filesystem::remove(path);
+}
+#endif
+
+#if __has_include(<sys/mman.h>)
+// packed hashtable storing values in a memory mapped file
+template<typename Key, typename Value>
+using mapped_packed_hashtable_t = thh::packed_hashtable_t<
+  Key, Value, std::hash<Key>, std::equal_to<Key>, thh::packed_hashtable_tag_t,
+  std::allocator<std::pair<const Key, Value>>, thh::mapped_policy_t<>>;
+
+TEST_CASE("Mapped storage preserves values when growing and reordering")
+{
+  mapped_packed_hashtable_t<int, std::array<int, 3>> packed_hashtable;
+  std::vector<thh::packed_hashtable_handle_t> handles;
+  for (int i = 0; i < 5000; ++i) {
+    handles.push_back(
+      packed_hashtable.add({i, {i, i * 2, i * 3}}).first->second);
+  }
+  for (int i = 0; i < 5000; i += 2) {
+    packed_hashtable.remove(i);
+  }
+  packed_hashtable.sort(
+    [&packed_hashtable](const int32_t lhs, const int32_t rhs) {
+      return (*(packed_hashtable.vbegin() + lhs))[0]
+           > (*(packed_hashtable.vbegin() + rhs))[0];
+    });
+  CHECK(packed_hashtable.size() == 2500);
+  CHECK((*packed_hashtable.vbegin())[0] == 4999);
+  for (int i = 1; i < 5000; i += 2) {
+    CHECK(
+      packed_hashtable.call_return(
+        handles[i], [](const std::array<int, 3>& value) { return value[2]; })
+      == i * 3);
+  }
+
+  auto copy = packed_hashtable;
+  copy.call(1, [](std::array<int, 3>& value) { value[0] = -1; });
+  CHECK(
+    packed_hashtable.call_return(
+      1, [](const std::array<int, 3>& value) { return value[0]; })
+    == 1);
+
+  auto moved = std::move(copy);
+  moved.shrink_to_fit();
+  CHECK(moved.size() == 2500);
+  CHECK(
+    moved.call_return(
+      1, [](const std::array<int, 3>& value) { return value[0]; })
+    == -1);
+  // key 1 sorts last, all other values are unchanged
+  CHECK(std::equal(
+    moved.vbegin(), moved.vend() - 1, packed_hashtable.vbegin(),
+    packed_hashtable.vend() - 1));
+}
+#endif
+
+// packed hashtable recording changes in a journal
+template<typename Key, typename Value>
+using journaled_packed_hashtable_t = thh::packed_hashtable_t<
+  Key, Value, std::hash<Key>, std::equal_to<Key>, thh::packed_hashtable_tag_t,
+  std::allocator<std::pair<const Key, Value>>, thh::journaled_policy_t<>>;
+
+// returns the sorted key/value pairs in a packed hashtable
+template<typename PackedHashtable>
+std::vector<std::pair<int, int>> key_values(const PackedHashtable& table)
+{
+  std::vector<std::pair<int, int>> result;
+  for (const auto& key_handle : table.handle_iteration()) {
+    table.call(key_handle.second, [&](const int value) {
+      result.push_back({key_handle.first, value});
+    });
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+TEST_CASE("Replaying a journal mirrors the journaled packed hashtable")
+{
+  journaled_packed_hashtable_t<int, int> packed_hashtable;
+  thh::packed_hashtable_t<int, int> replica;
+  thh::journal_replayer_t<int, int, thh::packed_hashtable_tag_t> replayer;
+
+  std::vector<thh::packed_hashtable_handle_t> handles;
+  for (int i = 0; i < 100; ++i) {
+    handles.push_back(packed_hashtable.add({i, i}).first->second);
+  }
+  packed_hashtable.add_or_update({5, 50});
+  packed_hashtable.call(6, [](int& value) { value = 60; });
+  packed_hashtable.call(handles[7], [](int& value) { value = 70; });
+  packed_hashtable.remove(8);
+  *(packed_hashtable.vbegin() + 9) = 90;
+  packed_hashtable.record_update(packed_hashtable.handle_from_index(9));
+  // reading through a const table is not journaled
+  const auto bytes = packed_hashtable.journal().size_bytes();
+  std::as_const(packed_hashtable).call(10, [](const int) {});
+  CHECK(packed_hashtable.journal().size_bytes() == bytes);
+
+  // replay in two parts, the first ending part way through a record
+  const auto* data = packed_hashtable.journal().data();
+  const auto consumed = replayer.replay(data, bytes / 2 + 1, replica);
+  CHECK(consumed <= bytes / 2 + 1);
+  CHECK(
+    replayer.replay(data + consumed, bytes - consumed, replica)
+    == bytes - consumed);
+  CHECK(key_values(replica) == key_values(packed_hashtable));
+
+  // only changes since the last checkpoint need to be replayed
+  packed_hashtable.journal().clear();
+  packed_hashtable.remove(1);
+  packed_hashtable.add({1000, 1000});
+  packed_hashtable.add_or_update({1000, 1001});
+  CHECK(
+    packed_hashtable.journal().size_bytes()
+    == packed_hashtable.journal().record_size(thh::journal_op_e::remove)
+         + packed_hashtable.journal().record_size(thh::journal_op_e::add)
+         + packed_hashtable.journal().record_size(thh::journal_op_e::update));
+  replayer.replay(
+    packed_hashtable.journal().data(),
+    packed_hashtable.journal().size_bytes(), replica);
+  CHECK(key_values(replica) == key_values(packed_hashtable));
+
+  packed_hashtable.journal().clear();
+  packed_hashtable.clear();
+  packed_hashtable.add({1, 2});
+  replayer.replay(
+    packed_hashtable.journal().data(),
+    packed_hashtable.journal().size_bytes(), replica);
+  CHECK(key_values(replica) == std::vector<std::pair<int, int>>{{1, 2}});
+}
+
+TEST_CASE("Compacted and rebased journals replay to the same packed hashtable")
+{
+  journaled_packed_hashtable_t<int, int> packed_hashtable;
+  for (int i = 0; i < 100; ++i) {
+    packed_hashtable.add({i, i});
+  }
+  for (int i = 0; i < 100; i += 3) {
+    packed_hashtable.remove(i);
+  }
+  for (int i = 1; i < 100; i += 3) {
+    packed_hashtable.call(i, [](int& value) { value *= 10; });
+    packed_hashtable.call(i, [](int& value) { value += 1; });
+  }
+  // re-adding a removed key after a remove must stay ordered
+  packed_hashtable.add({0, -1});
+
+  const auto replay = [](const auto& journal) {
+    thh::packed_hashtable_t<int, int> replica;
+    thh::journal_replayer_t<int, int, thh::packed_hashtable_tag_t> replayer;
+    replayer.replay(journal.data(), journal.size_bytes(), replica);
+    return key_values(replica);
+  };
+
+  const auto bytes = packed_hashtable.journal().size_bytes();
+  packed_hashtable.journal().compact();
+  CHECK(packed_hashtable.journal().size_bytes() < bytes);
+  CHECK(replay(packed_hashtable.journal()) == key_values(packed_hashtable));
+
+  packed_hashtable.journal().rebase(packed_hashtable);
+  CHECK(
+    packed_hashtable.journal().size_bytes()
+    == packed_hashtable.journal().record_size(thh::journal_op_e::clear)
+         + packed_hashtable.journal().record_size(thh::journal_op_e::add)
+             * packed_hashtable.size());
+  CHECK(replay(packed_hashtable.journal()) == key_values(packed_hashtable));
+
+  // updates after rebasing are appended and collapsed by compact
+  packed_hashtable.call(1, [](int& value) { value = 7; });
+  packed_hashtable.remove(2);
+  packed_hashtable.journal().compact();
+  CHECK(replay(packed_hashtable.journal()) == key_values(packed_hashtable));
+
+  // records before a clear are discarded
+  packed_hashtable.clear();
+  packed_hashtable.add({3, 3});
+  packed_hashtable.journal().compact();
+  CHECK(
+    packed_hashtable.journal().size_bytes()
+    == packed_hashtable.journal().record_size(thh::journal_op_e::clear)
+         + packed_hashtable.journal().record_size(thh::journal_op_e::add));
+  CHECK(replay(packed_hashtable.journal()) == key_values(packed_hashtable));
+}
+
+#if __has_include(<sys/mman.h>)
+// packed hashtable tracking changes for incremental checkpoints
+template<typename Key, typename Value>
+using checkpointed_packed_hashtable_t = thh::packed_hashtable_t<
+  Key, Value, std::hash<Key>, std::equal_to<Key>, thh::packed_hashtable_tag_t,
+  std::allocator<std::pair<const Key, Value>>, thh::checkpointed_policy_t<>>;
+
+// checks a snapshot holds the same elements (and handles) as a table
+template<typename PackedHashtable>
+void check_checkpoint(const PackedHashtable& table, const std::string& path)
+{
+  const auto snapshot =
+    thh::packed_hashtable_snapshot_t<int, int>::load_mmap(path.c_str());
+  REQUIRE(snapshot.has_value());
+  CHECK(snapshot->size() == table.size());
+  CHECK(std::equal(
+    table.vbegin(), table.vend(), snapshot->vbegin(), snapshot->vend()));
+  for (const auto& key_handle : table.handle_iteration()) {
+    CHECK(snapshot->find(key_handle.first) == key_handle.second);
+    CHECK(
+      snapshot->call_return(key_handle.second, [](const int value) {
+        return value;
+      }) == table.call_return(key_handle.second, [](const int value) {
+        return value;
+      }));
+  }
+}
+
+TEST_CASE("Checkpoints only copy chunks changed since the last checkpoint")
+{
+  const auto path =
+    (std::filesystem::temp_directory_path() / "thh-checkpoint-test.bin")
+      .string();
+  checkpointed_packed_hashtable_t<int, int> packed_hashtable;
+  std::vector<thh::packed_hashtable_handle_t> handles;
+  for (int i = 0; i < 10000; ++i) {
+    handles.push_back(packed_hashtable.add({i, i}).first->second);
+  }
+  CHECK(thh::checkpoint_async(packed_hashtable, path.c_str()).get());
+  const auto full_bytes = packed_hashtable.journal().checkpoint_bytes();
+  check_checkpoint(packed_hashtable, path);
+
+  // a few changes copy a few chunks
+  packed_hashtable.call(5, [](int& value) { value = 50; });
+  packed_hashtable.call(handles[9000], [](int& value) { value = 90; });
+  packed_hashtable.remove(10);
+  packed_hashtable.add({10000, 10000});
+  const auto checkpoint = thh::checkpoint_async(packed_hashtable, path.c_str());
+  CHECK(packed_hashtable.journal().checkpoint_bytes() < full_bytes / 10);
+  // checkpoints are written in order
+  packed_hashtable.remove(20);
+  packed_hashtable.sort(0, 100, [&packed_hashtable](int lhs, int rhs) {
+    return *(packed_hashtable.vbegin() + lhs)
+         > *(packed_hashtable.vbegin() + rhs);
+  });
+  CHECK(thh::checkpoint_async(packed_hashtable, path.c_str()).get());
+  CHECK(checkpoint.get());
+  check_checkpoint(packed_hashtable, path);
+
+  // removals are written to the key index (keys are no longer found)
+  for (int i = 0; i < 10000; i += 2) {
+    packed_hashtable.remove(i);
+  }
+  CHECK(thh::checkpoint_async(packed_hashtable, path.c_str()).get());
+  check_checkpoint(packed_hashtable, path);
+  {
+    const auto snapshot =
+      thh::packed_hashtable_snapshot_t<int, int>::load_mmap(path.c_str());
+    REQUIRE(snapshot.has_value());
+    CHECK(!snapshot->has(2));
+    CHECK(!snapshot->has(handles[2]));
+    CHECK(snapshot->has(3));
+  }
+
+  // growing beyond the space in the file rewrites it
+  for (int i = 20000; i < 40000; ++i) {
+    packed_hashtable.add({i, i});
+  }
+  CHECK(thh::checkpoint_async(packed_hashtable, path.c_str()).get());
+  CHECK(packed_hashtable.journal().checkpoint_bytes() > full_bytes);
+  check_checkpoint(packed_hashtable, path);
+
+  packed_hashtable.clear();
+  packed_hashtable.add({1, 1});
+  CHECK(thh::checkpoint_async(packed_hashtable, path.c_str()).get());
+  check_checkpoint(packed_hashtable, path);
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Checkpoints compact values waiting for compaction")
+{
+  const auto path =
+    (std::filesystem::temp_directory_path() / "thh-checkpoint-deferred.bin")
+      .string();
+  thh::packed_hashtable_t<
+    int, int, std::hash<int>, std::equal_to<int>, thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int, int>>,
+    thh::checkpointed_policy_t<thh::deferred_removal_policy_t<>>>
+    packed_hashtable;
+  for (int i = 0; i < 10000; ++i) {
+    packed_hashtable.add({i, i});
+  }
+  CHECK(thh::checkpoint_async(packed_hashtable, path.c_str()).get());
+
+  // removed values are moved into from the end of the values when compacted
+  for (int i = 0; i < 10000; i += 100) {
+    packed_hashtable.remove(i);
+  }
+  packed_hashtable.add({10000, 10000});
+  CHECK(thh::checkpoint_async(packed_hashtable, path.c_str()).get());
+  CHECK(packed_hashtable.pending_removals() == 0);
+  check_checkpoint(packed_hashtable, path);
+  {
+    const auto snapshot =
+      thh::packed_hashtable_snapshot_t<int, int>::load_mmap(path.c_str());
+    REQUIRE(snapshot.has_value());
+    CHECK(!snapshot->has(100));
+    CHECK(snapshot->has(10000));
+  }
+  std::filesystem::remove(path);
+}
+#endif
+
+#if __has_include(<sys/mman.h>)
+TEST_CASE("Shared packed hashtable readers see changes made by the writer")
+{
+  const char* name = "/thh-shared-hashtable-test";
+  using shared_t = thh::shared_packed_hashtable_t<int, int64_t>;
+  using reader_t = thh::shared_packed_hashtable_reader_t<int, int64_t>;
+  shared_t::unlink(name);
+
+  auto writer = shared_t::create(name, 1000);
+  REQUIRE(writer.has_value());
+  CHECK(!shared_t::create(name, 1000).has_value());
+  std::vector<thh::packed_hashtable_handle_t> handles;
+  for (int i = 0; i < 1000; ++i) {
+    const auto handle = writer->add(i, i * 10);
+    REQUIRE(handle.has_value());
+    handles.push_back(*handle);
+  }
+  CHECK(!writer->add(1000, 0).has_value());
+  CHECK(!writer->add(0, 0).has_value());
+
+  auto reader = reader_t::open(name);
+  REQUIRE(reader.has_value());
+  CHECK(reader->size() == 1000);
+  for (int i = 0; i < 1000; i += 4) {
+    CHECK(writer->remove(i));
+  }
+  for (int i = 2; i < 1000; i += 4) {
+    CHECK(writer->remove(handles[i]));
+  }
+  CHECK(!writer->remove(handles[0]));
+  CHECK(reader->size() == 500);
+  for (int i = 0; i < 1000; ++i) {
+    const auto present = i % 2 != 0;
+    CHECK(reader->has(i) == present);
+    CHECK(reader->has(handles[i]) == present);
+    CHECK(writer->has(i) == present);
+    if (present) {
+      CHECK(reader->find(i) == handles[i]);
+      CHECK(reader->get(i) == i * 10);
+      CHECK(reader->get(handles[i]) == i * 10);
+    }
+  }
+  CHECK(writer->vend() - writer->vbegin() == 500);
+
+  // every change made by the writer is visible and bumps the version
+  const auto version = reader->version();
+  writer->call(1, [](int64_t& value) { value = -1; });
+  CHECK(reader->version() != version);
+  CHECK(
+    reader->call_return(1, [](const int64_t value) { return value * 2; })
+    == -2);
+  const auto handle = writer->add_or_update(2000, 5);
+  REQUIRE(handle.has_value());
+  CHECK(reader->get(*handle) == 5);
+  CHECK(writer->add_or_update(2000, 6) == handle);
+  CHECK(reader->get(2000) == 6);
+
+  // readers of different types are rejected
+  CHECK(!thh::shared_packed_hashtable_reader_t<int, int32_t>::open(name)
+           .has_value());
+
+  writer->clear();
+  CHECK(reader->empty());
+  CHECK(!reader->has(handles[1]));
+  CHECK(writer->add(1, 10).has_value());
+  CHECK(reader->get(1) == 10);
+
+  // the segment name is removed with the writer, mapped readers still work
+  writer.reset();
+  CHECK(!reader_t::open(name).has_value());
+  CHECK(reader->get(1) == 10);
+}
+#endif
+
+TEST_CASE("Frozen packed hashtable finds every key with one probe")
+{
+  thh::packed_hashtable_t<int, int64_t> packed_hashtable;
+  for (int i = 0; i < 1000; ++i) {
+    packed_hashtable.add({i * 7, i * 10});
+  }
+  for (int i = 0; i < 1000; i += 3) {
+    packed_hashtable.remove(i * 7);
+  }
+
+  const auto frozen = thh::freeze(packed_hashtable);
+  CHECK(frozen.size() == packed_hashtable.size());
+  // one 4 byte pilot per 2 keys
+  CHECK(frozen.hash_bytes() <= std::size_t(frozen.size()) * 2 + 8);
+  for (int i = 0; i < 7000; ++i) {
+    const auto present = i % 7 == 0 && (i / 7) % 3 != 0;
+    CHECK(frozen.has(i) == present);
+    if (present) {
+      const auto index = frozen.find(i);
+      REQUIRE(index.has_value());
+      CHECK(*(frozen.kbegin() + *index) == i);
+      CHECK(
+        frozen.call_return(i, [](const int64_t value) { return value; })
+        == (i / 7) * 10);
+    }
+  }
+  // keys and values are in the same order
+  for (int32_t index = 0; index < frozen.size(); ++index) {
+    CHECK(*(frozen.vbegin() + index) == *(frozen.kbegin() + index) / 7 * 10);
+  }
+
+  CHECK_THROWS_AS(
+    (thh::frozen_packed_hashtable_t<int, int>({1, 2, 1}, {0, 0, 0})),
+    std::invalid_argument);
+  const thh::frozen_packed_hashtable_t<int, int> empty({}, {});
+  CHECK(empty.empty());
+  CHECK(!empty.has(0));
+
+#if __has_include(<sys/mman.h>)
+  const auto path =
+    (std::filesystem::temp_directory_path() / "thh-frozen-test.bin").string();
+  REQUIRE(thh::save_snapshot(frozen, path.c_str()));
+  using frozen_t = thh::frozen_packed_hashtable_t<int, int64_t>;
+  const auto loaded = frozen_t::load_mmap(path.c_str());
+  REQUIRE(loaded.has_value());
+  CHECK(loaded->size() == frozen.size());
+  CHECK(std::equal(
+    loaded->vbegin(), loaded->vend(), frozen.vbegin(), frozen.vend()));
+  for (int i = 0; i < 7000; ++i) {
+    CHECK(loaded->find(i) == frozen.find(i));
+  }
+  CHECK(!thh::frozen_packed_hashtable_t<int, int32_t>::load_mmap(path.c_str())
+           .has_value());
+  CHECK(!thh::packed_hashtable_snapshot_t<int, int64_t>::load_mmap(
+           path.c_str())
+           .has_value());
+  std::filesystem::remove(path);
+#endif
+}
+
+TEST_CASE("Frozen packed hashtable finds keys with equal hashes")
+{
+  // every 4 consecutive keys share a hash
+  struct colliding_hash_t
+  {
+    std::size_t operator()(const int key) const
+    {
+      return static_cast<std::size_t>(key / 4);
+    }
+  };
+  using frozen_t = thh::frozen_packed_hashtable_t<int, int, colliding_hash_t>;
+  std::vector<int> keys;
+  std::vector<int> values;
+  for (int i = 0; i < 400; i += 2) {
+    keys.push_back(i);
+    values.push_back(i * 10);
+  }
+  const frozen_t frozen(keys, values);
+  CHECK(frozen.size() == 200);
+  for (int i = 0; i < 400; ++i) {
+    const auto index = frozen.find(i);
+    CHECK(index.has_value() == (i % 2 == 0));
+    if (index.has_value()) {
+      CHECK(*(frozen.kbegin() + *index) == i);
+      CHECK(*(frozen.vbegin() + *index) == i * 10);
+    }
+  }
+  CHECK(!frozen.has(-1));
+
+  // every key has the same hash
+  const frozen_t same({5, 3, 1, 2}, {50, 30, 10, 20});
+  for (const int key : {1, 2, 3, 5}) {
+    CHECK(
+      same.call_return(key, [](const int value) { return value; })
+      == key * 10);
+  }
+  CHECK(!same.has(0));
+  CHECK_THROWS_AS(frozen_t({1, 2, 1}, {0, 0, 0}), std::invalid_argument);
+
+#if __has_include(<sys/mman.h>)
+  const auto path =
+    (std::filesystem::temp_directory_path() / "thh-frozen-equal-hashes.bin")
+      .string();
+  REQUIRE(thh::save_snapshot(frozen, path.c_str()));
+  const auto loaded = frozen_t::load_mmap(path.c_str());
+  REQUIRE(loaded.has_value());
+  for (int i = 0; i < 400; ++i) {
+    CHECK(loaded->find(i) == frozen.find(i));
+  }
+  std::filesystem::remove(path);
+#endif
+}
+
+TEST_CASE("Static packed hashtable stores a fixed number of elements inline")
+{
+  using static_packed_hashtable_t =
+    thh::static_packed_hashtable_t<std::string, int, 64>;
+  static_packed_hashtable_t names;
+  CHECK(names.capacity() == 64);
+
+  for (int i = 0; i < 64; ++i) {
+    CHECK(names.add({std::to_string(i), i}).second);
+  }
+  // full, new keys are rejected (existing keys are still found)
+  const auto rejected = names.add({"64", 64});
+  CHECK(!rejected.second);
+  CHECK(rejected.first == names.hend());
+  CHECK(!names.add_or_update({"65", 65}).second);
+  CHECK(names.add_or_update({"10", 100}).first != names.hend());
+  CHECK(names.size() == 64);
+  CHECK(!names.has("64"));
+
+  const auto handle = names.find("20")->second;
+  for (int i = 0; i < 64; i += 2) {
+    names.remove(std::to_string(i));
+  }
+  CHECK(names.size() == 32);
+  CHECK(!names.has("20"));
+  CHECK(!names.call_return(handle, [](int value) { return value; }));
+  for (int i = 0; i < 64; ++i) {
+    CHECK(names.has(std::to_string(i)) == (i % 2 != 0));
+  }
+
+  // removed space is reused
+  for (int i = 64; i < 96; ++i) {
+    CHECK(names.add({std::to_string(i), i}).second);
+  }
+  CHECK(!names.add({"96", 96}).second);
+
+  names.sort([&names](const int32_t lhs, const int32_t rhs) {
+    return *(names.vbegin() + lhs) < *(names.vbegin() + rhs);
+  });
+  CHECK(std::is_sorted(names.vbegin(), names.vend()));
+  int count = 0;
+  for (const auto& [key, value_handle] : names.handle_iteration()) {
+    names.call(value_handle, [&key = key](const int value) {
+      CHECK(std::to_string(value) == key);
+    });
+    ++count;
+  }
+  CHECK(count == 64);
+
+  const auto copy = names;
+  names.clear();
+  CHECK(names.empty());
+  CHECK(copy.size() == 64);
+  CHECK(copy.call_return("95", [](const int value) { return value; }) == 95);
+  CHECK(std::is_sorted(copy.vbegin(), copy.vend()));
+}
+
+// allocator that cannot allocate (compiles only if nothing allocates)
+template<typename T>
+struct no_allocator_t
+{
+  using value_type = T;
+
+  no_allocator_t() = default;
+  template<typename U>
+  no_allocator_t(const no_allocator_t<U>&)
+  {
+  }
+
+  T* allocate(std::size_t) = delete;
+  void deallocate(T*, std::size_t) {}
+
+  template<typename U>
+  bool operator==(const no_allocator_t<U>&) const
+  {
+    return true;
+  }
+  template<typename U>
+  bool operator!=(const no_allocator_t<U>&) const
+  {
+    return false;
+  }
+};
+
+TEST_CASE("Static packed hashtable removes elements without an allocator")
+{
+  thh::packed_hashtable_t<
+    int, int, std::hash<int>, std::equal_to<int>, thh::packed_hashtable_tag_t,
+    no_allocator_t<std::pair<const int, int>>, thh::static_policy_t<16>>
+    fixed;
+  for (int i = 0; i < 10; ++i) {
+    fixed.add({i, i});
+  }
+  CHECK(
+    thh::remove_when(fixed, [](const int value) { return value % 2 == 0; })
+    == 5);
+  for (int i = 0; i < 10; ++i) {
+    CHECK(fixed.has(i) == (i % 2 != 0));
+  }
+}
+
+TEST_CASE("Compact handles store the id and generation in a single word")
+{
+  static_assert(sizeof(thh::compact_handle_t<int>) == 4);
+  static_assert(sizeof(thh::compact_handle_t<int, uint64_t, 31>) == 8);
+
+  using compact_packed_hashtable_t = thh::packed_hashtable_t<
+    std::string, int, std::hash<std::string>, std::equal_to<>,
+    thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const std::string, int>>,
+    thh::compact_handle_policy_t<>>;
+  compact_packed_hashtable_t numbers;
+  for (int i = 0; i < 100; ++i) {
+    numbers.add({std::to_string(i), i});
+  }
+  static_assert(
+    sizeof(numbers.find("0")->second) == sizeof(thh::compact_handle_t<int>));
+
+  const thh::typed_handle_t<thh::packed_hashtable_tag_t> handle =
+    numbers.find("42")->second;
+  CHECK(handle.id_ == 42);
+  CHECK(handle.gen_ == 0);
+  CHECK(numbers.call_return(handle, [](int value) { return value; }) == 42);
+
+  numbers.remove("42");
+  CHECK(!numbers.call_return(handle, [](int value) { return value; }));
+  // the slot is reused with the next generation
+  numbers.add({"100", 100});
+  const thh::typed_handle_t<thh::packed_hashtable_tag_t> reused =
+    numbers.find("100")->second;
+  CHECK(reused.id_ == 42);
+  CHECK(reused.gen_ == 1);
+  CHECK(!numbers.call_return(handle, [](int value) { return value; }));
+
+  // the 8 bit generation wraps after 256 removals
+  for (int i = 0; i < 255; ++i) {
+    numbers.remove("100");
+    numbers.add({"100", 100});
+  }
+  const thh::typed_handle_t<thh::packed_hashtable_tag_t> wrapped =
+    numbers.find("100")->second;
+  CHECK(wrapped.id_ == 42);
+  CHECK(wrapped.gen_ == 0);
+
+  thh::remove_when(numbers, [](int value) { return value % 2 == 0; });
+  CHECK(numbers.size() == 50);
+  for (int i = 1; i < 100; i += 2) {
+    CHECK(
+      numbers.call_return(std::to_string(i), [](int value) {
+        return value;
+      }) == i);
+  }
+  numbers.shrink_to_fit();
+  numbers.add({"200", 200});
+  CHECK(numbers.size() == 51);
+  CHECK(numbers.has("200"));
+
+  // composes with other policies (compact_handle_policy_t is innermost)
+  thh::packed_hashtable_rl_t<
+    int, std::string, std::hash<int>, std::equal_to<>,
+    thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int, std::string>>,
+    thh::segmented_policy_t<4, thh::compact_handle_policy_t<uint64_t, 31>>>
+    names;
+  for (int i = 0; i < 20; ++i) {
+    names.add({i, std::to_string(i)});
+  }
+  names.remove(names.handle_from_index(0));
+  CHECK(names.size() == 19);
+  CHECK(!names.has(0));
+  for (int i = 0; i < names.size(); ++i) {
+    const auto key = names.key_from_index(i);
+    REQUIRE(key);
+    CHECK(*(names.vbegin() + i) == std::to_string(*key));
+  }
+}
+
+TEST_CASE("Wide size policy uses 64 bit handles and sizes")
+{
+  using wide_packed_hashtable_t = thh::packed_hashtable_rl_t<
+    int64_t, std::string, std::hash<int64_t>, std::equal_to<>,
+    thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int64_t, std::string>>,
+    thh::wide_size_policy_t<>>;
+  static_assert(std::is_same_v<wide_packed_hashtable_t::size_type, int64_t>);
+  static_assert(std::is_same_v<
+                wide_packed_hashtable_t::handle_type,
+                thh::wide_handle_t<thh::packed_hashtable_tag_t>>);
+  static_assert(
+    std::is_same_v<thh::packed_hashtable_t<int, int>::size_type, int32_t>);
+
+  wide_packed_hashtable_t numbers;
+  numbers.reserve(64);
+  CHECK(numbers.capacity() == 64);
+  for (int64_t i = 0; i < 100; ++i) {
+    numbers.add({i, std::to_string(i)});
+  }
+  CHECK(numbers.size() == 100);
+
+  const auto handle = numbers.find(42)->second;
+  CHECK(numbers.index_from_handle(handle) == 42);
+  CHECK(numbers.key_from_handle(handle) == 42);
+  CHECK(numbers.handle_from_index(42) == handle);
+  CHECK(numbers.remove(handle));
+  CHECK(!numbers.call_return(handle, [](const std::string& value) {
+    return value;
+  }));
+
+  CHECK(thh::remove_when(numbers, [](const std::string& value) {
+          return std::stoll(value) % 2 == 0;
+        }) == 49);
+  numbers.sort([&numbers](const int64_t lhs, const int64_t rhs) {
+    return *numbers.key_from_index(lhs) < *numbers.key_from_index(rhs);
+  });
+  int64_t expected = 1;
+  for (const auto& value : numbers.value_iteration()) {
+    CHECK(value == std::to_string(expected));
+    expected += 2;
+  }
+
+  thh::packed_hashset_t<
+    int64_t, std::hash<int64_t>, std::equal_to<>, thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int64_t, thh::empty_value_t>>,
+    thh::segmented_policy_t<0, thh::wide_size_policy_t<>>>
+    keys;
+  for (int64_t i = 0; i < 10; ++i) {
+    keys.add({i, {}});
+  }
+  CHECK(keys.partition([](int64_t index) { return index < 4; }) == 4);
+  CHECK(keys.size() == 10);
+}
+
+// needs roughly 150GB of memory, run with --no-skip on a large machine
+TEST_CASE(
+  "Wide size policy stores more than 2^31 elements" * doctest::skip())
+{
+  using wide_packed_hashtable_t = thh::packed_hashtable_t<
+    int64_t, int32_t, std::hash<int64_t>, std::equal_to<>,
+    thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int64_t, int32_t>>,
+    thh::wide_size_policy_t<>>;
+  const int64_t count = (int64_t(1) << 31) + 16;
+
+  wide_packed_hashtable_t numbers;
+  numbers.reserve(count);
+  for (int64_t i = 0; i < count; ++i) {
+    numbers.add({i, static_cast<int32_t>(i)});
+  }
+  REQUIRE(numbers.size() == count);
+
+  const int64_t last = count - 1;
+  const auto handle = numbers.find(last)->second;
+  CHECK(handle.id_ == last);
+  CHECK(numbers.index_from_handle(handle) == last);
+  CHECK(numbers.handle_from_index(last) == handle);
+  CHECK(
+    numbers.call_return(handle, [](int32_t value) { return value; })
+    == static_cast<int32_t>(last));
+
+  // removing an early element moves the last element into its position
+  numbers.remove(0);
+  CHECK(numbers.size() == count - 1);
+  CHECK(numbers.index_from_handle(handle) == 0);
+  numbers.sort(count - 17, count - 1, [&numbers](int64_t lhs, int64_t rhs) {
+    return *(numbers.vbegin() + lhs) > *(numbers.vbegin() + rhs);
+  });
+  CHECK(std::is_sorted(
+    numbers.vbegin() + (count - 17), numbers.vend(), std::greater<>()));
+}
+
+TEST_CASE("Packed hashtable reorders values by key")
+{
+  thh::packed_hashtable_t<int, int> packed_hashtable;
+  std::vector<std::pair<thh::packed_hashtable_handle_t, int>> handles;
+  for (const int key : {5, -3, 12, 0, -40, 7, 1000, -1}) {
+    handles.emplace_back(
+      packed_hashtable.add({key, key * 2}).first->second, key * 2);
+  }
+  packed_hashtable.reorder_by_key();
+  CHECK(std::is_sorted(packed_hashtable.vbegin(), packed_hashtable.vend()));
+  CHECK(*packed_hashtable.vbegin() == -80);
+  // handles are unaffected by the reorder
+  for (const auto& [handle, expected] : handles) {
+    CHECK(
+      packed_hashtable.call_return(
+        handle, [](const int value) { return value; })
+      == expected);
+  }
+
+  // typed_handle_t keys are ordered by id then generation
+  using entity_handle_t = thh::typed_handle_t<struct entity_tag_t>;
+  thh::packed_hashtable_t<
+    entity_handle_t, int, thh::typed_handle_hash_t<struct entity_tag_t>>
+    components;
+  for (const int id : {300, 2, 70000, 41, 5}) {
+    components.add({entity_handle_t{id, 1}, id});
+  }
+  components.add({entity_handle_t{41, 0}, 40});
+  components.reorder_by_key();
+  CHECK(std::is_sorted(components.vbegin(), components.vend()));
+
+  // other keys are compared with operator<
+  thh::packed_hashtable_rl_t<std::string, int> named;
+  for (const auto* name : {"pear", "apple", "fig", "banana"}) {
+    named.add({name, static_cast<int>(named.size())});
+  }
+  named.reorder_by_key();
+  std::vector<std::string> keys;
+  for (const auto& [key, value] : named.kv_iteration()) {
+    keys.push_back(key);
+  }
+  CHECK(keys == std::vector<std::string>{"apple", "banana", "fig", "pear"});
+  CHECK(named.call_return("fig", [](const int value) { return value; }) == 2);
+
+  // fixed capacity tables sort in place
+  thh::static_packed_hashtable_t<int, int, 16> fixed;
+  std::vector<std::pair<thh::packed_hashtable_handle_t, int>> fixed_handles;
+  for (const int key : {9, -2, 4, 15, 0, -7}) {
+    fixed_handles.emplace_back(fixed.add({key, key}).first->second, key);
+  }
+  fixed.reorder_by_key();
+  CHECK(std::is_sorted(fixed.vbegin(), fixed.vend()));
+  for (const auto& [handle, expected] : fixed_handles) {
+    CHECK(
+      fixed.call_return(handle, [](const int value) { return value; })
+      == expected);
+  }
+  thh::static_packed_hashtable_t<std::string, int, 16> fixed_named;
+  fixed_named.add({"pear", 3});
+  fixed_named.add({"apple", 0});
+  fixed_named.remove("pear");
+  fixed_named.add({"fig", 2});
+  fixed_named.add({"pear", 3});
+  fixed_named.add({"banana", 1});
+  fixed_named.reorder_by_key();
+  CHECK(
+    std::vector<int>(fixed_named.vbegin(), fixed_named.vend())
+    == std::vector<int>{0, 1, 2, 3});
+  CHECK(
+    fixed_named.call_return("fig", [](const int value) { return value; })
+    == 2);
+}
+
+TEST_CASE("Packed hashtable reorders values by sampled lookups")
+{
+  thh::packed_hashtable_t<
+    int, int, std::hash<int>, std::equal_to<int>, thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int, int>>, thh::hotness_policy_t<1>>
+    packed_hashtable;
+  for (int i = 0; i < 100; ++i) {
+    packed_hashtable.add({i, i});
+  }
+  // keys 90 to 99 are looked up most, 99 most of all
+  for (int i = 90; i < 100; ++i) {
+    for (int lookup = 0; lookup < i - 80; ++lookup) {
+      packed_hashtable.call(i, [](int&) {});
+    }
+  }
+  CHECK(std::as_const(packed_hashtable).find(50) != packed_hashtable.hend());
+  packed_hashtable.reorder_by_hotness();
+  const std::vector<int> front(
+    packed_hashtable.vbegin(), packed_hashtable.vbegin() + 11);
+  CHECK(front == std::vector<int>{99, 98, 97, 96, 95, 94, 93, 92, 91, 90, 50});
+  // values that were not looked up keep their relative order
+  CHECK(
+    std::is_sorted(packed_hashtable.vbegin() + 11, packed_hashtable.vend()));
+  for (int i = 0; i < 100; ++i) {
+    CHECK(
+      packed_hashtable.call_return(i, [](const int value) { return value; })
+      == i);
+  }
+
+  // a new element reusing the handle id of a removed one starts from zero
+  packed_hashtable.remove(99);
+  packed_hashtable.add({200, 200});
+  packed_hashtable.reorder_by_hotness();
+  CHECK(*packed_hashtable.vbegin() == 98);
+  CHECK(*(packed_hashtable.vend() - 1) == 200);
+}
+
+TEST_CASE("Packed hashtable defers removals during iteration")
+{
+  thh::packed_hashtable_t<
+    int, int, std::hash<int>, std::equal_to<int>, thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int, int>>,
+    thh::deferred_removal_policy_t<>>
+    packed_hashtable;
+  std::vector<thh::packed_hashtable_handle_t> handles;
+  for (int i = 0; i < 100; ++i) {
+    handles.push_back(packed_hashtable.add({i, i}).first->second);
+  }
+
+  // remove the current value while iterating, nothing moves
+  int visited = 0;
+  for (const int value : packed_hashtable.value_iteration()) {
+    if (value % 2 == 0) {
+      packed_hashtable.remove(value);
+    }
+    ++visited;
+  }
+  CHECK(visited == 100);
+  CHECK(packed_hashtable.size() == 50);
+  CHECK(packed_hashtable.pending_removals() == 50);
+  CHECK(packed_hashtable.vend() - packed_hashtable.vbegin() == 100);
+  CHECK(packed_hashtable.tombstoned(0));
+  CHECK(!packed_hashtable.tombstoned(1));
+  CHECK(!packed_hashtable.has(4));
+  CHECK(
+    !packed_hashtable
+       .call_return(handles[4], [](const int value) { return value; })
+       .has_value());
+  // handles of removed values are invalid before compaction
+  CHECK(!packed_hashtable.index_from_handle(handles[4]).has_value());
+  CHECK(packed_hashtable.index_from_handle(handles[5]) == 5);
+  int sum = 0;
+  for (const int value : std::as_const(packed_hashtable).value_iteration()) {
+    CHECK(value % 2 == 1);
+    sum += value;
+  }
+  CHECK(sum == 2500);
+
+  // a removed key can be added again before compaction
+  const auto readded = packed_hashtable.add({4, 400}).first->second;
+  CHECK(packed_hashtable.size() == 51);
+
+  packed_hashtable.compact_removals(thh::compaction_order_e::preserve);
+  CHECK(packed_hashtable.pending_removals() == 0);
+  CHECK(packed_hashtable.vend() - packed_hashtable.vbegin() == 51);
+  // insertion order is kept
+  CHECK(std::is_sorted(packed_hashtable.vbegin(), packed_hashtable.vend()));
+  CHECK(*(packed_hashtable.vend() - 1) == 400);
+  for (int i = 1; i < 100; i += 2) {
+    CHECK(
+      packed_hashtable.call_return(
+        handles[i], [](const int value) { return value; })
+      == i);
+  }
+  CHECK(
+    packed_hashtable.call_return(readded, [](const int value) { return value; })
+    == 400);
+
+  // swap compaction moves the last values into the holes
+  CHECK(thh::remove_when(packed_hashtable, [](const int value) {
+          return value < 50;
+        }) == 25);
+  packed_hashtable.compact_removals();
+  CHECK(packed_hashtable.size() == 26);
+  CHECK(packed_hashtable.vend() - packed_hashtable.vbegin() == 26);
+  CHECK(std::all_of(
+    packed_hashtable.vbegin(), packed_hashtable.vend(),
+    [](const int value) { return value >= 50; }));
+}
+
+TEST_CASE("Packed hashtable rl defers removals during iteration")
+{
+  thh::packed_hashtable_rl_t<
+    std::string, int, std::hash<std::string>, std::equal_to<std::string>,
+    thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const std::string, int>>,
+    thh::deferred_removal_policy_t<>>
+    packed_hashtable_rl;
+  for (int i = 0; i < 10; ++i) {
+    packed_hashtable_rl.add({std::to_string(i), i});
+  }
+  for (const auto& [key, handle, value] :
+       packed_hashtable_rl.dense_iteration()) {
+    if (value % 3 == 0) {
+      CHECK(packed_hashtable_rl.remove(handle));
+      CHECK(!packed_hashtable_rl.remove(handle));
+    }
+  }
+  CHECK(packed_hashtable_rl.size() == 6);
+  CHECK(packed_hashtable_rl.key_ptr_from_index(0) == nullptr);
+  CHECK(*packed_hashtable_rl.key_ptr_from_index(1) == "1");
+  std::vector<std::string> keys;
+  for (const auto& [key, value] :
+       std::as_const(packed_hashtable_rl).kv_iteration()) {
+    keys.push_back(key);
+  }
+  CHECK(keys == std::vector<std::string>{"1", "2", "4", "5", "7", "8"});
+
+  CHECK(thh::remove_when(packed_hashtable_rl, [](const int value) {
+          return value > 6;
+        }) == 2);
+  packed_hashtable_rl.compact_removals();
+  CHECK(packed_hashtable_rl.vend() - packed_hashtable_rl.vbegin() == 4);
+  for (const auto& [key, value] : packed_hashtable_rl.kv_iteration()) {
+    CHECK(std::stoi(key) == value);
+  }
+}
+
+TEST_CASE("Packed hashtable visits values changed since a version")
+{
+  thh::packed_hashtable_t<
+    int, int, std::hash<int>, std::equal_to<int>, thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int, int>>, thh::change_tracking_policy_t<>>
+    packed_hashtable;
+  std::vector<thh::packed_hashtable_handle_t> handles;
+  for (int i = 0; i < 200; ++i) {
+    handles.push_back(packed_hashtable.add({i, i}).first->second);
+  }
+  const auto changed_since = [&packed_hashtable](const uint64_t version) {
+    std::vector<int> changed;
+    packed_hashtable.for_each_changed_since(
+      version,
+      [&](const int value, const thh::packed_hashtable_handle_t handle) {
+        CHECK(
+          packed_hashtable.call_return(
+            handle, [](const int element) { return element; })
+          == value);
+        changed.push_back(value);
+      });
+    std::sort(changed.begin(), changed.end());
+    return changed;
+  };
+  CHECK(changed_since(0).size() == 200);
+
+  const auto version = packed_hashtable.version();
+  CHECK(changed_since(version).empty());
+  packed_hashtable.call(3, [](int& value) { value += 1000; });
+  packed_hashtable.call(handles[150], [](int& value) { value += 1000; });
+  packed_hashtable.add_or_update({199, 1199});
+  packed_hashtable.add({500, 500});
+  std::as_const(packed_hashtable).call(7, [](const int) {});
+  CHECK(changed_since(version) == std::vector<int>{500, 1003, 1150, 1199});
+
+  // stamps move with the values (swap and pop, sort and partition)
+  packed_hashtable.remove(0);
+  packed_hashtable.remove(3);
+  CHECK(changed_since(version) == std::vector<int>{500, 1150, 1199});
+  packed_hashtable.sort([&packed_hashtable](const int lhs, const int rhs) {
+    return *(packed_hashtable.vbegin() + lhs)
+         > *(packed_hashtable.vbegin() + rhs);
+  });
+  CHECK(changed_since(version) == std::vector<int>{500, 1150, 1199});
+  packed_hashtable.partition([&packed_hashtable](const int index) {
+    return *(packed_hashtable.vbegin() + index) % 2 == 0;
+  });
+  CHECK(changed_since(version) == std::vector<int>{500, 1150, 1199});
+  packed_hashtable.reorder_by_key();
+  CHECK(changed_since(version) == std::vector<int>{500, 1150, 1199});
+
+  // values modified through raw value iterators are reported once recorded
+  const auto later = packed_hashtable.version();
+  *packed_hashtable.vbegin() += 1;
+  CHECK(changed_since(later).empty());
+  packed_hashtable.record_update(packed_hashtable.handle_from_index(0));
+  CHECK(changed_since(later) == std::vector<int>{*packed_hashtable.vbegin()});
+
+  // values dereferenced through mutable value iteration are reported
+  const auto iterated = packed_hashtable.version();
+  int sum = 0;
+  for (const int value : std::as_const(packed_hashtable).value_iteration()) {
+    sum += value;
+  }
+  CHECK(sum > 0);
+  CHECK(changed_since(iterated).empty());
+  auto value_it = packed_hashtable.value_iteration().begin();
+  ++value_it;
+  *value_it += 1;
+  CHECK(changed_since(iterated) == std::vector<int>{*value_it});
+  for (int& value : packed_hashtable.value_iteration()) {
+    value += 1;
+  }
+  CHECK(
+    changed_since(iterated).size()
+    == static_cast<std::size_t>(packed_hashtable.size()));
+
+  packed_hashtable.clear();
+  CHECK(changed_since(0).empty());
+  CHECK(packed_hashtable.version() > later);
+}
+
+TEST_CASE("Packed hashtable tracks changes with deferred removals")
+{
+  thh::packed_hashtable_t<
+    int, int, std::hash<int>, std::equal_to<int>, thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int, int>>,
+    thh::change_tracking_policy_t<thh::deferred_removal_policy_t<>>>
+    packed_hashtable;
+  for (int i = 0; i < 10; ++i) {
+    packed_hashtable.add({i, i});
+  }
+  const auto version = packed_hashtable.version();
+  // read through const iteration so only the calls below stamp values
+  for (const int value : std::as_const(packed_hashtable).value_iteration()) {
+    if (value < 5) {
+      packed_hashtable.remove(value);
+    } else if (value % 2 == 0) {
+      packed_hashtable.call(value, [](int& element) { element *= 10; });
+    }
+  }
+  std::vector<int> changed;
+  const auto collect = [&changed](const int value, auto) {
+    changed.push_back(value);
+  };
+  CHECK(packed_hashtable.for_each_changed_since(version, collect) == 2);
+  packed_hashtable.compact_removals();
+  changed.clear();
+  CHECK(packed_hashtable.for_each_changed_since(version, collect) == 2);
+  std::sort(changed.begin(), changed.end());
+  CHECK(changed == std::vector<int>{60, 80});
+  changed.clear();
+  CHECK(packed_hashtable.for_each_changed_since(0, collect) == 5);
+
+  // mutable iteration skips removed values and stamps the rest
+  const auto iterated = packed_hashtable.version();
+  packed_hashtable.remove(6);
+  for (int& value : packed_hashtable.value_iteration()) {
+    value += 1;
+  }
+  CHECK(packed_hashtable.for_each_changed_since(iterated, collect) == 4);
+}
+
+TEST_CASE("Packed hashtable tracks changes through key value iteration")
+{
+  thh::packed_hashtable_rl_t<
+    std::string, int, std::hash<std::string>, std::equal_to<std::string>,
+    thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const std::string, int>>,
+    thh::change_tracking_policy_t<>>
+    packed_hashtable_rl;
+  for (int i = 0; i < 4; ++i) {
+    packed_hashtable_rl.add({std::to_string(i), i});
+  }
+  const auto count_changed = [&packed_hashtable_rl](const uint64_t version) {
+    return packed_hashtable_rl.for_each_changed_since(
+      version, [](const int, auto) {});
+  };
+  const auto version = packed_hashtable_rl.version();
+  for (const auto& [key, value] :
+       std::as_const(packed_hashtable_rl).kv_iteration()) {
+    CHECK(std::stoi(key) == value);
+  }
+  CHECK(count_changed(version) == 0);
+  for (auto [key, value] : packed_hashtable_rl.kv_iteration()) {
+    if (key == "2") {
+      value += 10;
+    }
+  }
+  CHECK(count_changed(version) == 4);
+  const auto later = packed_hashtable_rl.version();
+  auto element_it = packed_hashtable_rl.dense_iteration().begin();
+  (*element_it).value_ += 10;
+  CHECK(count_changed(later) == 1);
+}
+
+TEST_CASE("Packed hashtable delivers add and remove events in batches")
+{
+  using packed_hashtable_observed_t = thh::packed_hashtable_rl_t<
+    int, int, std::hash<int>, std::equal_to<int>, thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int, int>>, thh::observed_policy_t<>>;
+  using event_t = packed_hashtable_observed_t::observer_type::event_type;
+  packed_hashtable_observed_t packed_hashtable;
+
+  std::vector<event_t> delivered;
+  const auto deliver = [&delivered](const event_t* first, const event_t* last) {
+    CHECK(first != last);
+    delivered.assign(first, last);
+  };
+
+  const auto first = packed_hashtable.add({1, 10}).first->second;
+  const auto second = packed_hashtable.add_or_update({2, 20}).first->second;
+  packed_hashtable.add_or_update({2, 21});
+  packed_hashtable.add({1, 11});
+  packed_hashtable.remove(1);
+  packed_hashtable.remove(first);
+  packed_hashtable.remove(42);
+  CHECK(packed_hashtable.observer().size() == 3);
+  packed_hashtable.deliver_events(deliver);
+  REQUIRE(delivered.size() == 3);
+  CHECK(delivered[0].event_ == thh::observer_event_e::add);
+  CHECK(delivered[0].handle_ == first);
+  CHECK(delivered[1].event_ == thh::observer_event_e::add);
+  CHECK(delivered[1].handle_ == second);
+  CHECK(delivered[2].event_ == thh::observer_event_e::remove);
+  CHECK(delivered[2].handle_ == first);
+
+  // nothing is delivered until there are new events
+  delivered.clear();
+  packed_hashtable.deliver_events(deliver);
+  CHECK(delivered.empty());
+
+  // clear supersedes the events before it
+  packed_hashtable.add({3, 30});
+  packed_hashtable.clear();
+  packed_hashtable.add({4, 40});
+  packed_hashtable.deliver_events(deliver);
+  REQUIRE(delivered.size() == 2);
+  CHECK(delivered[0].event_ == thh::observer_event_e::clear);
+  CHECK(delivered[1].event_ == thh::observer_event_e::add);
+
+  // without an observer delivery does nothing
+  thh::packed_hashtable_t<int, int> unobserved;
+  unobserved.add({1, 1});
+  unobserved.deliver_events([](auto, auto) { CHECK(false); });
+  static_assert(!decltype(unobserved)::observer_type::enabled_v);
+}
+
+TEST_CASE("Packed hashtable noop policies take no space")
+{
+  using default_policies_t =
+    thh::packed_hashtable_policies_t<thh::packed_hashtable_policy_types_t<
+      int, int, std::hash<int>, thh::packed_hashtable_tag_t,
+      std::allocator<std::pair<const int, int>>,
+      thh::packed_hashtable_policy_t>>;
+  static_assert(std::is_empty_v<default_policies_t>);
+
+  // a policy with state is held as a data member
+  using packed_hashtable_filtered_t = thh::packed_hashtable_t<
+    int, int, std::hash<int>, std::equal_to<int>, thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int, int>>, thh::key_filter_policy_t<>>;
+  static_assert(
+    sizeof(packed_hashtable_filtered_t)
+    > sizeof(thh::packed_hashtable_t<int, int>));
+}
+
+TEST_CASE("Packed hashtable rejects missing keys with a key filter")
+{
+  using packed_hashtable_filtered_t = thh::packed_hashtable_rl_t<
+    int, int, std::hash<int>, std::equal_to<int>, thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int, int>>, thh::key_filter_policy_t<>>;
+  packed_hashtable_filtered_t packed_hashtable;
+  thh::packed_hashtable_rl_t<int, int> unfiltered;
+  static_assert(packed_hashtable_filtered_t::key_filter_type::enabled_v);
+  static_assert(!decltype(unfiltered)::key_filter_type::enabled_v);
+
+  // an empty container rejects every key
+  CHECK(!packed_hashtable.key_filter().may_contain(1));
+  CHECK(!packed_hashtable.has(1));
+  CHECK(packed_hashtable.find(1) == packed_hashtable.hend());
+
+  // adds, updates and removes (the filter is rebuilt as it fills up) agree
+  // with a container without a filter
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> keys(0, 3999);
+  for (int i = 0; i < 20000; ++i) {
+    const int key = keys(generator);
+    switch (i % 5) {
+      case 0:
+      case 1:
+        packed_hashtable.add({key, i});
+        unfiltered.add({key, i});
+        break;
+      case 2:
+        packed_hashtable.add_or_update({key, i});
+        unfiltered.add_or_update({key, i});
+        break;
+      case 3:
+        packed_hashtable.remove(key);
+        unfiltered.remove(key);
+        break;
+      case 4:
+        if (const auto found = unfiltered.find(key);
+            found != unfiltered.hend()) {
+          packed_hashtable.remove(packed_hashtable.find(key)->second);
+          unfiltered.remove(found);
+        }
+        break;
+    }
+  }
+  REQUIRE(packed_hashtable.size() == unfiltered.size());
+  for (int key = 0; key < 4000; ++key) {
+    CHECK(packed_hashtable.has(key) == unfiltered.has(key));
+    CHECK(
+      packed_hashtable.call_return(key, [](const int value) { return value; })
+      == unfiltered.call_return(key, [](const int value) { return value; }));
+  }
+  for (const auto& [key, value] : unfiltered.kv_iteration()) {
+    CHECK(packed_hashtable.key_filter().may_contain(key));
+  }
+
+  // most keys never added are rejected by the filter alone
+  const auto rejected = [&packed_hashtable] {
+    int rejected = 0;
+    for (int key = 4000; key < 14000; ++key) {
+      rejected += packed_hashtable.key_filter().may_contain(key) ? 0 : 1;
+      CHECK(!packed_hashtable.has(key));
+    }
+    return rejected;
+  };
+  CHECK(rejected() > 9800);
+
+  // shrink_to_fit rebuilds the filter without the removed keys
+  packed_hashtable.shrink_to_fit();
+  CHECK(rejected() > 9800);
+  for (const auto& [key, value] : unfiltered.kv_iteration()) {
+    CHECK(packed_hashtable.has(key));
+  }
+
+  packed_hashtable.clear();
+  CHECK(!packed_hashtable.key_filter().may_contain(keys(generator)));
+  packed_hashtable.add({1, 1});
+  CHECK(packed_hashtable.has(1));
+  CHECK(!packed_hashtable.has(2));
+}
+
+TEST_CASE("Packed cache evicts unreferenced elements with a clock")
+{
+  thh::packed_cache_t<int, int> packed_cache(3);
+  CHECK(packed_cache.add_or_update({1, 10}).second);
+  CHECK(packed_cache.add_or_update({2, 20}).second);
+  CHECK(packed_cache.add_or_update({3, 30}).second);
+  CHECK(packed_cache.size() == 3);
+
+  // a found element survives the next sweep
+  REQUIRE(packed_cache.find(1) != nullptr);
+  CHECK(*packed_cache.find(1) == 10);
+  CHECK(packed_cache.referenced(0));
+  CHECK(packed_cache.add_or_update({4, 40}).second);
+  CHECK(packed_cache.size() == 3);
+  CHECK(packed_cache.evictions() == 1);
+  CHECK(packed_cache.has(1));
+  CHECK(!packed_cache.has(2));
+  CHECK(packed_cache.has(3));
+  CHECK(packed_cache.has(4));
+  // the sweep cleared the reference bit
+  CHECK(!packed_cache.referenced(0));
+
+  // updating an existing key does not evict and marks it referenced
+  const auto [handle, added] = packed_cache.add_or_update({3, 31});
+  CHECK(!added);
+  CHECK(packed_cache.evictions() == 1);
+  REQUIRE(packed_cache.peek(3) != nullptr);
+  CHECK(*packed_cache.peek(3) == 31);
+  CHECK(packed_cache.table().index_from_handle(handle).has_value());
+
+  // the hand passes 3 (referenced) and evicts 4, peek and has do not mark
+  CHECK(*packed_cache.peek(4) == 40);
+  packed_cache.add_or_update({5, 50});
+  CHECK(packed_cache.has(1));
+  CHECK(packed_cache.has(3));
+  CHECK(!packed_cache.has(4));
+  CHECK(packed_cache.has(5));
+
+  // reference bits follow the values moved by swap and pop
+  CHECK(packed_cache.find(5) != nullptr);
+  CHECK(packed_cache.remove(1));
+  CHECK(!packed_cache.remove(1));
+  CHECK(packed_cache.referenced(0));
+  CHECK(packed_cache.size() == 2);
+  for (int index = 0; index < packed_cache.size(); ++index) {
+    const auto* key = packed_cache.table().key_ptr_from_index(index);
+    REQUIRE(key != nullptr);
+    CHECK(packed_cache.peek(*key) != nullptr);
+  }
+
+  packed_cache.clear();
+  CHECK(packed_cache.empty());
+  CHECK(packed_cache.evictions() == 0);
+  CHECK(!packed_cache.evict());
+  CHECK(packed_cache.max_size() == 3);
+
+  // a byte budget is converted to a maximum size
+  const auto budget = thh::packed_cache_t<int, int>::with_byte_budget(
+    thh::packed_cache_t<int, int>::element_bytes_v * 10);
+  CHECK(budget.max_size() == 10);
+  auto empty_cache = thh::packed_cache_t<int, int>::with_byte_budget(0);
+  CHECK(!empty_cache.add_or_update({1, 1}).second);
+  CHECK(empty_cache.empty());
+}
+
+TEST_CASE("Packed cache keeps the maximum size with many keys")
+{
+  thh::packed_cache_t<int, int> packed_cache(16);
+  int hits = 0;
+  for (int i = 0; i < 1000; ++i) {
+    // every other lookup is a hot key, the rest are all new
+    const int key = i % 2 == 0 ? i % 8 : 1000 + i;
+    if (const auto* value = packed_cache.find(key)) {
+      CHECK(*value == key);
+      ++hits;
+    } else {
+      packed_cache.add_or_update({key, key});
+    }
+    CHECK(packed_cache.size() <= 16);
+  }
+  // the hot keys stay cached once they have been referenced
+  CHECK(hits > 450);
+  for (int key = 0; key < 8; key += 2) {
+    CHECK(packed_cache.has(key));
+  }
+}
+
+TEST_CASE("Timing wheel expires handles in deadline order")
+{
+  using handle_t = thh::typed_handle_t<struct wheel_tag_t>;
+  thh::timing_wheel_t<handle_t> wheel;
+
+  // deadlines at every level and beyond the top level (2^24 ticks)
+  const std::vector<uint64_t> deadlines = {
+    1, 5, 63, 64, 65, 1000, 4095, 4096, 300'000, 20'000'000, 40'000'000};
+  for (std::size_t i = 0; i < deadlines.size(); ++i) {
+    wheel.schedule(handle_t{int32_t(i), 0}, deadlines[i]);
+  }
+  CHECK(wheel.deadline(handle_t{2, 0}) == 63);
+  CHECK(wheel.deadline(handle_t{2, 1}) == 0);
+
+  std::vector<uint64_t> expired;
+  const auto collect = [&wheel, &expired](const handle_t handle) {
+    expired.push_back(uint64_t(handle.id_));
+    CHECK(wheel.deadline(handle) == 0);
+  };
+  CHECK(wheel.advance(0, collect) == 0);
+  CHECK(wheel.advance(64, collect) == 4);
+  CHECK(wheel.now() == 64);
+  CHECK(expired == std::vector<uint64_t>{0, 1, 2, 3});
+
+  // a cancelled or rescheduled handle only expires at its new deadline
+  wheel.cancel(handle_t{5, 0});
+  wheel.schedule(handle_t{4, 0}, 5000);
+  expired.clear();
+  CHECK(wheel.advance(4096, collect) == 2);
+  CHECK(expired == std::vector<uint64_t>{6, 7});
+
+  // deadlines in the past expire on the next advance
+  wheel.schedule(handle_t{0, 1}, 10);
+  CHECK(wheel.deadline(handle_t{0, 1}) == 4097);
+  expired.clear();
+  CHECK(wheel.advance(50'000'000, collect) == 5);
+  CHECK(expired == std::vector<uint64_t>{0, 4, 8, 9, 10});
+  CHECK(wheel.now() == 50'000'000);
+
+  // compare with the deadlines of many random handles
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<uint64_t> ttl(0, 1 << 20);
+  std::vector<uint64_t> expected(1000);
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    expected[i] = wheel.now() + 1 + ttl(generator);
+    wheel.schedule(handle_t{int32_t(i), 2}, expected[i]);
+  }
+  const auto start = wheel.now();
+  for (uint64_t now = start; now < start + (1 << 21);) {
+    now += 777;
+    wheel.advance(now, [&expected, now](const handle_t handle) {
+      auto& deadline = expected[std::size_t(handle.id_)];
+      CHECK(deadline <= now);
+      CHECK(deadline > now - 777);
+      deadline = 0;
+    });
+  }
+  CHECK(std::all_of(expected.begin(), expected.end(), [](uint64_t deadline) {
+    return deadline == 0;
+  }));
+}
+
+TEST_CASE("Expiring packed hashtable removes elements past their deadline")
+{
+  thh::expiring_packed_hashtable_t<int, int> packed_hashtable;
+  const auto first = packed_hashtable.add({1, 10}, 100).first->second;
+  packed_hashtable.add({2, 20}, 200);
+  packed_hashtable.add({3, 30}, 300);
+  const auto forever = packed_hashtable.table().add({4, 40}).first->second;
+  CHECK(!packed_hashtable.add({1, 11}, 1000).second);
+  CHECK(packed_hashtable.deadline(first) == 100);
+  CHECK(!packed_hashtable.deadline(forever));
+
+  CHECK(packed_hashtable.expire(99) == 0);
+  CHECK(packed_hashtable.expire(150) == 1);
+  CHECK(!packed_hashtable.table().has(1));
+  CHECK(!packed_hashtable.deadline(first));
+  CHECK(packed_hashtable.size() == 3);
+  // removals are compacted in the same call
+  CHECK(packed_hashtable.table().pending_removals() == 0);
+
+  // add_or_update and expire_after replace the time to live
+  CHECK(!packed_hashtable.add_or_update({2, 21}, 500).second);
+  const auto third = packed_hashtable.table().find(3)->second;
+  CHECK(packed_hashtable.expire_after(third, 1000));
+  CHECK(packed_hashtable.expire_after(forever, 10));
+  packed_hashtable.persist(forever);
+  CHECK(packed_hashtable.expire(400) == 0);
+  CHECK(packed_hashtable.now() == 400);
+
+  // elements removed through the table are skipped (and have no time to
+  // live before they are compacted)
+  const auto second = packed_hashtable.table().find(2)->second;
+  packed_hashtable.table().remove(2);
+  CHECK(packed_hashtable.table().pending_removals() == 1);
+  CHECK(!packed_hashtable.deadline(second));
+  CHECK(!packed_hashtable.expire_after(second, 10));
+  CHECK(packed_hashtable.expire(1000) == 0);
+  CHECK(packed_hashtable.expire(1150) == 1);
+  CHECK(packed_hashtable.size() == 1);
+  CHECK(packed_hashtable.table().has(4));
+  CHECK(!packed_hashtable.expire_after(first, 10));
+
+  packed_hashtable.add({5, 50}, 10);
+  packed_hashtable.clear();
+  CHECK(packed_hashtable.empty());
+  CHECK(packed_hashtable.expire(2000) == 0);
+
+  // without deferred removals each element is removed immediately
+  thh::expiring_packed_hashtable_t<
+    int, int, std::hash<int>, std::equal_to<int>, thh::packed_hashtable_tag_t,
+    std::allocator<std::pair<const int, int>>, thh::packed_hashtable_policy_t>
+    immediate;
+  for (int i = 0; i < 100; ++i) {
+    immediate.add({i, i}, uint64_t(i % 10));
+  }
+  CHECK(immediate.expire(4) == 50);
+  CHECK(immediate.size() == 50);
+  for (const auto& [key, value] : immediate.table().kv_iteration()) {
+    CHECK(key == value);
+    CHECK(key % 10 >= 5);
+  }
+}